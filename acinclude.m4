@@ -237,6 +237,12 @@ dnl			else
 			],[
 				AC_MSG_WARN([Could not find libugpio, not building hd44780-gpio driver])
 			])
+			AC_CHECK_DECL([GPIO_V2_LINE_SET_VALUES_IOCTL],[
+				HD44780_DRIVERS="$HD44780_DRIVERS hd44780-hd44780-gpiochip.o"
+				AC_DEFINE(HAVE_GPIO_CDEV_V2, [1], [Define to 1 if you have the GPIO character device v2 interface])
+			],[
+				AC_MSG_WARN([No GPIO character device v2 interface, not building hd44780-gpiochip driver])
+			],[#include <linux/gpio.h>])
 			if test "$ac_cv_port_have_lpt" = yes ; then
 				HD44780_DRIVERS="$HD44780_DRIVERS hd44780-hd44780-4bit.o hd44780-hd44780-ext8bit.o hd44780-hd44780-winamp.o hd44780-hd44780-serialLpt.o hd44780-hd44780-lcm162.o"
 			fi
@@ -258,7 +264,7 @@ dnl			else
 				HD44780_I2C=""
 			fi
 			if test "$x_ac_have_spi" = yes; then
-				HD44780_DRIVERS="$HD44780_DRIVERS hd44780-hd44780-spi.o hd44780-hd44780-pifacecad.o"
+				HD44780_DRIVERS="$HD44780_DRIVERS hd44780-hd44780-spi.o hd44780-hd44780-pifacecad.o hd44780-hd44780-spiburst.o"
 			fi
 dnl			The hd4470-rpi driver only works on a Raspberry Pi,
 dnl			which is an ARM platform. Require people to compile on
@@ -21,13 +21,15 @@
 #include <time.h>
 #include <sys/wait.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
 
 #include "getopt.h"
 
 #include "shared/str.h"
 #include "shared/report.h"
 #include "shared/configfile.h"
-#include "shared/sockets.h"
+#include "shared/lcdclient.h"
 
 #include "menu.h"
 
@@ -42,6 +44,12 @@
 #define DEFAULT_CONFIGFILE	SYSCONFDIR "/lcdexec.conf"
 #define DEFAULT_PIDFILE		PIDFILEDIR "/lcdexec.pid"
 
+/** Interval (in s) to send an empty line to check the server still exists */
+#define KEEPALIVE_INTERVAL	3
+
+#define OUTPUT_LINES		4	/**< number of output lines kept per process */
+#define OUTPUT_LINE_LEN		80	/**< max. length of a kept output line */
+
 
 /** information about a process started by lcdexec */
 typedef struct ProcInfo {
@@ -53,6 +61,12 @@ typedef struct ProcInfo {
 	int status;		/**< exit status of the process */
 	int feedback;		/**< what info to show to the user */
 	int shown;		/**< tell if the info has been shown to the user */
+	int outfd;		/**< read end of the output pipe (-1 if not captured) */
+	int outscreen;		/**< tell if the output screen has been created */
+	int outchanged;		/**< tell if output arrived since the last update */
+	int outline;		/**< index of the output line being filled */
+	int outpos;		/**< fill position in the current output line */
+	char output[OUTPUT_LINES][OUTPUT_LINE_LEN+1];	/**< ring of the last output lines */
 } ProcInfo;
 
 
@@ -65,7 +79,7 @@ char * help_text =
 "Usage: lcdexec [<options>]\n"
 "  where <options> are:\n"
 "    -c <file>           Specify configuration file ["DEFAULT_CONFIGFILE"]\n"
-"    -a <address>        DNS name or IP address of the LCDd server [localhost]\n"
+"    -a <address>        DNS name, IP address or Unix socket of the LCDd server [localhost]\n"
 "    -p <port>           port of the LCDd server [13666]\n"
 "    -f                  Run in foreground\n"
 "    -r <level>          Set reporting level (0-5) [2: errors and warnings]\n"
@@ -95,7 +109,10 @@ ProcInfo *proc_queue = NULL;	/**< pointer to the list of executed processes */
 int lcd_wid = 0;		/**< LCD display width reported by the server */
 int lcd_hgt = 0;		/**< LCD display height reported by the server */
 
-int sock = -1;			/**< socket to connect to server */
+LcdcConnection *conn = NULL;	/**< connection to the server */
+
+/** self-pipe to wake up the main loop when a child terminates */
+static int sigchld_pipe[2] = { -1, -1 };
 
 int Quit = 0;			/**< indicate end of main loop */
 
@@ -106,9 +123,13 @@ static void sigchld_handler(int signal);
 static int process_command_line(int argc, char **argv);
 static int process_configfile(char * configfile);
 static int connect_and_setup(void);
-static int process_response(char *str);
+static void server_event(LcdcConnection *c, int argc, char **argv, void *data);
 static int exec_command(MenuEntry *cmd);
 static int show_procinfo_msg(ProcInfo *p);
+static void reap_children(void);
+static void read_output(ProcInfo *p);
+static void show_output(ProcInfo *p);
+static void process_procs(void);
 static int main_loop(void);
 
 
@@ -169,6 +190,15 @@ int main(int argc, char **argv)
 	sigaction(SIGKILL, &sa, NULL);	// kill -9 [cannot be trapped; but ...]
 
 	/* setup signal handler for children to avoid zombies */
+	if (pipe(sigchld_pipe) < 0) {
+		report(RPT_ERR, "Could not create pipe: %s", strerror(errno));
+		return(EXIT_FAILURE);
+	}
+	fcntl(sigchld_pipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(sigchld_pipe[1], F_SETFL, O_NONBLOCK);
+	fcntl(sigchld_pipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(sigchld_pipe[1], F_SETFD, FD_CLOEXEC);
+
 	sigemptyset(&sa.sa_mask);
 	sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
 	sa.sa_handler = sigchld_handler;
@@ -187,21 +217,36 @@ static void exit_program(int val)
 {
 	//printf("exit program\n");
 	Quit = 1;
-	sock_close(sock);
+	lcdc_close(conn);
 	if ((foreground != TRUE) && (pidfile != NULL) && (pidfile_written == TRUE))
 		unlink(pidfile);
 	exit(val);
 }
 
 
-/* the grim reaper ;-) */
+/**
+ * Signal handler for SIGCHLD. Only wakes up the main loop, which reaps the
+ * children outside of signal context.
+ */
 static void sigchld_handler(int signal)
+{
+	int saved_errno = errno;
+
+	if (write(sigchld_pipe[1], "", 1) < 0) {
+		; /* pipe full: the main loop is going to wake up anyway */
+	}
+	errno = saved_errno;
+}
+
+
+/* the grim reaper ;-) */
+static void reap_children(void)
 {
 	pid_t pid;
 	int status;
 
-	/* wait for the child that was signalled as finished */
-	if ((pid = wait(&status)) != -1) {
+	/* wait for all children that have finished */
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
 		ProcInfo *p;
 
 		/* fill the procinfo structure with the necessary information */
@@ -353,46 +398,49 @@ static int connect_and_setup(void)
 {
 	report(RPT_INFO, "Connecting to %s:%d", address, port);
 
-	sock = sock_connect(address, port);
-	if (sock < 0) {
+	conn = lcdc_connect(address, port);
+	if (conn == NULL) {
 		return -1;
 	}
+	lcdc_set_handler(conn, server_event, NULL);
 
 	/* init connection and set client name */
-	sock_send_string(sock, "hello\n");
+	if (lcdc_hello(conn, 5000) < 0) {
+		return -1;
+	}
+	lcd_wid = conn->wid;
+	lcd_hgt = conn->hgt;
+
 	if (displayname != NULL) {
-		sock_printf(sock, "client_set -name {%s}\n", displayname);
+		lcdc_printf(conn, "client_set -name {%s}\n", displayname);
 	}
 	else {
 		struct utsname unamebuf;
 
 		if (uname(&unamebuf) == 0)
-			sock_printf(sock, "client_set -name {%s %s}\n", progname, unamebuf.nodename);
+			lcdc_printf(conn, "client_set -name {%s %s}\n", progname, unamebuf.nodename);
 		else
-			sock_printf(sock, "client_set -name {%s}\n", progname);
+			lcdc_printf(conn, "client_set -name {%s}\n", progname);
 	}
 
 	/* Create our menu */
-	if (menu_sock_send(main_menu, NULL, sock) < 0) {
+	if (menu_sock_send(main_menu, NULL, conn) < 0) {
 		return -1;
 	}
 
-	return 0;
+	return lcdc_flush(conn);
 }
 
 
-static int process_response(char *str)
+/**
+ * Handle a message of the server that is not a reply to a command.
+ * \param c     Connection to the server.
+ * \param argc  Number of words of the message.
+ * \param argv  Words of the message.
+ * \param data  Unused.
+ */
+static void server_event(LcdcConnection *c, int argc, char **argv, void *data)
 {
-	char *argv[20];
-	int argc;
-
-	debug(RPT_DEBUG, "Server said: \"%s\"", str);
-
-	/* Check what the server just said to us... */
-	argc = get_args(argv, str, sizeof(argv)/sizeof(argv[0]));
-	if (argc < 1)
-		return 0;
-
 	if (strcmp(argv[0], "menuevent") == 0) {
 		/* Ah, this is what we were waiting for ! */
 
@@ -410,7 +458,7 @@ static int process_response(char *str)
 			entry = menu_find_by_id(main_menu, atoi(argv[2]));
 			if (entry == NULL) {
 				report(RPT_WARNING, "Could not find the item id given by the server");
-				return -1;
+				return;
 			}
 
 			/* The id has been found.
@@ -440,7 +488,7 @@ static int process_response(char *str)
 			entry = menu_find_by_id(main_menu, atoi(argv[2]));
 			if (entry == NULL) {
 				report(RPT_WARNING, "Could not find the item id given by the server");
-				return -1;
+				return;
 			}
 
 			switch (entry->type) {
@@ -474,41 +522,25 @@ static int process_response(char *str)
 					break;
 				default:
 					report(RPT_WARNING, "Illegal menu entry type for event");
-					return -1;
+					return;
 			}
 		}
 		else {
 			; /* Ignore other menuevents */
 		}
 	}
-	else if (strcmp(argv[0], "connect") == 0) {
-		int a;
-
-		/* determine display height and width */
-		for (a = 1; a < argc; a++) {
-			if (strcmp(argv[a], "wid") == 0)
-				lcd_wid = atoi(argv[++a]);
-			else if (strcmp(argv[a], "hgt") == 0)
-				lcd_hgt = atoi(argv[++a]);
-		}
-	}
 	else if (strcmp(argv[0], "bye") == 0) {
 		// TODO: make it better
-		report(RPT_INFO, "Server said: \"%s\"", str);
+		report(RPT_INFO, "Server said: \"%s\"", argv[0]);
 		exit_program(EXIT_SUCCESS);
 	}
-	else if (strcmp(argv[0], "huh?") == 0) {
-		/* Report errors */
-		report(RPT_WARNING, "Server said: \"%s\"", str);
-	}
 	else {
-		; /* Ignore all other responses */
+		; /* Ignore all other messages */
 	}
-	return 0;
+	return;
 
 err_invalid:
 	report(RPT_WARNING, "Server gave invalid response");
-	return -1;
 }
 
 
@@ -522,6 +554,7 @@ static int exec_command(MenuEntry *cmd)
 		char *envp[cmd->numChildren+1];
 		MenuEntry *arg;
 		int i;
+		int outpipe[2] = { -1, -1 };
 
 		/* set argument vector */
 		argv[0] = default_shell;
@@ -575,9 +608,21 @@ static int exec_command(MenuEntry *cmd)
 
 		debug(RPT_DEBUG, "Executing '%s' via Shell %s", command, default_shell);
 
+		/* capture stdout & stderr of the command if requested */
+		if ((cmd->data.exec.show_output) && (pipe(outpipe) < 0)) {
+			report(RPT_WARNING, "Could not create pipe: %s", strerror(errno));
+			outpipe[0] = outpipe[1] = -1;
+		}
+
 		switch (pid = fork()) {
 		  case 0:
 			/* We're the child: execute the command */
+			if (outpipe[1] >= 0) {
+				dup2(outpipe[1], STDOUT_FILENO);
+				dup2(outpipe[1], STDERR_FILENO);
+				close(outpipe[0]);
+				close(outpipe[1]);
+			}
 			execve(argv[0], (char **) argv, envp);
 			exit(EXIT_SUCCESS);
 			break;
@@ -589,13 +634,28 @@ static int exec_command(MenuEntry *cmd)
 				p->pid = pid;
 				p->starttime = time(NULL);
 				p->feedback = cmd->data.exec.feedback;
-				/* prepend it to existing queue atomically */
+				p->outfd = outpipe[0];
+				/* prepend it to existing queue */
 				p->next = proc_queue;
 				proc_queue = p;
 			}
+			else if (outpipe[0] >= 0) {
+				close(outpipe[0]);
+			}
+			if (outpipe[1] >= 0) {
+				close(outpipe[1]);
+				if (p != NULL) {
+					fcntl(p->outfd, F_SETFL, O_NONBLOCK);
+					fcntl(p->outfd, F_SETFD, FD_CLOEXEC);
+				}
+			}
         		break;
 		  case -1:
 			report(RPT_ERR, "Could not fork");
+			if (outpipe[0] >= 0) {
+				close(outpipe[0]);
+				close(outpipe[1]);
+			}
 			return -1;
 		}
 
@@ -617,58 +677,58 @@ static int show_procinfo_msg(ProcInfo *p)
 			if ((p->shown) || (!p->feedback))
 				return 1;
 
-			sock_printf(sock, "screen_add [%u]\n", p->pid);
-			sock_printf(sock, "screen_set [%u] -name {lcdexec [%u]}"
+			lcdc_printf(conn, "screen_add [%u]\n", p->pid);
+			lcdc_printf(conn, "screen_set [%u] -name {lcdexec [%u]}"
 					  " -priority alert -timeout %d"
 					  " -heartbeat off\n",
 					p->pid, p->pid, 6*8);
 
 			if (lcd_hgt > 2) {
-				sock_printf(sock, "widget_add [%u] t title\n", p->pid);
-				sock_printf(sock, "widget_set [%u] t {%s}\n", p->pid, p->cmd->displayname);
-				sock_printf(sock, "widget_add [%u] s1 string\n", p->pid);
-				sock_printf(sock, "widget_add [%u] s2 string\n", p->pid);
-				sock_printf(sock, "widget_add [%u] s3 string\n", p->pid);
+				lcdc_printf(conn, "widget_add [%u] t title\n", p->pid);
+				lcdc_printf(conn, "widget_set [%u] t {%s}\n", p->pid, p->cmd->displayname);
+				lcdc_printf(conn, "widget_add [%u] s1 string\n", p->pid);
+				lcdc_printf(conn, "widget_add [%u] s2 string\n", p->pid);
+				lcdc_printf(conn, "widget_add [%u] s3 string\n", p->pid);
 
-				sock_printf(sock, "widget_set [%u] s1 1 2 {[%u] finished%s}\n",
+				lcdc_printf(conn, "widget_set [%u] s1 1 2 {[%u] finished%s}\n",
 						p->pid, p->pid, (WIFSIGNALED(p->status) ? "," : ""));
 
 				if (WIFEXITED(p->status)) {
 					if (WEXITSTATUS(p->status) == EXIT_SUCCESS) {
-						sock_printf(sock, "widget_set [%u] s2 1 3 {successfully.}\n",
+						lcdc_printf(conn, "widget_set [%u] s2 1 3 {successfully.}\n",
 								p->pid);
 					}
 					else {
-						sock_printf(sock, "widget_set [%u] s2 1 3 {with code 0x%02X.}\n",
+						lcdc_printf(conn, "widget_set [%u] s2 1 3 {with code 0x%02X.}\n",
 								p->pid, WEXITSTATUS(p->status));
 					}
 				}
 				else if (WIFSIGNALED(p->status)) {
-					sock_printf(sock, "widget_set [%u] s2 1 3 {killed by SIG %d.}\n",
+					lcdc_printf(conn, "widget_set [%u] s2 1 3 {killed by SIG %d.}\n",
 						p->pid, WTERMSIG(p->status));
 				}
 
 				if (lcd_hgt > 3)
-					sock_printf(sock, "widget_set [%u] s3 1 4 {Exec time: %lds}\n",
+					lcdc_printf(conn, "widget_set [%u] s3 1 4 {Exec time: %lds}\n",
 							p->pid, p->endtime - p->starttime);
 			}
 			else {
-				sock_printf(sock, "widget_add [%u] s1 string\n", p->pid);
-				sock_printf(sock, "widget_add [%u] s2 string\n", p->pid);
-				sock_printf(sock, "widget_set [%u] s1 1 1 {%s}\n",
+				lcdc_printf(conn, "widget_add [%u] s1 string\n", p->pid);
+				lcdc_printf(conn, "widget_add [%u] s2 string\n", p->pid);
+				lcdc_printf(conn, "widget_set [%u] s1 1 1 {%s}\n",
 						p->pid, p->cmd->displayname);
 				if (WIFEXITED(p->status)) {
 					if (WEXITSTATUS(p->status) == EXIT_SUCCESS) {
-						sock_printf(sock, "widget_set [%u] s2 1 2 {succeeded}\n",
+						lcdc_printf(conn, "widget_set [%u] s2 1 2 {succeeded}\n",
 								p->pid, p->status);
 					}
 					else {
-						sock_printf(sock, "widget_set [%u] s2 1 2 {finished (0x%02X)}\n",
+						lcdc_printf(conn, "widget_set [%u] s2 1 2 {finished (0x%02X)}\n",
 								p->pid, p->status);
 					}
 				}
 				else if (WIFSIGNALED(p->status)) {
-					sock_printf(sock, "widget_set [%u] s2 1 2 {killed by SIG %d}\n",
+					lcdc_printf(conn, "widget_set [%u] s2 1 2 {killed by SIG %d}\n",
 							p->pid, WTERMSIG(p->status));
 
 				}
@@ -680,57 +740,211 @@ static int show_procinfo_msg(ProcInfo *p)
 }
 
 
+/**
+ * Read the available output of a process into its ring of output lines.
+ * Closes the pipe on end of file.
+ */
+static void read_output(ProcInfo *p)
+{
+	char buf[256];
+	ssize_t len;
+
+	while ((len = read(p->outfd, buf, sizeof(buf))) > 0) {
+		ssize_t i;
+
+		for (i = 0; i < len; i++) {
+			char *line = p->output[p->outline];
+
+			if (buf[i] == '\n') {
+				/* start a new line, overwriting the oldest one */
+				p->outline = (p->outline + 1) % OUTPUT_LINES;
+				p->outpos = 0;
+				p->output[p->outline][0] = '\0';
+			}
+			else if (buf[i] == '\r') {
+				/* overwrite the current line */
+				p->outpos = 0;
+				line[0] = '\0';
+			}
+			else if (p->outpos < OUTPUT_LINE_LEN) {
+				line[p->outpos++] = ((unsigned char) buf[i] >= ' ') ? buf[i] : '?';
+				line[p->outpos] = '\0';
+			}
+		}
+		p->outchanged = 1;
+	}
+
+	if ((len == 0) || ((errno != EAGAIN) && (errno != EINTR))) {
+		close(p->outfd);
+		p->outfd = -1;
+	}
+}
+
+
+/**
+ * Show the last lines of output of a running process on its own screen,
+ * creating the screen on first use.
+ */
+static void show_output(ProcInfo *p)
+{
+	int first_row = (lcd_hgt > 2) ? 2 : 1;
+	int rows = lcd_hgt - first_row + 1;
+	int row, line;
+
+	if ((lcd_wid <= 0) || (lcd_hgt <= 0))
+		return;
+
+	if (rows > OUTPUT_LINES)
+		rows = OUTPUT_LINES;
+
+	if (!p->outscreen) {
+		lcdc_printf(conn, "screen_add [%u]\n", p->pid);
+		lcdc_printf(conn, "screen_set [%u] -name {lcdexec [%u]}"
+				  " -priority foreground -heartbeat off\n",
+				p->pid, p->pid);
+		if (first_row > 1) {
+			lcdc_printf(conn, "widget_add [%u] t title\n", p->pid);
+			lcdc_printf(conn, "widget_set [%u] t {%s}\n", p->pid, p->cmd->displayname);
+		}
+		for (row = 0; row < rows; row++)
+			lcdc_printf(conn, "widget_add [%u] o%d string\n", p->pid, row);
+		p->outscreen = 1;
+	}
+
+	/* the last line shown is the one being filled, unless it is empty */
+	line = (p->outpos > 0) ? p->outline : p->outline + OUTPUT_LINES - 1;
+	line += OUTPUT_LINES - rows + 1;
+
+	for (row = 0; row < rows; row++, line++) {
+		const char *src = p->output[line % OUTPUT_LINES];
+		char text[2 * OUTPUT_LINE_LEN + 1];
+		char *dst = text;
+
+		/* escape the characters that are special inside "..." */
+		for (; *src != '\0'; src++) {
+			if ((*src == '\\') || (*src == '\"'))
+				*dst++ = '\\';
+			*dst++ = *src;
+		}
+		*dst = '\0';
+
+		lcdc_printf(conn, "widget_set [%u] o%d 1 %d \"%s\"\n",
+				p->pid, row, first_row + row, text);
+	}
+	p->outchanged = 0;
+}
+
+
+/**
+ * Update the screens of all processes and remove finished processes whose
+ * completion has been shown to the user.
+ */
+static void process_procs(void)
+{
+	ProcInfo **pp = &proc_queue;
+	ProcInfo *p;
+
+	while ((p = *pp) != NULL) {
+		if ((p->endtime > 0) && (p->outfd >= 0)) {
+			/* get the rest of the output */
+			read_output(p);
+			if (p->outfd >= 0) {
+				close(p->outfd);
+				p->outfd = -1;
+			}
+		}
+
+		if (p->outchanged)
+			show_output(p);
+
+		if ((p->endtime > 0) && (p->outscreen)) {
+			/* the completion message replaces the output screen */
+			lcdc_printf(conn, "screen_del [%u]\n", p->pid);
+			p->outscreen = 0;
+		}
+
+		/* display completion & delete the ProcInfo from the queue */
+		p->shown |= show_procinfo_msg(p);
+		if (p->shown) {
+			*pp = p->next;
+			free(p);
+		}
+		else {
+			pp = &p->next;
+		}
+	}
+}
+
+
 static int main_loop(void)
 {
-	int num_bytes;
 	char buf[100];
-	int keepalive_delay = 0;
-	int status_delay = 0;
-
-	/* Continuously check if we get a menu event... */
-	while (!Quit && ((num_bytes = sock_recv_string(sock, buf, sizeof(buf)-1)) >= 0)) {
-		if (num_bytes == 0) {
-			ProcInfo *p;
-
-			/* wait for 1/10th of a second */
-			usleep(100000);
-
-			/* send an empty line every 3 seconds to make sure the server still exists */
-			if (keepalive_delay++ >= 30) {
-				keepalive_delay = 0;
-				if (sock_send_string(sock, "\n") < 0) {
-					break; /* Out of while loop */
+	time_t last_keepalive = time(NULL);
+
+	/* Wait for menu events, terminating children and command output */
+	while (!Quit) {
+		int nprocs = 0;
+		ProcInfo *p;
+
+		for (p = proc_queue; p != NULL; p = p->next)
+			nprocs++;
+
+		{
+			struct pollfd fds[2 + nprocs];
+			ProcInfo *fdprocs[nprocs + 1];
+			int nfds = 2;
+			int i, ret;
+
+			if (lcdc_flush(conn) < 0)
+				break;
+
+			fds[0].fd = conn->fd;
+			fds[0].events = POLLIN;
+			fds[1].fd = sigchld_pipe[0];
+			fds[1].events = POLLIN;
+			for (p = proc_queue; p != NULL; p = p->next) {
+				if (p->outfd >= 0) {
+					fds[nfds].fd = p->outfd;
+					fds[nfds].events = POLLIN;
+					fdprocs[nfds - 2] = p;
+					nfds++;
 				}
 			}
 
-			/* check for a screen to show and procinfo deletion every second */
-			if (status_delay++ >= 10) {
-				status_delay = 0;
-
-				/* delete the ProcInfo from the queue */
-				for (p = proc_queue; p != NULL; p = p->next) {
-					ProcInfo *pn = p->next;
+			ret = poll(fds, nfds, KEEPALIVE_INTERVAL * 1000);
+			if ((ret < 0) && (errno != EINTR)) {
+				report(RPT_ERR, "poll failed: %s", strerror(errno));
+				break;
+			}
 
-					if ((pn != NULL) && (pn->shown)) {
-						p->next = pn->next;
-						free(pn);
-					}
+			if (ret > 0) {
+				if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+					if (lcdc_process_input(conn) < 0)
+						break;
 				}
-				/* deleting queue head is special */
-				if ((proc_queue != NULL) && (proc_queue->shown)) {
-					p = proc_queue;
-					proc_queue = proc_queue->next;
-					free(p);
+
+				for (i = 2; i < nfds; i++) {
+					if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+						read_output(fdprocs[i - 2]);
 				}
 
-				/* look for a process to display, display it & mark it as shown */
-				for (p = proc_queue; p != NULL; p = p->next) {
-					p->shown |= show_procinfo_msg(p);
+				if (fds[1].revents & POLLIN) {
+					while (read(sigchld_pipe[0], buf, sizeof(buf)) > 0)
+						;	/* NADA */
 				}
 			}
 		}
-		else {
-			process_response(buf);
+
+		/* collect terminated children & show what has changed */
+		reap_children();
+		process_procs();
+
+		/* send an empty line every few seconds to make sure the server still exists */
+		if (time(NULL) - last_keepalive >= KEEPALIVE_INTERVAL) {
+			last_keepalive = time(NULL);
+			if (lcdc_send_string(conn, "\n") < 0) {
+				break; /* Out of while loop */
+			}
 		}
 	}
 
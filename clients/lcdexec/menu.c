@@ -19,7 +19,7 @@
 
 #include "shared/report.h"
 #include "shared/configfile.h"
-#include "shared/sockets.h"
+#include "shared/lcdclient.h"
 
 #include "menu.h"
 
@@ -93,6 +93,7 @@ MenuEntry *menu_read(MenuEntry *parent, const char *name)
 				return NULL;
 			}
 			me->data.exec.feedback = config_get_bool(name, "Feedback", 0, 0);
+			me->data.exec.show_output = config_get_bool(name, "ShowOutput", 0, 0);
 
 			// try to read parameters
 			while ((entryname = config_get_string(name, "Parameter", me->numChildren, NULL)) != NULL) {
@@ -244,18 +245,18 @@ MenuEntry *menu_read(MenuEntry *parent, const char *name)
 }
 
 /* Helper for repetitive code */
-static int menu_set_quit(MenuEntry *me, int sock) {
+static int menu_set_quit(MenuEntry *me, LcdcConnection *conn) {
 	if (me->next != NULL)
 		return 0;
 
-	return sock_printf(sock, "menu_set_item {} {%d} -next _quit_\n",
+	return lcdc_printf(conn, "menu_set_item {} {%d} -next _quit_\n",
 			   me->id);
 }
 
 /** create LCDproc commands for the menu entry hierarchy and send it to the server */
-int menu_sock_send(MenuEntry *me, MenuEntry *parent, int sock)
+int menu_sock_send(MenuEntry *me, MenuEntry *parent, LcdcConnection *conn)
 {
-	if ((me != NULL) && (sock > 0)) {
+	if ((me != NULL) && (conn != NULL)) {
 		char parent_id[12];
 
 		// set parent_id depending on the parent given
@@ -270,43 +271,43 @@ int menu_sock_send(MenuEntry *me, MenuEntry *parent, int sock)
 			case MT_MENU:
 				// don't create a separate entry for the main menu
 				if ((parent != NULL) && (me->id != 0)) {
-					if (sock_printf(sock, "menu_add_item \"%s\" \"%d\" menu \"%s\"\n",
+					if (lcdc_printf(conn, "menu_add_item \"%s\" \"%d\" menu \"%s\"\n",
 							parent_id, me->id, me->displayname) < 0)
 						return -1;
 				}
 
 				// recursively do it for the menu's sub-menus
 				for (entry = me->children; entry != NULL; entry = entry->next) {
-					if (menu_sock_send(entry, me, sock) < 0)
+					if (menu_sock_send(entry, me, conn) < 0)
 						return -1;
 				}
 				break;
 			case MT_EXEC:
 				if (me->children == NULL) {
-					if (sock_printf(sock, "menu_add_item \"%s\" \"%d\" action \"%s\"\n",
+					if (lcdc_printf(conn, "menu_add_item \"%s\" \"%d\" action \"%s\"\n",
 							parent_id, me->id, me->displayname) < 0)
 						return -1;
 
-					if (sock_printf(sock, "menu_set_item {} {%d} -menu_result quit\n",
+					if (lcdc_printf(conn, "menu_set_item {} {%d} -menu_result quit\n",
 							me->id) < 0)
 						return -1;
 				}
 				else {
 					if ((parent != NULL) && (me->id != 0)) {
-						if (sock_printf(sock, "menu_add_item \"%s\" \"%d\" menu \"%s\"\n",
+						if (lcdc_printf(conn, "menu_add_item \"%s\" \"%d\" menu \"%s\"\n",
 								parent_id, me->id, me->displayname) < 0)
 							return -1;
 					}
 
 					// (recursively) do it for the entry's parameters
 					for (entry = me->children; entry != NULL; entry = entry->next) {
-						if (menu_sock_send(entry, me, sock) < 0)
+						if (menu_sock_send(entry, me, conn) < 0)
 							return -1;
 					}
 				}
 				break;
 			case MT_ARG_SLIDER:
-				if (sock_printf(sock, "menu_add_item \"%s\" \"%d\" slider -text \"%s\""
+				if (lcdc_printf(conn, "menu_add_item \"%s\" \"%d\" slider -text \"%s\""
 						      " -value %d -minvalue %d -maxvalue %d"
 						      " -mintext \"%s\" -maxtext \"%s\" -stepsize %d\n",
 						      parent_id, me->id, me->displayname,
@@ -318,7 +319,7 @@ int menu_sock_send(MenuEntry *me, MenuEntry *parent, int sock)
 						      me->data.slider.stepsize) <0)
 					return -1;
 
-				if (menu_set_quit(me, sock) < 0)
+				if (menu_set_quit(me, conn) < 0)
 					return -1;
 
 				break;
@@ -336,7 +337,7 @@ int menu_sock_send(MenuEntry *me, MenuEntry *parent, int sock)
 						strcat(tmp, me->data.ring.strings[i]);
 					}
 
-					if (sock_printf(sock, "menu_add_item \"%s\" \"%d\" ring -text \"%s\""
+					if (lcdc_printf(conn, "menu_add_item \"%s\" \"%d\" ring -text \"%s\""
 							      " -value %d -strings \"%s\"\n",
 							      parent_id, me->id, me->displayname,
 							      me->data.ring.value,
@@ -344,12 +345,12 @@ int menu_sock_send(MenuEntry *me, MenuEntry *parent, int sock)
 						return -1;
 				}
 
-				if (menu_set_quit(me, sock) < 0)
+				if (menu_set_quit(me, conn) < 0)
 					return -1;
 
 				break;
 			case MT_ARG_NUMERIC:
-				if (sock_printf(sock, "menu_add_item \"%s\" \"%d\" numeric -text \"%s\""
+				if (lcdc_printf(conn, "menu_add_item \"%s\" \"%d\" numeric -text \"%s\""
 						      " -value %d -minvalue %d -maxvalue %d\n",
 						      parent_id, me->id, me->displayname,
 						      me->data.numeric.value,
@@ -357,12 +358,12 @@ int menu_sock_send(MenuEntry *me, MenuEntry *parent, int sock)
 						      me->data.numeric.maxval) < 0)
 					return -1;
 
-				if (menu_set_quit(me, sock) < 0)
+				if (menu_set_quit(me, conn) < 0)
 					return -1;
 
 				break;
 			case MT_ARG_ALPHA:
-				if (sock_printf(sock, "menu_add_item \"%s\" \"%d\" alpha -text \"%s\""
+				if (lcdc_printf(conn, "menu_add_item \"%s\" \"%d\" alpha -text \"%s\""
 						      " -value \"%s\" -minlength %d -maxlength %d"
 						      " -allow_caps false -allow_noncaps false"
 						      " -allow_numbers false -allowed_extra \"%s\"\n",
@@ -373,40 +374,40 @@ int menu_sock_send(MenuEntry *me, MenuEntry *parent, int sock)
 						      me->data.alpha.allowed) <0)
 					return -1;
 
-				if (menu_set_quit(me, sock) < 0)
+				if (menu_set_quit(me, conn) < 0)
 					return -1;
 
 				break;
 			case MT_ARG_IP:
-				if (sock_printf(sock, "menu_add_item \"%s\" \"%d\" ip -text \"%s\""
+				if (lcdc_printf(conn, "menu_add_item \"%s\" \"%d\" ip -text \"%s\""
 						      " -value \"%s\" -v6 %s\n",
 						      parent_id, me->id, me->displayname,
 						      me->data.ip.value,
 						      boolValueName[me->data.ip.v6]) < 0)
 					return -1;
 
-				if (menu_set_quit(me, sock) < 0)
+				if (menu_set_quit(me, conn) < 0)
 					return -1;
 
 				break;
 			case MT_ARG_CHECKBOX:
-				if (sock_printf(sock, "menu_add_item \"%s\" \"%d\" checkbox -text \"%s\""
+				if (lcdc_printf(conn, "menu_add_item \"%s\" \"%d\" checkbox -text \"%s\""
 						      " -value %s -allow_gray %s\n",
 						      parent_id, me->id, me->displayname,
 						      triGrayValueName[me->data.checkbox.value],
 						      boolValueName[me->data.checkbox.allow_gray]) < 0)
 					return -1;
 
-				if (menu_set_quit(me, sock) < 0)
+				if (menu_set_quit(me, conn) < 0)
 					return -1;
 
 				break;
 			case MT_ACTION:
-				if (sock_printf(sock, "menu_add_item \"%s\" \"%d\" action \"%s\"\n",
+				if (lcdc_printf(conn, "menu_add_item \"%s\" \"%d\" action \"%s\"\n",
 						parent_id, me->id, me->displayname) < 0)
 					return -1;
 
-				if (sock_printf(sock, "menu_set_item {} {%d} -menu_result quit\n",
+				if (lcdc_printf(conn, "menu_set_item {} {%d} -menu_result quit\n",
 						me->id) < 0)
 					return -1;
 				break;
@@ -562,6 +563,7 @@ void menu_dump(MenuEntry *me)
 			case MT_EXEC:
 				report(RPT_DEBUG, "Exec=\"%s\"", me->data.exec.command);
 				report(RPT_DEBUG, "Feedback=%s", boolValueName[me->data.exec.feedback]);
+				report(RPT_DEBUG, "ShowOutput=%s", boolValueName[me->data.exec.show_output]);
 
 				// dump entry's parameter referencess
 				for (entry = me->children; entry != NULL; entry = entry->next)
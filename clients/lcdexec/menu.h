@@ -14,6 +14,8 @@
 #ifndef LCDEXEC_MENU_H
 #define LCDEXEC_MENU_H
 
+#include "shared/lcdclient.h"
+
 /* boolean values */
 #ifndef TRUE
 # define TRUE    1
@@ -57,6 +59,7 @@ typedef struct menu_entry {
 		struct exec{	// elements necessary for type MT_EXEC
 			char *command;	/**< Command to execute. */
 			int feedback;	/**< Feedback flag. */
+			int show_output;	/**< Flag: show command output while it runs. */
 		} exec;
 		struct slider {	// elements necessary for type MT_ARG_SLIDER
 			int value;	/**< Numeric value of slider. */
@@ -95,7 +98,7 @@ typedef struct menu_entry {
 
 
 MenuEntry *menu_read(MenuEntry *parent, const char *name);
-int menu_sock_send(MenuEntry *me, MenuEntry *parent, int sock);
+int menu_sock_send(MenuEntry *me, MenuEntry *parent, LcdcConnection *conn);
 MenuEntry *menu_find_by_id(MenuEntry *me, int id);
 const char *menu_command(MenuEntry *me);
 void menu_free(MenuEntry *me);
@@ -38,12 +38,13 @@
 #endif
 
 #include "shared/configfile.h"
-#include "shared/sockets.h"
+#include "shared/lcdclient.h"
 
 #include "main.h"
 #include "mode.h"
 #include "machine.h"
 #include "chrono.h"
+#include "util.h"
 
 
 static char *tickTime(char *time, int heartbeat);
@@ -89,21 +90,21 @@ time_screen(int rep, int display, int *flags_ptr)
 		timeFormat = config_get_string("TimeDate", "TimeFormat", 0, "%H:%M:%S");
 		dateFormat = config_get_string("TimeDate", "DateFormat", 0, "%b %d %Y");
 
-		sock_send_string(sock, "screen_add T\n");
-		sock_printf(sock, "screen_set T -name {Time Screen: %s}\n", get_hostname());
-		sock_send_string(sock, "widget_add T title title\n");
-		sock_send_string(sock, "widget_add T one string\n");
+		lcdc_send_string(conn, "screen_add T\n");
+		lcdc_printf(conn, "screen_set T -name {Time Screen: %s}\n", get_hostname());
+		lcdc_send_string(conn, "widget_add T title title\n");
+		lcdc_send_string(conn, "widget_add T one string\n");
 		if (lcd_hgt >= 4) {
-			sock_send_string(sock, "widget_add T two string\n");
-			sock_send_string(sock, "widget_add T three string\n");
+			lcdc_send_string(conn, "widget_add T two string\n");
+			lcdc_send_string(conn, "widget_add T three string\n");
 
 			/* write title bar: OS name, OS version, hostname */
-			sock_printf(sock, "widget_set T title {%s %s: %s}\n",
+			widget_set("T title {%s %s: %s}",
 				get_sysname(), get_sysrelease(), get_hostname());
 		}
 		else {
 			/* write title bar: hostname */
-			sock_printf(sock, "widget_set T title {TIME: %s}\n", get_hostname());
+			widget_set("T title {TIME: %s}", get_hostname());
 		}
 	}
 
@@ -138,24 +139,24 @@ time_screen(int rep, int display, int *flags_ptr)
 
 		xoffs = (lcd_wid > strlen(tmp)) ? ((lcd_wid - strlen(tmp)) / 2) + 1 : 1;
 		if (display)
-			sock_printf(sock, "widget_set T one %i 2 {%s}\n", xoffs, tmp);
+			widget_set("T one %i 2 {%s}", xoffs, tmp);
 
 		/* display the date */
 		xoffs = (lcd_wid > strlen(today)) ? ((lcd_wid - strlen(today)) / 2) + 1 : 1;
 		if (display)
-			sock_printf(sock, "widget_set T two %i 3 {%s}\n", xoffs, today);
+			widget_set("T two %i 3 {%s}", xoffs, today);
 
 		/* display the time & idle time... */
 		sprintf(tmp, "%s %3i%% idle", now, (int) idle);
 		xoffs = (lcd_wid > strlen(tmp)) ? ((lcd_wid - strlen(tmp)) / 2) + 1 : 1;
 		if (display)
-			sock_printf(sock, "widget_set T three %i 4 {%s}\n", xoffs, tmp);
+			widget_set("T three %i 4 {%s}", xoffs, tmp);
 	}
 	else {			/* 2 line version of the screen */
 		xoffs = (lcd_wid > (strlen(today) + strlen(now) + 1))
 			? ((lcd_wid - ((strlen(today) + strlen(now) + 1))) / 2) + 1 : 1;
 		if (display)
-			sock_printf(sock, "widget_set T one %i 2 {%s %s}\n", xoffs, today, now);
+			widget_set("T one %i 2 {%s %s}", xoffs, today, now);
 	}
 
 	return 0;
@@ -211,29 +212,29 @@ clock_screen(int rep, int display, int *flags_ptr)
 		dateFormat = config_get_string("OldTime", "DateFormat", 0, "%b %d %Y");
 		showTitle = config_get_bool("OldTime", "ShowTitle", 0, 1);
 
-		sock_send_string(sock, "screen_add O\n");
-		sock_printf(sock, "screen_set O -name {Old Clock Screen: %s}\n", get_hostname());
+		lcdc_send_string(conn, "screen_add O\n");
+		lcdc_printf(conn, "screen_set O -name {Old Clock Screen: %s}\n", get_hostname());
 		if (!showTitle)
-			sock_send_string(sock, "screen_set O -heartbeat off\n");
-		sock_send_string(sock, "widget_add O one string\n");
+			lcdc_send_string(conn, "screen_set O -heartbeat off\n");
+		lcdc_send_string(conn, "widget_add O one string\n");
 		if (lcd_hgt >= 4) {
-			sock_send_string(sock, "widget_add O title title\n");
-			sock_send_string(sock, "widget_add O two string\n");
-			sock_send_string(sock, "widget_add O three string\n");
+			lcdc_send_string(conn, "widget_add O title title\n");
+			lcdc_send_string(conn, "widget_add O two string\n");
+			lcdc_send_string(conn, "widget_add O three string\n");
 
-			sock_printf(sock, "widget_set O title {DATE & TIME}\n");
+			widget_set("O title {DATE & TIME}");
 
 			sprintf(tmp, "%s", get_hostname());
 			xoffs = (lcd_wid > strlen(tmp)) ? (((lcd_wid - strlen(tmp)) / 2) + 1) : 1;
-			sock_printf(sock, "widget_set O one %i 2 {%s}\n", xoffs, tmp);
+			widget_set("O one %i 2 {%s}", xoffs, tmp);
 		}
 		else {
 			if (showTitle) {
-				sock_send_string(sock, "widget_add O title title\n");
-				sock_printf(sock, "widget_set O title {TIME: %s}\n", get_hostname());
+				lcdc_send_string(conn, "widget_add O title title\n");
+				widget_set("O title {TIME: %s}", get_hostname());
 			}
 			else {
-				sock_send_string(sock, "widget_add O two string\n");
+				lcdc_send_string(conn, "widget_add O two string\n");
 			}
 		}
 	}
@@ -253,26 +254,26 @@ clock_screen(int rep, int display, int *flags_ptr)
 	if (lcd_hgt >= 4) {	/* 4-line version of the screen */
 		xoffs = (lcd_wid > strlen(today)) ? ((lcd_wid - strlen(today)) / 2) + 1 : 1;
 		if (display)
-			sock_printf(sock, "widget_set O two %i 3 {%s}\n", xoffs, today);
+			widget_set("O two %i 3 {%s}", xoffs, today);
 
 		xoffs = (lcd_wid > strlen(now)) ? ((lcd_wid - strlen(now)) / 2) + 1 : 1;
 		if (display)
-			sock_printf(sock, "widget_set O three %i 4 {%s}\n", xoffs, now);
+			widget_set("O three %i 4 {%s}", xoffs, now);
 	}
 	else {			/* 2-line version of the screen */
 		if (showTitle) {
 			xoffs = (lcd_wid > (strlen(today) + strlen(now) + 1))
 				? ((lcd_wid - ((strlen(today) + strlen(now) + 1))) / 2) + 1 : 1;
 			if (display)
-				sock_printf(sock, "widget_set O one %i 2 {%s %s}\n", xoffs, today, now);
+				widget_set("O one %i 2 {%s %s}", xoffs, today, now);
 		}
 		else {
 			xoffs = (lcd_wid > strlen(today)) ? ((lcd_wid - strlen(today)) / 2) + 1 : 1;
 			if (display)
-				sock_printf(sock, "widget_set O one %i 1 {%s}\n", xoffs, today);
+				widget_set("O one %i 1 {%s}", xoffs, today);
 			xoffs = (lcd_wid > strlen(now)) ? ((lcd_wid - strlen(now)) / 2) + 1 : 1;
 			if (display)
-				sock_printf(sock, "widget_set O two %i 2 {%s}\n", xoffs, now);
+				widget_set("O two %i 2 {%s}", xoffs, now);
 		}
 	}
 
@@ -311,28 +312,28 @@ uptime_screen(int rep, int display, int *flags_ptr)
 	if ((*flags_ptr & INITIALIZED) == 0) {
 		*flags_ptr |= INITIALIZED;
 
-		sock_send_string(sock, "screen_add U\n");
-		sock_printf(sock, "screen_set U -name {Uptime Screen: %s}\n", get_hostname());
-		sock_send_string(sock, "widget_add U title title\n");
+		lcdc_send_string(conn, "screen_add U\n");
+		lcdc_printf(conn, "screen_set U -name {Uptime Screen: %s}\n", get_hostname());
+		lcdc_send_string(conn, "widget_add U title title\n");
 		if (lcd_hgt >= 4) {
-			sock_send_string(sock, "widget_add U one string\n");
-			sock_send_string(sock, "widget_add U two string\n");
-			sock_send_string(sock, "widget_add U three string\n");
+			lcdc_send_string(conn, "widget_add U one string\n");
+			lcdc_send_string(conn, "widget_add U two string\n");
+			lcdc_send_string(conn, "widget_add U three string\n");
 
-			sock_send_string(sock, "widget_set U title {SYSTEM UPTIME}\n");
+			widget_set("U title {SYSTEM UPTIME}");
 
 			sprintf(tmp, "%s", get_hostname());
 			xoffs = (lcd_wid > strlen(tmp)) ? (((lcd_wid - strlen(tmp)) / 2) + 1) : 1;
-			sock_printf(sock, "widget_set U one %i 2 {%s}\n", xoffs, tmp);
+			widget_set("U one %i 2 {%s}", xoffs, tmp);
 
 			sprintf(tmp, "%s %s", get_sysname(), get_sysrelease());
 			xoffs = (lcd_wid > strlen(tmp)) ? (((lcd_wid - strlen(tmp)) / 2) + 1) : 1;
-			sock_printf(sock, "widget_set U three %i 4 {%s}\n", xoffs, tmp);
+			widget_set("U three %i 4 {%s}", xoffs, tmp);
 		}
 		else {
-			sock_send_string(sock, "widget_add U one string\n");
+			lcdc_send_string(conn, "widget_add U one string\n");
 
-			sock_printf(sock, "widget_set U title {%s %s: %s}\n",
+			widget_set("U title {%s %s: %s}",
 					get_sysname(), get_sysrelease(), get_hostname());
 		}
 	}
@@ -354,9 +355,9 @@ uptime_screen(int rep, int display, int *flags_ptr)
 	if (display) {
 		xoffs = (lcd_wid > strlen(tmp)) ? (((lcd_wid - strlen(tmp)) / 2) + 1) : 1;
 		if (lcd_hgt >= 4)
-			sock_printf(sock, "widget_set U two %d 3 {%s}\n", xoffs, tmp);
+			widget_set("U two %d 3 {%s}", xoffs, tmp);
 		else
-			sock_printf(sock, "widget_set U one %d 2 {%s}\n", xoffs, tmp);
+			widget_set("U one %d 2 {%s}", xoffs, tmp);
 	}
 
 	return 0;
@@ -417,18 +418,18 @@ big_clock_screen(int rep, int display, int *flags_ptr)
 	if ((*flags_ptr & INITIALIZED) == 0) {
 		*flags_ptr |= INITIALIZED;
 
-		sock_send_string(sock, "screen_add K\n");
-		sock_send_string(sock, "screen_set K -name {Big Clock Screen} -heartbeat off\n");
-		sock_send_string(sock, "widget_add K d0 num\n");
-		sock_send_string(sock, "widget_add K d1 num\n");
-		sock_send_string(sock, "widget_add K d2 num\n");
-		sock_send_string(sock, "widget_add K d3 num\n");
-		sock_send_string(sock, "widget_add K c0 num\n");
+		lcdc_send_string(conn, "screen_add K\n");
+		lcdc_send_string(conn, "screen_set K -name {Big Clock Screen} -heartbeat off\n");
+		lcdc_send_string(conn, "widget_add K d0 num\n");
+		lcdc_send_string(conn, "widget_add K d1 num\n");
+		lcdc_send_string(conn, "widget_add K d2 num\n");
+		lcdc_send_string(conn, "widget_add K d3 num\n");
+		lcdc_send_string(conn, "widget_add K c0 num\n");
 
 		if (digits > 4) {
-			sock_send_string(sock, "widget_add K d4 num\n");
-			sock_send_string(sock, "widget_add K d5 num\n");
-			sock_send_string(sock, "widget_add K c1 num\n");
+			lcdc_send_string(conn, "widget_add K d4 num\n");
+			lcdc_send_string(conn, "widget_add K d5 num\n");
+			lcdc_send_string(conn, "widget_add K c1 num\n");
 		}
 
 		strcpy(old_fulltxt, "      ");
@@ -443,20 +444,20 @@ big_clock_screen(int rep, int display, int *flags_ptr)
 
 	for (j = 0; j < digits; j++) {
 		if (fulltxt[j] != old_fulltxt[j]) {
-			sock_printf(sock, "widget_set K d%d %d %c\n", j, xoffs+pos[j], fulltxt[j]);
+			widget_set("K d%d %d %c", j, xoffs+pos[j], fulltxt[j]);
 			old_fulltxt[j] = fulltxt[j];
 		}
 	}
 
 	if (heartbeat) {	/* 10 means: colon */
-		sock_printf(sock, "widget_set K c0 %d 10\n", xoffs + 7);
+		widget_set("K c0 %d 10", xoffs + 7);
 		if (digits > 4)
-			sock_printf(sock, "widget_set K c1 %d 10\n", xoffs + 14);
+			widget_set("K c1 %d 10", xoffs + 14);
 	}
 	else {			/* kludge: use illegal number to clear colon display */
-		sock_printf(sock, "widget_set K c0 %d 11\n", xoffs + 7);
+		widget_set("K c0 %d 11", xoffs + 7);
 		if (digits > 4)
-			sock_printf(sock, "widget_set K c1 %d 11\n", xoffs + 14);
+			widget_set("K c1 %d 11", xoffs + 14);
 	}
 
 	return 0;
@@ -501,9 +502,9 @@ mini_clock_screen(int rep, int display, int *flags_ptr)
 		/* get config values */
 		timeFormat = config_get_string("MiniClock", "TimeFormat", 0, "%H:%M");
 
-		sock_send_string(sock, "screen_add N\n");
-		sock_send_string(sock, "screen_set N -name {Mini Clock Screen} -heartbeat off\n");
-		sock_send_string(sock, "widget_add N one string\n");
+		lcdc_send_string(conn, "screen_add N\n");
+		lcdc_send_string(conn, "screen_set N -name {Mini Clock Screen} -heartbeat off\n");
+		lcdc_send_string(conn, "widget_add N one string\n");
 	}
 
 	time(&thetime);
@@ -514,7 +515,7 @@ mini_clock_screen(int rep, int display, int *flags_ptr)
 	tickTime(now, heartbeat);
 
 	xoffs = (lcd_wid > strlen(now)) ? (((lcd_wid - strlen(now)) / 2) + 1) : 1;
-	sock_printf(sock, "widget_set N one %d %d {%s}\n", xoffs, (lcd_hgt / 2), now);
+	widget_set("N one %d %d {%s}", xoffs, (lcd_hgt / 2), now);
 
 	return 0;
 }				/* End mini_clock_screen() */
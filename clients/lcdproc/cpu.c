@@ -19,7 +19,7 @@
 #include <limits.h>
 #include <errno.h>
 
-#include "shared/sockets.h"
+#include "shared/lcdclient.h"
 
 #include "main.h"
 #include "mode.h"
@@ -66,34 +66,34 @@ cpu_screen(int rep, int display, int *flags_ptr)
 	if ((*flags_ptr & INITIALIZED) == 0) {
 		*flags_ptr |= INITIALIZED;
 
-		sock_send_string(sock, "screen_add C\n");
-		sock_printf(sock, "screen_set C -name {CPU Use: %s}\n", get_hostname());
+		lcdc_send_string(conn, "screen_add C\n");
+		lcdc_printf(conn, "screen_set C -name {CPU Use: %s}\n", get_hostname());
 		if (lcd_hgt >= 4) {
 			us_wid = ((lcd_wid + 1) / 2) - 7; /* Usr/Sys label width -7 for " xx.x% " */
 			ni_wid = lcd_wid / 2 - 6;       /* Nice/Idle label width -6 for " xx.x%" */
 
-			sock_send_string(sock, "widget_add C title title\n");
-			sock_send_string(sock, "widget_set C title {CPU LOAD}\n");
-			sock_send_string(sock, "widget_add C one string\n");
-			sock_send_string(sock, "widget_add C two string\n");
-			sock_printf(sock, "widget_set C one 1 2 {%-*.*s       %-*.*s}\n",
+			lcdc_send_string(conn, "widget_add C title title\n");
+			widget_set("C title {CPU LOAD}");
+			lcdc_send_string(conn, "widget_add C one string\n");
+			lcdc_send_string(conn, "widget_add C two string\n");
+			widget_set("C one 1 2 {%-*.*s       %-*.*s}",
 					us_wid, us_wid, "Usr", ni_wid, ni_wid, "Nice");
-			sock_printf(sock, "widget_set C two 1 3 {%-*.*s       %-*.*s}\n",
+			widget_set("C two 1 3 {%-*.*s       %-*.*s}",
 					us_wid, us_wid, "Sys", ni_wid, ni_wid, "Idle");
-			sock_send_string(sock, "widget_add C usr string\n");
-			sock_send_string(sock, "widget_add C nice string\n");
-			sock_send_string(sock, "widget_add C idle string\n");
-			sock_send_string(sock, "widget_add C sys string\n");
+			lcdc_send_string(conn, "widget_add C usr string\n");
+			lcdc_send_string(conn, "widget_add C nice string\n");
+			lcdc_send_string(conn, "widget_add C idle string\n");
+			lcdc_send_string(conn, "widget_add C sys string\n");
 			pbar_widget_add("C", "bar");
 		}
 		else {
 			usni_wid = lcd_wid / 4;	  /* 4 gauges */
 			gauge_wid = lcd_wid - 10; /* room between "CPU " and "99.9%@" */
 
-			sock_send_string(sock, "widget_add C cpu string\n");
-			sock_printf(sock, "widget_set C cpu 1 1 {CPU }\n");
-			sock_send_string(sock, "widget_add C cpu% string\n");
-			sock_printf(sock, "widget_set C cpu%% 1 %d { 0.0%%}\n", lcd_wid - 5);
+			lcdc_send_string(conn, "widget_add C cpu string\n");
+			widget_set("C cpu 1 1 {CPU }");
+			lcdc_send_string(conn, "widget_add C cpu% string\n");
+			widget_set("C cpu%% 1 %d { 0.0%%}", lcd_wid - 5);
 			pbar_widget_add("C", "usr");
 			pbar_widget_add("C", "sys");
 			pbar_widget_add("C", "nice");
@@ -141,25 +141,25 @@ cpu_screen(int rep, int display, int *flags_ptr)
 
 	if (lcd_hgt >= 4) {	/* 4-line display */
 		sprintf_percent(tmp, cpu[CPU_BUF_SIZE][4]);
-		sock_printf(sock, "widget_set C title {CPU %5s: %s}\n", tmp, get_hostname());
+		widget_set("C title {CPU %5s: %s}", tmp, get_hostname());
 
 		sprintf_percent(tmp, cpu[CPU_BUF_SIZE][0]);
-		sock_printf(sock, "widget_set C usr %i 2 {%5s}\n", ((lcd_wid + 1) / 2) - 5, tmp);
+		widget_set("C usr %i 2 {%5s}", ((lcd_wid + 1) / 2) - 5, tmp);
 
 		sprintf_percent(tmp, cpu[CPU_BUF_SIZE][1]);
-		sock_printf(sock, "widget_set C sys %i 3 {%5s}\n", ((lcd_wid + 1) / 2) - 5, tmp);
+		widget_set("C sys %i 3 {%5s}", ((lcd_wid + 1) / 2) - 5, tmp);
 
 		sprintf_percent(tmp, cpu[CPU_BUF_SIZE][2]);
-		sock_printf(sock, "widget_set C nice %i 2 {%5s}\n", lcd_wid - 4, tmp);
+		widget_set("C nice %i 2 {%5s}", lcd_wid - 4, tmp);
 
 		sprintf_percent(tmp, cpu[CPU_BUF_SIZE][3]);
-		sock_printf(sock, "widget_set C idle %i 3 {%5s}\n", lcd_wid - 4, tmp);
+		widget_set("C idle %i 3 {%5s}", lcd_wid - 4, tmp);
 
 		pbar_widget_set("C", "bar", 1, 4, lcd_wid, cpu[CPU_BUF_SIZE][4] * 10, "0%", "100%");
 	}
 	else {			/* 2-line display */
 		sprintf_percent(tmp, cpu[CPU_BUF_SIZE][4]);
-		sock_printf(sock, "widget_set C cpu%% %d 1 {%5s}\n", lcd_wid - 5, tmp);
+		widget_set("C cpu%% %d 1 {%5s}", lcd_wid - 5, tmp);
 
 		pbar_widget_set("C", "total", 5, 1, gauge_wid, cpu[CPU_BUF_SIZE][4] * 10, NULL, NULL);
 		pbar_widget_set("C", "usr",  1 + 0 * usni_wid, 2, usni_wid, cpu[CPU_BUF_SIZE][0] * 10, "U", NULL);
@@ -210,21 +210,21 @@ cpu_graph_screen(int rep, int display, int *flags_ptr)
 
 		gauge_hgt = (lcd_hgt > 2) ? (lcd_hgt - 1) : lcd_hgt;
 
-		sock_send_string(sock, "screen_add G\n");
-		sock_printf(sock, "screen_set G -name {CPU Graph: %s}\n", get_hostname());
+		lcdc_send_string(conn, "screen_add G\n");
+		lcdc_printf(conn, "screen_set G -name {CPU Graph: %s}\n", get_hostname());
 
 		if (lcd_hgt >= 4) {
-			sock_send_string(sock, "widget_add G title title\n");
-			sock_printf(sock, "widget_set G title {CPU: %s}\n", get_hostname());
+			lcdc_send_string(conn, "widget_add G title title\n");
+			widget_set("G title {CPU: %s}", get_hostname());
 		}
 		else {
-			sock_send_string(sock, "widget_add G title string\n");
-			sock_printf(sock, "widget_set G title 1 1 {CPU: %s}\n", get_hostname());
+			lcdc_send_string(conn, "widget_add G title string\n");
+			widget_set("G title 1 1 {CPU: %s}", get_hostname());
 		}
 
 		for (i = 1; i <= lcd_wid; i++) {
-			sock_printf(sock, "widget_add G bar%d vbar\n", i);
-			sock_printf(sock, "widget_set G bar%d %d %d 0\n", i, i, lcd_hgt);
+			lcdc_printf(conn, "widget_add G bar%d vbar\n", i);
+			widget_set("G bar%d %d %d 0", i, i, lcd_hgt);
 			cpu_past[i - 1] = 0;
 		};
 
@@ -257,15 +257,15 @@ cpu_graph_screen(int rep, int display, int *flags_ptr)
 		cpu_past[i] = cpu_past[i + 1];
 
 		if (display) {
-			sock_printf(sock, "widget_set G bar%d %d %d %d\n",
-			              i + 1, i + 1, lcd_hgt, cpu_past[i]);
+			widget_set("G bar%d %d %d %d",
+			             i + 1, i + 1, lcd_hgt, cpu_past[i]);
 		}
 	}
 
 	/* Save the newest entry and display it */
 	cpu_past[lcd_wid - 1] = n;
 	if (display) {
-		sock_printf(sock, "widget_set G bar%d %d %d %d\n", lcd_wid, lcd_wid, lcd_hgt, n);
+		widget_set("G bar%d %d %d %d", lcd_wid, lcd_wid, lcd_hgt, n);
 	}
 
 	return (0);
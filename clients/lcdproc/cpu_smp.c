@@ -34,12 +34,13 @@
 #include <unistd.h>
 #include <ctype.h>
 
-#include "shared/sockets.h"
+#include "shared/lcdclient.h"
 
 #include "main.h"
 #include "mode.h"
 #include "machine.h"
 #include "cpu_smp.h"
+#include "util.h"
 
 
 /**
@@ -76,28 +77,28 @@ cpu_smp_screen (int rep, int display, int *flags_ptr)
 	if ((*flags_ptr & INITIALIZED) == 0) {
 		*flags_ptr |= INITIALIZED;
 
-		sock_send_string(sock, "screen_add P\n");
+		lcdc_send_string(conn, "screen_add P\n");
 
 		/* print title if he have room for it */
 		if (lines_used < lcd_hgt) {
-			sock_send_string(sock, "widget_add P title title\n");
-			sock_printf(sock, "widget_set P title {SMP CPU %s}\n", get_hostname());
+			lcdc_send_string(conn, "widget_add P title title\n");
+			widget_set("P title {SMP CPU %s}", get_hostname());
 		}
 		else {
-			sock_send_string(sock, "screen_set P -heartbeat off\n");
+			lcdc_send_string(conn, "screen_set P -heartbeat off\n");
 		}
 
-		sock_printf(sock, "screen_set P -name {CPU Use: %s}\n", get_hostname());
+		lcdc_printf(conn, "screen_set P -name {CPU Use: %s}\n", get_hostname());
 
 		for (z = 0; z < num_cpus; z++) {
 			int y_offs = (lines_used < lcd_hgt) ? 2 : 1;
 			int x = (num_cpus > lcd_hgt) ? ((z % 2) * (lcd_wid/2) + 1) : 1;
 			int y = (num_cpus > lcd_hgt) ? (z/2 + y_offs) : (z + y_offs);
 
-			sock_printf(sock, "widget_add P cpu%d_title string\n", z);
-			sock_printf(sock, "widget_set P cpu%d_title %d %d \"CPU%d[%*s]\"\n",
+			lcdc_printf(conn, "widget_add P cpu%d_title string\n", z);
+			widget_set("P cpu%d_title %d %d \"CPU%d[%*s]\"",
 					z, x, y, z, bar_size, "");
-			sock_printf(sock, "widget_add P cpu%d_bar hbar\n", z);
+			lcdc_printf(conn, "widget_add P cpu%d_bar hbar\n", z);
 		}
 
 		return 0;
@@ -126,7 +127,7 @@ cpu_smp_screen (int rep, int display, int *flags_ptr)
 		value /= CPU_BUF_SIZE;
 
 		n = (int) ((value * lcd_cellwid * bar_size) / 100.0 + 0.5);
-		sock_printf(sock, "widget_set P cpu%d_bar %d %d %d\n", z, x, y, n);
+		widget_set("P cpu%d_bar %d %d %d", z, x, y, n);
 	}
 
 	return 0;
@@ -22,7 +22,7 @@
 #include "config.h"
 #endif
 
-#include "shared/sockets.h"
+#include "shared/lcdclient.h"
 
 #include "main.h"
 #include "mode.h"
@@ -78,29 +78,29 @@ disk_screen(int rep, int display, int *flags_ptr)
 		gauge_wid = lcd_wid - hbar_pos;
 		gauge_scale = gauge_wid * lcd_cellwid;
 
-		sock_send_string(sock, "screen_add D\n");
-		sock_printf(sock, "screen_set D -name {Disk Use: %s}\n", get_hostname());
-		sock_send_string(sock, "widget_add D title title\n");
-		sock_printf(sock, "widget_set D title {DISKS: %s}\n", get_hostname());
-		sock_send_string(sock, "widget_add D f frame\n");
-		sock_printf(sock, "widget_set D f 1 2 %i %i %i %i v 12\n", lcd_wid, lcd_hgt, lcd_wid, lcd_hgt - 1);
-		sock_send_string(sock, "widget_add D err1 string\n");
-		sock_send_string(sock, "widget_add D err2 string\n");
-		sock_send_string(sock, "widget_set D err1 5 2 {  Reading  }\n");
-		sock_send_string(sock, "widget_set D err2 5 3 {Filesystems}\n");
+		lcdc_send_string(conn, "screen_add D\n");
+		lcdc_printf(conn, "screen_set D -name {Disk Use: %s}\n", get_hostname());
+		lcdc_send_string(conn, "widget_add D title title\n");
+		widget_set("D title {DISKS: %s}", get_hostname());
+		lcdc_send_string(conn, "widget_add D f frame\n");
+		widget_set("D f 1 2 %i %i %i %i v 12", lcd_wid, lcd_hgt, lcd_wid, lcd_hgt - 1);
+		lcdc_send_string(conn, "widget_add D err1 string\n");
+		lcdc_send_string(conn, "widget_add D err2 string\n");
+		widget_set("D err1 5 2 {  Reading  }");
+		widget_set("D err2 5 3 {Filesystems}");
 	}
 
 	/* Get rid of old, unmounted filesystems... */
 	machine_get_fs(mnt, &count);
 	if (!count) {
-		sock_send_string(sock, "widget_set D err1 1 2 {Error Retrieving}\n");
-		sock_send_string(sock, "widget_set D err2 1 3 {Filesystem Stats}\n");
+		widget_set("D err1 1 2 {Error Retrieving}");
+		widget_set("D err2 1 3 {Filesystem Stats}");
 		return 0;
 	}
 
 	/* Fill the display structure... */
-	sock_send_string(sock, "widget_set D err1 0 0 .\n");
-	sock_send_string(sock, "widget_set D err2 0 0 .\n");
+	widget_set("D err1 0 0 .");
+	widget_set("D err2 0 0 .");
 	for (i = 0; i < count; i++) {
 		if (strlen(mnt[i].mpoint) > dev_wid)
 			sprintf(table[i].dev, "-%s", (mnt[i].mpoint) + (strlen(mnt[i].mpoint) - (dev_wid - 1)));
@@ -121,7 +121,7 @@ disk_screen(int rep, int display, int *flags_ptr)
 	 * Display stuff...  (show for two seconds, then scroll once per
 	 * second, then hold at the end for two seconds)
 	 */
-	sock_printf(sock, "widget_set D f 1 2 %i %i %i %i v 12\n", lcd_wid, lcd_hgt, lcd_wid, count);
+	widget_set("D f 1 2 %i %i %i %i v 12", lcd_wid, lcd_hgt, lcd_wid, count);
 	for (i = 0; i < count; i++) {
 		char tmp[lcd_wid + 1];	/* should be large enough */
 
@@ -129,8 +129,8 @@ disk_screen(int rep, int display, int *flags_ptr)
 			continue;
 
 		if (i >= num_disks) {	/* Make sure we have enough lines... */
-			sock_printf(sock, "widget_add D s%i string -in f\n", i);
-			sock_printf(sock, "widget_add D h%i hbar -in f\n", i);
+			lcdc_printf(conn, "widget_add D s%i string -in f\n", i);
+			lcdc_printf(conn, "widget_add D h%i hbar -in f\n", i);
 		}
 		if (lcd_wid >= 20) {	/* 20+x columns */
 			sprintf(tmp, "%-*s %6s E%*sF", dev_wid, table[i].dev, table[i].cap, gauge_wid, "");
@@ -138,15 +138,15 @@ disk_screen(int rep, int display, int *flags_ptr)
 		else {		/* < 20 columns */
 			sprintf(tmp, "%-*s E%*sF", dev_wid, table[i].dev, gauge_wid, "");
 		}
-		sock_printf(sock, "widget_set D s%i 1 %i {%s}\n", i, i + 1, tmp);
-		sock_printf(sock, "widget_set D h%i %i %i %i\n",
+		widget_set("D s%i 1 %i {%s}", i, i + 1, tmp);
+		widget_set("D h%i %i %i %i",
 					i, hbar_pos, i + 1, table[i].full);
 	}
 
 	/* Now remove extra widgets... */
 	for (; i < num_disks; i++) {
-		sock_printf(sock, "widget_del D s%i\n", i);
-		sock_printf(sock, "widget_del D h%i\n", i);
+		widget_del("D s%i", i);
+		widget_del("D h%i", i);
 	}
 
 	num_disks = count;
@@ -22,7 +22,7 @@
 #include <limits.h>
 #include <errno.h>
 
-#include "shared/sockets.h"
+#include "shared/lcdclient.h"
 
 #include "main.h"
 #include "mode.h"
@@ -42,8 +42,8 @@ eyebox_screen(char display, int init)
 	load_type load;
 
 	if (init == 0) {
-		sock_printf(sock, "widget_add %c eyebo_cpu string\n", display);
-		sock_printf(sock, "widget_add %c eyebo_mem string\n", display);
+		lcdc_printf(conn, "widget_add %c eyebo_cpu string\n", display);
+		lcdc_printf(conn, "widget_add %c eyebo_mem string\n", display);
 
 		return 0;
 	}
@@ -86,7 +86,7 @@ eyebox_screen(char display, int init)
 	 * a = Bar ID
 	 * b = Level
 	 */
-	sock_printf(sock, "widget_set %c eyebo_cpu 1 2 {/xB%d%d}\n",
+	lcdc_printf(conn, "widget_set %c eyebo_cpu 1 2 {/xB%d%d}\n",
 			display, 2,(int)(cpu[CPU_BUF_SIZE][4]/10));
 
 	/*-
@@ -96,7 +96,7 @@ eyebox_screen(char display, int init)
 	 */
 	value = 1.0 - (double) (mem[0].free + mem[0].buffers + mem[0].cache)
 		/ (double) mem[0].total;
-	sock_printf(sock, "widget_set %c eyebo_mem 1 3 {/xB%d%d}\n", display, 1, (int) (value * 10));
+	lcdc_printf(conn, "widget_set %c eyebo_mem 1 3 {/xB%d%d}\n", display, 1, (int) (value * 10));
 
 	return 0;
 }
@@ -105,19 +105,19 @@ void
 eyebox_clear(void)
 {
 	/* Clear LEDs before exit */
-	sock_send_string(sock, "screen_add OFF\n");
-	sock_send_string(sock, "screen_set OFF -priority alert -name {EyeBO}\n");
-	sock_send_string(sock, "widget_add OFF title title\n");
-	sock_send_string(sock, "widget_set OFF title {EYEBOX ONE}\n");
-	sock_send_string(sock, "widget_add OFF text string\n");
-	sock_send_string(sock, "widget_add OFF about string\n");
-	sock_send_string(sock, "widget_add OFF cpu string\n");
-	sock_send_string(sock, "widget_add OFF mem string\n");
-
-	sock_send_string(sock, "widget_set OFF text 1 2 {Reseting Leds...}\n");
-	sock_send_string(sock, "widget_set OFF about 5 4 {EyeBO by NeZetiC}\n");
-	sock_printf(sock, "widget_set OFF cpu 1 2 {/xB%d%d}\n", 2, 0);
-	sock_printf(sock, "widget_set OFF mem 1 3 {/xB%d%d}\n", 1, 0);
+	lcdc_send_string(conn, "screen_add OFF\n");
+	lcdc_send_string(conn, "screen_set OFF -priority alert -name {EyeBO}\n");
+	lcdc_send_string(conn, "widget_add OFF title title\n");
+	lcdc_send_string(conn, "widget_set OFF title {EYEBOX ONE}\n");
+	lcdc_send_string(conn, "widget_add OFF text string\n");
+	lcdc_send_string(conn, "widget_add OFF about string\n");
+	lcdc_send_string(conn, "widget_add OFF cpu string\n");
+	lcdc_send_string(conn, "widget_add OFF mem string\n");
+
+	lcdc_send_string(conn, "widget_set OFF text 1 2 {Reseting Leds...}\n");
+	lcdc_send_string(conn, "widget_set OFF about 5 4 {EyeBO by NeZetiC}\n");
+	lcdc_printf(conn, "widget_set OFF cpu 1 2 {/xB%d%d}\n", 2, 0);
+	lcdc_printf(conn, "widget_set OFF mem 1 3 {/xB%d%d}\n", 1, 0);
 	usleep(2000000);	/* Wait last order execution */
 }
 
@@ -34,7 +34,7 @@
 
 #include "main.h"
 #include "mode.h"
-#include "shared/sockets.h"
+#include "shared/lcdclient.h"
 #include "shared/report.h"
 #include "shared/configfile.h"
 #include "getopt.h"		/* This is our local getopt.h! */
@@ -49,13 +49,14 @@
 #include "mem.h"
 #include "machine.h"
 #include "iface.h"
+#include "util.h"
 #ifdef LCDPROC_EYEBOXONE
 # include "eyebox.h"
 #endif
 
 /* The following 8 variables are defined 'external' in main.h! */
 int Quit = 0;
-int sock = -1;
+LcdcConnection *conn = NULL;
 
 char *version = VERSION;
 
@@ -74,6 +75,7 @@ static void HelpScreen(int exit_state);
 static void exit_program(int val);
 static void main_loop(void);
 static int process_configfile(char *cfgfile);
+static void server_event(LcdcConnection *c, int argc, char **argv, void *data);
 
 
 #define TIME_UNIT	125000	/**< 1/8th second is a single time unit. */
@@ -184,8 +186,11 @@ set_mode(int shortname, char *longname, int state)
 				 */
 				sequence[k].flags &= (~ACTIVE & ~INITIALIZED);
 				/* delete the screen if we are connected */
-				if (sock >= 0) {
-					sock_printf(sock, "screen_del %c\n", sequence[k].which);
+				if (conn != NULL) {
+					char screen[2] = { sequence[k].which, '\0' };
+
+					lcdc_printf(conn, "screen_del %c\n", sequence[k].which);
+					widget_cache_clear(screen);
 				}
 			}
 			else
@@ -327,22 +332,35 @@ main(int argc, char **argv)
 		server = DEFAULT_SERVER;
 
 	/* Connect to the server... */
-	sock = sock_connect(server, port);
-	if (sock < 0) {
+	conn = lcdc_connect(server, port);
+	if (conn == NULL) {
 		fprintf(stderr, "Error connecting to LCD server %s on port %d.\n"
 			"Check to see that the server is running and operating normally.\n",
 			server, port);
 		return (EXIT_FAILURE);
 	}
+	lcdc_set_handler(conn, server_event, NULL);
 
-	sock_send_string(sock, "hello\n");
-	usleep(500000);		/* wait for the server to say hi. */
-
-	/* We grab the real values below, from the "connect" line. */
-	lcd_wid = 20;
-	lcd_hgt = 4;
-	lcd_cellwid = 5;
-	lcd_cellhgt = 8;
+	/* Wait for the server to say hi and tell us about the display. */
+	if (lcdc_hello(conn, 5000) < 0) {
+		fprintf(stderr, "Error: LCD server %s on port %d did not respond.\n",
+			server, port);
+		return (EXIT_FAILURE);
+	}
+	lcd_wid = conn->wid;
+	lcd_hgt = conn->hgt;
+	lcd_cellwid = conn->cellwid;
+	lcd_cellhgt = conn->cellhgt;
+	protocol_major_version = conn->protocol_major;
+	protocol_minor_version = conn->protocol_minor;
+
+	if (displayname != NULL)
+		lcdc_printf(conn, "client_set -name \"%s\"\n", displayname);
+	else
+		lcdc_printf(conn, "client_set -name {LCDproc %s}\n", get_hostname());
+#ifdef LCDPROC_MENUS
+	menus_init();
+#endif
 
 	if (foreground != TRUE) {
 		if (daemon(1, 0) != 0) {
@@ -475,7 +493,7 @@ HelpScreen(int exit_state)
 		"\n"
 		"Usage: lcdproc [<options>] [<screens> ...]\n"
 		"  where <options> are\n"
-		"    -s <host>           connect to LCDd daemon on <host>\n"
+		"    -s <host>           connect to LCDd daemon on <host> (or Unix socket /path)\n"
 		"    -p <port>           connect to LCDd daemon using <port>\n"
 		"    -f                  run in foreground\n"
 		"    -e <delay>          slow down initial announcement of screens (in 1/100s)\n"
@@ -518,7 +536,7 @@ exit_program(int val)
 	eyebox_clear();
 #endif
 	Quit = 1;
-	sock_close(sock);
+	lcdc_close(conn);
 	mode_close();
 	if ((foreground != TRUE) && (pidfile != NULL) && (pidfile_written == TRUE))
 		unlink(pidfile);
@@ -533,7 +551,7 @@ menus_init()
 
 	for (k = 0; sequence[k].which; k++) {
 		if (sequence[k].longname) {
-			sock_printf(sock, "menu_add_item {} %c checkbox {%s} -value %s\n",
+			lcdc_printf(conn, "menu_add_item {} %c checkbox {%s} -value %s\n",
 				    sequence[k].which, sequence[k].longname,
 			       (sequence[k].flags & ACTIVE) ? "on" : "off");
 		}
@@ -544,34 +562,34 @@ menus_init()
 	 * to be entered on escape from test_menu (but overwritten for
 	 * test_{checkbox,ring}
 	 */
-	sock_send_string(sock, "menu_add_item {} ask menu {Leave menus?} -is_hidden true\n");
-	sock_send_string(sock, "menu_add_item {ask} ask_yes action {Yes} -next _quit_\n");
-	sock_send_string(sock, "menu_add_item {ask} ask_no action {No} -next _close_\n");
-	sock_send_string(sock, "menu_add_item {} test menu {Test}\n");
-	sock_send_string(sock, "menu_add_item {test} test_action action {Action}\n");
-	sock_send_string(sock, "menu_add_item {test} test_checkbox checkbox {Checkbox}\n");
-	sock_send_string(sock, "menu_add_item {test} test_ring ring {Ring} -strings {one\ttwo\tthree}\n");
-	sock_send_string(sock, "menu_add_item {test} test_slider slider {Slider} -mintext < -maxtext > -value 50\n");
-	sock_send_string(sock, "menu_add_item {test} test_numeric numeric {Numeric} -value 42\n");
-	sock_send_string(sock, "menu_add_item {test} test_alpha alpha {Alpha} -value abc\n");
-	sock_send_string(sock, "menu_add_item {test} test_ip ip {IP} -v6 false -value 192.168.1.1\n");
-	sock_send_string(sock, "menu_add_item {test} test_menu menu {Menu}\n");
-	sock_send_string(sock, "menu_add_item {test_menu} test_menu_action action {Submenu's action}\n");
+	lcdc_send_string(conn, "menu_add_item {} ask menu {Leave menus?} -is_hidden true\n");
+	lcdc_send_string(conn, "menu_add_item {ask} ask_yes action {Yes} -next _quit_\n");
+	lcdc_send_string(conn, "menu_add_item {ask} ask_no action {No} -next _close_\n");
+	lcdc_send_string(conn, "menu_add_item {} test menu {Test}\n");
+	lcdc_send_string(conn, "menu_add_item {test} test_action action {Action}\n");
+	lcdc_send_string(conn, "menu_add_item {test} test_checkbox checkbox {Checkbox}\n");
+	lcdc_send_string(conn, "menu_add_item {test} test_ring ring {Ring} -strings {one\ttwo\tthree}\n");
+	lcdc_send_string(conn, "menu_add_item {test} test_slider slider {Slider} -mintext < -maxtext > -value 50\n");
+	lcdc_send_string(conn, "menu_add_item {test} test_numeric numeric {Numeric} -value 42\n");
+	lcdc_send_string(conn, "menu_add_item {test} test_alpha alpha {Alpha} -value abc\n");
+	lcdc_send_string(conn, "menu_add_item {test} test_ip ip {IP} -v6 false -value 192.168.1.1\n");
+	lcdc_send_string(conn, "menu_add_item {test} test_menu menu {Menu}\n");
+	lcdc_send_string(conn, "menu_add_item {test_menu} test_menu_action action {Submenu's action}\n");
 	/*
 	 * no successor for menus. Since test_checkbox and test_ring have
 	 * their own predecessors defined the "ask" rule will not work for
 	 * them.
 	 */
-	sock_send_string(sock, "menu_set_item {} test -prev {ask}\n");
-
-	sock_send_string(sock, "menu_set_item {} test_action -next {test_checkbox}\n");
-	sock_send_string(sock, "menu_set_item {} test_checkbox -next {test_ring} -prev test_action\n");
-	sock_send_string(sock, "menu_set_item {} test_ring -next {test_slider} -prev {test_checkbox}\n");
-	sock_send_string(sock, "menu_set_item {} test_slider -next {test_numeric} -prev {test_ring}\n");
-	sock_send_string(sock, "menu_set_item {} test_numeric -next {test_alpha} -prev {test_slider}\n");
-	sock_send_string(sock, "menu_set_item {} test_alpha -next {test_ip} -prev {test_numeric}\n");
-	sock_send_string(sock, "menu_set_item {} test_ip -next {test_menu} -prev {test_alpha}\n");
-	sock_send_string(sock, "menu_set_item {} test_menu_action -next {_close_}\n");
+	lcdc_send_string(conn, "menu_set_item {} test -prev {ask}\n");
+
+	lcdc_send_string(conn, "menu_set_item {} test_action -next {test_checkbox}\n");
+	lcdc_send_string(conn, "menu_set_item {} test_checkbox -next {test_ring} -prev test_action\n");
+	lcdc_send_string(conn, "menu_set_item {} test_ring -next {test_slider} -prev {test_checkbox}\n");
+	lcdc_send_string(conn, "menu_set_item {} test_slider -next {test_numeric} -prev {test_ring}\n");
+	lcdc_send_string(conn, "menu_set_item {} test_numeric -next {test_alpha} -prev {test_slider}\n");
+	lcdc_send_string(conn, "menu_set_item {} test_alpha -next {test_ip} -prev {test_numeric}\n");
+	lcdc_send_string(conn, "menu_set_item {} test_ip -next {test_menu} -prev {test_alpha}\n");
+	lcdc_send_string(conn, "menu_set_item {} test_menu_action -next {_close_}\n");
 #endif				/* LCDPROC_CLIENT_TESTMENUS */
 
 	return 0;
@@ -579,147 +597,93 @@ menus_init()
 #endif				/* LCDPROC_MENUS */
 
 
+/**
+ * Handle a message of the server that is not a reply to a command.
+ * \param c     Connection to the server.
+ * \param argc  Number of words of the message.
+ * \param argv  Words of the message.
+ * \param data  Unused.
+ */
+static void
+server_event(LcdcConnection *c, int argc, char **argv, void *data)
+{
+	int j;
+
+	if (0 == strcmp(argv[0], "listen") && (argc > 1)) {
+		for (j = 0; sequence[j].which; j++) {
+			if (sequence[j].which == argv[1][0]) {
+				sequence[j].flags |= VISIBLE;
+				debug(RPT_DEBUG, "Listen %s", argv[1]);
+			}
+		}
+	}
+	else if (0 == strcmp(argv[0], "ignore") && (argc > 1)) {
+		for (j = 0; sequence[j].which; j++) {
+			if (sequence[j].which == argv[1][0]) {
+				sequence[j].flags &= ~VISIBLE;
+				debug(RPT_DEBUG, "Ignore %s", argv[1]);
+			}
+		}
+	}
+	else if (0 == strcmp(argv[0], "key") && (argc > 1)) {
+		debug(RPT_DEBUG, "Key %s", argv[1]);
+	}
+#ifdef LCDPROC_MENUS
+	else if (0 == strcmp(argv[0], "menuevent")) {
+		if (argc == 4 && (0 == strcmp(argv[1], "update"))) {
+			set_mode(argv[2][0], "", strcmp(argv[3], "off"));
+		}
+	}
+#endif
+	else if (0 == strcmp(argv[0], "bye")) {
+		exit_program(EXIT_SUCCESS);
+	}
+}
+
+
 /** Main program loop... */
 void
 main_loop(void)
 {
-	int i = 0, j;
-	int connected = 0;
-	char buf[8192];
-	char *argv[256];
-	int argc, newtoken;
-	int len;
+	int i = 0;
 
 	while (!Quit) {
-		/* Check for server input... */
-		len = sock_recv(sock, buf, 8000);
-
 		/* Handle server input... */
-		while (len > 0) {
-			/* Now split the string into tokens... */
-			argc = 0;
-			newtoken = 1;
-
-			for (i = 0; i < len; i++) {
-				switch (buf[i]) {
-					case ' ':
-						newtoken = 1;
-						buf[i] = 0;
-						break;
-					default:	/* regular chars, keep
-							 * tokenizing */
-						if (newtoken)
-							argv[argc++] = buf + i;
-						newtoken = 0;
-						break;
-					case '\0':
-					case '\n':
-						buf[i] = 0;
-						if (argc > 0) {
-							if (0 == strcmp(argv[0], "listen")) {
-								for (j = 0; sequence[j].which; j++) {
-									if (sequence[j].which == argv[1][0]) {
-										sequence[j].flags |= VISIBLE;
-										debug(RPT_DEBUG, "Listen %s", argv[1]);
-									}
-								}
-							}
-							else if (0 == strcmp(argv[0], "ignore")) {
-								for (j = 0; sequence[j].which; j++) {
-									if (sequence[j].which == argv[1][0]) {
-										sequence[j].flags &= ~VISIBLE;
-										debug(RPT_DEBUG, "Ignore %s", argv[1]);
-									}
-								}
-							}
-							else if (0 == strcmp(argv[0], "key")) {
-								debug(RPT_DEBUG, "Key %s", argv[1]);
-							}
-#ifdef LCDPROC_MENUS
-							else if (0 == strcmp(argv[0], "menuevent")) {
-								if (argc == 4 && (0 == strcmp(argv[1], "update"))) {
-									set_mode(argv[2][0], "", strcmp(argv[3], "off"));
-								}
-							}
-#else
-							else if (0 == strcmp(argv[0], "menu")) {
-							}
-#endif
-							else if (0 == strcmp(argv[0], "connect")) {
-								int a;
-								for (a = 1; a < argc; a++) {
-									if (0 == strcmp(argv[a], "wid"))
-										lcd_wid = atoi(argv[++a]);
-									else if (0 == strcmp(argv[a], "hgt"))
-										lcd_hgt = atoi(argv[++a]);
-									else if (0 == strcmp(argv[a], "cellwid"))
-										lcd_cellwid = atoi(argv[++a]);
-									else if (0 == strcmp(argv[a], "cellhgt"))
-										lcd_cellhgt = atoi(argv[++a]);
-									else if (0 == strcmp(argv[a], "protocol"))
-										sscanf(argv[++a], "%d.%d", &protocol_major_version, &protocol_minor_version);
-								}
-								connected = 1;
-								if (displayname != NULL)
-									sock_printf(sock, "client_set -name \"%s\"\n", displayname);
-								else
-									sock_printf(sock, "client_set -name {LCDproc %s}\n", get_hostname());
-#ifdef LCDPROC_MENUS
-								menus_init();
-#endif
-							}
-							else if (0 == strcmp(argv[0], "bye")) {
-								exit_program(EXIT_SUCCESS);
-							}
-							else if (0 == strcmp(argv[0], "success")) {
-							}
-							else {
-								/*
-								int j;
-								for (j = 0; j < argc; j++)
-									printf("%s ", argv[j]);
-								printf("\n");
-								*/
-							}
-						}
-
-						/* Restart tokenizing */
-						argc = 0;
-						newtoken = 1;
-						break;
-				}	/* switch( buf[i] ) */
-			}
-
-			len = sock_recv(sock, buf, 8000);
+		if (lcdc_process_input(conn) < 0) {
+			report(RPT_ERR, "Connection to LCDd lost");
+			exit_program(EXIT_FAILURE);
 		}
 
 		/* Gather stats and update screens */
-		if (connected) {
-			for (i = 0; sequence[i].which > 0; i++) {
-				sequence[i].timer++;
-
-				if (!(sequence[i].flags & ACTIVE))
-					continue;
-
-				if (sequence[i].flags & VISIBLE) {
-					if (sequence[i].timer >= sequence[i].on_time) {
-						sequence[i].timer = 0;
-						/* Now, update the screen... */
-						update_screen(&sequence[i], 1);
-					}
+		for (i = 0; sequence[i].which > 0; i++) {
+			sequence[i].timer++;
+
+			if (!(sequence[i].flags & ACTIVE))
+				continue;
+
+			if (sequence[i].flags & VISIBLE) {
+				if (sequence[i].timer >= sequence[i].on_time) {
+					sequence[i].timer = 0;
+					/* Now, update the screen... */
+					update_screen(&sequence[i], 1);
 				}
-				else {
-					if (sequence[i].timer >= sequence[i].off_time) {
-						sequence[i].timer = 0;
-						/* Now, update the screen... */
-						update_screen(&sequence[i], sequence[i].show_invisible);
-					}
+			}
+			else {
+				if (sequence[i].timer >= sequence[i].off_time) {
+					sequence[i].timer = 0;
+					/* Now, update the screen... */
+					update_screen(&sequence[i], sequence[i].show_invisible);
 				}
-				if (islow > 0)
-					usleep(islow * 10000);
+			}
+			if (islow > 0) {
+				widget_flush();
+				usleep(islow * 10000);
 			}
 		}
 
+		/* Send all changed widgets of this tick at once */
+		widget_flush();
+
 		/* Now sleep... */
 		usleep(TIME_UNIT);
 	}
@@ -13,6 +13,7 @@
 #define MAIN_H
 
 #include "shared/defines.h"
+#include "shared/lcdclient.h"
 
 #ifndef TRUE
 # define TRUE    1
@@ -34,7 +35,7 @@
 #define LCDP_AC_UNKNOWN		0x03
 
 extern int Quit;
-extern int sock;
+extern LcdcConnection *conn;
 extern char *version;
 extern char *build_date;
 
@@ -25,11 +25,12 @@
 # include <strings.h>
 #endif
 
-#include "shared/sockets.h"
+#include "shared/lcdclient.h"
 
 #include "main.h"
 #include "mode.h"
 #include "machine.h"
+#include "util.h"
 #ifdef LCDPROC_EYEBOXONE
 # include "eyebox.h"
 #endif
@@ -83,11 +84,11 @@ update_screen(ScreenMode *m, int display)
 
 	if (status != old_status) {
 		if (status == BACKLIGHT_OFF)
-			sock_send_string(sock, "backlight off\n");
+			lcdc_send_string(conn, "backlight off\n");
 		if (status == BACKLIGHT_ON)
-			sock_send_string(sock, "backlight on\n");
+			lcdc_send_string(conn, "backlight on\n");
 		if (status == BLINK_ON)
-			sock_send_string(sock, "backlight blink\n");
+			lcdc_send_string(conn, "backlight blink\n");
 	}
 
 	return (status);
@@ -187,27 +188,27 @@ credit_screen(int rep, int display, int *flags_ptr)
 		for (contr_num = 0; contributors[contr_num] != NULL; contr_num++)
 			;	/* NADA */
 
-		sock_send_string(sock, "screen_add A\n");
-		sock_send_string(sock, "screen_set A -name {Credits for LCDproc}\n");
-		sock_send_string(sock, "widget_add A title title\n");
-		sock_printf(sock, "widget_set A title {LCDPROC %s}\n", version);
+		lcdc_send_string(conn, "screen_add A\n");
+		lcdc_send_string(conn, "screen_set A -name {Credits for LCDproc}\n");
+		lcdc_send_string(conn, "widget_add A title title\n");
+		widget_set("A title {LCDPROC %s}", version);
 		if (lcd_hgt >= 4) {
-			sock_send_string(sock, "widget_add A text scroller\n");
-			sock_printf(sock, "widget_set A text 1 2 %d 2 h 8 {%s}\n",
-				    lcd_wid, "LCDproc was brought to you by:");
+			lcdc_send_string(conn, "widget_add A text scroller\n");
+			widget_set("A text 1 2 %d 2 h 8 {%s}",
+				   lcd_wid, "LCDproc was brought to you by:");
 		}
 
 		/* frame from (2nd/3rd line, left) to (last line, right) */
-		sock_send_string(sock, "widget_add A f frame\n");
-		sock_printf(sock, "widget_set A f 1 %i %i %i %i %i v %i\n",
-			    ((lcd_hgt >= 4) ? 3 : 2), lcd_wid, lcd_hgt, lcd_wid, contr_num,
-			    /* scroll rate: 1 line every X ticks (= 1/8 sec) */
-			    ((lcd_hgt >= 4) ? 8 : 12));
+		lcdc_send_string(conn, "widget_add A f frame\n");
+		widget_set("A f 1 %i %i %i %i %i v %i",
+			   ((lcd_hgt >= 4) ? 3 : 2), lcd_wid, lcd_hgt, lcd_wid, contr_num,
+			   /* scroll rate: 1 line every X ticks (= 1/8 sec) */
+			   ((lcd_hgt >= 4) ? 8 : 12));
 
 		/* frame contents */
 		for (i = 1; i < contr_num; i++) {
-			sock_printf(sock, "widget_add A c%i string -in f\n", i);
-			sock_printf(sock, "widget_set A c%i 1 %i {%s}\n", i, i, contributors[i]);
+			lcdc_printf(conn, "widget_add A c%i string -in f\n", i);
+			widget_set("A c%i 1 %i {%s}", i, i, contributors[i]);
 		}
 	}
 
@@ -21,11 +21,39 @@
  */
 
 #include <sys/types.h>
-#include "shared/sockets.h"
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include "shared/lcdclient.h"
+#include "shared/report.h"
 #include "main.h"
 #include "util.h"
 
 
+/** Number of hash buckets of the widget state cache */
+#define WIDGET_CACHE_BUCKETS	256
+
+/** Cached parameters of a widget, as last sent to the server */
+typedef struct widget_cache_entry {
+	struct widget_cache_entry *next;	/**< Next entry in hash chain */
+	char *key;				/**< "<screen> <widget>" */
+	size_t keylen;				/**< Length of \c key */
+	char *value;				/**< Parameters after the key */
+	unsigned long serial;			/**< Serial number of the update that sent value */
+} WidgetCacheEntry;
+
+static WidgetCacheEntry *widget_cache[WIDGET_CACHE_BUCKETS];
+
+/** Serial number of the last cached update sent */
+static unsigned long widget_serial = 0;
+
+static void widget_cache_forget(const char *key, size_t keylen);
+
+/* statistics */
+static unsigned long widget_updates_sent = 0;
+static unsigned long widget_updates_suppressed = 0;
+
+
 /** Print a memory value with the correct unit to a given string.
  * \param *dst        String to print the value to.
  * \param value       Value to print.
@@ -110,13 +138,13 @@ pbar_widget_add(const char *screen, const char *name)
 {
 
 	if (check_protocol_version(0, 4)) {
-		sock_printf(sock, "widget_add %s %s pbar\n", screen, name);
+		lcdc_printf(conn, "widget_add %s %s pbar\n", screen, name);
 	} else {
-		sock_printf(sock, "widget_add %s %s-begin-label string\n",
+		lcdc_printf(conn, "widget_add %s %s-begin-label string\n",
 			    screen, name);
-		sock_printf(sock, "widget_add %s %s hbar\n",
+		lcdc_printf(conn, "widget_add %s %s hbar\n",
 			    screen, name);
-		sock_printf(sock, "widget_add %s %s-end-label string\n",
+		lcdc_printf(conn, "widget_add %s %s-end-label string\n",
 			    screen, name);
 	}
 }
@@ -142,13 +170,13 @@ pbar_widget_set(const char *screen, const char *name, int x, int y, int width,
 
 	if (check_protocol_version(0, 4)) {
 		if (begin_label || end_label)
-			sock_printf(sock, "widget_set %s %s %d %d %d %d {%s} {%s}\n",
-				    screen, name, x, y, width, promille,
-				    begin_label ? begin_label : "",
-				    end_label ? end_label : "");
+			widget_set("%s %s %d %d %d %d {%s} {%s}",
+				   screen, name, x, y, width, promille,
+				   begin_label ? begin_label : "",
+				   end_label ? end_label : "");
 		else
-			sock_printf(sock, "widget_set %s %s %d %d %d %d\n",
-				    screen, name, x, y, width, promille);
+			widget_set("%s %s %d %d %d %d",
+				   screen, name, x, y, width, promille);
 		return;
 	}
 
@@ -180,18 +208,278 @@ pbar_widget_set(const char *screen, const char *name, int x, int y, int width,
 
 	len = width - begin_length - end_length;
 
-	sock_printf(sock, "widget_set %s %s-begin-label %d %d {%s}\n",
-		    screen, name, x, y, begin_label);
+	widget_set("%s %s-begin-label %d %d {%s}",
+		   screen, name, x, y, begin_label);
 	x += begin_length;
 
 	/* hbar takes number of pixels to fill as 3th argument */
 	hbar_pixels = (promille * lcd_cellwid * len + 500) / 1000;
-	sock_printf(sock, "widget_set %s %s %d %d %d\n",
-		    screen, name, x, y, hbar_pixels);
+	widget_set("%s %s %d %d %d",
+		   screen, name, x, y, hbar_pixels);
 	x += len;
 
-	sock_printf(sock, "widget_set %s %s-end-label %d %d {%s}\n",
-		    screen, name, x, y, end_label);
+	widget_set("%s %s-end-label %d %d {%s}",
+		   screen, name, x, y, end_label);
+}
+
+
+/** Hash the key of a widget cache entry. */
+static unsigned int
+widget_cache_hash(const char *key, size_t keylen)
+{
+	unsigned int hash = 5381;
+
+	while (keylen-- > 0)
+		hash = (hash << 5) + hash + (unsigned char) *key++;
+
+	return hash % WIDGET_CACHE_BUCKETS;
+}
+
+
+/**
+ * Reply handler of cached widget updates. If the server rejected an update,
+ * the cache entry holding its value is dropped, so the next update of the
+ * widget is sent even if its parameters did not change. An entry that was
+ * deleted or got a newer value since is left alone.
+ * \param data  Serial number of the update.
+ */
+static void
+widget_set_reply(LcdcConnection *c, int success, const char *reply, void *data)
+{
+	unsigned long serial = (unsigned long) (uintptr_t) data;
+	int i;
+
+	if (success)
+		return;
+
+	for (i = 0; i < WIDGET_CACHE_BUCKETS; i++) {
+		WidgetCacheEntry **prev = &widget_cache[i];
+		WidgetCacheEntry *entry;
+
+		while ((entry = *prev) != NULL) {
+			if (entry->serial == serial) {
+				*prev = entry->next;
+				free(entry->key);
+				free(entry->value);
+				free(entry);
+				return;
+			}
+			prev = &entry->next;
+		}
+	}
+}
+
+
+/**
+ * Queue a command line behind the other commands of this tick.
+ * \param entry  Cache entry of a widget update, or NULL.
+ */
+static void
+widget_queue(const char *cmd, const char *line, size_t len, WidgetCacheEntry *entry)
+{
+	if (entry != NULL) {
+		entry->serial = ++widget_serial;
+		lcdc_command(conn, widget_set_reply, (void *) (uintptr_t) entry->serial,
+			     "%s%.*s", cmd, (int) len, line);
+	}
+	else
+		lcdc_printf(conn, "%s%.*s\n", cmd, (int) len, line);
+}
+
+
+/**
+ * Set the parameters of a widget, but only if they differ from the values
+ * sent last time. Changed updates are queued and sent by widget_flush().
+ * \param format  printf-like format of the widget_set arguments, starting
+ *                with screen and widget id (e.g. "C usr %i 2 {%5s}").
+ * \return  1 if the update was queued, 0 if it was suppressed.
+ */
+int
+widget_set(const char *format, ...)
+{
+	char buf[1000];		/* leaves room for "widget_set " in lcdc_command() */
+	char *line = buf;
+	char *value;
+	size_t keylen;
+	unsigned int hash;
+	WidgetCacheEntry *entry;
+	va_list ap;
+	int len;
+
+	va_start(ap, format);
+	len = vsnprintf(buf, sizeof(buf), format, ap);
+	va_end(ap);
+	if (len < 0)
+		return 0;
+
+	if (len >= sizeof(buf)) {
+		if ((line = malloc(len + 1)) == NULL)
+			return 0;
+		va_start(ap, format);
+		vsnprintf(line, len + 1, format, ap);
+		va_end(ap);
+	}
+
+	/* the key consists of the screen and widget ids */
+	value = strchr(line, ' ');
+	if (value != NULL)
+		value = strchr(value + 1, ' ');
+	if (value == NULL) {
+		/* malformed, let the server complain about it */
+		widget_queue("widget_set ", line, len, NULL);
+		goto done;
+	}
+	keylen = value - line;
+	value++;
+
+	if (line != buf) {
+		/* too long to be cached */
+		widget_cache_forget(line, keylen);
+		widget_queue("widget_set ", line, len, NULL);
+		widget_updates_sent++;
+		goto done;
+	}
+
+	hash = widget_cache_hash(line, keylen);
+	for (entry = widget_cache[hash]; entry != NULL; entry = entry->next) {
+		if ((entry->keylen == keylen) && (memcmp(entry->key, line, keylen) == 0))
+			break;
+	}
+
+	if (entry != NULL) {
+		if (strcmp(entry->value, value) == 0) {
+			widget_updates_suppressed++;
+			if (line != buf)
+				free(line);
+			return 0;
+		}
+		free(entry->value);
+		if ((entry->value = strdup(value)) == NULL) {
+			widget_cache_forget(line, keylen);
+			entry = NULL;
+		}
+	}
+	else if ((entry = malloc(sizeof(WidgetCacheEntry))) != NULL) {
+		entry->key = strndup(line, keylen);
+		entry->keylen = keylen;
+		entry->value = strdup(value);
+		entry->serial = 0;
+		if ((entry->key != NULL) && (entry->value != NULL)) {
+			entry->next = widget_cache[hash];
+			widget_cache[hash] = entry;
+		}
+		else {
+			/* not cached, the next update is simply sent again */
+			free(entry->key);
+			free(entry->value);
+			free(entry);
+			entry = NULL;
+		}
+	}
+
+	widget_queue("widget_set ", line, len, entry);
+	widget_updates_sent++;
+
+done:
+	if (line != buf)
+		free(line);
+	return 1;
+}
+
+
+/**
+ * Remove a single entry from the widget cache.
+ * \param key     Key of the entry ("<screen> <widget>").
+ * \param keylen  Length of key.
+ */
+static void
+widget_cache_forget(const char *key, size_t keylen)
+{
+	WidgetCacheEntry **prev = &widget_cache[widget_cache_hash(key, keylen)];
+	WidgetCacheEntry *entry;
+
+	while ((entry = *prev) != NULL) {
+		if ((entry->keylen == keylen) && (memcmp(entry->key, key, keylen) == 0)) {
+			*prev = entry->next;
+			free(entry->key);
+			free(entry->value);
+			free(entry);
+			return;
+		}
+		prev = &entry->next;
+	}
+}
+
+
+/**
+ * Delete a widget. The command is queued behind pending updates so ordering
+ * is preserved, and the widget's cached state is forgotten so a widget
+ * re-added under the same name gets its first update sent.
+ * \param format  printf-like format of the screen and widget id (e.g. "D s%i").
+ */
+void
+widget_del(const char *format, ...)
+{
+	char key[256];
+	va_list ap;
+	int len;
+
+	va_start(ap, format);
+	len = vsnprintf(key, sizeof(key), format, ap);
+	va_end(ap);
+	if ((len < 0) || (len >= sizeof(key)))
+		return;
+
+	widget_cache_forget(key, len);
+	widget_queue("widget_del ", key, len, NULL);
+}
+
+
+/**
+ * Forget the cached state of all widgets of a screen. Must be called when
+ * the screen is deleted on the server.
+ * \param screen  Name of the screen.
+ */
+void
+widget_cache_clear(const char *screen)
+{
+	size_t screenlen = strlen(screen);
+	int i;
+
+	for (i = 0; i < WIDGET_CACHE_BUCKETS; i++) {
+		WidgetCacheEntry **prev = &widget_cache[i];
+		WidgetCacheEntry *entry;
+
+		while ((entry = *prev) != NULL) {
+			if ((entry->keylen > screenlen) &&
+			    (entry->key[screenlen] == ' ') &&
+			    (strncmp(entry->key, screen, screenlen) == 0)) {
+				*prev = entry->next;
+				free(entry->key);
+				free(entry->value);
+				free(entry);
+			}
+			else
+				prev = &entry->next;
+		}
+	}
+}
+
+
+/**
+ * Send all queued commands, including the widget updates, to the server.
+ * \return  Result of lcdc_flush(), or 0 if nothing was queued.
+ */
+int
+widget_flush(void)
+{
+	if (conn->outlen == 0)
+		return 0;
+
+	debug(RPT_DEBUG, "%s: %lu widget updates sent, %lu suppressed", __FUNCTION__,
+	      widget_updates_sent, widget_updates_suppressed);
+
+	return lcdc_flush(conn);
 }
 
 /* EOF */
@@ -33,4 +33,16 @@ void pbar_widget_add(const char *screen, const char *name);
 void pbar_widget_set(const char *screen, const char *name, int x, int y, int width,
 		     int promille, char *begin_label, char *end_label);
 
+/** set widget parameters, suppressing the update if they did not change */
+int widget_set(const char *format, .../*args*/);
+
+/** delete a widget and forget its cached state */
+void widget_del(const char *format, .../*args*/);
+
+/** forget the cached state of all widgets on a screen */
+void widget_cache_clear(const char *screen);
+
+/** send all queued widget updates to the server */
+int widget_flush(void);
+
 #endif
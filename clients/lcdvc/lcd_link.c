@@ -26,26 +26,29 @@
 #include "lcdvc.h"
 #include "shared/report.h"
 #include "shared/str.h"
-#include "shared/sockets.h"
+#include "shared/lcdclient.h"
 
 char *address = UNSET_STR;
 int port = UNSET_INT;
 short autoscroll = 1;
 
-int sock;
+LcdcConnection *conn = NULL;
 short listening = 0;
 short scroll_x = 0, scroll_y = 0;
 short lcd_cursor_x, lcd_cursor_y;
 short lcd_width = 0, lcd_height = 0;
 char *lcd_buf = NULL;
 
+/* Preallocated buffer holding all commands of one display update */
+static char *send_buf = NULL;
+static size_t send_buf_size = 0;
+
 short last_vc_cursor_y = 0;
 short last_vc_cursor_x = 0;
 short last_lcd_cursor_x = 0;
 short last_lcd_cursor_y = 0;
 
-static int read_connect_string(void);
-static int split(char *str, char delim, char *parts[], int maxparts);
+static void server_event(LcdcConnection *c, int argc, char **argv, void *data);
 
 
 int setup_connection(void)
@@ -57,38 +60,56 @@ int setup_connection(void)
 
 	report(RPT_INFO, "Connecting to %s:%d", address, port);
 
-	sock = sock_connect(address, port);
-	if (sock < 0) {
+	conn = lcdc_connect(address, port);
+	if (conn == NULL) {
 		report(RPT_ERR, "Connecting to %s:%d failed", address, port);
 		return -1;
 	}
-	/* Create our menu */
-	sock_send_string(sock, "hello\n");
-	if (read_connect_string() < 0) {
+	lcdc_set_handler(conn, server_event, NULL);
+
+	/* Give the server 5 secs to respond */
+	if (lcdc_hello(conn, 5000) < 0) {
+		return -1;
+	}
+	lcd_width = conn->wid;
+	lcd_height = conn->hgt;
+	if (lcd_width == 0 || lcd_height == 0) {
+		report(RPT_ERR, "Received invalid LCDd connect response.");
+		return -1;
+	}
+
+	/* Allocate the display buffers once we know the display size */
+	lcd_buf = malloc(lcd_width * lcd_height);
+	send_buf_size = 80 + lcd_height * (80 + 2 * lcd_width) + 1;
+	send_buf = malloc(send_buf_size);
+	if (lcd_buf == NULL || send_buf == NULL) {
+		report(RPT_ERR, "malloc failure: %s", strerror(errno));
 		return -1;
 	}
+	memset(lcd_buf, ' ', lcd_width * lcd_height);
 
 	snprintf(buf, sizeof(buf)-1, "client_set -name \"%s\"\n", progname);
-	sock_send_string(sock, buf);
+	lcdc_send_string(conn, buf);
 
 	/* Create screen */
-	CHAIN(e, sock_send_string(sock, "screen_add console\n"));
+	CHAIN(e, lcdc_send_string(conn, "screen_add console\n"));
 	for (line = 0; line < lcd_height; line++) {
 		snprintf(buf, sizeof(buf)-1, "widget_add console line%d string\n", line);
 		buf[sizeof(buf)-1] = 0;
-		CHAIN(e, sock_send_string(sock, buf));
+		CHAIN(e, lcdc_send_string(conn, buf));
 	}
 	/* Add menu items */
-	CHAIN(e, sock_send_string(sock, "menu_add_item \"\" autoscroll checkbox \"Auto scroll\"\n"));
-	CHAIN(e, sock_send_string(sock, "menu_set_item \"\" autoscroll -value on\n"));
+	CHAIN(e, lcdc_send_string(conn, "menu_add_item \"\" autoscroll checkbox \"Auto scroll\"\n"));
+	CHAIN(e, lcdc_send_string(conn, "menu_set_item \"\" autoscroll -value on\n"));
 
 	/* Reserve keys */
 
 	for (i = 0; i < 4; i++) {
 		snprintf(buf, sizeof(buf)-1, "client_add_key \"%s\"\n", keys[i]);
-		CHAIN(e, sock_send_string(sock, buf));
+		CHAIN(e, lcdc_send_string(conn, buf));
 	}
 
+	CHAIN(e, lcdc_flush(conn));
 	if (e < 0) {
 		report(RPT_ERR, "Could not send to to LCDd");
 		return -1;
@@ -100,111 +121,46 @@ int setup_connection(void)
 
 int teardown_connection(void)
 {
-	sock_close(sock);
-
-	return 0;
-}
-
-
-static int read_connect_string(void)
-{
-	char buf[8192];
-	int len = 0;
-	int a;
-	char *argv[20];
-	int argc;
-	short received = 0;
-	short timeout = 50; /* Give the server 5 secs to respond */
-
-	buf[0] = '\0';
-
-	while (!received && timeout > 0) {
-		len = sock_recv_string(sock, buf, sizeof(buf));
-		if (len == 0) {
-			usleep(100000);
-			timeout --;
-		} else {
-			received = 1;
-		}
-	}
-	report(RPT_INFO, "Received: %s", buf);
-
-	if (len <= 0) {
-		report(RPT_ERR, "Did not receive LCDd connect response.");
-		return -1;
-	}
+	lcdc_close(conn);
+	conn = NULL;
+	free(send_buf);
+	send_buf = NULL;
+	free(lcd_buf);
+	lcd_buf = NULL;
 
-	argc = split(buf, ' ', argv, 20);
-	for (a = 1; a < argc; a++) {
-		if (0 == strcmp(argv[a], "wid"))
-			lcd_width = atoi(argv[++a]);
-		else if (0 == strcmp(argv[a], "hgt"))
-			lcd_height = atoi(argv[++a]);
-	}
-	if (argc <= 0 || strcmp(argv[0], "connect") != 0
-	|| lcd_width == 0 || lcd_width == 0) {
-		report(RPT_ERR, "Received invalid LCDd connect response.");
-		return -1;
-	}
 	return 0;
 }
 
 
 /**
- * Splits a string into parts, to which pointers will be returned in &parts.
- * The return value is the number of parts.
- * maxparts is the maximum number of parts returned. If more parts exist
- * they are (unsplit) in the last part.
- * The parts are split at the character delim.
- * No new space will be allocated, the string str will be mutated !
+ * Return the file descriptor of the server connection, to be watched for
+ * incoming responses.
  */
-static int split(char *str, char delim, char *parts[], int maxparts)
+int lcd_poll_fd(void)
 {
-	char *p1 = str;
-	char *p2;
-	int part_nr = 0;
-
-	/* Find the delim char to end the current part */
-	while (part_nr < maxparts - 1 && (p2 = strchr(p1, delim))) {
-
-		/* subsequent parts... */
-		*p2 = 0;
-		parts[part_nr] = p1;
-
-		p1 = p2 + 1; /* Just after the delim char */
-		part_nr ++;
-	}
-	/* and the last part... */
-	parts[part_nr] = p1;
-	part_nr ++;
-
-	return part_nr;
+	return conn->fd;
 }
 
 
-int read_response(char *buf, int maxsize)
+/**
+ * Read all available messages of the server and handle them.
+ * \return  Number of messages read, or -1 if the connection was lost.
+ */
+int process_input(void)
 {
-	return sock_recv_string(sock, buf, maxsize);
+	return lcdc_process_input(conn);
 }
 
 
-int process_response(char *str)
+/**
+ * Handle a message of the server that is not a reply to a command.
+ * \param c     Connection to the server.
+ * \param argc  Number of words of the message.
+ * \param argv  Words of the message.
+ * \param data  Unused.
+ */
+static void server_event(LcdcConnection *c, int argc, char **argv, void *data)
 {
-	char *argv[10];
-	int argc;
-	//int i;
-	//char *p;
-	char *str2 = strdup(str); /* get_args modifies str2 */
-
-	report(RPT_DEBUG, "Server said: \"%s\"", str);
-
-	/* Check what the server just said to us... */
-	argc = get_args(argv, str2, 10);
-	if (argc < 1) {
-		free(str2);
-		return 0;
-	}
-
 	if (strcmp(argv[0], "listen") == 0) {
 		listening = 1;
 	}
@@ -215,14 +171,12 @@ int process_response(char *str)
 		/* Ah, this is what we were waiting for ! */
 		if (argc < 2) {
 			report(RPT_WARNING, "Server gave invalid response");
-			free(str2);
-			return -1;
+			return;
 		}
 		else if (strcmp(argv[1], "update") == 0) {
 			if (argc < 4) {
 				report(RPT_WARNING, "Server gave invalid response");
-				free(str2);
-				return -1;
+				return;
 			}
 			if (strcmp(argv[2], "autoscroll") == 0) {
 				if (strcmp(argv[3], "on") == 0) {
@@ -240,8 +194,7 @@ int process_response(char *str)
 	else if (strcmp(argv[0], "key") == 0) {
 		if (argc < 2) {
 			report(RPT_WARNING, "Server gave invalid response");
-			free(str2);
-			return -1;
+			return;
 		}
 		if (strcmp(argv[1], keys[0]) == 0) {
 			if (scroll_y > 0) scroll_y --;
@@ -253,38 +206,23 @@ int process_response(char *str)
 			if (scroll_x + lcd_width < vc_width) scroll_x ++;
 		}
 	}
-	else if (strcmp(argv[0], "huh?") == 0) {
-		/* Report errors */
-		report(RPT_WARNING, "Server said: \"%s\"", str);
-	}
 	else {
-		; /* Ignore all other responses */
+		; /* Ignore all other messages */
 	}
-	free(str2);
-	return 0;
-
 }
 
 
 int update_display(void)
 {
-	//int bytes_read;
 	short line;
-	int e = 0;
-	char buf[80];
-	char *str_buf;
+	char *a;
 	short num_lines;
+
 	num_lines = min(lcd_height, vc_height);
 
 	if (!listening)
 		return 0;
 
-	if (!lcd_buf) {
-		/* Not yet allocated */
-		lcd_buf = malloc(lcd_width * lcd_height);
-		memset(lcd_buf, ' ', lcd_width * lcd_height);
-	}
-
 	if (autoscroll
 	&& (last_vc_cursor_x != vc_cursor_x || last_vc_cursor_y != vc_cursor_y)) {
 		last_vc_cursor_x = vc_cursor_x;
@@ -300,6 +238,10 @@ int update_display(void)
 		if (scroll_y < vc_cursor_y - lcd_height + 1)
 			scroll_y = vc_cursor_y - lcd_height + 1;
 	}
+
+	/* All commands are collected in send_buf and sent at once */
+	a = send_buf;
+
 	lcd_cursor_x = vc_cursor_x - scroll_x + 1;
 	lcd_cursor_y = vc_cursor_y - scroll_y + 1;
 	if (lcd_cursor_x != last_lcd_cursor_x || lcd_cursor_y != last_lcd_cursor_y) {
@@ -309,17 +251,14 @@ int update_display(void)
 		/* New scroll positions, send the cursor command */
 		if (lcd_cursor_x < 1 || lcd_cursor_x > lcd_width
 		|| lcd_cursor_y < 1 || lcd_cursor_y > lcd_height) {
-			snprintf(buf, sizeof(buf)-1, "screen_set console -cursor off\n");
+			a += snprintf(a, 80, "screen_set console -cursor off\n");
 		} else {
-			snprintf(buf, sizeof(buf)-1, "screen_set console -cursor on -cursor_x %d -cursor_y %d\n",
+			a += snprintf(a, 80, "screen_set console -cursor on -cursor_x %d -cursor_y %d\n",
 					lcd_cursor_x, lcd_cursor_y);
 		}
-		buf[sizeof(buf)-1] = 0;
-		CHAIN(e, sock_send_string(sock, buf));
 	}
 
-	/* Send all (changed) lines */
-	str_buf = malloc(80 + 2 * lcd_width);
+	/* Add all changed lines */
 	for (line = 0; line < num_lines; line++) {
 
 		char *vc_p;
@@ -335,13 +274,10 @@ int update_display(void)
 		/* Has the line data changed ? */
 		if (memcmp(vc_p, lcd_p, line_width) != 0) {
 			/* Yes, so send it */
-			char *a;
 			short pos;
 
 			/* Format/escape the data */
-			snprintf(str_buf, 80, "widget_set console line%d 1 %d \"", line, line+1);
-
-			a = str_buf + strlen(str_buf); /* start just after the " */
+			a += snprintf(a, 80, "widget_set console line%d 1 %d \"", line, line+1);
 			for (pos = 0; pos < line_width; pos++) {
 				if (vc_p[pos] == '\\' || vc_p[pos] == '\"') {
 					*a++ = '\\'; /* add escape char */
@@ -354,17 +290,16 @@ int update_display(void)
 			}
 			*a++ = '\"'; /* end string */
 			*a++ = '\n'; /* newline */
-			*a = 0; /* terminate */
-			CHAIN(e, sock_send_string(sock, str_buf));
 
 			/* And store the new data */
 			memcpy(lcd_p, vc_p, line_width);
 
 		}
 	}
-	free(str_buf);
 
-	if (e < 0) {
+	*a = '\0';
+	if (a > send_buf
+	&& (lcdc_send_string(conn, send_buf) < 0 || lcdc_flush(conn) < 0)) {
 		report(RPT_ERR, "Error while sending data to LCDd");
 		return -1;
 	}
@@ -375,5 +310,5 @@ int update_display(void)
 
 int send_nop(void)
 {
-	return sock_send_string(sock, "\n");
+	return lcdc_send_string(conn, "\n");
 }
@@ -6,8 +6,8 @@ extern int port;
 
 int setup_connection(void);
 int teardown_connection(void);
-int read_response(char *str, int maxsize);
-int process_response(char *str);
+int lcd_poll_fd(void);
+int process_input(void);
 int update_display(void);
 int send_nop(void);
 
@@ -21,6 +21,8 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <poll.h>
+#include <time.h>
 
 #include "getopt.h"
 
@@ -41,6 +43,13 @@
 #define DEFAULT_CONFIGFILE	SYSCONFDIR "/lcdvc.conf"
 #define DEFAULT_PIDFILE		PIDFILEDIR "/lcdvc.pid"
 
+/** Interval (in ms) to re-read the console if no change was signalled */
+#define VC_IDLE_INTERVAL	1000
+/** Interval (in ms) to re-read the console if it cannot signal changes */
+#define VC_FALLBACK_INTERVAL	50
+/** Interval (in s) to send an empty line to check the server still exists */
+#define NOP_INTERVAL		3
+
 
 char *help_text =
 "lcdvc - LCDproc virtual console\n"
@@ -51,7 +60,7 @@ char *help_text =
 "Usage: lcdvc [<options>]\n"
 "  where <options> are:\n"
 "    -c <file>           Specify configuration file ["DEFAULT_CONFIGFILE"]\n"
-"    -a <address>        DNS name or IP address of the LCDd server [localhost]\n"
+"    -a <address>        DNS name, IP address or Unix socket of the LCDd server [localhost]\n"
 "    -p <port>           port of the LCDd server [13666]\n"
 "    -f                  Run in foreground\n"
 "    -r <level>          Set reporting level (0-5) [2: errors and warnings]\n"
@@ -268,33 +277,67 @@ static int process_configfile(char *configfile)
 
 static int main_loop(void)
 {
-	int num_bytes;
-	char buf[80];
-	short w = 0;
+	struct pollfd fds[2];
+	int timeout = VC_IDLE_INTERVAL;
+	time_t last_nop = time(NULL);
+
+	/* Wait for server responses and console changes */
+	fds[0].fd = lcd_poll_fd();
+	fds[0].events = POLLIN;
+	fds[1].fd = vc_poll_fd();
+	fds[1].events = POLLPRI;
+
+	if (read_vcdata() < 0)
+		return -1;
+
+	while (!Quit) {
+		int ret = poll(fds, 2, timeout);
+		int changed = 0;
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			report(RPT_ERR, "poll failed: %s", strerror(errno));
+			break;
+		}
+
+		if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+			if (process_input() < 0)
+				break;
+			/* listen or scroll keys may require an update */
+			changed = 1;
+		}
 
-	/* Continuously check if we get a menu event... */
+		if (fds[1].revents & POLLERR) {
+			/*
+			 * The console cannot notify us (old kernel or console
+			 * deallocated): fall back to periodic polling.
+			 */
+			report(RPT_WARNING, "%s does not signal changes, polling it", vcsa_device);
+			fds[1].fd = -1;
+			timeout = VC_FALLBACK_INTERVAL;
+		}
 
-	while (!Quit && ((num_bytes = read_response(buf, sizeof(buf)-1)) >= 0)) {
-		if (num_bytes != 0) {
-			process_response(buf);
+		/* On timeout re-read anyway, in case a change went unnoticed */
+		if ((fds[1].revents & POLLPRI) || (fds[1].fd < 0) || (ret == 0)) {
+			if (read_vcdata() < 0)
+				break;
+			changed = 1;
 		}
-		else {
-			read_vcdata();
-			update_display();
-
-			/* Send an empty line every 3 seconds to make sure the server still exists */
-			if (w++ >= 60) {
-				w = 0;
-				if (send_nop() < 0) {
-					break; /* Out of while loop */
-				}
+
+		if (changed && update_display() < 0)
+			break;
+
+		/* Send an empty line every few seconds to make sure the server still exists */
+		if (time(NULL) - last_nop >= NOP_INTERVAL) {
+			last_nop = time(NULL);
+			if (send_nop() < 0) {
+				break; /* Out of while loop */
 			}
-			usleep(50000);
 		}
 	}
 
 	if (!Quit)
-		report(RPT_WARNING, "Server disconnected %d", num_bytes);
+		report(RPT_WARNING, "Server disconnected");
 	return 0;
 }
-
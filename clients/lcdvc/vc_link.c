@@ -49,6 +49,16 @@ int open_vcs(void)
 }
 
 
+/**
+ * Return the file descriptor to watch for console changes. Linux signals
+ * updates of the console contents and cursor with POLLPRI on /dev/vcsaX.
+ */
+int vc_poll_fd(void)
+{
+	return vcsa;
+}
+
+
 int read_vcdata(void)
 {
 	unsigned short new_vc_height;
@@ -6,6 +6,7 @@ extern unsigned short vc_cursor_x, vc_cursor_y;
 extern char *vc_buf;
 
 int open_vcs(void);
+int vc_poll_fd(void);
 int read_vcdata(void);
 
 #endif
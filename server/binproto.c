@@ -0,0 +1,291 @@
+/** \file server/binproto.c
+ * Binary framing of client messages.
+ *
+ * A client saying "hello binary" sends length-prefixed frames instead of
+ * text lines from then on (see shared/lcdbinary.h for the format). Frames
+ * are queued in the client's message list like text messages, marked by a
+ * leading NUL byte, so they are scheduled just like them. Control commands
+ * still use the text syntax inside LCDB_OP_COMMAND frames, but widget
+ * updates address the widget by the handle widget_add returned and carry
+ * fixed-width integers, so they need neither tokenizing nor id lookups.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "shared/report.h"
+#include "shared/sockets.h"
+#include "shared/lcdbinary.h"
+#include "shared/defines.h"
+
+#include "client.h"
+#include "screen.h"
+#include "widget.h"
+#include "drivers.h"
+#include "binproto.h"
+
+
+/**
+ * Switch a client to binary frames. All data received after its
+ * "hello binary" line is split into frames.
+ * \param c  The client.
+ * \retval 0   Success.
+ * \retval <0  Error allocating memory.
+ */
+int
+binproto_enable(Client *c)
+{
+	if (c->frame_buf == NULL) {
+		c->frame_buf = malloc(LCDB_MAX_FRAME);
+		if (c->frame_buf == NULL) {
+			report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+			return -1;
+		}
+	}
+	c->frame_len = 0;
+	c->binary = 1;
+
+	return 0;
+}
+
+
+/**
+ * Free the frame buffer and the handle table of a client.
+ * \param c  The client.
+ */
+void
+binproto_destroy(Client *c)
+{
+	free(c->frame_buf);
+	c->frame_buf = NULL;
+	free(c->handles);
+	c->handles = NULL;
+	c->handles_size = 0;
+}
+
+
+/**
+ * Split received data into frames and add complete ones to the client's
+ * messages. Incomplete frames are kept until the rest arrives.
+ * \param c     The client.
+ * \param data  Received data.
+ * \param len   Number of bytes received.
+ * \retval 0    Success.
+ * \retval <0   Invalid frame or error allocating memory; the client has
+ *              to be disconnected.
+ */
+int
+binproto_read(Client *c, const char *data, int len)
+{
+	while (len > 0) {
+		int want, n;
+
+		if (c->frame_len < 2) {
+			want = 2;
+		}
+		else {
+			want = 2 + LCDB_GET16(c->frame_buf);
+			if ((want < LCDB_HEADER_SIZE) || (want > LCDB_MAX_FRAME)) {
+				report(RPT_WARNING, "Invalid frame length %d from client on socket %i",
+					want, c->sock);
+				return -1;
+			}
+		}
+
+		n = min(want - c->frame_len, len);
+		memcpy(c->frame_buf + c->frame_len, data, n);
+		c->frame_len += n;
+		data += n;
+		len -= n;
+
+		if ((c->frame_len == want) && (want > 2)) {
+			if (client_add_frame(c, c->frame_buf, want) < 0)
+				return -1;
+			c->frame_len = 0;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * Give a widget a handle for binary frames. Free handles are reused.
+ * \param c  The client owning the widget.
+ * \param w  The widget.
+ * \return  The handle, or -1 if no handle is available.
+ */
+int
+binproto_add_handle(Client *c, Widget *w)
+{
+	int h;
+
+	for (h = 0; h < c->handles_size; h++) {
+		if (c->handles[h] == NULL)
+			break;
+	}
+
+	if (h == c->handles_size) {
+		int newsize = (c->handles_size > 0) ? 2 * c->handles_size : 16;
+		void **tmp;
+
+		newsize = min(newsize, LCDB_MAX_HANDLES);
+		if (newsize <= h)
+			return -1;
+		tmp = realloc(c->handles, newsize * sizeof(void *));
+		if (tmp == NULL)
+			return -1;
+		memset(tmp + c->handles_size, 0, (newsize - c->handles_size) * sizeof(void *));
+		c->handles = tmp;
+		c->handles_size = newsize;
+	}
+
+	c->handles[h] = w;
+	w->handle = h;
+
+	return h;
+}
+
+
+/**
+ * Invalidate the handle of a widget that is deleted.
+ * \param w  The widget.
+ */
+void
+binproto_forget_widget(Widget *w)
+{
+	Client *c;
+
+	if (w->handle < 0)
+		return;
+
+	c = (w->screen != NULL) ? w->screen->client : NULL;
+	if ((c != NULL) && (w->handle < c->handles_size) && (c->handles[w->handle] == w))
+		c->handles[w->handle] = NULL;
+	w->handle = -1;
+}
+
+
+/**
+ * Look up the widget a frame addresses.
+ * \param c       The client.
+ * \param handle  Handle of the widget.
+ * \return  The widget, or NULL after reporting an error to the client.
+ */
+static Widget *
+binproto_find_widget(Client *c, unsigned int handle)
+{
+	if ((handle < (unsigned int) c->handles_size) && (c->handles[handle] != NULL))
+		return (Widget *) c->handles[handle];
+
+	sock_printf(c->sock, "error Invalid widget handle %u\n", handle);
+	return NULL;
+}
+
+
+/**
+ * Set the text of a string, title or scroller widget.
+ * Payload: handle, x, y (16 bit each), text.
+ * \param c        The client.
+ * \param payload  Payload of the frame, NUL-terminated.
+ * \param len      Length of the payload.
+ */
+void
+binproto_widget_text(Client *c, const char *payload, int len)
+{
+	Widget *w;
+	const char *text = payload + 6;
+
+	if (len < 6) {
+		sock_send_string(c->sock, "error Short widget text frame\n");
+		return;
+	}
+	if ((w = binproto_find_widget(c, LCDB_GET16(payload))) == NULL)
+		return;
+	screen_touch(w->screen);
+
+	switch (w->type) {
+	case WID_STRING:
+		w->x = LCDB_GET16(payload + 2);
+		w->y = LCDB_GET16(payload + 4);
+		break;
+	case WID_TITLE:
+		w->width = display_props->width;
+		break;
+	case WID_SCROLLER:
+		break;
+	default:
+		sock_printf(c->sock, "error Widget %s takes no text\n", w->id);
+		return;
+	}
+
+	if (widget_set_text(w, text) < 0)
+		sock_send_string(c->sock, "error Error allocating text\n");
+}
+
+
+/**
+ * Set the value of a bar, icon or num widget.
+ * Payload: handle, x, y (16 bit each), value (32 bit).
+ * \param c        The client.
+ * \param payload  Payload of the frame.
+ * \param len      Length of the payload.
+ */
+void
+binproto_widget_value(Client *c, const char *payload, int len)
+{
+	Widget *w;
+	int x, y, value;
+
+	if (len < 10) {
+		sock_send_string(c->sock, "error Short widget value frame\n");
+		return;
+	}
+	if ((w = binproto_find_widget(c, LCDB_GET16(payload))) == NULL)
+		return;
+	screen_touch(w->screen);
+
+	x = LCDB_GET16(payload + 2);
+	y = LCDB_GET16(payload + 4);
+	value = LCDB_GET32(payload + 6);
+
+	switch (w->type) {
+	case WID_HBAR:
+	case WID_VBAR:
+		w->x = x;
+		w->y = y;
+		w->length = value;
+		break;
+	case WID_PBAR:
+		w->x = x;
+		w->y = y;
+		w->promille = value;
+		break;
+	case WID_ICON:
+		if (widget_icon_to_iconname(value) == NULL) {
+			sock_printf(c->sock, "error Invalid icon %d\n", value);
+			return;
+		}
+		w->x = x;
+		w->y = y;
+		w->length = value;
+		break;
+	case WID_NUM:
+		if ((value < 0) || (value > 10)) {
+			sock_printf(c->sock, "error Invalid number %d\n", value);
+			return;
+		}
+		w->x = x;
+		w->y = value;
+		break;
+	default:
+		sock_printf(c->sock, "error Widget %s takes no value\n", w->id);
+		break;
+	}
+}
@@ -0,0 +1,36 @@
+/** \file server/binproto.h
+ * Binary framing of client messages (see shared/lcdbinary.h).
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef BINPROTO_H
+#define BINPROTO_H
+
+#include "client.h"
+#include "widget.h"
+
+/* Switch a client to binary frames */
+int binproto_enable(Client *c);
+
+/* Free the binary protocol data of a client */
+void binproto_destroy(Client *c);
+
+/* Split received data into frames and queue them as messages */
+int binproto_read(Client *c, const char *data, int len);
+
+/* Give a widget a handle for binary frames */
+int binproto_add_handle(Client *c, Widget *w);
+
+/* Invalidate the handle of a widget */
+void binproto_forget_widget(Widget *w);
+
+/* Execute widget frames */
+void binproto_widget_text(Client *c, const char *payload, int len);
+void binproto_widget_value(Client *c, const char *payload, int len);
+
+#endif
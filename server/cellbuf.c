@@ -0,0 +1,1026 @@
+/** \file server/cellbuf.c
+ * Core-side frame buffer that the drivers are updated from.
+ *
+ * Rendering a frame no longer calls every driver for every widget. The
+ * output operations are recorded here in the order they are made, and for
+ * each cell of the display a signature of all writes to it is kept. When
+ * the frame is flushed, a driver only gets the operations that touch cells
+ * whose signature changed since the previous frame:
+ *
+ * - Changed cells are reset to blank, as clear() would have done.
+ * - Operations touching a changed cell are replayed in their original order.
+ *   Text is only sent for the changed cells, through the driver's cells()
+ *   function if it has one, or string() otherwise. Bars, icons and big
+ *   numbers are replayed as a whole and make the cells they cover count as
+ *   changed for all later operations, so whatever was drawn over them is
+ *   drawn again.
+ *
+ * This leaves each cell with the same content as clearing the display and
+ * replaying everything would. Heartbeat and cursor are animated by the
+ * drivers themselves, so they are replayed every frame and their cells are
+ * always treated as changed.
+ *
+ * Drivers use their custom characters differently for bars, icons and big
+ * numbers, and a display can usually only show one set at a time. Whenever
+ * the kinds of these operations (or heartbeat or cursor state) differ from
+ * the previous frame, every driver is cleared and gets the complete frame,
+ * exactly like before.
+ *
+ * A driver may be left out of a flush, e.g. because it cannot be refreshed
+ * that often. The signatures of the last frame it got are then kept for it,
+ * so that it gets all changes since that frame when it is flushed again.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "shared/report.h"
+
+#include "driver.h"
+#include "cellbuf.h"
+
+#define FNV_BASIS	2166136261U
+#define FNV_PRIME	16777619U
+
+/** The frame a driver last got, while it is left out of flushes */
+typedef struct {
+	Driver *drv;
+	unsigned int *sig;		/**< Its signatures; NULL to redraw all */
+	unsigned int layout;
+} CellLag;
+
+/** The frame being composed and the state of the previous one */
+static struct {
+	int width, height;		/**< Size of the buffer */
+	unsigned int *sig;		/**< Write signature of each cell */
+	unsigned int *old_sig;		/**< Signatures of the previous frame */
+	unsigned char *dirty;		/**< Cells to update, per driver */
+	char *row;			/**< Scratch buffer for one row of text */
+	char *blank;			/**< One row of spaces */
+
+	CellOp *ops;			/**< Operations of the frame */
+	int num_ops, ops_size;
+	char *text;			/**< Strings used by the operations */
+	int text_len, text_size;
+
+	unsigned int layout;		/**< Hash of the special operations */
+	unsigned int old_layout;
+	int full;			/**< Next flush has to redraw everything */
+
+	CellLag *lag;			/**< Drivers left out of flushes */
+	int num_lag, lag_size;
+} cb = { .full = 1 };
+
+/** Copy of the operations and cell signatures of a frame */
+struct CellFrame {
+	int width, height;
+	unsigned int *sig;
+	CellOp *ops;
+	int num_ops, ops_size;
+	char *text;
+	int text_len, text_size;
+	unsigned int layout;
+};
+
+
+static inline unsigned int
+hash_int(unsigned int h, unsigned int v)
+{
+	int i;
+
+	for (i = 0; i < 4; i++, v >>= 8)
+		h = (h ^ (v & 0xFF)) * FNV_PRIME;
+	return h;
+}
+
+
+static unsigned int
+hash_text(unsigned int h, int offset)
+{
+	const unsigned char *s;
+
+	if (offset < 0)
+		return hash_int(h, 0x100);
+	for (s = (unsigned char *) cb.text + offset; *s != '\0'; s++)
+		h = (h ^ *s) * FNV_PRIME;
+	return hash_int(h, 0x101);
+}
+
+
+/**
+ * Get the cells an operation covers, clipped to the buffer. For drivers
+ * that draw them differently, bars, icons and numbers cover the cells of
+ * the widest form: two cells for icons, three columns of all rows for
+ * numbers.
+ * \param drv  Driver the operation is replayed to, or NULL.
+ * \param op   The operation.
+ * \param x1   Receives the first column (0-based).
+ * \param y1   Receives the first row (0-based).
+ * \param x2   Receives the last column.
+ * \param y2   Receives the last row.
+ * \return  1 if the operation covers any cell of the buffer, 0 if not.
+ */
+static int
+op_extent(Driver *drv, const CellOp *op, int *x1, int *y1, int *x2, int *y2)
+{
+	int x = op->x - 1;
+	int y = op->y - 1;
+
+	switch (op->type) {
+	  case CELL_STRING:
+	  case CELL_HBAR:
+	  case CELL_PBAR:
+		*x1 = x; *x2 = x + op->a - 1; *y1 = *y2 = y;
+		break;
+	  case CELL_VBAR:
+		*x1 = *x2 = x; *y1 = y - op->a + 1; *y2 = y;
+		break;
+	  case CELL_ICON:
+		*x1 = x; *x2 = x + 1; *y1 = *y2 = y;
+		break;
+	  case CELL_NUM:
+		*x1 = x; *x2 = x + 2; *y1 = 0; *y2 = cb.height - 1;
+		break;
+	  case CELL_HEARTBEAT:
+		/* drawn at the right end of the first row, if at all */
+		if (drv == NULL || drv->width == NULL)
+			return 0;
+		*x1 = *x2 = drv->width(drv) - 1; *y1 = *y2 = 0;
+		break;
+	  case CELL_CURSOR:
+		if (drv == NULL)
+			return 0;
+		/* fall through */
+	  default:
+		*x1 = *x2 = x; *y1 = *y2 = y;
+		break;
+	}
+
+	if (*x1 < 0)
+		*x1 = 0;
+	if (*y1 < 0)
+		*y1 = 0;
+	if (*x2 >= cb.width)
+		*x2 = cb.width - 1;
+	if (*y2 >= cb.height)
+		*y2 = cb.height - 1;
+
+	return (*x1 <= *x2) && (*y1 <= *y2);
+}
+
+
+/**
+ * Store a string for an operation.
+ * \param s  The string, or NULL.
+ * \return  Its offset in the text buffer, -1 for NULL or on error.
+ */
+static int
+add_text(const char *s)
+{
+	int len, offset;
+
+	if (s == NULL)
+		return -1;
+
+	len = strlen(s) + 1;
+	if (cb.text_len + len > cb.text_size) {
+		int size = (cb.text_size > 0) ? cb.text_size : 256;
+		char *tmp;
+
+		while (cb.text_len + len > size)
+			size *= 2;
+		tmp = realloc(cb.text, size);
+		if (tmp == NULL)
+			return -1;
+		cb.text = tmp;
+		cb.text_size = size;
+	}
+
+	offset = cb.text_len;
+	memcpy(cb.text + offset, s, len);
+	cb.text_len += len;
+
+	return offset;
+}
+
+
+/**
+ * Append an operation to the frame.
+ * \return  The new operation, or NULL on error (the next frame is then
+ *          redrawn completely).
+ */
+static CellOp *
+add_op(CellOpType type, int x, int y, int a, int b, int c)
+{
+	CellOp *op;
+
+	if (cb.num_ops == cb.ops_size) {
+		int size = (cb.ops_size > 0) ? 2 * cb.ops_size : 32;
+		CellOp *tmp = realloc(cb.ops, size * sizeof(CellOp));
+
+		if (tmp == NULL) {
+			report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+			cb.full = 1;
+			return NULL;
+		}
+		cb.ops = tmp;
+		cb.ops_size = size;
+	}
+
+	op = &cb.ops[cb.num_ops++];
+	op->type = type;
+	op->x = x;
+	op->y = y;
+	op->a = a;
+	op->b = b;
+	op->c = c;
+	op->text = op->text2 = -1;
+	op->hash = 0;
+
+	return op;
+}
+
+
+/**
+ * Finish recording a bar, icon or number: sign the cells it covers and
+ * note it in the layout of the frame.
+ * \param op  The operation, with all parameters set.
+ */
+static void
+sign_special(CellOp *op)
+{
+	int x1, y1, x2, y2, x, y;
+
+	op->hash = hash_int(FNV_BASIS, op->type);
+	op->hash = hash_int(op->hash, op->a);
+	op->hash = hash_int(op->hash, op->b);
+	op->hash = hash_int(op->hash, op->c);
+	op->hash = hash_text(op->hash, op->text);
+	op->hash = hash_text(op->hash, op->text2);
+
+	cb.layout = hash_int(cb.layout, op->type);
+	if (op->type == CELL_ICON)
+		cb.layout = hash_int(cb.layout, op->a);
+
+	if (!op_extent(NULL, op, &x1, &y1, &x2, &y2))
+		return;
+
+	for (y = y1; y <= y2; y++) {
+		for (x = x1; x <= x2; x++) {
+			unsigned int *s = &cb.sig[y * cb.width + x];
+
+			*s = hash_int(*s, op->hash);
+			*s = hash_int(*s, ((x - op->x + 1) << 16) | (y - op->y + 1 + 0x8000));
+		}
+	}
+}
+
+
+/**
+ * Start a new frame. Nothing is sent to the drivers until the frame is
+ * flushed.
+ * \param width   Width of the widest display.
+ * \param height  Height of the highest display.
+ */
+void
+cellbuf_clear(int width, int height)
+{
+	int i;
+
+	if (width < 1)
+		width = 1;
+	if (height < 1)
+		height = 1;
+
+	if (width != cb.width || height != cb.height || cb.sig == NULL) {
+		int n = width * height;
+
+		free(cb.sig);
+		free(cb.old_sig);
+		free(cb.dirty);
+		free(cb.row);
+		free(cb.blank);
+		cb.sig = malloc(n * sizeof(unsigned int));
+		cb.old_sig = malloc(n * sizeof(unsigned int));
+		cb.dirty = malloc(n);
+		cb.row = malloc(width + 1);
+		cb.blank = malloc(width);
+		if (cb.sig == NULL || cb.old_sig == NULL || cb.dirty == NULL
+		    || cb.row == NULL || cb.blank == NULL) {
+			report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+			cellbuf_free();
+			return;
+		}
+		memset(cb.blank, ' ', width);
+		cb.width = width;
+		cb.height = height;
+		cb.full = 1;
+
+		/* Drivers left behind get the whole frame */
+		for (i = 0; i < cb.num_lag; i++) {
+			free(cb.lag[i].sig);
+			cb.lag[i].sig = NULL;
+		}
+	}
+
+	for (i = 0; i < cb.width * cb.height; i++)
+		cb.sig[i] = FNV_BASIS;
+	cb.num_ops = 0;
+	cb.text_len = 0;
+	cb.layout = FNV_BASIS;
+}
+
+
+/**
+ * Record a string.
+ * \param x       Horizontal character position (column).
+ * \param y       Vertical character position (row).
+ * \param string  String that gets written.
+ */
+void
+cellbuf_string(int x, int y, const char *string)
+{
+	CellOp *op;
+	int i;
+
+	if (string == NULL || cb.sig == NULL)
+		return;
+	if ((op = add_op(CELL_STRING, x, y, strlen(string), 0, 0)) == NULL)
+		return;
+	if ((op->text = add_text(string)) < 0) {
+		cb.num_ops--;
+		cb.full = 1;
+		return;
+	}
+
+	if (y < 1 || y > cb.height)
+		return;
+	for (i = 0; string[i] != '\0' && x + i <= cb.width; i++) {
+		if (x + i >= 1) {
+			unsigned int *s = &cb.sig[(y - 1) * cb.width + x + i - 1];
+
+			*s = hash_int(*s, (CELL_STRING << 8) | (unsigned char) string[i]);
+		}
+	}
+}
+
+
+/**
+ * Record a character.
+ * \param x  Horizontal character position (column).
+ * \param y  Vertical character position (row).
+ * \param c  Character that gets written.
+ */
+void
+cellbuf_chr(int x, int y, char c)
+{
+	if (cb.sig == NULL)
+		return;
+	if (add_op(CELL_CHR, x, y, (unsigned char) c, 0, 0) == NULL)
+		return;
+
+	if (x >= 1 && x <= cb.width && y >= 1 && y <= cb.height) {
+		unsigned int *s = &cb.sig[(y - 1) * cb.width + x - 1];
+
+		*s = hash_int(*s, (CELL_CHR << 8) | (unsigned char) c);
+	}
+}
+
+
+/**
+ * Record a horizontal bar.
+ * \param x        Horizontal character position (column) of the starting point.
+ * \param y        Vertical character position (row) of the starting point.
+ * \param len      Number of characters that the bar is long at 100%
+ * \param promille Current length level of the bar in promille.
+ * \param pattern  Options (currently unused).
+ */
+void
+cellbuf_hbar(int x, int y, int len, int promille, int pattern)
+{
+	CellOp *op;
+
+	if (cb.sig != NULL && (op = add_op(CELL_HBAR, x, y, len, promille, pattern)) != NULL)
+		sign_special(op);
+}
+
+
+/**
+ * Record a vertical bar.
+ * \param x        Horizontal character position (column) of the starting point.
+ * \param y        Vertical character position (row) of the starting point.
+ * \param len      Number of characters that the bar is long at 100%
+ * \param promille Current length level of the bar in promille.
+ * \param pattern  Options (currently unused).
+ */
+void
+cellbuf_vbar(int x, int y, int len, int promille, int pattern)
+{
+	CellOp *op;
+
+	if (cb.sig != NULL && (op = add_op(CELL_VBAR, x, y, len, promille, pattern)) != NULL)
+		sign_special(op);
+}
+
+
+/**
+ * Record a percentage bar.
+ * \param x            Horizontal character position (column) of the starting point.
+ * \param y            Vertical character position (row) of the starting point.
+ * \param width        Width of the widget in characters, including labels.
+ * \param promille     Current length level of the bar in promille.
+ * \param begin_label  Optional (may be NULL) label in front of the bar.
+ * \param end_label    Optional label at the end of the bar.
+ */
+void
+cellbuf_pbar(int x, int y, int width, int promille, const char *begin_label, const char *end_label)
+{
+	CellOp *op;
+
+	if (cb.sig == NULL || (op = add_op(CELL_PBAR, x, y, width, promille, 0)) == NULL)
+		return;
+
+	op->text = add_text(begin_label);
+	op->text2 = add_text(end_label);
+	if ((begin_label != NULL && op->text < 0) || (end_label != NULL && op->text2 < 0)) {
+		cb.num_ops--;
+		cb.full = 1;
+		return;
+	}
+	sign_special(op);
+}
+
+
+/**
+ * Record a big number.
+ * \param x    Horizontal character position (column).
+ * \param num  Character to write (0 - 10 with 10 representing ':')
+ */
+void
+cellbuf_num(int x, int num)
+{
+	CellOp *op;
+
+	if (cb.sig != NULL && (op = add_op(CELL_NUM, x, 1, num, 0, 0)) != NULL)
+		sign_special(op);
+}
+
+
+/**
+ * Record an icon.
+ * \param x     Horizontal character position (column).
+ * \param y     Vertical character position (row).
+ * \param icon  Symbolic value representing the icon.
+ */
+void
+cellbuf_icon(int x, int y, int icon)
+{
+	CellOp *op;
+
+	if (cb.sig != NULL && (op = add_op(CELL_ICON, x, y, icon, 0, 0)) != NULL)
+		sign_special(op);
+}
+
+
+/**
+ * Record the heartbeat. It is replayed every frame.
+ * \param state  Heartbeat state.
+ */
+void
+cellbuf_heartbeat(int state)
+{
+	if (cb.sig != NULL && add_op(CELL_HEARTBEAT, 0, 0, state, 0, 0) != NULL)
+		cb.layout = hash_int(hash_int(cb.layout, CELL_HEARTBEAT), state);
+}
+
+
+/**
+ * Record the cursor. It is replayed every frame.
+ * \param x      Horizontal cursor position (column).
+ * \param y      Vertical cursor position (row).
+ * \param state  New cursor state.
+ */
+void
+cellbuf_cursor(int x, int y, int state)
+{
+	if (cb.sig != NULL && add_op(CELL_CURSOR, x, y, state, 0, 0) != NULL) {
+		cb.layout = hash_int(hash_int(cb.layout, CELL_CURSOR), state);
+		cb.layout = hash_int(hash_int(cb.layout, x), y);
+	}
+}
+
+
+/**
+ * Keep a copy of the frame composed so far, e.g. to show the same screen
+ * again later without rendering its widgets.
+ * \param frame  Pointer to the copy; a previous copy is reused, a new one
+ *               is allocated if it is NULL.
+ * \retval 0    Success.
+ * \retval <0   Error allocating memory; *frame is freed and set to NULL.
+ */
+int
+cellbuf_save(CellFrame **frame)
+{
+	CellFrame *f = *frame;
+	int n = cb.width * cb.height;
+
+	if (cb.sig == NULL)
+		return -1;
+
+	if (f == NULL) {
+		f = *frame = calloc(1, sizeof(CellFrame));
+		if (f == NULL)
+			return -1;
+	}
+
+	if (f->width != cb.width || f->height != cb.height) {
+		free(f->sig);
+		f->sig = malloc(n * sizeof(unsigned int));
+		if (f->sig == NULL)
+			goto fail;
+		f->width = cb.width;
+		f->height = cb.height;
+	}
+	if (f->ops_size < cb.num_ops) {
+		CellOp *tmp = realloc(f->ops, cb.num_ops * sizeof(CellOp));
+
+		if (tmp == NULL)
+			goto fail;
+		f->ops = tmp;
+		f->ops_size = cb.num_ops;
+	}
+	if (f->text_size < cb.text_len) {
+		char *tmp = realloc(f->text, cb.text_len);
+
+		if (tmp == NULL)
+			goto fail;
+		f->text = tmp;
+		f->text_size = cb.text_len;
+	}
+
+	memcpy(f->sig, cb.sig, n * sizeof(unsigned int));
+	memcpy(f->ops, cb.ops, cb.num_ops * sizeof(CellOp));
+	memcpy(f->text, cb.text, cb.text_len);
+	f->num_ops = cb.num_ops;
+	f->text_len = cb.text_len;
+	f->layout = cb.layout;
+
+	return 0;
+
+fail:
+	report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+	cellbuf_frame_free(f);
+	*frame = NULL;
+	return -1;
+}
+
+
+/**
+ * Start the frame from a copy made by cellbuf_save(). Must be called
+ * right after cellbuf_clear(), before anything else is recorded.
+ * \param frame  The copy.
+ * \retval 0    Success.
+ * \retval <0   The copy does not fit (the display size changed) or error
+ *              allocating memory; the frame is still empty.
+ */
+int
+cellbuf_restore(const CellFrame *frame)
+{
+	if (frame == NULL || cb.sig == NULL || cb.num_ops != 0
+	    || frame->width != cb.width || frame->height != cb.height)
+		return -1;
+
+	if (cb.ops_size < frame->num_ops) {
+		CellOp *tmp = realloc(cb.ops, frame->num_ops * sizeof(CellOp));
+
+		if (tmp == NULL)
+			return -1;
+		cb.ops = tmp;
+		cb.ops_size = frame->num_ops;
+	}
+	if (cb.text_size < frame->text_len) {
+		char *tmp = realloc(cb.text, frame->text_len);
+
+		if (tmp == NULL)
+			return -1;
+		cb.text = tmp;
+		cb.text_size = frame->text_len;
+	}
+
+	memcpy(cb.sig, frame->sig, cb.width * cb.height * sizeof(unsigned int));
+	memcpy(cb.ops, frame->ops, frame->num_ops * sizeof(CellOp));
+	memcpy(cb.text, frame->text, frame->text_len);
+	cb.num_ops = frame->num_ops;
+	cb.text_len = frame->text_len;
+	cb.layout = frame->layout;
+
+	return 0;
+}
+
+
+/**
+ * Free a copy of a frame.
+ * \param frame  The copy, or NULL.
+ */
+void
+cellbuf_frame_free(CellFrame *frame)
+{
+	if (frame == NULL)
+		return;
+
+	free(frame->sig);
+	free(frame->ops);
+	free(frame->text);
+	free(frame);
+}
+
+
+/**
+ * Replay an operation to a driver, like the per-call API used to.
+ * \param drv  Pointer to driver structure.
+ * \param op   The operation.
+ */
+static void
+replay_op(Driver *drv, const CellOp *op)
+{
+	switch (op->type) {
+	  case CELL_STRING:
+		if (drv->string)
+			drv->string(drv, op->x, op->y, cb.text + op->text);
+		break;
+	  case CELL_CHR:
+		if (drv->chr)
+			drv->chr(drv, op->x, op->y, (char) op->a);
+		break;
+	  case CELL_HBAR:
+		if (drv->hbar)
+			drv->hbar(drv, op->x, op->y, op->a, op->b, op->c);
+		else
+			driver_alt_hbar(drv, op->x, op->y, op->a, op->b, op->c);
+		break;
+	  case CELL_VBAR:
+		if (drv->vbar)
+			drv->vbar(drv, op->x, op->y, op->a, op->b, op->c);
+		else
+			driver_alt_vbar(drv, op->x, op->y, op->a, op->b, op->c);
+		break;
+	  case CELL_PBAR:
+		driver_pbar(drv, op->x, op->y, op->a, op->b,
+			    (op->text >= 0) ? cb.text + op->text : NULL,
+			    (op->text2 >= 0) ? cb.text + op->text2 : NULL);
+		break;
+	  case CELL_NUM:
+		if (drv->num)
+			drv->num(drv, op->x, op->a);
+		else
+			driver_alt_num(drv, op->x, op->a);
+		break;
+	  case CELL_ICON:
+		if (drv->icon == NULL || drv->icon(drv, op->x, op->y, op->a) == -1)
+			driver_alt_icon(drv, op->x, op->y, op->a);
+		break;
+	  case CELL_HEARTBEAT:
+		if (drv->heartbeat)
+			drv->heartbeat(drv, op->a);
+		else
+			driver_alt_heartbeat(drv, op->a);
+		break;
+	  case CELL_CURSOR:
+		if (drv->cursor)
+			drv->cursor(drv, op->x, op->y, op->a);
+		else
+			driver_alt_cursor(drv, op->x, op->y, op->a);
+		break;
+	}
+}
+
+
+/**
+ * Send a run of characters to a driver.
+ * \param drv  Pointer to driver structure.
+ * \param x    Horizontal character position (column) of the first cell.
+ * \param y    Vertical character position (row).
+ * \param s    The characters.
+ * \param len  Number of characters.
+ */
+static void
+put_cells(Driver *drv, int x, int y, const char *s, int len)
+{
+	if (drv->cells) {
+		drv->cells(drv, x, y, s, len);
+	}
+	else if (drv->string) {
+		memcpy(cb.row, s, len);
+		cb.row[len] = '\0';
+		drv->string(drv, x, y, cb.row);
+	}
+}
+
+
+/**
+ * Send the changed cells of a string operation.
+ * \param drv  Pointer to driver structure.
+ * \param op   The operation.
+ */
+static void
+replay_string(Driver *drv, const CellOp *op)
+{
+	const char *text = cb.text + op->text;
+	unsigned char *dirty;
+	int x1, y1, x2, y2, x;
+
+	if (!op_extent(drv, op, &x1, &y1, &x2, &y2))
+		return;
+
+	dirty = cb.dirty + y1 * cb.width;
+	for (x = x1; x <= x2; x++) {
+		int start = x;
+
+		while (x <= x2 && dirty[x])
+			x++;
+		if (x > start)
+			put_cells(drv, start + 1, op->y,
+				  text + start - (op->x - 1), x - start);
+	}
+}
+
+
+/**
+ * Check whether an operation covers any changed cell and if so, mark all
+ * of its cells as changed.
+ * \param drv  Pointer to driver structure.
+ * \param op   The operation.
+ * \return  1 if the operation has to be replayed, 0 if not.
+ */
+static int
+touch_dirty(Driver *drv, const CellOp *op)
+{
+	int x1, y1, x2, y2, x, y;
+	int touched = 0;
+
+	if (!op_extent(drv, op, &x1, &y1, &x2, &y2))
+		return 0;
+
+	for (y = y1; y <= y2 && !touched; y++)
+		for (x = x1; x <= x2 && !touched; x++)
+			touched = cb.dirty[y * cb.width + x];
+
+	if (touched)
+		for (y = y1; y <= y2; y++)
+			memset(cb.dirty + y * cb.width + x1, 1, x2 - x1 + 1);
+
+	return touched;
+}
+
+
+/**
+ * Find the frame a driver last got, if it was left out of flushes.
+ * \param drv  Pointer to driver structure.
+ * \return  The driver's entry, or NULL if it got the previous frame.
+ */
+static CellLag *
+find_lag(Driver *drv)
+{
+	int i;
+
+	for (i = 0; i < cb.num_lag; i++) {
+		if (cb.lag[i].drv == drv)
+			return &cb.lag[i];
+	}
+	return NULL;
+}
+
+
+/**
+ * Get the frame a driver is updated from.
+ * \param lag     The driver's entry from find_lag().
+ * \param base    Receives the signatures of the frame, or NULL if the
+ *                driver has to be redrawn completely.
+ * \param layout  Receives the layout of the frame.
+ */
+static void
+get_base(const CellLag *lag, const unsigned int **base, unsigned int *layout)
+{
+	if (lag != NULL) {
+		*base = lag->sig;
+		*layout = lag->layout;
+	}
+	else {
+		*base = cb.full ? NULL : cb.old_sig;
+		*layout = cb.old_layout;
+	}
+}
+
+
+/**
+ * Forget the frame a driver last got, once it is up to date.
+ * \param lag  The driver's entry from find_lag(), or NULL.
+ */
+static void
+drop_lag(CellLag *lag)
+{
+	if (lag == NULL)
+		return;
+
+	free(lag->sig);
+	*lag = cb.lag[--cb.num_lag];
+}
+
+
+/**
+ * Leave a driver out of this flush. It keeps the frame it got last, and
+ * gets all changes since when it is replayed to again.
+ * \param drv  Pointer to driver structure.
+ * \retval 0   Success.
+ * \retval <0  Error allocating memory; the driver has to get this frame.
+ */
+int
+cellbuf_skip(Driver *drv)
+{
+	CellLag *lag;
+	int n = cb.width * cb.height;
+
+	if (cb.sig == NULL || find_lag(drv) != NULL)
+		return 0;
+
+	if (cb.num_lag == cb.lag_size) {
+		int size = (cb.lag_size > 0) ? 2 * cb.lag_size : 4;
+		CellLag *tmp = realloc(cb.lag, size * sizeof(CellLag));
+
+		if (tmp == NULL) {
+			report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+			return -1;
+		}
+		cb.lag = tmp;
+		cb.lag_size = size;
+	}
+
+	lag = &cb.lag[cb.num_lag++];
+	lag->drv = drv;
+	lag->layout = cb.old_layout;
+	lag->sig = NULL;
+	if (!cb.full) {
+		lag->sig = malloc(n * sizeof(unsigned int));
+		if (lag->sig != NULL)
+			memcpy(lag->sig, cb.old_sig, n * sizeof(unsigned int));
+	}
+	return 0;
+}
+
+
+/**
+ * Check whether the frame looks different on a driver's display than the
+ * frame the driver got last. A heartbeat or cursor that is on counts as a
+ * change, as the driver may animate it.
+ * \param drv  Pointer to driver structure.
+ * \return  1 if the driver has something to update, 0 if not.
+ */
+int
+cellbuf_changed(Driver *drv)
+{
+	const unsigned int *base;
+	unsigned int layout;
+	int i;
+
+	if (cb.sig == NULL)
+		return 1;
+
+	get_base(find_lag(drv), &base, &layout);
+	if (base == NULL || cb.layout != layout
+	    || memcmp(base, cb.sig, cb.width * cb.height * sizeof(unsigned int)) != 0)
+		return 1;
+
+	for (i = 0; i < cb.num_ops; i++) {
+		if ((cb.ops[i].type == CELL_HEARTBEAT && cb.ops[i].a != HEARTBEAT_OFF)
+		    || (cb.ops[i].type == CELL_CURSOR && cb.ops[i].a != CURSOR_OFF))
+			return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * Bring a driver's display up to date with the frame. The driver's flush()
+ * is not called.
+ * \param drv  Pointer to driver structure.
+ */
+void
+cellbuf_replay(Driver *drv)
+{
+	const unsigned int *base;
+	unsigned int layout;
+	CellLag *lag;
+	int i, x, y;
+
+	if (cb.sig == NULL)
+		return;
+
+	/* A driver left out of flushes is caught up from the frame it got */
+	lag = find_lag(drv);
+	get_base(lag, &base, &layout);
+
+	if (base == NULL || cb.layout != layout) {
+		if (drv->clear)
+			drv->clear(drv);
+		for (i = 0; i < cb.num_ops; i++)
+			replay_op(drv, &cb.ops[i]);
+		drop_lag(lag);
+		return;
+	}
+
+	for (i = 0; i < cb.width * cb.height; i++)
+		cb.dirty[i] = (cb.sig[i] != base[i]);
+	drop_lag(lag);
+
+	/* Heartbeat and cursor may look different every frame */
+	for (i = 0; i < cb.num_ops; i++) {
+		int x1, y1, x2, y2;
+
+		if ((cb.ops[i].type == CELL_HEARTBEAT || cb.ops[i].type == CELL_CURSOR)
+		    && op_extent(drv, &cb.ops[i], &x1, &y1, &x2, &y2))
+			cb.dirty[y1 * cb.width + x1] = 1;
+	}
+
+	/* Blank the changed cells */
+	for (y = 0; y < cb.height; y++) {
+		unsigned char *dirty = cb.dirty + y * cb.width;
+
+		for (x = 0; x < cb.width; x++) {
+			int start = x;
+
+			while (x < cb.width && dirty[x])
+				x++;
+			if (x > start)
+				put_cells(drv, start + 1, y + 1, cb.blank, x - start);
+		}
+	}
+
+	for (i = 0; i < cb.num_ops; i++) {
+		CellOp *op = &cb.ops[i];
+
+		switch (op->type) {
+		  case CELL_STRING:
+			replay_string(drv, op);
+			break;
+		  case CELL_CHR:
+			if (op->x >= 1 && op->x <= cb.width && op->y >= 1 && op->y <= cb.height
+			    && cb.dirty[(op->y - 1) * cb.width + op->x - 1])
+				replay_op(drv, op);
+			break;
+		  case CELL_HEARTBEAT:
+		  case CELL_CURSOR:
+			touch_dirty(drv, op);
+			replay_op(drv, op);
+			break;
+		  default:
+			if (touch_dirty(drv, op))
+				replay_op(drv, op);
+			break;
+		}
+	}
+}
+
+
+/**
+ * Make the frame the base of the next one, after it was replayed to all
+ * drivers.
+ */
+void
+cellbuf_commit(void)
+{
+	if (cb.sig == NULL)
+		return;
+
+	memcpy(cb.old_sig, cb.sig, cb.width * cb.height * sizeof(unsigned int));
+	cb.old_layout = cb.layout;
+	cb.full = 0;
+}
+
+
+/**
+ * Free all memory of the frame buffer.
+ */
+void
+cellbuf_free(void)
+{
+	int i;
+
+	for (i = 0; i < cb.num_lag; i++)
+		free(cb.lag[i].sig);
+	free(cb.lag);
+	free(cb.sig);
+	free(cb.old_sig);
+	free(cb.dirty);
+	free(cb.row);
+	free(cb.blank);
+	free(cb.ops);
+	free(cb.text);
+	memset(&cb, 0, sizeof(cb));
+	cb.full = 1;
+}
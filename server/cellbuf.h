@@ -0,0 +1,73 @@
+/** \file server/cellbuf.h
+ * Core-side frame buffer that the drivers are updated from.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef CELLBUF_H
+#define CELLBUF_H
+
+#include "drivers/lcd.h"
+
+/** Kinds of output operations recorded for a frame */
+typedef enum {
+	CELL_STRING,
+	CELL_CHR,
+	CELL_HBAR,
+	CELL_VBAR,
+	CELL_PBAR,
+	CELL_NUM,
+	CELL_ICON,
+	CELL_HEARTBEAT,
+	CELL_CURSOR
+} CellOpType;
+
+/** One output operation of a frame */
+typedef struct CellOp {
+	CellOpType type;
+	int x, y;
+	int a, b, c;		/**< Parameters; meaning depends on the type */
+	int text, text2;	/**< Offsets of strings in the text buffer, or -1 */
+	unsigned int hash;	/**< Hash of the operation */
+} CellOp;
+
+/** Copy of a composed frame */
+typedef struct CellFrame CellFrame;
+
+/* Start a new frame of the given size */
+void cellbuf_clear(int width, int height);
+
+/* Record output operations */
+void cellbuf_string(int x, int y, const char *string);
+void cellbuf_chr(int x, int y, char c);
+void cellbuf_hbar(int x, int y, int len, int promille, int pattern);
+void cellbuf_vbar(int x, int y, int len, int promille, int pattern);
+void cellbuf_pbar(int x, int y, int width, int promille, const char *begin_label, const char *end_label);
+void cellbuf_num(int x, int num);
+void cellbuf_icon(int x, int y, int icon);
+void cellbuf_heartbeat(int state);
+void cellbuf_cursor(int x, int y, int state);
+
+/* Keep a copy of the frame composed so far, or start a frame from one */
+int cellbuf_save(CellFrame **frame);
+int cellbuf_restore(const CellFrame *frame);
+void cellbuf_frame_free(CellFrame *frame);
+
+/* Bring a driver's display up to date with the frame */
+void cellbuf_replay(Driver *drv);
+
+/* Leave a driver out of a flush, or check whether it has to be flushed */
+int cellbuf_skip(Driver *drv);
+int cellbuf_changed(Driver *drv);
+
+/* Make the frame the base of the next one */
+void cellbuf_commit(void);
+
+/* Free all memory */
+void cellbuf_free(void);
+
+#endif
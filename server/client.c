@@ -25,6 +25,8 @@
 #include "render.h"
 #include "input.h"
 #include "menuscreens.h"
+#include "shm.h"
+#include "binproto.h"
 #include "shared/report.h"
 #include "shared/LL.h"
 
@@ -42,17 +44,22 @@ Client *client_create(int sock)
 	}
 	/* Init struct members*/
 	c->sock = sock;
-	c->messages = NULL;
+	IL_Init(&c->messages);
 	c->backlight = BACKLIGHT_OPEN;
 	c->heartbeat = HEARTBEAT_OPEN;
-
-	/*Set up message list...*/
-	c->messages = LL_new();
-	if (!c->messages) {
-		report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
-		free(c);
-		return NULL;
-	}
+	c->msg_budget = 0;
+	c->msg_count = 0;
+	c->msg_deferred = 0;
+	c->backlog = 0;
+	c->backlog_max = 0;
+	c->shm = NULL;
+	c->shm_size = 0;
+	c->shm_slots = 0;
+	c->binary = 0;
+	c->frame_buf = NULL;
+	c->frame_len = 0;
+	c->handles = NULL;
+	c->handles_size = 0;
 
 	c->state = NEW;
 	c->name = NULL;
@@ -79,11 +86,13 @@ client_destroy(Client *c)
 
 	debug(RPT_DEBUG, "%s(c=[%d])", __FUNCTION__, c->sock);
 
+	report(RPT_INFO, "Client on socket %i: %lu messages, backlog in %lu strokes, max backlog %i",
+		c->sock, c->msg_count, c->msg_deferred, c->backlog_max);
+
 	/* Eat messages */
 	while ((str = client_get_message(c))) {
-		free(str);
+		client_free_message(str);
 	}
-	LL_Destroy(c->messages);
 
 	/* Clean up the screenlist...*/
 	debug(RPT_DEBUG, "%s: Cleaning screenlist", __FUNCTION__);
@@ -109,6 +118,12 @@ client_destroy(Client *c)
 	/* Forget client's key reservations */
 	input_release_client_keys(c);
 
+	/* Remove its shared memory segment */
+	shm_destroy(c);
+
+	/* Free the binary protocol data (after all widgets are gone) */
+	binproto_destroy(c);
+
 	/* Close the socket */
 	close(c->sock);
 
@@ -127,42 +142,151 @@ client_destroy(Client *c)
 }
 
 /*Add and remove messages from the client's queue...*/
+
+/** A queued message; its text follows in the same allocation */
+typedef struct ClientMessage {
+	IL_node link;		/**< node in the client's queue, or the pool */
+	int size;		/**< allocated size of text */
+	char text[];
+} ClientMessage;
+
+/** Size of the text of pooled messages; longer ones are allocated singly */
+#define CLIENT_MSG_POOLED	120
+/** Max. number of unused messages kept in the pool */
+#define CLIENT_MSG_POOL_MAX	256
+
+/* Unused messages; linked through link.next */
+static IL_node *message_pool = NULL;
+static int message_pool_count = 0;
+
+
+/**
+ * Append an empty message to a client's queue. Messages of up to
+ * CLIENT_MSG_POOLED bytes are taken from the pool of messages that were
+ * parsed already, so queueing them usually does not call malloc().
+ * \param c     The client.
+ * \param size  Number of bytes of text.
+ * \return      Text of the message, for the caller to fill; NULL on error.
+ */
+static char *
+client_queue_message(Client *c, int size)
+{
+	ClientMessage *msg;
+
+	if ((size <= CLIENT_MSG_POOLED) && (message_pool != NULL)) {
+		msg = IL_ENTRY(message_pool, ClientMessage, link);
+		message_pool = message_pool->next;
+		message_pool_count--;
+	} else {
+		int alloc = max(size, CLIENT_MSG_POOLED);
+
+		msg = malloc(sizeof(ClientMessage) + alloc);
+		if (msg == NULL) {
+			report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+			return NULL;
+		}
+		msg->size = alloc;
+	}
+
+	IL_PushTail(&c->messages, &msg->link);
+	return msg->text;
+}
+
+
 int
-client_add_message(Client *c, char *message)
+client_add_message(Client *c, const char *message)
 {
-	int err = 0;
+	int len;
+	char *text;
 
 	if (!c)
 		return -1;
 	if (!message)
 		return -1;
 
-	if (strlen(message) > 0) {
+	len = strlen(message);
+	if (len > 0) {
 		debug(RPT_DEBUG, "%s(c=[%d], message=\"%s\")", __FUNCTION__,
 			c->sock, message);
-		err = LL_Enqueue(c->messages, (void *) message);
+		text = client_queue_message(c, len + 1);
+		if (text == NULL)
+			return -1;
+		memcpy(text, message, len + 1);
 	}
 
-	return err;
+	return 0;
 }
 
+
+/**
+ * Add a binary frame to the client's queue. It is queued with a leading
+ * NUL, which marks it for the parser, and a trailing NUL that terminates
+ * text payloads.
+ * \param c      The client.
+ * \param frame  The frame, header included.
+ * \param len    Length of the frame.
+ * \return       0 on success, -1 on error.
+ */
+int
+client_add_frame(Client *c, const char *frame, int len)
+{
+	char *text;
+
+	if (!c)
+		return -1;
+
+	text = client_queue_message(c, len + 2);
+	if (text == NULL)
+		return -1;
+	text[0] = '\0';
+	memcpy(text + 1, frame, len);
+	text[len + 1] = '\0';
+
+	return 0;
+}
+
+
 /* Woo-hoo!  A simple function.  :)*/
 char *
 client_get_message(Client *c)
 {
-	char *str;
+	IL_node *node;
 
 	debug(RPT_DEBUG, "%s(c=[%d])", __FUNCTION__, c->sock);
 
 	if (!c)
 		return NULL;
 
-	str = (char *) LL_Dequeue(c->messages);
+	node = IL_PopHead(&c->messages);
+	if (node == NULL)
+		return NULL;
 
-	return str;
+	return IL_ENTRY(node, ClientMessage, link)->text;
 }
 
 
+/**
+ * Give back a message got by client_get_message().
+ * \param message  Text of the message.
+ */
+void
+client_free_message(char *message)
+{
+	ClientMessage *msg;
+
+	if (message == NULL)
+		return;
+
+	msg = (ClientMessage *) (message - offsetof(ClientMessage, text));
+	if ((msg->size == CLIENT_MSG_POOLED) && (message_pool_count < CLIENT_MSG_POOL_MAX)) {
+		msg->link.next = message_pool;
+		message_pool = &msg->link;
+		message_pool_count++;
+	} else {
+		free(msg);
+	}
+}
+
 Screen *
 client_find_screen(Client *c, char *id)
 {
@@ -228,3 +352,20 @@ int client_screen_count(Client *c)
 {
 	return LL_Length(c->screenlist);
 }
+
+int
+client_get_priority(Client *c)
+{
+	Screen *s;
+	int priority = PRI_HIDDEN;
+
+	if (!c)
+		return PRI_HIDDEN;
+
+	for (s = LL_GetFirst(c->screenlist); s; s = LL_GetNext(c->screenlist)) {
+		if (s->priority > priority)
+			priority = s->priority;
+	}
+
+	return priority;
+}
@@ -25,6 +25,7 @@
 #define CLIENT_H_TYPES
 
 #include "shared/LL.h"
+#include "shared/IL.h"
 
 #define CLIENT_NAME_SIZE 256
 
@@ -44,10 +45,26 @@ typedef struct Client {
 	int backlight;
 	int heartbeat;
 
-	LinkedList *messages;		/**< Messages that the client sent. */
+	IntrusiveList messages;		/**< Messages that the client sent. */
 	LinkedList *screenlist;		/**< List of client's screens. */
 
 	void* menu;			/**< Menu hierarchy, if any */
+
+	int msg_budget;			/**< Messages it may still send in this processing stroke. */
+	unsigned long msg_count;	/**< Number of messages parsed. */
+	unsigned long msg_deferred;	/**< Number of strokes that ended with messages left over. */
+	int backlog;			/**< Messages left over after the last stroke. */
+	int backlog_max;		/**< Largest backlog seen so far. */
+
+	void *shm;			/**< Shared memory segment for widget values, or NULL. */
+	size_t shm_size;		/**< Size of the segment. */
+	int shm_slots;			/**< Number of slots in the segment. */
+
+	int binary;			/**< Client sends binary frames (see shared/lcdbinary.h). */
+	char *frame_buf;		/**< Incomplete binary frame. */
+	int frame_len;			/**< Number of bytes in frame_buf. */
+	void **handles;			/**< Widgets addressed by binary frames, indexed by handle. */
+	int handles_size;		/**< Allocated number of handles. */
 } Client;
 
 #endif
@@ -69,11 +86,13 @@ int client_destroy(Client *c);
 /* Close the socket */
 void client_close_sock(Client *c);
 
-/* Add message to the client's queue...*/
-int client_add_message(Client *c, char *message);
+/* Add message or binary frame to the client's queue...*/
+int client_add_message(Client *c, const char *message);
+int client_add_frame(Client *c, const char *frame, int len);
 
-/* Get message from queue */
+/* Get message from queue, and give it back once it is parsed */
 char *client_get_message(Client *c);
+void client_free_message(char *message);
 
 /* Find a named screen for the client */
 Screen *client_find_screen(Client *c, char *id);
@@ -84,5 +103,8 @@ int client_remove_screen(Client *c, Screen *s);
 
 int client_screen_count(Client *c);
 
+/* Get the highest priority of the client's screens */
+int client_get_priority(Client *c);
+
 #endif
 #endif
@@ -26,11 +26,15 @@
 
 #include "shared/report.h"
 #include "shared/sockets.h"
+#include "shared/lcdshm.h"
 
 #include "drivers.h"
 #include "client.h"
 #include "render.h"
 #include "input.h"
+#include "shm.h"
+#include "sock.h"
+#include "main.h" /* for key_latency_get */
 #include "client_commands.h"
 
 
@@ -54,8 +58,12 @@ test_func_func(Client *c, int argc, char **argv)
  *
  * It sends back a string of info about the server to the client.
  *
+ * With "hello binary" the client switches to binary frames for everything
+ * it sends afterwards (see shared/lcdbinary.h); the server confirms this by
+ * appending "binary" to its answer.
+ *
  *\verbatim
- * Usage: hello
+ * Usage: hello [binary]
  *\endverbatim
  *
  * \todo  Give \em real info about the server/lcd
@@ -63,16 +71,20 @@ test_func_func(Client *c, int argc, char **argv)
 int
 hello_func(Client *c, int argc, char **argv)
 {
-	if (argc > 1) {
-		sock_send_error(c->sock, "extra parameters ignored\n");
+	/* "hello binary" already switched the client to binary frames */
+	/* the connect line is the only reply, so extra parameters are
+	 * just logged */
+	if ((argc > 2) || ((argc == 2) && !c->binary)) {
+		report(RPT_INFO, "client error: extra parameters of hello ignored");
 	}
 
 	debug(RPT_INFO, "Hello!");
 
-	sock_printf(c->sock, "connect LCDproc %s protocol %s lcd wid %i hgt %i cellwid %i cellhgt %i\n",
+	sock_printf(c->sock, "connect LCDproc %s protocol %s lcd wid %i hgt %i cellwid %i cellhgt %i%s\n",
 		VERSION, PROTOCOL_VERSION,
 		display_props->width, display_props->height,
-		display_props->cellwidth, display_props->cellheight);
+		display_props->cellwidth, display_props->cellheight,
+		c->binary ? " binary" : "");
 
 	/* make note that client has sent hello */
 	c->state = ACTIVE;
@@ -191,12 +203,15 @@ client_add_key_func(Client *c, int argc, char **argv)
 		}
 		else {
 			sock_printf_error(c->sock, "Invalid option: %s\n", argv[argnr]);
+			return 0;
 		}
 		argnr++;
 	}
+	/* Keys reserved before a failing one stay reserved */
 	for ( ; argnr < argc; argnr++) {
 		if (input_reserve_key(argv[argnr], exclusively, c) < 0) {
 			sock_printf_error(c->sock, "Could not reserve key \"%s\"\n", argv[argnr]);
+			return 0;
 		}
 	}
 	sock_send_string(c->sock, "success\n");
@@ -281,6 +296,90 @@ backlight_func(Client *c, int argc, char **argv)
 
 }
 
+/**
+ * Sends back the message statistics of the client: messages parsed,
+ * processing strokes that ended with messages left over, messages left
+ * over after the last stroke, and the largest backlog seen so far.
+ * They are followed by the key-to-display latency of the keys the server
+ * handled itself: number of keys, average and largest latency in
+ * microseconds.
+ *
+ *\verbatim
+ * Usage: client_stats
+ * Return: stats <messages> <deferred> <backlog> <max_backlog>
+ *               <keys> <key_latency_avg> <key_latency_max>
+ *\endverbatim
+ */
+int
+client_stats_func(Client *c, int argc, char **argv)
+{
+	unsigned long keys;
+	long int latency_avg, latency_max;
+
+	if (c->state != ACTIVE)
+		return 1;
+
+	/* the answer is the only reply, so extra arguments are just logged */
+	if (argc > 1) {
+		report(RPT_INFO, "client error: extra arguments of %s ignored", argv[0]);
+	}
+
+	key_latency_get(&keys, &latency_avg, &latency_max);
+	sock_printf(c->sock, "stats %lu %lu %i %i %lu %ld %ld\n", c->msg_count,
+		    c->msg_deferred, c->backlog, c->backlog_max,
+		    keys, latency_avg, latency_max);
+
+	return 0;
+}
+
+/**
+ * Creates a shared memory segment the client can write widget values to
+ * (see shared/lcdshm.h). It replaces any segment the client had before.
+ * The file descriptor of the segment comes with the reply (SCM_RIGHTS),
+ * so the command needs a connection over the Unix domain socket.
+ *
+ *\verbatim
+ * Usage: shm_open <slots>
+ * Return: shm <slots> <slotsize>
+ *\endverbatim
+ */
+int
+shm_open_func(Client *c, int argc, char **argv)
+{
+	char reply[40];
+	int slots;
+	int fd;
+
+	if (c->state != ACTIVE)
+		return 1;
+
+	if (argc != 2) {
+		sock_send_error(c->sock, "Usage: shm_open <slots>\n");
+		return 0;
+	}
+
+	slots = atoi(argv[1]);
+	if ((slots <= 0) || (slots > LCDSHM_MAX_SLOTS)) {
+		sock_printf_error(c->sock, "Number of slots must be 1..%d\n", LCDSHM_MAX_SLOTS);
+		return 0;
+	}
+
+	if (!sock_is_local(c->sock)) {
+		sock_send_error(c->sock, "Shared memory needs the Unix domain socket\n");
+		return 0;
+	}
+	if ((fd = shm_create(c, slots)) < 0) {
+		sock_send_error(c->sock, "Shared memory not available\n");
+		return 0;
+	}
+
+	snprintf(reply, sizeof(reply), "shm %d %d\n", c->shm_slots, (int) sizeof(LcdShmSlot));
+	if (sock_send_fd(c->sock, fd, reply) < 0)
+		shm_destroy(c);
+	close(fd);
+	return 0;
+}
+
 /**
  * Sends back information about the loaded drivers.
  *
@@ -294,8 +393,9 @@ info_func(Client *c, int argc, char **argv)
 	if (c->state != ACTIVE)
 		return 1;
 
+	/* the answer is the only reply, so extra arguments are just logged */
 	if (argc > 1) {
-		sock_send_error(c->sock, "Extra arguments ignored...\n");
+		report(RPT_INFO, "client error: extra arguments of %s ignored", argv[0]);
 	}
 
 	sock_printf(c->sock, "%s\n", drivers_get_info());
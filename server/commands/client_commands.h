@@ -18,6 +18,8 @@ int client_set_func(Client *c, int argc, char **argv);
 int client_add_key_func(Client *c, int argc, char **argv);
 int client_del_key_func(Client *c, int argc, char **argv);
 int backlight_func(Client *c, int argc, char **argv);
+int shm_open_func(Client *c, int argc, char **argv);
+int client_stats_func(Client *c, int argc, char **argv);
 
 #endif
 
@@ -30,12 +30,14 @@ static client_function commands[] = {
 	{ "client_set",     client_set_func     },
 	{ "client_add_key", client_add_key_func },
 	{ "client_del_key", client_del_key_func },
+	{ "client_stats",   client_stats_func   },
 	{ "screen_add",     screen_add_func     },
 	{ "screen_del",     screen_del_func     },
 	{ "screen_set",     screen_set_func     },
 	{ "widget_add",     widget_add_func     },
 	{ "widget_del",     widget_del_func     },
 	{ "widget_set",     widget_set_func     },
+	{ "widget_shm",     widget_shm_func     },
 	{ "menu_add_item",  menu_add_item_func  },
 	{ "menu_del_item",  menu_del_item_func  },
 	{ "menu_set_item",  menu_set_item_func  },
@@ -46,6 +48,7 @@ static client_function commands[] = {
 	{ "output",         output_func         },
 	{ "noop",           noop_func           },
 	{ "info",           info_func           },
+	{ "shm_open",       shm_open_func       },
 	{ "sleep",          sleep_func          },
 	{ "bye",            bye_func            },
 	{ NULL,             NULL},
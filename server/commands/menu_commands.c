@@ -460,7 +460,7 @@ menu_set_item_func(Client *c, int argc, char **argv)
 		}
 		else {
 			sock_printf_error(c->sock, "Found non-option: \"%.40s\"\n", argv[argnr]);
-			continue; /* Skip to next arg */
+			return 0;
 		}
 		if (option_nr == -1) {
 			if (found_option_name) {
@@ -469,7 +469,7 @@ menu_set_item_func(Client *c, int argc, char **argv)
 			else {
 				sock_printf_error(c->sock, "Unknown option: \"%.40s\"\n", argv[argnr]);
 			}
-			continue; /* Skip to next arg */
+			return 0;
 		}
 
 		/* OK, we now know we have an option that is valid for the item type. */
@@ -478,7 +478,7 @@ menu_set_item_func(Client *c, int argc, char **argv)
 		if (option_table[option_nr].attr_type != NOVALUE) {
 			if (argnr + 1 >= argc) {
 				sock_printf_error(c->sock, "Missing value at option: \"%.40s\"\n", argv[argnr]);
-				continue; /* Skip to next arg (probably is not existing :) */
+				return 0;
 			}
 		}
 		/* Process the value that goes with the option */
@@ -556,18 +556,19 @@ menu_set_item_func(Client *c, int argc, char **argv)
 				*(char **) location = strdup(string_value);
 			}
 			else if (strcmp(argv[argnr], "-prev") == 0) {
-				set_predecessor(item, string_value, c);
+				if (set_predecessor(item, string_value, c) < 0)
+					return 0;
 			}
 			else if (strcmp(argv[argnr], "-next") == 0) {
-				set_successor(item, string_value, c);
+				if (set_successor(item, string_value, c) < 0)
+					return 0;
 			}
 			break;
 		}
 		switch (error) {
 		  case 1:
 			sock_printf_error(c->sock, "Could not interpret value at option: \"%.40s\"\n", argv[argnr]);
-			argnr ++;
-			continue; /* Skip current option and the invalid value */
+			return 0;
 		}
 
 		/* And at last process extra things for certain options.
@@ -660,11 +661,10 @@ menu_set_item_func(Client *c, int argc, char **argv)
 		switch (error) {
 		  case 1:
 			sock_printf_error(c->sock, "Could not interpret value at option: \"%.40s\"\n", argv[argnr]);
-			continue; /* Skip to next arg and retry it as an option */
+			return 0;
 		  case 2:
 			sock_printf_error(c->sock, "Value out of range at option: \"%.40s\"\n", argv[argnr]);
-			argnr ++;
-			continue; /* Skip current option and the invalid value */
+			return 0;
 		}
 		menuscreen_inform_item_modified(item);
 		if (option_table[option_nr].attr_type != NOVALUE) {
@@ -716,8 +716,8 @@ menu_goto_func(Client * c, int argc, char **argv)
 		return 0;
 	}
 
-	if (argc > 2)
-		set_predecessor(menu, argv[2], c);
+	if ((argc > 2) && (set_predecessor(menu, argv[2], c) < 0))
+		return 0;
 
 	menuscreen_goto(menu);
 	/* Failure is not returned (Robijn) */
@@ -29,6 +29,7 @@
 
 #include "client.h"
 #include "screen.h"
+#include "screenlist.h"
 #include "render.h"
 #include "screen_commands.h"
 
@@ -167,6 +168,7 @@ screen_set_func(Client *c, int argc, char **argv)
 		sock_send_error(c->sock, "Unknown screen id\n");
 		return 0;
 	}
+	screen_touch(s);
 	/* Handle the rest of the parameters*/
 	for (i = 2; i < argc; i++) {
 		char *p = argv[i];
@@ -185,10 +187,10 @@ screen_set_func(Client *c, int argc, char **argv)
 				if (s->name != NULL)
 					free(s->name);
 				s->name = strdup(argv[i]);
-				sock_send_string(c->sock, "success\n");
 			}
 			else {
 				sock_send_error(c->sock, "-name requires a parameter\n");
+				return 0;
 			}
 		}
 		/* Handle the "priority" parameter*/
@@ -213,14 +215,15 @@ screen_set_func(Client *c, int argc, char **argv)
 				}
 				if (number >= 0) {
 					s->priority = number;
-					sock_send_string(c->sock, "success\n");
 				}
 				else {
 					sock_send_error(c->sock, "invalid argument at -priority\n");
+					return 0;
 				}
 			}
 			else {
 				sock_send_error(c->sock, "-priority requires a parameter\n");
+				return 0;
 			}
 		}
 		/* Handle the "duration" parameter*/
@@ -231,12 +234,14 @@ screen_set_func(Client *c, int argc, char **argv)
 
 				/* set the duration...*/
 				number = atoi(argv[i]);
-				if (number > 0)
+				if (number > 0) {
 					s->duration = number;
-				sock_send_string(c->sock, "success\n");
+					screenlist_update_duration(s);
+				}
 			}
 			else {
 				sock_send_error(c->sock, "-duration requires a parameter\n");
+				return 0;
 			}
 		}
 		/* Handle the "heartbeat" parameter*/
@@ -252,10 +257,10 @@ screen_set_func(Client *c, int argc, char **argv)
 					s->heartbeat = HEARTBEAT_OFF;
 				else if (0 == strcmp(argv[i], "open"))
 					s->heartbeat = HEARTBEAT_OPEN;
-				sock_send_string(c->sock, "success\n");
 			}
 			else {
 				sock_send_error(c->sock, "-heartbeat requires a parameter\n");
+				return 0;
 			}
 		}
 		/* Handle the "wid" parameter*/
@@ -268,10 +273,10 @@ screen_set_func(Client *c, int argc, char **argv)
 				number = atoi(argv[i]);
 				if (number > 0)
 					s->width = number;
-				sock_send_string(c->sock, "success\n");
 			}
 			else {
 				sock_send_error(c->sock, "-wid requires a parameter\n");
+				return 0;
 			}
 
 		}
@@ -285,10 +290,10 @@ screen_set_func(Client *c, int argc, char **argv)
 				number = atoi(argv[i]);
 				if (number > 0)
 					s->height = number;
-				sock_send_string(c->sock, "success\n");
 			}
 			else {
 				sock_send_error(c->sock, "-hgt requires a parameter\n");
+				return 0;
 			}
 		}
 		/* Handle the "timeout" parameter*/
@@ -303,12 +308,13 @@ screen_set_func(Client *c, int argc, char **argv)
 				 */
 				if (number > 0) {
 					s->timeout = number;
+					screenlist_update_timeout(s);
 					report(RPT_NOTICE, "Timeout set.");
 				}
-				sock_send_string(c->sock, "success\n");
 			}
 			else {
 				sock_send_error(c->sock, "-timeout requires a parameter\n");
+				return 0;
 			}
 		}
 		/* Handle the "backlight" parameter*/
@@ -338,13 +344,14 @@ screen_set_func(Client *c, int argc, char **argv)
 				else if (strcmp("open", argv[i]) == 0)
 					s->backlight = BACKLIGHT_OPEN;
 
-				else
+				else {
 					sock_send_error(c->sock, "unknown backlight mode\n");
-
-				sock_send_string(c->sock, "success\n");
+					return 0;
+				}
 			}
 			else {
 				sock_send_error(c->sock, "-backlight requires a parameter\n");
+				return 0;
 			}
 		}
 		/* Handle the "cursor" parameter */
@@ -362,10 +369,10 @@ screen_set_func(Client *c, int argc, char **argv)
 					s->cursor = CURSOR_UNDER;
 				if (0 == strcmp(argv[i], "block"))
 					s->cursor = CURSOR_BLOCK;
-				sock_send_string(c->sock, "success\n");
 			}
 			else {
 				sock_send_error(c->sock, "-cursor requires a parameter\n");
+				return 0;
 			}
 		}
 		/* Handle the "cursor_x" parameter */
@@ -378,14 +385,15 @@ screen_set_func(Client *c, int argc, char **argv)
 				number = atoi(argv[i]);
 				if (number > 0 && number <= s->width) {
 					s->cursor_x = number;
-					sock_send_string(c->sock, "success\n");
 				}
 				else {
 					sock_send_error(c->sock, "Cursor position outside screen\n");
+					return 0;
 				}
 			}
 			else {
 				sock_send_error(c->sock, "-cursor_x requires a parameter\n");
+				return 0;
 			}
 		}
 		/* Handle the "cursor_y" parameter */
@@ -398,19 +406,26 @@ screen_set_func(Client *c, int argc, char **argv)
 				number = atoi(argv[i]);
 				if (number > 0 && number <= s->height) {
 					s->cursor_y = number;
-					sock_send_string(c->sock, "success\n");
 				}
 				else {
 					sock_send_error(c->sock, "Cursor position outside screen\n");
+					return 0;
 				}
 			}
 			else {
 				sock_send_error(c->sock, "-cursor_y requires a parameter\n");
+				return 0;
 			}
 		}
 
-		else sock_send_error(c->sock, "invalid parameter\n");
+		else {
+			sock_send_error(c->sock, "invalid parameter\n");
+			return 0;
+		}
 	}/* done checking argv*/
+
+	/* one reply for all options; an error above ends the command */
+	sock_send_string(c->sock, "success\n");
 	return 0;
 }
 
@@ -31,6 +31,7 @@
 #include "screen.h"
 #include "widget.h"
 #include "drivers.h"
+#include "binproto.h"
 #include "widget_commands.h"
 
 
@@ -114,10 +115,19 @@ widget_add_func(Client *c, int argc, char **argv)
 
 	/* Add the widget to the screen */
 	err = screen_add_widget(s, w);
-	if (err == 0)
-		sock_send_string(c->sock, "success\n");
-	else
+	if (err != 0)
 		sock_send_error(c->sock, "Error adding widget\n");
+	else if (c->binary) {
+		/* binary clients address the widget by its handle */
+		int handle = binproto_add_handle(c, w);
+
+		if (handle < 0)
+			sock_send_error(c->sock, "No widget handle left\n");
+		else
+			sock_printf(c->sock, "success %d\n", handle);
+	}
+	else
+		sock_send_string(c->sock, "success\n");
 
 	return 0;
 }
@@ -165,6 +175,7 @@ widget_del_func(Client *c, int argc, char **argv)
 	}
 
 	err = screen_remove_widget(s, w);
+	binproto_forget_widget(w);
 	if (err == 0)
 		sock_send_string(c->sock, "success\n");
 	else
@@ -173,6 +184,55 @@ widget_del_func(Client *c, int argc, char **argv)
 	return 0;
 }
 
+/**
+ * Binds a widget to a slot of the client's shared memory segment (see
+ * shm_open). The widget then takes its value from the slot whenever it is
+ * rendered. A slot of -1 removes the binding.
+ *
+ *\verbatim
+ * Usage: widget_shm <screenid> <widgetid> <slot>
+ *\endverbatim
+ */
+int
+widget_shm_func(Client *c, int argc, char **argv)
+{
+	Screen *s;
+	Widget *w;
+	int slot;
+
+	if (c->state != ACTIVE)
+		return 1;
+
+	if (argc != 4) {
+		sock_send_error(c->sock, "Usage: widget_shm <screenid> <widgetid> <slot>\n");
+		return 0;
+	}
+
+	s = client_find_screen(c, argv[1]);
+	if (s == NULL) {
+		sock_send_error(c->sock, "Invalid screen id\n");
+		return 0;
+	}
+
+	w = screen_find_widget(s, argv[2]);
+	if (w == NULL) {
+		sock_send_error(c->sock, "Invalid widget id\n");
+		return 0;
+	}
+
+	slot = atoi(argv[3]);
+	if ((slot < -1) || (slot >= c->shm_slots)) {
+		sock_send_error(c->sock, "Invalid slot\n");
+		return 0;
+	}
+
+	w->shm_slot = slot;
+	w->shm_seq = 0;
+
+	sock_send_string(c->sock, "success\n");
+	return 0;
+}
+
 static int not_direction(char c) {
 	return c != 'h' && c != 'v';
 }
@@ -230,6 +290,7 @@ widget_set_func(Client *c, int argc, char **argv)
 		}
 		return 0;
 	}
+	screen_touch(w->screen);
 	i = 3;
 	switch (w->type) {
 	case WID_STRING:		/* String takes "x y text" */
@@ -246,9 +307,11 @@ widget_set_func(Client *c, int argc, char **argv)
 
 		w->x = atoi(argv[i]);
 		w->y = atoi(argv[i + 1]);
-		free(w->text);
-		w->text = strdup(argv[i + 2]);
-		debug(RPT_DEBUG, "Widget %s set to %s", wid, w->text);
+		if (widget_set_text(w, argv[i + 2]) < 0) {
+			sock_send_error(c->sock, "Error allocating text\n");
+			return 0;
+		}
+		debug(RPT_DEBUG, "Widget %s set to %s", wid, argv[i + 2]);
 
 		break;
 	case WID_HBAR:			/* Hbar takes "x y length" */
@@ -343,11 +406,14 @@ widget_set_func(Client *c, int argc, char **argv)
 			return 0;
 		}
 
-		free(w->text);
-		w->text = strdup(argv[i]);
+		if (widget_set_text(w, argv[i]) < 0) {
+			sock_send_error(c->sock, "Error allocating text\n");
+			return 0;
+		}
 		/* Set width too */
 		w->width = display_props->width;
-		debug(RPT_DEBUG, "Widget %s set to %s", wid, w->text);
+		w->anim.valid = 0;
+		debug(RPT_DEBUG, "Widget %s set to %s", wid, argv[i]);
 
 		break;
 	case WID_SCROLLER:		/* Scroller takes "left top right bottom direction speed text" */
@@ -376,9 +442,12 @@ widget_set_func(Client *c, int argc, char **argv)
 		w->bottom = atoi(argv[i + 3]);
 		w->length = argv[i + 4][0];
 		w->speed = atoi(argv[i + 5]);
-		free(w->text);
-		w->text = strdup(argv[i + 6]);
-		debug(RPT_DEBUG, "Widget %s set to %s", wid, w->text);
+		w->anim.valid = 0;
+		if (widget_set_text(w, argv[i + 6]) < 0) {
+			sock_send_error(c->sock, "Error allocating text\n");
+			return 0;
+		}
+		debug(RPT_DEBUG, "Widget %s set to %s", wid, argv[i + 6]);
 
 		break;
 	case WID_FRAME:			/* Frame takes "left top right bottom wid hgt direction speed" */
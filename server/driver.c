@@ -73,6 +73,9 @@ DriverSymbols driver_symbols[] = {
 	{ "output",             offsetof(Driver, output),             0 },
 	{ "get_key",            offsetof(Driver, get_key),            0 },
 	{ "get_info",           offsetof(Driver, get_info),           0 },
+	{ "get_input_fd",       offsetof(Driver, get_input_fd),       0 },
+	{ "input_ready",        offsetof(Driver, input_ready),        0 },
+	{ "cells",              offsetof(Driver, cells),              0 },
 	{ NULL, 0, 0 }
 };
 
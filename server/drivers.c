@@ -15,6 +15,9 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/select.h>
 
 #ifdef HAVE_CONFIG_H
 # include "config.h"
@@ -27,6 +30,8 @@
 #include "driver.h"
 #include "drivers.h"
 #include "widget.h"
+#include "cellbuf.h"
+#include "main.h" /* for frame_interval */
 
 Driver *output_driver = NULL;
 LinkedList *loaded_drivers = NULL;		/**< list of loaded drivers */
@@ -34,6 +39,15 @@ DisplayProps *display_props = NULL;		/**< properties of the display */
 
 #define ForAllDrivers(drv) for (drv = LL_GetFirst(loaded_drivers); drv; drv = LL_GetNext(loaded_drivers))
 
+/** Default for the least number of flushes per second of a static display */
+#define DEFAULT_IDLE_REFRESH_RATE	1
+
+/** Microseconds from a to b */
+#define TV_DIFF(a, b)	(((b).tv_sec - (a).tv_sec) * 1000000L + ((b).tv_usec - (a).tv_usec))
+
+static struct timeval catch_up;	/**< When the first driver left out may be flushed */
+static int catching_up = 0;	/**< A driver was left out of the last flush */
+
 
 /**
  * Load driver based on "DriverPath" config setting and section name or
@@ -48,6 +62,7 @@ drivers_load_driver(const char *name)
 {
 	Driver *driver;
 	const char *s;
+	double rate;
 
 	debug(RPT_DEBUG, "%s(name=\"%.40s\")", __FUNCTION__, name);
 
@@ -81,6 +96,13 @@ drivers_load_driver(const char *name)
 		return -1;
 	}
 
+	/* Refresh rates, in flushes per second */
+	rate = config_get_float(name, "MaxRefreshRate", 0, 0);
+	driver->refresh_interval = (rate > 0) ? (long) (1e6 / rate) : 0;
+	rate = config_get_float(name, "IdleRefreshRate", 0, DEFAULT_IDLE_REFRESH_RATE);
+	driver->idle_interval = (rate > 0) ? (long) (1e6 / rate) : 0;
+	driver->states_pending = 1;
+
 	/* Add driver to list */
 	LL_Push(loaded_drivers, driver);
 
@@ -127,6 +149,8 @@ drivers_unload_all(void)
 	while ((driver = LL_Pop(loaded_drivers)) != NULL) {
 		driver_unload(driver);
 	}
+
+	cellbuf_free();
 }
 
 
@@ -152,44 +176,144 @@ drivers_get_info(void)
 
 
 /**
- * Clear screen on all loaded drivers.
- * Call clear() function of all loaded drivers that have a clear() function defined.
+ * Start a new frame on all loaded drivers.
+ * The frame is composed in the core's cell buffer, sized to the largest
+ * display; the drivers are only cleared if drivers_flush() has to redraw
+ * them completely.
  */
 void
 drivers_clear(void)
 {
 	Driver *drv;
+	int width = display_props ? display_props->width : 0;
+	int height = display_props ? display_props->height : 0;
 
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
 	ForAllDrivers(drv) {
-		if (drv->clear)
-			drv->clear(drv);
+		if (drv->width && drv->width(drv) > width)
+			width = drv->width(drv);
+		if (drv->height && drv->height(drv) > height)
+			height = drv->height(drv);
 	}
+
+	cellbuf_clear(width, height);
+}
+
+
+/**
+ * Check whether a driver is to be flushed now: if the frame changed for it
+ * or it has not been refreshed for its idle interval, and unless it was
+ * flushed less than its refresh interval ago or is still catching up with
+ * a slow flush.
+ * \param drv  Pointer to driver structure.
+ * \param now  Current time.
+ * \return  1 if the driver is to be flushed, 0 if it is left out.
+ */
+static int
+drivers_flush_due(Driver *drv, const struct timeval *now)
+{
+	if (TV_DIFF(drv->next_flush, *now) < 0)
+		return 0;
+	if (drv->states_pending || cellbuf_changed(drv))
+		return 1;
+	/* Keep refreshing; the renders for it fall on frame boundaries */
+	return ((drv->idle_interval > 0)
+		&& (TV_DIFF(drv->last_flush, *now) >= drv->idle_interval - frame_interval / 2));
 }
 
 
 /**
- * Flush data on all loaded drivers to LCDs.
- * Call flush() function of all loaded drivers that have a flush() function defined.
+ * Flush the frame to all loaded drivers.
+ * Each driver gets the changes since the frame it got last (see cellbuf.c),
+ * then its flush() function is called if it has one. Drivers that would not
+ * change, that are limited by MaxRefreshRate, or whose last flush took
+ * long are left out and get the changes with a later frame: a flush that
+ * took some time is followed by at least the same time without one, so a
+ * slow display cannot hold up the server.
  */
 void
 drivers_flush(void)
 {
 	Driver *drv;
+	struct timeval start, end;
 
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
+	catching_up = 0;
 	ForAllDrivers(drv) {
+		long int took;
+
+		gettimeofday(&start, NULL);
+		if (!drivers_flush_due(drv, &start) && (cellbuf_skip(drv) == 0)) {
+			if ((drv->states_pending || cellbuf_changed(drv))
+			    && (!catching_up || TV_DIFF(drv->next_flush, catch_up) > 0)) {
+				catch_up = drv->next_flush;
+				catching_up = 1;
+			}
+			continue;
+		}
+
+		cellbuf_replay(drv);
 		if (drv->flush)
 			drv->flush(drv);
+		drv->states_pending = 0;
+
+		gettimeofday(&end, NULL);
+		took = max(TV_DIFF(start, end), 0);
+		drv->last_flush = start;
+		drv->next_flush = end;
+		drv->next_flush.tv_usec += max(took, drv->refresh_interval - took);
+		drv->next_flush.tv_sec += drv->next_flush.tv_usec / 1000000;
+		drv->next_flush.tv_usec %= 1000000;
 	}
+
+	cellbuf_commit();
+}
+
+
+/**
+ * Get the time until a driver that was left out of the last flush, but has
+ * changes to show, can be flushed.
+ * \return  Time in microseconds, or -1 if no driver is waiting.
+ */
+long int
+drivers_catch_up_time(void)
+{
+	struct timeval now;
+
+	if (!catching_up)
+		return -1;
+
+	gettimeofday(&now, NULL);
+	return max(TV_DIFF(now, catch_up), 0);
+}
+
+
+/**
+ * Get the longest time the display may go without a render, so that every
+ * driver is refreshed according to its IdleRefreshRate.
+ * \return  Time in microseconds, or -1 if no driver needs refreshing.
+ */
+long int
+drivers_idle_interval(void)
+{
+	Driver *drv;
+	long int interval = -1;
+
+	ForAllDrivers(drv) {
+		if ((drv->idle_interval > 0)
+		    && ((interval < 0) || (drv->idle_interval < interval)))
+			interval = drv->idle_interval;
+	}
+	return interval;
 }
 
 
 /**
  * Write string to all loaded drivers.
- * Call string() function of all loaded drivers that have a flush() function defined.
+ * The string is recorded in the frame; drivers_flush() calls string() (or
+ * cells()) of the drivers for the cells that changed.
  * \param x        Horizontal character position (column).
  * \param y        Vertical character position (row).
  * \param string   String that gets written.
@@ -197,20 +321,16 @@ drivers_flush(void)
 void
 drivers_string(int x, int y, const char *string)
 {
-	Driver *drv;
-
 	debug(RPT_DEBUG, "%s(x=%d, y=%d, string=\"%.40s\")", __FUNCTION__, x, y, string);
 
-	ForAllDrivers(drv) {
-		if (drv->string)
-			drv->string(drv, x, y, string);
-	}
+	cellbuf_string(x, y, string);
 }
 
 
 /**
  * Write a character to all loaded drivers.
- * Call chr() function of all loaded drivers that have a chr() function defined.
+ * The character is recorded in the frame; drivers_flush() calls chr() of
+ * the drivers if it changed.
  * \param x        Horizontal character position (column).
  * \param y        Vertical character position (row).
  * \param c        Character that gets written.
@@ -218,21 +338,17 @@ drivers_string(int x, int y, const char *string)
 void
 drivers_chr(int x, int y, char c)
 {
-	Driver *drv;
-
 	debug(RPT_DEBUG, "%s(x=%d, y=%d, c='%c')", __FUNCTION__, x, y, c);
 
-	ForAllDrivers(drv) {
-		if (drv->chr)
-			drv->chr(drv, x, y, c);
-	}
+	cellbuf_chr(x, y, c);
 }
 
 
 /**
  * Draw a vertical bar to all drivers.
- * For drivers that define a vbar() function, call it;
- * otherwise call the general driver_alt_vbar() function from the server core.
+ * When the bar is flushed, drivers that define a vbar() function get it
+ * through that; for the others the general driver_alt_vbar() function from
+ * the server core is used.
  * \param x        Horizontal character position (column) of the starting point.
  * \param y        Vertical character position (row) of the starting point.
  * \param len      Number of characters that the bar is long at 100%
@@ -242,8 +358,6 @@ drivers_chr(int x, int y, char c)
 void
 drivers_vbar(int x, int y, int len, int promille, int pattern)
 {
-	Driver *drv;
-
 	debug(RPT_DEBUG, "%s(x=%d, y=%d, len=%d, promille=%d, pattern=%d)",
 	      __FUNCTION__, x, y, len, promille, pattern);
 
@@ -252,20 +366,15 @@ drivers_vbar(int x, int y, int len, int promille, int pattern)
 	 * We need more data in the widget. Requires language update...
 	 */
 
-
-	ForAllDrivers(drv) {
-		if (drv->vbar)
-			drv->vbar(drv, x, y, len, promille, pattern);
-		else
-			driver_alt_vbar(drv, x, y, len, promille, pattern);
-	}
+	cellbuf_vbar(x, y, len, promille, pattern);
 }
 
 
 /**
  * Draw a horizontal bar to all drivers.
- * For drivers that define a hbar() function, call it;
- * otherwise call the general driver_alt_hbar() function from the server core.
+ * When the bar is flushed, drivers that define a hbar() function get it
+ * through that; for the others the general driver_alt_hbar() function from
+ * the server core is used.
  * \param x        Horizontal character position (column) of the starting point.
  * \param y        Vertical character position (row) of the starting point.
  * \param len      Number of characters that the bar is long at 100%
@@ -275,17 +384,10 @@ drivers_vbar(int x, int y, int len, int promille, int pattern)
 void
 drivers_hbar(int x, int y, int len, int promille, int pattern)
 {
-	Driver *drv;
-
 	debug(RPT_DEBUG, "%s(x=%d, y=%d, len=%d, promille=%d, pattern=%d)",
 	      __FUNCTION__, x, y, len, promille, pattern);
 
-	ForAllDrivers(drv) {
-		if (drv->hbar)
-			drv->hbar(drv, x, y, len, promille, pattern);
-		else
-			driver_alt_hbar(drv, x, y, len, promille, pattern);
-	}
+	cellbuf_hbar(x, y, len, promille, pattern);
 }
 
 
@@ -306,64 +408,49 @@ drivers_hbar(int x, int y, int len, int promille, int pattern)
 void
 drivers_pbar(int x, int y, int width, int promille, char *begin_label, char *end_label)
 {
-	Driver *drv;
-
-	ForAllDrivers(drv)
-		driver_pbar(drv, x, y, width, promille, begin_label, end_label);
+	cellbuf_pbar(x, y, width, promille, begin_label, end_label);
 }
 
 
 /**
  * Write a big number to all output drivers.
- * For drivers that define a num() function, call it;
- * otherwise call the general driver_alt_num() function from the server core.
+ * When the number is flushed, drivers that define a num() function get it
+ * through that; for the others the general driver_alt_num() function from
+ * the server core is used.
  * \param x        Horizontal character position (column).
  * \param num      Character to write (0 - 10 with 10 representing ':')
  */
 void
 drivers_num(int x, int num)
 {
-	Driver *drv;
-
 	debug(RPT_DEBUG, "%s(x=%d, num=%d)", __FUNCTION__, x, num);
 
-	ForAllDrivers(drv) {
-		if (drv->num)
-			drv->num(drv, x, num);
-		else
-			driver_alt_num(drv, x, num);
-	}
+	cellbuf_num(x, num);
 }
 
 
 /**
  * Perform heartbeat on all drivers.
- * For drivers that define a heartbeat() function, call it;
- * otherwise call the general driver_alt_heartbeat() function from the server core.
+ * When the frame is flushed, drivers that define a heartbeat() function get
+ * it through that; for the others the general driver_alt_heartbeat()
+ * function from the server core is used.
  * \param state    Heartbeat state.
  */
 void
 drivers_heartbeat(int state)
 {
-	Driver *drv;
-
 	debug(RPT_DEBUG, "%s(state=%d)", __FUNCTION__, state);
 
-	ForAllDrivers(drv) {
-		if (drv->heartbeat)
-			drv->heartbeat(drv, state);
-		else
-			driver_alt_heartbeat(drv, state);
-	}
+	cellbuf_heartbeat(state);
 }
 
 
 /**
  * Write icon to all drivers.
- * For drivers that define a icon() function, call it;
- * otherwise call the general driver_alt_icon() function from the server core.
- * If the driver's locally defined icon() function returns -1, then also
- * call the server core's driver_alt_icon().
+ * When the icon is flushed, drivers that define a icon() function get it
+ * through that; for the others the general driver_alt_icon() function from
+ * the server core is used. If the driver's locally defined icon() function
+ * returns -1, then also the server core's driver_alt_icon() is used.
  * \param x        Horizontal character position (column).
  * \param y        Vertical character position (row).
  * \param icon     synbolic value representing the icon.
@@ -371,30 +458,17 @@ drivers_heartbeat(int state)
 void
 drivers_icon(int x, int y, int icon)
 {
-	Driver *drv;
-
 	debug(RPT_DEBUG, "%s(x=%d, y=%d, icon=ICON_%s)", __FUNCTION__, x, y, widget_icon_to_iconname(icon));
 
-	ForAllDrivers(drv) {
-		/* Does the driver have the icon function ? */
-		if (drv->icon) {
-			/* Try driver call */
-			if (drv->icon(drv, x, y, icon) == -1) {
-				/* do alternative call if driver's function does not know the icon */
-				driver_alt_icon(drv, x, y, icon);
-			}
-		} else {
-			/* Also do alternative call if the driver does not have icon function */
-			driver_alt_icon(drv, x, y, icon);
-		}
-	}
+	cellbuf_icon(x, y, icon);
 }
 
 
 /**
  * Set cursor on all loaded drivers.
- * For drivers that define a cursor() function, call it;
- * otherwise call the general driver_alt_cursor() function from the server core.
+ * When the frame is flushed, drivers that define a cursor() function get it
+ * through that; for the others the general driver_alt_cursor() function
+ * from the server core is used.
  * \param x        Horizontal cursor position (column).
  * \param y        Vertical cursor position (row).
  * \param state    New cursor state.
@@ -402,16 +476,9 @@ drivers_icon(int x, int y, int icon)
 void
 drivers_cursor(int x, int y, int state)
 {
-	Driver *drv;
-
 	debug(RPT_DEBUG, "%s(x=%d, y=%d, state=%d)", __FUNCTION__, x, y, state);
 
-	ForAllDrivers(drv) {
-		if (drv->cursor)
-			drv->cursor(drv, x, y, state);
-		else
-			driver_alt_cursor(drv, x, y, state);
-	}
+	cellbuf_cursor(x, y, state);
 }
 
 
@@ -423,13 +490,19 @@ drivers_cursor(int x, int y, int state)
 void
 drivers_backlight(int state)
 {
+	static int last_state = -1;
+	int changed = (state != last_state);
 	Driver *drv;
 
 	debug(RPT_DEBUG, "%s(state=%d)", __FUNCTION__, state);
 
+	last_state = state;
 	ForAllDrivers(drv) {
 		if (drv->backlight)
 			drv->backlight(drv, state);
+		/* Drivers may only change the backlight when flushed */
+		if (changed)
+			drv->states_pending = 1;
 	}
 }
 
@@ -442,13 +515,18 @@ drivers_backlight(int state)
 void
 drivers_output(int state)
 {
+	static int last_state = -1;
+	int changed = (state != last_state);
 	Driver *drv;
 
 	debug(RPT_DEBUG, "%s(state=%d)", __FUNCTION__, state);
 
+	last_state = state;
 	ForAllDrivers(drv) {
 		if (drv->output)
 			drv->output(drv, state);
+		if (changed)
+			drv->states_pending = 1;
 	}
 }
 
@@ -468,14 +546,86 @@ drivers_get_key(void)
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
 	ForAllDrivers(drv) {
-		if (drv->get_key) {
+		if (drv->get_input_fd && drv->get_input_fd(drv) >= 0) {
+			/* only read from drivers the server saw input for */
+			if (!drv->input_pending)
+				continue;
+			keystroke = (drv->input_ready) ? drv->input_ready(drv) : drv->get_key(drv);
+			if (keystroke == NULL)
+				drv->input_pending = 0;
+		}
+		else if (drv->get_key) {
 			keystroke = drv->get_key(drv);
-			if (keystroke != NULL) {
-				report(RPT_INFO, "Driver [%.40s] generated keystroke %.40s", drv->name, keystroke);
-				return keystroke;
-			}
+		}
+		else
+			continue;
+
+		if (keystroke != NULL) {
+			report(RPT_INFO, "Driver [%.40s] generated keystroke %.40s", drv->name, keystroke);
+			return keystroke;
 		}
 	}
 	return NULL;
 }
 
+
+/**
+ * Wait until one of the drivers that provide an input file descriptor has
+ * input, or the timeout expires. Drivers with input are remembered, so the
+ * next drivers_get_key() only reads from those.
+ * \param timeout  Max. time to wait in microseconds.
+ * \return  Number of drivers that have input.
+ */
+int
+drivers_wait_input(long int timeout)
+{
+	Driver *drv;
+	fd_set rfds;
+	struct timeval tv;
+	int maxfd = -1;
+	int ready = 0;
+
+	FD_ZERO(&rfds);
+	ForAllDrivers(drv) {
+		if (drv->get_input_fd) {
+			int fd = drv->get_input_fd(drv);
+
+			if (fd >= 0 && fd < FD_SETSIZE) {
+				if (drv->input_pending)
+					ready++;
+				FD_SET(fd, &rfds);
+				if (fd > maxfd)
+					maxfd = fd;
+			}
+		}
+	}
+
+	/* input left over from the last call is handled at once */
+	if (ready > 0)
+		return ready;
+
+	if (maxfd < 0) {
+		/* no driver to wait for */
+		if (timeout > 0)
+			usleep(timeout);
+		return 0;
+	}
+
+	tv.tv_sec = timeout / 1000000;
+	tv.tv_usec = timeout % 1000000;
+	if (select(maxfd + 1, &rfds, NULL, NULL, &tv) <= 0)
+		return 0;
+
+	ForAllDrivers(drv) {
+		if (drv->get_input_fd) {
+			int fd = drv->get_input_fd(drv);
+
+			if (fd >= 0 && fd < FD_SETSIZE && FD_ISSET(fd, &rfds)) {
+				drv->input_pending = 1;
+				ready++;
+			}
+		}
+	}
+	return ready;
+}
+
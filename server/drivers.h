@@ -37,6 +37,12 @@ drivers_clear(void);
 void
 drivers_flush(void);
 
+long int
+drivers_catch_up_time(void);
+
+long int
+drivers_idle_interval(void);
+
 void
 drivers_string(int x, int y, const char *string);
 
@@ -82,6 +88,9 @@ drivers_output(int state);
 const char *
 drivers_get_key(void);
 
+int
+drivers_wait_input(long int timeout);
+
 
 extern Driver *output_driver;
 
@@ -2,6 +2,14 @@
  * I/O routines for the \c CFontzPacket driver. Currently the CFA-631,
  * CFA-533, CFA-633 and CFA-635 LCDs use this type of protocol.
  *
+ * Packets are pipelined: a command is written with a single writev() and
+ * the next one is sent without waiting for its acknowledgement, as long as
+ * no more than CFONTZ633_MAX_INFLIGHT packets (CFONTZ633_MAX_INFLIGHT_BYTES
+ * bytes) are unacknowledged. Acknowledgements are matched against the queue
+ * of commands in flight as they arrive, together with key reports from the
+ * same stream, so updating several lines costs about one round trip instead
+ * of one per line.
+ *
  * \todo  Add reporting (shared/report.h) to the send_#_message functions
  *        if send failed (or an error response is received).
  * \todo  Make the content of a response packet available to the driver.
@@ -60,6 +68,8 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
 
 #if defined(HAVE_SYS_SELECT_H)
 # include <sys/select.h>
@@ -81,11 +91,49 @@
 #endif
 
 
+/*
+ * Max. number of packets and bytes sent to the LCD without being
+ * acknowledged. The LCD buffers incoming packets while it processes the
+ * current one; stay well below the size of its receive buffer.
+ */
+#if !defined(CFONTZ633_MAX_INFLIGHT)
+# define CFONTZ633_MAX_INFLIGHT 4
+#endif
+#if !defined(CFONTZ633_MAX_INFLIGHT_BYTES)
+# define CFONTZ633_MAX_INFLIGHT_BYTES 64
+#endif
+
+/* Max. time to wait for an acknowledgement (LCDs should answer within 250ms) */
+#define ACK_TIMEOUT 250000
+
+/* Response types in the upper two bits of the command byte */
+#define TYPE_MASK	0xC0
+#define TYPE_ACK	0x40
+#define TYPE_REPORT	0x80
+#define TYPE_ERROR	0xC0
+
+/** Commands sent to the LCD whose acknowledgement is outstanding. */
+typedef struct {
+	unsigned char command[CFONTZ633_MAX_INFLIGHT];	/**< Ring of commands in send order */
+	unsigned char size[CFONTZ633_MAX_INFLIGHT];	/**< Packet size of each command */
+	int head;		/**< Index of the oldest command */
+	int count;		/**< Number of commands in flight */
+	int bytes;		/**< Number of bytes in flight */
+} InFlight;
+
+static InFlight inflight;
+
+
 /* static local functions */
-static void send_packet(int fd, COMMAND_PACKET *out, COMMAND_PACKET *in);
+static void send_packet(int fd, COMMAND_PACKET *out);
+static int  write_all(int fd, struct iovec *iov, int iovcnt);
 static int  get_crc(unsigned char *buf, int len, int seed);
-static int  test_packet(int fd, unsigned char response, COMMAND_PACKET *in);
-static int  check_for_packet(int fd, COMMAND_PACKET *in, unsigned char expected_length);
+static void fill_receive_buffer(ReceiveBuffer *rb, int fd, unsigned int number);
+static void receive_bytes(ReceiveBuffer *rb, int fd, int usec);
+static int  process_packets(int fd, int usec);
+static void handle_packet(COMMAND_PACKET *in);
+static void wait_for_room(int fd, int size);
+static int  check_for_packet(COMMAND_PACKET *in);
 #ifdef DEBUG
 static void print_packet(COMMAND_PACKET *packet);
 #endif
@@ -165,14 +213,13 @@ unsigned char GetKeyFromKeyRing(KeyRing *kr)
 void send_bytes_message(int fd, unsigned char msg, int len, unsigned char *data)
 {
 	COMMAND_PACKET out;
-	COMMAND_PACKET in;
 
 	out.command = msg;
 	out.data_length = (unsigned char) ((len > MAX_DATA_LENGTH) ? MAX_DATA_LENGTH : len);
 	memcpy(out.data, data, out.data_length);
 
 	/* send message & calc CRC */
-	send_packet(fd, &out, &in);
+	send_packet(fd, &out);
 }
 
 
@@ -185,14 +232,13 @@ void send_bytes_message(int fd, unsigned char msg, int len, unsigned char *data)
 void send_onebyte_message(int fd, unsigned char msg, unsigned char value)
 {
 	COMMAND_PACKET out;
-	COMMAND_PACKET in;
 
 	out.command = msg;
 	out.data_length = 1;
 	out.data[0] = value;
 
 	/* send message & calc CRC */
-	send_packet(fd, &out, &in);
+	send_packet(fd, &out);
 }
 
 
@@ -204,43 +250,220 @@ void send_onebyte_message(int fd, unsigned char msg, unsigned char value)
 void send_zerobyte_message(int fd, unsigned char msg)
 {
 	COMMAND_PACKET out;
-	COMMAND_PACKET in;
 
 	out.command = msg;
 	out.data_length = 0;
 
 	/* send message & calc CRC */
-	send_packet(fd, &out, &in);
+	send_packet(fd, &out);
 }
 
 
 /**
- * Send out to the given handle; calc & send CRC when doing so.
+ * Wait until all packets sent are acknowledged (or timed out). Use this
+ * before operations that depend on the LCD having executed all commands.
+ * \param fd    File handle of the LCD.
+ */
+void drain_packets(int fd)
+{
+	while (inflight.count > 0)
+		wait_for_room(fd, CFONTZ633_MAX_INFLIGHT_BYTES);
+}
+
+
+/**
+ * Read all packets the LCD sent so far, without waiting. Key reports are
+ * stored in the key ring and acknowledgements are matched.
+ * \param fd    File handle of the LCD.
+ */
+void poll_packets(int fd)
+{
+	process_packets(fd, 0);
+}
+
+
+/**
+ * Send out to the given handle; calc & send CRC when doing so. The packet
+ * is queued as in flight; it does not wait for the acknowledgement unless
+ * the LCD has too many packets to process.
  * \param fd    File handle to write to.
  * \param out   Pointer to COMMAND_PACKET structure to write.
- * \param in    Pointer to COMMAND_PACKET structure to read after write.
  */
 static void
-send_packet(int fd, COMMAND_PACKET *out, COMMAND_PACKET *in)
+send_packet(int fd, COMMAND_PACKET *out)
 {
 	unsigned char CRC[2];
+	struct iovec iov[3];
+	int size = out->data_length + 4;
+	int slot;
 
-	write(fd, &out->command, 1);
-	write(fd, &out->data_length, 1);
-	if (out->data_length > 0)
-		write(fd, out->data, out->data_length);
-
-	/* calculate & send the CRC: convert to bytes manually to avoid endianess issues */
+	/* calculate the CRC: convert to bytes manually to avoid endianess issues */
 	out->crc = get_crc((unsigned char *) out, out->data_length + 2, 0xFFFF);
 	CRC[0] = out->crc & 0xFF;
 	CRC[1] = (out->crc >> 8) & 0xFF;
-	write(fd, CRC, 2);
+
+	iov[0].iov_base = &out->command;	/* command & data_length */
+	iov[0].iov_len = 2;
+	iov[1].iov_base = out->data;
+	iov[1].iov_len = out->data_length;
+	iov[2].iov_base = CRC;
+	iov[2].iov_len = 2;
 
 	/**** TEST STUFF ****/
 	//print_packet(out);
 
-	/* Every time we send a message, we also check for an incoming one. */
-	test_packet(fd, 0x40 | out->command, in);
+	/* make sure the LCD can take the packet, handling responses meanwhile */
+	wait_for_room(fd, size);
+
+	if (write_all(fd, iov, 3) < 0)
+		return;
+
+	slot = (inflight.head + inflight.count) % CFONTZ633_MAX_INFLIGHT;
+	inflight.command[slot] = out->command;
+	inflight.size[slot] = size;
+	inflight.count++;
+	inflight.bytes += size;
+
+	/* Every time we send a message, we also check for incoming ones. */
+	process_packets(fd, 0);
+}
+
+
+/**
+ * Write a vector of buffers completely, even to a non-blocking handle.
+ * \param fd      File handle to write to.
+ * \param iov     Buffers to write; modified.
+ * \param iovcnt  Number of buffers.
+ * \retval 0   Success.
+ * \retval -1  Write error.
+ */
+static int
+write_all(int fd, struct iovec *iov, int iovcnt)
+{
+	while (iovcnt > 0) {
+		ssize_t written = writev(fd, iov, iovcnt);
+
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+#if defined(HAVE_SELECT)
+			if (errno == EAGAIN) {
+				fd_set wfds;
+
+				FD_ZERO(&wfds);
+				FD_SET(fd, &wfds);
+				select(fd + 1, NULL, &wfds, NULL, NULL);
+				continue;
+			}
+#endif
+			return -1;
+		}
+
+		/* skip what was written */
+		while ((iovcnt > 0) && (written >= (ssize_t) iov->iov_len)) {
+			written -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * Wait for acknowledgements until a packet of the given size may be sent.
+ * If the LCD does not answer in time, the oldest packet is given up.
+ * \param fd    File handle of the LCD.
+ * \param size  Size of the packet to be sent.
+ */
+static void
+wait_for_room(int fd, int size)
+{
+	while ((inflight.count >= CFONTZ633_MAX_INFLIGHT) ||
+	       ((inflight.count > 0) && (inflight.bytes + size > CFONTZ633_MAX_INFLIGHT_BYTES))) {
+#if defined(HAVE_SELECT) && defined(CFONTZ633_WRITE_DELAY) && (CFONTZ633_WRITE_DELAY > 0)
+		int count = inflight.count;
+		int loop;
+
+		for (loop = ACK_TIMEOUT/CFONTZ633_WRITE_DELAY; (inflight.count == count) && (loop > 0); loop--)
+			process_packets(fd, CFONTZ633_WRITE_DELAY);
+
+		if (inflight.count < count)
+			continue;
+#else
+		process_packets(fd, 0);
+#endif
+		/* no acknowledgement: assume the packet got lost */
+		inflight.bytes -= inflight.size[inflight.head];
+		inflight.head = (inflight.head + 1) % CFONTZ633_MAX_INFLIGHT;
+		inflight.count--;
+	}
+}
+
+
+/**
+ * Read data the LCD sent and handle all complete packets in it.
+ * \param fd    File handle to read from.
+ * \param usec  Max. time to wait for data, in microseconds.
+ * \return  Number of packets handled.
+ */
+static int
+process_packets(int fd, int usec)
+{
+	COMMAND_PACKET in;
+	int handled = 0;
+	int is_msg;
+
+	receive_bytes(&receivebuffer, fd, usec);
+
+	while ((is_msg = check_for_packet(&in)) != GIVE_UP) {
+		if (is_msg == GOOD_MSG) {
+			handle_packet(&in);
+			handled++;
+		}
+	}
+	return handled;
+}
+
+
+/**
+ * Handle a packet received from the LCD: store key reports in the key ring
+ * and match acknowledgements against the commands in flight. The LCD
+ * answers in order, so commands before the acknowledged one got lost.
+ * \param in  Pointer to the received packet.
+ */
+static void
+handle_packet(COMMAND_PACKET *in)
+{
+	unsigned char type = in->command & TYPE_MASK;
+	unsigned char command = in->command & ~TYPE_MASK;
+	int i;
+
+	if (type == TYPE_REPORT) {
+		/* key activity ? */
+		if (command == 0)
+			AddKeyToKeyRing(&keyring, in->data[0]);
+		return;
+	}
+	if ((type != TYPE_ACK) && (type != TYPE_ERROR))
+		return;
+
+	for (i = 0; i < inflight.count; i++) {
+		if (inflight.command[(inflight.head + i) % CFONTZ633_MAX_INFLIGHT] == command)
+			break;
+	}
+	if (i == inflight.count)
+		return;		/* late answer to a packet already given up */
+
+	for (; i >= 0; i--) {
+		inflight.bytes -= inflight.size[inflight.head];
+		inflight.head = (inflight.head + 1) % CFONTZ633_MAX_INFLIGHT;
+		inflight.count--;
+	}
 }
 
 
@@ -348,44 +571,85 @@ void EmptyReceiveBuffer(ReceiveBuffer *rb)
  */
 void SyncReceiveBuffer(ReceiveBuffer *rb, int fd, unsigned int number)
 {
-	unsigned char buffer[MAX_DATA_LENGTH];
-	int BytesRead;
-
 #if defined(HAVE_SELECT) && defined(CFONTZ633_WRITE_DELAY) && (CFONTZ633_WRITE_DELAY > 0)
 	fd_set rfds;
 	struct timeval timeout;
-	int retval;
 
 	FD_ZERO(&rfds);
 	FD_SET(fd, &rfds);
 	timeout.tv_sec = 0;
 	timeout.tv_usec = CFONTZ633_WRITE_DELAY;
-	retval = select(fd + 1, &rfds, NULL, NULL, &timeout);
 
-	if (!retval)
+	if (select(fd + 1, &rfds, NULL, NULL, &timeout) <= 0)
 		return;
 #endif
 
-	if (number > MAX_DATA_LENGTH)
-		number = MAX_DATA_LENGTH;
+	fill_receive_buffer(rb, fd, number);
+}
 
-	BytesRead = read(fd, buffer, number);
 
-	if (BytesRead > 0) {
-		int i;
+/**
+ * Read up to the given number of bytes that are available from the given
+ * file handle straight into the free space of the receive buffer.
+ * \param rb      Pointer to ReceiveBuffer structure.
+ * \param fd      File handle to read from.
+ * \param number  Max. number of bytes to read from file handle.
+ */
+static void
+fill_receive_buffer(ReceiveBuffer *rb, int fd, unsigned int number)
+{
+	while (number > 0) {
+		/* free space up to the buffer end */
+		int space = RECEIVEBUFFERSIZE - 1 - BytesAvail(rb);
+		int BytesRead;
 
-		/* wrap write pointer to the receive buffer */
 		rb->head %= RECEIVEBUFFERSIZE;
-
-		/* store the bytes read wrapping at the buffer end */
-		for (i = 0; i < BytesRead; i++) {
-			rb->contents[rb->head] = buffer[i];
-			rb->head = (rb->head + 1) % RECEIVEBUFFERSIZE;
-		}
+		if (space > RECEIVEBUFFERSIZE - rb->head)
+			space = RECEIVEBUFFERSIZE - rb->head;
+		if (space > (int) number)
+			space = number;
+		if (space <= 0)
+			return;
+
+		BytesRead = read(fd, rb->contents + rb->head, space);
+		if (BytesRead <= 0)
+			return;
+
+		rb->head = (rb->head + BytesRead) % RECEIVEBUFFERSIZE;
+		number -= BytesRead;
+		if (BytesRead < space)
+			return;
 	}
 }
 
 
+/**
+ * Read everything available from given file handle into receive buffer,
+ * waiting for data for at most the given time.
+ * \param rb    Pointer to ReceiveBuffer structure.
+ * \param fd    File handle to read from.
+ * \param usec  Max. time to wait, in microseconds.
+ */
+static void
+receive_bytes(ReceiveBuffer *rb, int fd, int usec)
+{
+#if defined(HAVE_SELECT)
+	fd_set rfds;
+	struct timeval timeout;
+
+	FD_ZERO(&rfds);
+	FD_SET(fd, &rfds);
+	timeout.tv_sec = 0;
+	timeout.tv_usec = usec;
+
+	if (select(fd + 1, &rfds, NULL, NULL, &timeout) <= 0)
+		return;
+#endif
+
+	fill_receive_buffer(rb, fd, RECEIVEBUFFERSIZE);
+}
+
+
 /**
  * Get number of bytes available for reading in receive buffer.
  * \param rb  Pointer to ReceiveBuffer structure.
@@ -492,78 +756,22 @@ unsigned char PeekByte(ReceiveBuffer *rb)
 
 
 /**
- * Check for a response packet and try to identify it.
- * \param fd        File handle to read from.
- * \param response  Expected response command.
- * \param in        Pointer to COMMAND_PACKET structure to write the response to.
- * \retval 1  Expected response received.
- * \retval 0  Expected response not received.
- *
- * \todo check_for_packet is always called with MAX_DATA_LENGTH. This doesn't
- *       do any harm, but passing that parameter is useless then. Additionally
- *       one complete packet is MAX_DATA_LENGTH + 4 (command, length, CRC).
- */
-static int
-test_packet(int fd, unsigned char response, COMMAND_PACKET *in)
-{
-#if defined(HAVE_SELECT) && defined(CFONTZ633_WRITE_DELAY) && (CFONTZ633_WRITE_DELAY > 0)
-	int response_received = 0;
-	int loop;
-
-	/* wait for answer packet but forever (LCDs should answer within max. 250ms) */
-	for (loop = 250000/CFONTZ633_WRITE_DELAY; !response_received && loop > 0; loop--) {
-		int is_msg = check_for_packet(fd, in, MAX_DATA_LENGTH);
-
-		while (is_msg != GIVE_UP) {
-			if (is_msg == GOOD_MSG) {
-				/* key activity ? */
-				if (in->command == 0x80)
-					AddKeyToKeyRing(&keyring, in->data[0]);
-				else if (in->command == response)
-					response_received = 1;
-			}
-
-			is_msg = check_for_packet(fd, in, MAX_DATA_LENGTH);
-		}
-	}
-	return(response_received);
-#else
-	int is_msg = check_for_packet(fd, in, MAX_DATA_LENGTH);
-	while (is_msg != GIVE_UP) {
-		if (is_msg == GOOD_MSG) {
-			if (in->command == 0x80)
-				AddKeyToKeyRing(&keyring, in->data[0]);
-		}
-
-		is_msg = check_for_packet(fd, in, MAX_DATA_LENGTH);
-	}
-
-	return 1;
-#endif
-}
-
-
-/**
- * Check for a packet to read. If there is a valid packet in the input buffer
- * it will copy it into \c in and return GOOD_MSG. If there is no enough data
- * available for a valid packet it returns GIVE_UP.
+ * Check for a packet in the receive buffer. If there is a valid packet in
+ * the buffer it will copy it into \c in and return GOOD_MSG. If there is no
+ * enough data available for a valid packet it returns GIVE_UP.
  *
- * \param fd        File handle to read from.
  * \param in        Pointer to COMMAND_PACKET structure to write the response to.
- * \param expected_length  Expected response length.
  *
  * \retval GIVE_UP    No message and we should not retry until new input.
  * \retval TRY_AGAIN  No message but we should try again immediately.
  * \retval GOOD_MSG   Message correctly identified.
  */
 static int
-check_for_packet(int fd, COMMAND_PACKET *in, unsigned char expected_length)
+check_for_packet(COMMAND_PACKET *in)
 {
 	int i;
 	int testcrc;
 
-	SyncReceiveBuffer(&receivebuffer, fd, expected_length);
-
 	/*
 	 * There must be at least 4 bytes available in the input stream for
 	 * there to be a valid command in it (command, length, no data, CRC).
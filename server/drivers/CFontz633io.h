@@ -115,6 +115,8 @@ unsigned char GetKeyFromKeyRing(KeyRing *kr);
 void          send_bytes_message(int fd, unsigned char msg, int len, unsigned char *data);
 void          send_onebyte_message(int fd, unsigned char msg, unsigned char value);
 void          send_zerobyte_message(int fd, unsigned char msg);
+void          drain_packets(int fd);
+void          poll_packets(int fd);
 
 void          EmptyReceiveBuffer(ReceiveBuffer *rb);
 void          SyncReceiveBuffer(ReceiveBuffer *rb, int fd, unsigned int number);
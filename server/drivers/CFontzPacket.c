@@ -324,8 +324,11 @@ CFontzPacket_close (Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 
 	if (p != NULL) {
-		if (p->fd >= 0)
+		if (p->fd >= 0) {
+			/* let the LCD finish the packets still in flight */
+			drain_packets(p->fd);
 			close(p->fd);
+		}
 
 		if (p->framebuf)
 			free(p->framebuf);
@@ -413,28 +416,16 @@ CFontzPacket_flush (Driver *drvthis)
 		 * Older CFA-633 HW/FW types only support updates of full or
 		 * partial line starting from pos 0.
 		 */
-		unsigned char *xp = p->framebuf;
-		unsigned char *xq = p->backingstore;
-
-		for (i = 0; i < p->width; i++) {
-			if (*xp++ != *xq++) {
-				send_bytes_message(p->fd, CF633_Set_LCD_Contents_Line_One, 16, p->framebuf);
-				memcpy(p->backingstore, p->framebuf, p->width);
-				modified++;
-				break;
-			}
+		if (lib_fb_changed(p->framebuf, p->backingstore, p->width)) {
+			send_bytes_message(p->fd, CF633_Set_LCD_Contents_Line_One, 16, p->framebuf);
+			memcpy(p->backingstore, p->framebuf, p->width);
+			modified++;
 		}
 
-		xp = p->framebuf + p->width;
-		xq = p->backingstore + p->width;
-
-		for (i = 0; i < p->width; i++) {
-			if (*xp++ != *xq++) {
-				send_bytes_message(p->fd, CF633_Set_LCD_Contents_Line_Two, 16, p->framebuf + p->width);
-				memcpy(p->backingstore + p->width, p->framebuf + p->width, p->width);
-				modified++;
-				break;
-			}
+		if (lib_fb_changed(p->framebuf + p->width, p->backingstore + p->width, p->width)) {
+			send_bytes_message(p->fd, CF633_Set_LCD_Contents_Line_Two, 16, p->framebuf + p->width);
+			memcpy(p->backingstore + p->width, p->framebuf + p->width, p->width);
+			modified++;
 		}
 	}
 	else {
@@ -454,22 +445,14 @@ CFontzPacket_flush (Driver *drvthis)
 			/* set pointers to start of the line in frame buffer & backing store */
 			unsigned char *sp = p->framebuf + (i * p->width);
 			unsigned char *sq = p->backingstore + (i * p->width);
-
-			/* set pointers to end of the line in frame buffer & backing store */
-			unsigned char *ep = sp + (p->width - 1);
-			unsigned char *eq = sq + (p->width - 1);
-			int length = 0;
+			int length;
 
 			debug(RPT_DEBUG, "Framebuf: '%.*s'", p->width, sp);
 			debug(RPT_DEBUG, "Backingstore: '%.*s'", p->width, sq);
 
-			/* skip over leading identical portions of the line */
-			for (j = 0; (sp <= ep) && (*sp == *sq); sp++, sq++, j++)
-			  ;
-
-			/* skip over trailing identical portions of the line */
-			for (length = p->width - j; (length > 0) && (*ep == *eq); ep--, eq--, length--)
-			  ;
+			/* leave out leading and trailing identical portions of the line */
+			length = lib_fb_diff(sp, sq, p->width, &j);
+			sp += j;
 
 			/* there are differences, ... */
 			if (length > 0) {
@@ -507,7 +490,13 @@ CFontzPacket_flush (Driver *drvthis)
 MODULE_EXPORT const char *
 CFontzPacket_get_key (Driver *drvthis)
 {
-	unsigned char key = GetKeyFromKeyRing(&keyring);
+	PrivateData *p = drvthis->private_data;
+	unsigned char key;
+
+	/* frames without changes are not flushed, so read the key reports
+	 * here instead of waiting for the next flush */
+	poll_packets(p->fd);
+	key = GetKeyFromKeyRing(&keyring);
 
 	switch (key) {
 		case CFP_KEY_UL_PRESS:
@@ -780,6 +769,7 @@ CFontzPacket_reboot (Driver *drvthis)
 	unsigned char out[3] = { 8, 18, 99 };
 
 	send_bytes_message(p->fd, CF633_Reboot, 3, out);
+	drain_packets(p->fd);
 	sleep(2);
 }
 
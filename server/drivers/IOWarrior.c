@@ -564,7 +564,7 @@ IOWarrior_flush(Driver *drvthis)
 {
   PrivateData *p = drvthis->private_data;
 
-  int x, y;
+  int y;
   int i;
   int count;
 
@@ -572,21 +572,17 @@ IOWarrior_flush(Driver *drvthis)
   for (y = 0; y < p->height; y++) {
     int offset = y * p->width;
 
-    for (x = 0; x < p->width; x++) {
-      if (p->backingstore[offset+x] != p->framebuf[offset+x]) {
-        /* always flush a full line */
-        unsigned char buffer[LCD_MAX_WIDTH];
+    if (lib_fb_changed(p->framebuf + offset, p->backingstore + offset, p->width)) {
+      /* always flush a full line */
+      unsigned char buffer[LCD_MAX_WIDTH];
 
-        for (count = 0; count < p->width; count++) {
-          buffer[count] = HD44780_charmap[(unsigned char) p->framebuf[offset+count]];
-          p->backingstore[offset+count] = p->framebuf[offset+count];
-        }
-        iowlcd_set_text(p, 0, y, count, buffer);
-        debug(RPT_DEBUG, "%s: flushed %d chars at (%d,%d)",
-			drvthis->name, count, 0, y);
-
-        x += count-1;
+      for (count = 0; count < p->width; count++) {
+        buffer[count] = HD44780_charmap[(unsigned char) p->framebuf[offset+count]];
+        p->backingstore[offset+count] = p->framebuf[offset+count];
       }
+      iowlcd_set_text(p, 0, y, count, buffer);
+      debug(RPT_DEBUG, "%s: flushed %d chars at (%d,%d)",
+		drvthis->name, count, 0, y);
     }
   }
 
@@ -606,11 +606,7 @@ MtxOrb_flush (Driver *drvthis)
 		/* set pointers to start of the line in frame buffer & backing store */
 		unsigned char *sp = p->framebuf + (i * p->width);
 		unsigned char *sq = p->backingstore + (i * p->width);
-
-		/* set pointers to end of the line in frame buffer & backing store */
-		unsigned char *ep = sp + (p->width - 1);
-		unsigned char *eq = sq + (p->width - 1);
-		int length = 0;
+		int length;
 
 		debug(RPT_DEBUG, "Framebuf: '%.*s'", p->width, sp);
 		debug(RPT_DEBUG, "Backingstore: '%.*s'", p->width, sq);
@@ -619,14 +615,8 @@ MtxOrb_flush (Driver *drvthis)
 		 * - not more than one update command per line
 		 * - leave out leading and trailing parts that are identical
 		 */
-
-		/* skip over leading identical portions of the line */
-		for (j = 0; (sp <= ep) && (*sp == *sq); sp++, sq++, j++)
-			;
-
-		/* skip over trailing identical portions of the line */
-		for (length = p->width - j; (length > 0) && (*ep == *eq); ep--, eq--, length--)
-			;
+		length = lib_fb_diff(sp, sq, p->width, &j);
+		sp += j;
 
 		/* there are differences, ... */
 		if (length > 0) {
@@ -413,17 +413,12 @@ SureElec_flush(Driver * drvthis)
 {
 	PrivateData *p = drvthis->private_data;
 	int modified = 0;
-	int i, j;
+	int i;
 	unsigned char cmd[4] = {'\xFE', '\x47', '\x01', /* line */ 0};
 
 	for (i = 0; i < p->height; i++) {
 		/* Check if line content changed */
-		for (j = 0; j < p->width && p->framebuf[p->width * i + j] ==
-		     p->backingstore[p->width * i + j]; j++) {
-			;
-		}
-
-		if (j < p->width) {
+		if (lib_fb_changed(p->framebuf + p->width * i, p->backingstore + p->width * i, p->width)) {
 			/*
 			 * Line content has been changed, need to output the
 			 * line on screen
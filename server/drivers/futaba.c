@@ -109,6 +109,7 @@ typedef struct futaba_private_data {
 	futabaDriver_t *device;		/* data structure to store info about the futaba device */
 #ifdef HAVE_LIBUSB_1_0
 	libusb_context *ctx;		/* usb context */
+	struct lib_usb_async *usb;	/* asynchronous transfers */
 #endif
 } PrivateData;
 
@@ -119,35 +120,38 @@ MODULE_EXPORT int supports_multiple = 0;
 MODULE_EXPORT char *symbol_prefix = "futaba_";
 
 /**
- * Send the report to the display.
- * \param my_handle  Pointer to usb handle.
+ * Send the report to the display. With libusb-1.0 the report is queued
+ * and futaba_flush() processes the completions.
+ * \param drvthis    Pointer to driver structure.
  * \param my_report  Pointer to the report holding the string.
  * \return	     0 on success, -1 on error.
  */
 int
-futaba_send_report(USB_DEVICE_HANDLE * my_handle, futabaReport_t * my_report)
+futaba_send_report(Driver *drvthis, futabaReport_t * my_report)
 {
-	int retVal = -1;
+	PrivateData *p = drvthis->private_data;
 	uint8_t *p_rep = (uint8_t *) my_report;
 
-	retVal = USB_CONTROL_TRANSFER(my_handle,
 #ifdef HAVE_LIBUSB_1_0
-				LIBUSB_DT_HID,	// Request Type (LIBUSB1.0)
-#else
-				USB_DT_HID,	// Request Type (USB0.1)
-#endif
+	return lib_usb_async_control_out(p->usb,
+				LIBUSB_DT_HID,	// Request Type
 				SET_REPORT,	// Request
 				0x0200,		// Report Type OUTPUT | ID 0
 				0,		// Endpoint
-#ifdef HAVE_LIBUSB_1_0
-				p_rep,		// Data (LIBUSB1.0)
+				p_rep,		// Data
+				sizeof(futabaReport_t));	// Length
 #else
-				(char *) p_rep,	// Data (USB0.1)
-#endif
+	int retVal = USB_CONTROL_TRANSFER(p->my_handle,
+				USB_DT_HID,	// Request Type
+				SET_REPORT,	// Request
+				0x0200,		// Report Type OUTPUT | ID 0
+				0,		// Endpoint
+				(char *) p_rep,	// Data
 				sizeof(futabaReport_t),	// Length
 				5000);
 
 	return (retVal != sizeof(futabaReport_t));
+#endif
 }
 
  /**
@@ -199,7 +203,7 @@ futaba_send_string(Driver *drvthis)
 
 		if (len > 7) {
 			while (len >= 7) {
-				if (futaba_send_report(p->my_handle, &my_report)) {
+				if (futaba_send_report(drvthis, &my_report)) {
 					report(RPT_ERR, "[%s] Failed to send report",
 					       drvthis->name);
 					return -1;
@@ -211,7 +215,7 @@ futaba_send_string(Driver *drvthis)
 		}
 		else {
 			my_report.type.str.len = 7;
-			futaba_send_report(p->my_handle, &my_report);
+			futaba_send_report(drvthis, &my_report);
 		}
 	}
 
@@ -430,6 +434,16 @@ futaba_start_driver(Driver *drvthis)
 		debug(RPT_INFO, "LIBUSB1.0: [%s] device successfully claimed", drvthis->name);
 	}
 
+	/* a frame is a report per line and one for the icons; two frames
+	 * may be queued */
+	p->usb = lib_usb_async_open(p->ctx, p->my_handle, drvthis->name,
+				    2 * (p->height + 1));
+	if (p->usb == NULL) {
+		report(RPT_ERR, "LIBUSB1.0: [%s] unable to set up usb transfers", drvthis->name);
+		futaba_shutdown(drvthis);
+		return -1;
+	}
+
 #else /* HAVE_LIBUSB_1_0 */
 	/* USB 0.1 code */
 	if (usb_claim_interface(p->my_handle, 0) < 0) {
@@ -459,6 +473,10 @@ futaba_shutdown(Driver *drvthis)
 	/* LIBUSB 1.0 version of code */
 	int error;
 
+	/* sends what is still queued */
+	lib_usb_async_close(p->usb);
+	p->usb = NULL;
+
 	error = libusb_release_interface(p->my_handle, 0);
 	if (error) {
 		report(RPT_ERR, "LIBUSB1.0: [%s] usb interface release failed with error [%d]",
@@ -624,6 +642,11 @@ futaba_flush(Driver *drvthis)
 		return;
 	}
 
+#ifdef HAVE_LIBUSB_1_0
+	/* process the completions of the reports sent last time */
+	lib_usb_async_poll(p->usb);
+#endif
+
 	for (i = 0; i < p->height; i++) {
 		int offset = i * p->width;
 
@@ -704,6 +727,36 @@ futaba_chr(Driver *drvthis, int x, int y, char c)
 	debug(RPT_DEBUG, "[%s] chr complete [%c]", drvthis->name, c);
 }
 
+#ifdef HAVE_LIBUSB_1_0
+/**
+ * Get the file descriptor the server waits on for completed reports.
+ * \param drvthis  Pointer to driver structure.
+ * \return         File descriptor, or -1 if there is none.
+ */
+MODULE_EXPORT int
+futaba_get_input_fd(Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+
+	return (p->usb != NULL) ? lib_usb_async_get_fd(p->usb) : -1;
+}
+
+
+/**
+ * Process the completed reports. The display has no keys.
+ * \param drvthis  Pointer to driver structure.
+ * \return         Always \c NULL.
+ */
+MODULE_EXPORT const char *
+futaba_input_ready(Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+
+	lib_usb_async_poll(p->usb);
+	return NULL;
+}
+#endif
+
 /**
  * Provide some information about this driver.
  * \param drvthis  Pointer to driver structure.
@@ -804,7 +857,7 @@ futaba_output(Driver *drvthis, uint64_t icon_map)
 		if (icons_changed & (1 << i)) {
 			my_report.type.sym.symbol[0].symName = Icon[i];
 			my_report.type.sym.symbol[0].state = ((icon_map & (1 << i)) < 1) ? 0 : 1;;
-			futaba_send_report(p->my_handle, &my_report);
+			futaba_send_report(drvthis, &my_report);
 			debug(RPT_INFO, "[%s] Icon no.%d [%c] updated", drvthis->name, i, Icon[i]);
 		}
 	}
@@ -835,7 +888,7 @@ futaba_output(Driver *drvthis, uint64_t icon_map)
 			}
 		}
 		/* all done, send to the display */
-		futaba_send_report(p->my_handle, &my_report);
+		futaba_send_report(drvthis, &my_report);
 	}
 	/* and off we go again */
 	p->old_icon_map = icon_map;
@@ -11,7 +11,7 @@
 /* INCLUDES-------------------------------------- */
 #include <stdint.h>
 #ifdef HAVE_LIBUSB_1_0
-#include <libusb.h>
+#include "usb_async_lib.h"
 #define USB_DEVICE_HANDLE    libusb_device_handle
 #define USB_RESET_DEVICE     libusb_reset_device
 #define USB_CLOSE_DEVICE     libusb_close
@@ -81,7 +81,7 @@ typedef struct {
 } futabaDriver_t;
 
 /* Function declarations------------------------- */
-int futaba_send_report(USB_DEVICE_HANDLE * my_handle, futabaReport_t * report);
+int futaba_send_report(Driver *drvthis, futabaReport_t * report);
 
 int futaba_set_volume(USB_DEVICE_HANDLE * my_handle, int volPercent);
 
@@ -101,5 +101,9 @@ MODULE_EXPORT void futaba_string(Driver *drvthis, int x, int y, const char strin
 MODULE_EXPORT void futaba_chr(Driver *drvthis, int x, int y, char c);
 MODULE_EXPORT void futaba_output(Driver *drvthis, uint64_t icon_map);
 MODULE_EXPORT const char *futaba_get_info(Driver *drvthis);
+#ifdef HAVE_LIBUSB_1_0
+MODULE_EXPORT int futaba_get_input_fd(Driver *drvthis);
+MODULE_EXPORT const char *futaba_input_ready(Driver *drvthis);
+#endif
 
 #endif // #ifndef FUTABA_H
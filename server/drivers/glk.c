@@ -37,6 +37,7 @@
 #endif
 
 #include "lcd.h"
+#include "lcd_lib.h"
 #include "glk.h"
 #include "glkproto.h"
 #include "shared/report.h"
@@ -389,38 +390,21 @@ glk_flush(Driver *drvthis)
 {
   PrivateData *p = drvthis->private_data;
 
-  unsigned char *pf = p->framebuf;
-  unsigned char *qf = p->backingstore;
-  int x, y;
-  unsigned char *ps = NULL;
+  LibFbSpanIter it;
+  int x, y, len;
 
   debug(RPT_DEBUG, "flush()");
 
-  for (y = 0; y < p->height; ++y) {
-    int xs = -1;  /* XStart not set */
-
-    for (x = 0; x < p->width; ++x) {
-      if ((*qf == *pf) && (xs >= 0)) {
-        /* Write accumulated string */
-        glkputl(p->fd, GLKCommand, 0x79, xs * p->cellwidth, y * p->cellheight, EOF);
-        glkputa(p->fd, x - xs, ps);
-        debug(RPT_DEBUG, "flush: Writing at (%d,%d) for %d", xs, y, x - xs);
-        xs = -1;
-      }
-      else if ((*qf != *pf) && (xs < 0)) {
-        /* Start new string of changes */
-        ps = pf;
-        xs = x;
-      }
-      *qf++ = *pf++;  /* Update p->backingstore from p->framebuf */
-    }
-    if (xs >= 0) {
-      /* Write accumulated line */
-      glkputl(p->fd, GLKCommand, 0x79, xs * p->cellwidth, y * p->cellheight, EOF);
-      glkputa(p->fd, p->width - xs, ps);
-      debug(RPT_DEBUG, "flush: Writing at (%d,%d) for %d", xs, y, p->width - xs);
-    }
+  /* Write each string of changes */
+  lib_fb_span_init(&it, p->framebuf, p->backingstore, p->width, p->height, 0);
+  while (lib_fb_span_next(&it, &x, &y, &len)) {
+    glkputl(p->fd, GLKCommand, 0x79, x * p->cellwidth, y * p->cellheight, EOF);
+    glkputa(p->fd, len, p->framebuf + y * p->width + x);
+    debug(RPT_DEBUG, "flush: Writing at (%d,%d) for %d", x, y, len);
   }
+
+  /* Update p->backingstore from p->framebuf */
+  memcpy(p->backingstore, p->framebuf, p->width * p->height);
 }
 
 
@@ -48,6 +48,9 @@
 #ifdef HAVE_UGPIO
 # include "hd44780-gpio.h"
 #endif
+#ifdef HAVE_GPIO_CDEV_V2
+# include "hd44780-gpiochip.h"
+#endif
 /* add new connection type header files to the correct section above or here */
 
 
@@ -106,6 +109,9 @@ static const ConnectionMapping connectionMapping[] = {
 #endif
 #ifdef HAVE_UGPIO
 	{ "gpio",          HD44780_CT_GPIO,          IF_TYPE_PARPORT, hd_init_gpio      },
+#endif
+#ifdef HAVE_GPIO_CDEV_V2
+	{ "gpiochip",      HD44780_CT_GPIOCHIP,      IF_TYPE_PARPORT, hd_init_gpiochip  },
 #endif
 	/* add new connection types in the correct section above or here */
 
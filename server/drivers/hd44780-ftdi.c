@@ -17,6 +17,13 @@
 
    RW of your display can either be connected to D6 or GND.
 \endverbatim
+ *
+ * After initialization the 4 bit mode does not write every pin change
+ * separately: the pin states of a whole flush are collected in a buffer and
+ * written with a single ftdi_write_data(). The bit-bang FIFO clocks them out
+ * at a fixed rate, so delays are produced by repeating the idle pin state.
+ * The 8 bit mode cannot do this, as its data and control lines are on two
+ * channels whose FIFOs are not synchronized.
  */
 
 /*-
@@ -51,10 +58,17 @@
 #include "hd44780-low.h"
 #include "shared/report.h"
 
+/** Size of the output buffer of the 4 bit mode */
+#define FTDI_TX_SIZE		4096
+/** Upper bound of the bit-bang output rate in bytes per millisecond */
+#define FTDI_BYTES_PER_MS	3000
+
 /* connection type specific functions to be exposed using pointers in init() */
 void ftdi_HD44780_senddata(PrivateData *p, unsigned char displayID, unsigned char flags, unsigned char ch);
 void ftdi_HD44780_backlight(PrivateData *p, unsigned char state);
 void ftdi_HD44780_close(PrivateData *p);
+void ftdi_HD44780_flush(PrivateData *p);
+static void ftdi_HD44780_uPause(PrivateData *p, int usecs);
 
 
 /**
@@ -180,6 +194,17 @@ hd_init_ftdi(Driver *drvthis)
 	ftdi_HD44780_senddata(p, 0, RS_INSTR, FUNCSET | IF_4BIT);
 
 	common_init(p, IF_4BIT);
+
+	/* from now on collect the pin states of a flush in one buffer */
+	if ((p->tx_buf.buffer = malloc(FTDI_TX_SIZE)) == NULL) {
+	    report(RPT_ERR, "hd_init_ftdi: could not allocate send buffer");
+	    f = -1;
+	    goto hd_init_ftdi_done;
+	}
+	p->ftdi_pins = p->backlight_bit;
+	p->tx_buf.use_count = 0;
+	p->hd44780_functions->flush = ftdi_HD44780_flush;
+	p->hd44780_functions->uPause = ftdi_HD44780_uPause;
     }
 
     f = 0;
@@ -190,6 +215,72 @@ hd_init_ftdi_done:
 }
 
 
+/**
+ * Append pin states to the output buffer of the 4 bit mode, writing the
+ * buffer first if they do not fit.
+ * \param p    Pointer to driver's private data structure.
+ * \param buf  Pin states.
+ * \param len  Number of pin states.
+ */
+static void
+ftdi_queue(PrivateData *p, const unsigned char *buf, int len)
+{
+    if (p->tx_buf.use_count + len > FTDI_TX_SIZE)
+	ftdi_HD44780_flush(p);
+
+    memcpy(p->tx_buf.buffer + p->tx_buf.use_count, buf, len);
+    p->tx_buf.use_count += len;
+    p->ftdi_pins = buf[len - 1];
+}
+
+
+/**
+ * Delay the following pin changes by repeating the current pin state in
+ * the output buffer. Long delays write the buffer and sleep instead.
+ * \param p      Pointer to driver's private data structure.
+ * \param usecs  Delay in microseconds.
+ */
+static void
+ftdi_HD44780_uPause(PrivateData *p, int usecs)
+{
+    int n = (usecs * FTDI_BYTES_PER_MS + 999) / 1000;
+
+    if (n > FTDI_TX_SIZE / 4) {
+	ftdi_HD44780_flush(p);
+	usleep(usecs);
+	return;
+    }
+
+    if (p->tx_buf.use_count + n > FTDI_TX_SIZE)
+	ftdi_HD44780_flush(p);
+
+    memset(p->tx_buf.buffer + p->tx_buf.use_count, p->ftdi_pins, n);
+    p->tx_buf.use_count += n;
+}
+
+
+/**
+ * Write the collected pin states of the 4 bit mode to the device.
+ * \param p  Pointer to driver's private data structure.
+ */
+void
+ftdi_HD44780_flush(PrivateData *p)
+{
+    int f;
+
+    if (p->tx_buf.buffer == NULL || p->tx_buf.use_count == 0)
+	return;
+
+    f = ftdi_write_data(&p->ftdic, p->tx_buf.buffer, p->tx_buf.use_count);
+    if (f < 0) {
+	p->hd44780_functions->drv_report(RPT_ERR, "failed to write: %d (%s). Exiting",
+				   f, ftdi_get_error_string(&p->ftdic));
+	exit(-1);
+    }
+    p->tx_buf.use_count = 0;
+}
+
+
 /**
  * Send data or commands to the display.
  * \param p          Pointer to driver's private data structure.
@@ -251,6 +342,26 @@ ftdi_HD44780_senddata(PrivateData *p, unsigned char displayID, unsigned char fla
 	    portControl |= p->ftdi_line_RS;
 	}
 
+	if (p->tx_buf.buffer != NULL) {
+	    unsigned char out[8];
+
+	    /*
+	     * EN is held high for two pin states and each nibble ends with
+	     * two idle states, which keeps the EN pulse and cycle times
+	     * within spec at the fastest bit-bang rate.
+	     */
+	    out[0] = out[1] = ((ch >> 4) & 0x0F) | portControl | enableLines;
+	    out[2] = out[3] = ((ch >> 4) & 0x0F) | portControl;
+	    out[4] = out[5] = (ch & 0x0F) | portControl | enableLines;
+	    out[6] = out[7] = (ch & 0x0F) | portControl;
+	    ftdi_queue(p, out, 8);
+
+	    /* Clear and home take 1.52ms, other instructions 37us */
+	    if (flags == RS_INSTR)
+		ftdi_HD44780_uPause(p, ((ch & 0xFC) == 0) ? 1600 : 40);
+	    return;
+	}
+
 	buf[0] = ((ch >> 4) & 0x0F) | portControl | enableLines;
 	buf[1] = ((ch >> 4) & 0x0F) | portControl;
 	buf[2] = (ch & 0x0F) | portControl | enableLines;
@@ -284,6 +395,12 @@ ftdi_HD44780_backlight(PrivateData *p, unsigned char state)
     p->backlight_bit = state ? p->ftdi_line_backlight : 0;
     buf[0] = p->backlight_bit;
 
+    if (p->tx_buf.buffer != NULL) {
+	ftdi_queue(p, buf, 1);
+	ftdi_HD44780_flush(p);
+	return;
+    }
+
     if (p->ftdi_mode == 8) {
 	f = ftdi_write_data(&p->ftdic2, buf, 1);
 	if (f < 0) {
@@ -310,6 +427,12 @@ ftdi_HD44780_backlight(PrivateData *p, unsigned char state)
 void
 ftdi_HD44780_close(PrivateData *p)
 {
+    if (p->tx_buf.buffer != NULL) {
+	ftdi_HD44780_flush(p);
+	free(p->tx_buf.buffer);
+	p->tx_buf.buffer = NULL;
+    }
+
     ftdi_disable_bitbang(&p->ftdic);
     ftdi_usb_close(&p->ftdic);
     ftdi_deinit(&p->ftdic);
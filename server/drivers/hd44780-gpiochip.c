@@ -0,0 +1,298 @@
+/** \file server/drivers/hd44780-gpiochip.c
+ * \c gpiochip connection type of \c hd44780 driver for Hitachi HD44780 based
+ * LCD displays.
+ *
+ * Like the \c gpio connection type, but using the Linux GPIO character
+ * device (v2 interface) instead of sysfs. All lines are requested at once,
+ * so the data lines and EN are changed together by a single ioctl: a nibble
+ * takes two system calls instead of six sysfs writes.
+ *
+ * The LCD is operated in its 4 bit-mode. R/W (5) on the LCD MUST be hard wired
+ * low to prevent 5V logic appearing on the GPIO pins.
+ *
+ * The GPIO chip is set with the Device key, the line offsets on that chip
+ * with the keys pin_EN, pin_EN2, pin_RS, pin_D7, pin_D6, pin_D5, pin_D4,
+ * pin_BL, pin_RW in the [hd44780] section.
+ */
+
+/*-
+ * This file is released under the GNU General Public License. Refer to the
+ * COPYING file distributed with this package.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#include "hd44780-gpiochip.h"
+#include "hd44780-low.h"
+#include "shared/report.h"
+
+#define DEFAULT_DEVICE		"/dev/gpiochip0"
+
+void gpiochip_HD44780_senddata(PrivateData *p, unsigned char displayID,
+			       unsigned char flags, unsigned char ch);
+void gpiochip_HD44780_backlight(PrivateData *p, unsigned char state);
+void gpiochip_HD44780_close(PrivateData *p);
+
+/** Index of each LCD signal in the line request */
+enum {
+	LINE_EN, LINE_RS, LINE_D7, LINE_D6, LINE_D5, LINE_D4,
+	LINE_EN2, LINE_BL, LINE_RW, NUM_LINES
+};
+
+static const char *line_names[NUM_LINES] = {
+	"EN", "RS", "D7", "D6", "D5", "D4", "EN2", "BL", "RW"
+};
+
+typedef struct {
+	int req_fd;			/**< File descriptor of the line request */
+	__u64 mask[NUM_LINES];		/**< Bit of each signal in the request; 0 if unused */
+	__u64 data_mask;		/**< Bits of D4..D7 */
+	__u64 values;			/**< Current value of all lines */
+} gpiochip_lines;
+
+
+/**
+ * Set lines of the request.
+ * \param lines   The line request.
+ * \param mask    Bits of the lines to change.
+ * \param values  New values of these lines.
+ */
+static void
+set_lines(gpiochip_lines *lines, __u64 mask, __u64 values)
+{
+	struct gpio_v2_line_values lv;
+
+	lines->values = (lines->values & ~mask) | (values & mask);
+
+	lv.mask = mask;
+	lv.bits = lines->values;
+	if (ioctl(lines->req_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv) < 0)
+		report(RPT_ERR, "HD44780: gpiochip: setting lines failed: %s", strerror(errno));
+}
+
+
+/**
+ * Get the bits of the enable lines of the given display.
+ * \param p          Pointer to driver's private data structure.
+ * \param lines      The line request.
+ * \param displayID  ID of the display (or 0 for all).
+ * \return  Bits of the EN lines.
+ */
+static __u64
+enable_mask(PrivateData *p, gpiochip_lines *lines, unsigned char displayID)
+{
+	__u64 mask = 0;
+
+	if (displayID == 1 || displayID == 0)
+		mask |= lines->mask[LINE_EN];
+	if (displayID == 2 || (p->numDisplays > 1 && displayID == 0))
+		mask |= lines->mask[LINE_EN2];
+
+	return mask;
+}
+
+
+/**
+ * Send 4-bit data. The data lines and EN are raised together, as data only
+ * needs to be valid before the falling edge of EN.
+ *
+ * \param p     Pointer to driver's private data structure.
+ * \param ch    The value to send (lower nibble must contain the data).
+ * \param displayID  ID of the display (or 0 for all) to send data to.
+ */
+static void
+send_nibble(PrivateData *p, unsigned char ch, unsigned char displayID)
+{
+	gpiochip_lines *lines = (gpiochip_lines *) p->connection_data;
+	__u64 en = enable_mask(p, lines, displayID);
+	__u64 data = 0;
+
+	if (ch & 0x08)
+		data |= lines->mask[LINE_D7];
+	if (ch & 0x04)
+		data |= lines->mask[LINE_D6];
+	if (ch & 0x02)
+		data |= lines->mask[LINE_D5];
+	if (ch & 0x01)
+		data |= lines->mask[LINE_D4];
+
+	/* Data is clocked on the falling edge of EN */
+	set_lines(lines, lines->data_mask | en, data | en);
+	p->hd44780_functions->uPause(p, 50);
+
+	set_lines(lines, en, 0);
+	p->hd44780_functions->uPause(p, 50);
+}
+
+
+/**
+ * Initialize the driver.
+ *
+ * \param drvthis   Pointer to driver structure.
+ * \return          0 on success; -1 on error.
+ */
+int
+hd_init_gpiochip(Driver *drvthis)
+{
+	PrivateData *p = (PrivateData *) drvthis->private_data;
+	struct gpio_v2_line_request req;
+	gpiochip_lines *lines;
+	char device[256] = DEFAULT_DEVICE;
+	int chip_fd;
+	int i;
+
+	lines = calloc(1, sizeof(gpiochip_lines));
+	if (lines == NULL) {
+		report(RPT_ERR, "hd_init_gpiochip: unable to allocate memory");
+		return -1;
+	}
+	lines->req_fd = -1;
+	p->connection_data = lines;
+
+	/* Get the GPIO chip to use */
+	strncpy(device, drvthis->config_get_string(drvthis->name, "Device", 0, DEFAULT_DEVICE),
+		sizeof(device));
+	device[sizeof(device) - 1] = '\0';
+	report(RPT_INFO, "HD44780: gpiochip: Using device '%s'", device);
+
+	/* Collect the line offsets; EN, RS and D4..D7 are required */
+	memset(&req, 0, sizeof(req));
+	for (i = 0; i < NUM_LINES; i++) {
+		char config_key[8];
+		int offset;
+
+		if ((i == LINE_EN2 && p->numDisplays <= 1) ||
+		    (i == LINE_BL && !have_backlight_pin(p)))
+			continue;
+
+		snprintf(config_key, sizeof(config_key), "pin_%s", line_names[i]);
+		offset = drvthis->config_get_int(drvthis->name, config_key, 0, -1);
+		if (offset < 0) {
+			if (i == LINE_BL) {
+				report(RPT_WARNING,
+				       "hd_init_gpiochip: pin_BL not set - disabling backlight");
+				set_have_backlight_pin(p, 0);
+				continue;
+			}
+			if (i == LINE_RW)
+				continue;
+			report(RPT_ERR, "hd_init_gpiochip: pin_%s not set", line_names[i]);
+			gpiochip_HD44780_close(p);
+			return -1;
+		}
+
+		lines->mask[i] = (__u64) 1 << req.num_lines;
+		req.offsets[req.num_lines++] = offset;
+		report(RPT_INFO, "hd_init_gpiochip: Pin %s mapped to line %d", line_names[i], offset);
+	}
+	lines->data_mask = lines->mask[LINE_D7] | lines->mask[LINE_D6] |
+			   lines->mask[LINE_D5] | lines->mask[LINE_D4];
+
+	/* Request all lines as outputs, initially low */
+	strncpy(req.consumer, "LCDd", sizeof(req.consumer) - 1);
+	req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+	req.config.num_attrs = 1;
+	req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+	req.config.attrs[0].attr.values = 0;
+	req.config.attrs[0].mask = ((__u64) 1 << req.num_lines) - 1;
+
+	chip_fd = open(device, O_RDWR | O_CLOEXEC);
+	if (chip_fd < 0) {
+		report(RPT_ERR, "HD44780: gpiochip: open(%s) failed: %s", device, strerror(errno));
+		gpiochip_HD44780_close(p);
+		return -1;
+	}
+	if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+		report(RPT_ERR, "HD44780: gpiochip: unable to request lines of %s: %s",
+		       device, strerror(errno));
+		close(chip_fd);
+		gpiochip_HD44780_close(p);
+		return -1;
+	}
+	close(chip_fd);
+	lines->req_fd = req.fd;
+
+	p->hd44780_functions->senddata = gpiochip_HD44780_senddata;
+	p->hd44780_functions->close = gpiochip_HD44780_close;
+	if (have_backlight_pin(p))
+		p->hd44780_functions->backlight = gpiochip_HD44780_backlight;
+
+	send_nibble(p, (FUNCSET | IF_8BIT) >> 4, 0);
+	p->hd44780_functions->uPause(p, 4100);
+	send_nibble(p, (FUNCSET | IF_8BIT) >> 4, 0);
+	p->hd44780_functions->uPause(p, 100);
+	send_nibble(p, (FUNCSET | IF_8BIT) >> 4, 0);
+	send_nibble(p, (FUNCSET | IF_4BIT) >> 4, 0);
+
+	common_init(p, IF_4BIT);
+
+	return 0;
+}
+
+
+/**
+ * Send data or commands to the display.
+ *
+ * \param p             Pointer to driver's private data structure.
+ * \param displayID     ID of the display (or 0 for all) to send data to.
+ * \param flags         Defines whether to end a command or data.
+ * \param ch            The value to send.
+ */
+void
+gpiochip_HD44780_senddata(PrivateData *p, unsigned char displayID,
+			  unsigned char flags, unsigned char ch)
+{
+	gpiochip_lines *lines = (gpiochip_lines *) p->connection_data;
+	__u64 rs = (flags == RS_INSTR) ? 0 : lines->mask[LINE_RS];
+
+	/* RS has to be stable before EN rises; only touch it when it changes */
+	if ((lines->values & lines->mask[LINE_RS]) != rs)
+		set_lines(lines, lines->mask[LINE_RS], rs);
+
+	send_nibble(p, ch >> 4, displayID);
+	send_nibble(p, ch, displayID);
+}
+
+
+/**
+ * Turn display backlight on or off.
+ *
+ * \param p         Pointer to driver's private data structure.
+ * \param state     New backlight status.
+ */
+void
+gpiochip_HD44780_backlight(PrivateData *p, unsigned char state)
+{
+	gpiochip_lines *lines = (gpiochip_lines *) p->connection_data;
+
+	set_lines(lines, lines->mask[LINE_BL], (state == BACKLIGHT_ON) ? lines->mask[LINE_BL] : 0);
+}
+
+
+/**
+ * Free resources used by this connection type. Releasing the line request
+ * releases all lines.
+ *
+ * \param p     Pointer to driver's PrivateData structure.
+ */
+void
+gpiochip_HD44780_close(PrivateData *p)
+{
+	gpiochip_lines *lines = (gpiochip_lines *) p->connection_data;
+
+	if (lines == NULL)
+		return;
+
+	if (lines->req_fd >= 0)
+		close(lines->req_fd);
+
+	free(lines);
+	p->connection_data = NULL;
+}
@@ -0,0 +1,9 @@
+#ifndef HD_GPIOCHIP_H
+#define HD_GPIOCHIP_H
+
+#include "lcd.h"		/* for Driver */
+
+/* initialize this particular driver */
+int hd_init_gpiochip(Driver *drvthis);
+
+#endif
@@ -62,6 +62,7 @@
 #define HD44780_CT_LCM162		26
 #define HD44780_CT_GPIO			27
 #define HD44780_CT_EZIO			28
+#define HD44780_CT_GPIOCHIP		29
 /**@}*/
 
 /** \name Symbolic names for interface types
@@ -210,6 +211,7 @@ typedef struct hd44780_private_data {
 	int ftdi_line_EN;
 	int ftdi_line_EN2;
 	int ftdi_line_backlight;
+	unsigned char ftdi_pins;	/**< Last pin state queued in 4 bit mode */
 #endif
 
 #ifdef HAVE_I2C
@@ -45,6 +45,7 @@
 #endif
 
 #include "hd44780-pifacecad.h"
+#include "hd44780-spiburst.h"
 #include "hd44780-low.h"
 #include "shared/report.h"
 
@@ -113,7 +114,8 @@ const unsigned char spi_delay = 0;
 /**@}*/
 
 /**
- * Writes to a register on the MCP23S17.
+ * Writes to a register on the MCP23S17. The write is queued and sent
+ * together with the following ones when the display is flushed.
  *
  * \param p     Pointer to PrivateData structure.
  * \param reg   Register address to write to.
@@ -123,24 +125,8 @@ static void
 mcp23s17_write_reg(PrivateData *p, unsigned char reg, unsigned char data)
 {
 	unsigned char tx_buf[3] = { 0x40 | SPI_HW_ADDR | WRITE_CMD, reg, data };
-	unsigned char rx_buf[3];
 
-	struct spi_ioc_transfer spi;
-	memset(&spi, 0, sizeof(spi));
-	spi.tx_buf = (unsigned long) tx_buf;
-	spi.rx_buf = (unsigned long) rx_buf;
-	spi.len = sizeof(tx_buf);
-	spi.delay_usecs = spi_delay;
-	spi.speed_hz = spi_speed;
-	spi.bits_per_word = spi_bpw;
-
-	/* do the SPI transaction */
-	if (ioctl(p->fd, SPI_IOC_MESSAGE(1), &spi) < 0) {
-		p->hd44780_functions->drv_report(RPT_ERR,
-						 "HD44780: PiFaceCAD: mcp23s17_write_reg: There was "
-						 "a error during the SPI transaction: %s",
-						 strerror(errno));
-	}
+	spiburst_write(p, tx_buf, sizeof(tx_buf));
 }
 
 
@@ -158,6 +144,10 @@ mcp23s17_read_reg(PrivateData *p, unsigned char reg)
 	unsigned char rx_buf[3] = { 0, 0, 0 };
 
 	struct spi_ioc_transfer spi;
+
+	/* queued writes have to happen first */
+	spiburst_flush(p);
+
 	memset(&spi, 0, sizeof(spi));
 	spi.tx_buf = (unsigned long) tx_buf;
 	spi.rx_buf = (unsigned long) rx_buf;
@@ -242,6 +232,10 @@ hd_init_pifacecad(Driver *drvthis)
 		return -1;
 	}
 
+	/* register writes are queued and sent with one ioctl per flush */
+	if (spiburst_init(p, spi_speed, spi_bpw) < 0)
+		return -1;
+
 	/* Set IO config */
 	mcp23s17_write_reg(p, IOCON, 0x08);	/* Hardware Address Enable */
 	mcp23s17_write_reg(p, IODIRB, 0x00);	/* Set GPIOB (LCD port) to output */
@@ -269,6 +263,7 @@ hd_init_pifacecad(Driver *drvthis)
 	hd44780_functions->uPause(p, DELAY_SETTLE_US);
 
 	common_init(p, IF_4BIT);
+	spiburst_flush(p);
 
 	report(RPT_INFO, "HD44780: PiFaceCAD: initialized");
 
@@ -277,13 +272,16 @@ hd_init_pifacecad(Driver *drvthis)
 
 
 /**
- * Closes the file descriptor of the HD44780 (SPI bus to MCP23S17).
+ * Sends queued data and closes the file descriptor of the HD44780 (SPI bus
+ * to MCP23S17).
  *
  * \param p  Pointer to driver's private data structure.
  */
 void
 pifacecad_HD44780_close(PrivateData *p)
 {
+	spiburst_close(p);
+
 	if (p->fd >= 0) {
 		close(p->fd);
 	}
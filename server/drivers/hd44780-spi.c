@@ -20,6 +20,7 @@
  */
 
 #include "hd44780-spi.h"
+#include "hd44780-spiburst.h"
 #include "hd44780-low.h"
 #include "shared/report.h"
 
@@ -35,6 +36,7 @@
 
 void spi_HD44780_senddata(PrivateData *p, unsigned char displayID, unsigned char flags, unsigned char ch);
 void spi_HD44780_backlight(PrivateData *p, unsigned char state);
+void spi_HD44780_close(PrivateData *p);
 
 #define DEFAULT_DEVICE		"/dev/spidev0.0"
 
@@ -46,62 +48,17 @@ void spi_HD44780_backlight(PrivateData *p, unsigned char state);
 #define RS	0x02u
 
 
-/**
- * Reverses the bits of \a u8.
- * \param u8  byte of which to reverse the bits.
- * \return Value resulting from \a u8 with reversed bits.
- */
-static inline uint8_t
-bit_reverse8(uint8_t u8)
-{
-	/*
-	 * See
-	 * http://graphics.stanford.edu/~seander/bithacks.html#ReverseByteWith32Bits
-	 * for how this works and. This code snippet is in the public domain.
-	 */
-	return (uint8_t) (((u8 * 0x0802LU & 0x22110LU) | (u8 * 0x8020LU & 0x88440LU)) * 0x10101LU >> 16);
-}
-
+/** \name Bit reversal table
+ * Table of all bytes with their bits reversed, built at compile time.
+ *@{*/
+#define R2(n)	(n), (n) + 2 * 64, (n) + 1 * 64, (n) + 3 * 64
+#define R4(n)	R2(n), R2((n) + 2 * 16), R2((n) + 1 * 16), R2((n) + 3 * 16)
+#define R6(n)	R4(n), R4((n) + 2 * 4), R4((n) + 1 * 4), R4((n) + 3 * 4)
 
-/**
- * Do a SPI transfer by sending \c length bytes of \c outbuf and read the same
- * number of bytes into \c inbuf.
- * \param p       Pointer to driver's private data structure.
- * \param outbuf  Buffer holding data to send.
- * \param inbuf   Buffer to store incoming data (or NULL).
- * \param length  Length of buffers (both).
- * \return  Status from ioctl.
- */
-static int
-spi_transfer(PrivateData *p, const unsigned char *outbuf, unsigned char *inbuf, unsigned length)
-{
-	struct spi_ioc_transfer xfer;
-	int status;
-
-	static unsigned char no_more_errormsgs = 0;
-
-	memset(&xfer, 0, sizeof(xfer));
-	xfer.tx_buf = (unsigned long) outbuf;
-	xfer.rx_buf = (unsigned long) inbuf;
-	xfer.len = length;
-
-	p->hd44780_functions->drv_debug(RPT_DEBUG, "SPI sending %02x %02x %02x",
-					outbuf[0], outbuf[1], length > 2 ? outbuf[2] : 0xFFu);
-	status = ioctl(p->fd, SPI_IOC_MESSAGE(1), &xfer);
-	if (status < 0) {
-		p->hd44780_functions->drv_report(no_more_errormsgs ? RPT_DEBUG : RPT_ERR,
-						 "HD44780: SPI: spidev write data %u failed: %s",
-						 status, strerror(errno));
-		no_more_errormsgs = 1;
-	}
-#ifdef DEBUG
-	if (inbuf)
-		p->hd44780_functions->drv_debug(RPT_DEBUG, "SPI returned data %02x %02x %02x",
-						inbuf[0], inbuf[1], length > 2 ? inbuf[2] : 0xFFu);
-#endif
-
-	return status;
-}
+static const uint8_t bit_reverse8[256] = {
+	R6(0), R6(2), R6(1), R6(3)
+};
+/**@}*/
 
 
 /**
@@ -154,15 +111,24 @@ hd_init_spi(Driver *drvthis)
 		}
 	}
 
+	/* characters are queued and sent with one ioctl per flush */
+	if (spiburst_init(p, 0, 0) < 0) {
+		close(p->fd);
+		return -1;
+	}
+
 	hd44780_functions->senddata = spi_HD44780_senddata;
+	hd44780_functions->close = spi_HD44780_close;
 	common_init(p, IF_8BIT);
+	spiburst_flush(p);
 
 	return 0;
 }
 
 
 /**
- * Send data or commands to the display.
+ * Send data or commands to the display. The data is queued until the
+ * display is flushed.
  * \param p          Pointer to driver's private data structure.
  * \param displayID  ID of the display (or 0 for all) to send data to.
  * \param flags      Defines whether to end a command or data.
@@ -184,13 +150,13 @@ spi_HD44780_senddata(PrivateData *p, unsigned char displayID, unsigned char flag
 
 	/* KS0073 wants Least Significant Bit first, with the added twist of
 	 * peculiar splitting of a byte across 4 nibbles. If we ever need to
-	 * read from the device, remember to bit_reverse8() each byte (note
+	 * read from the device, remember to bit_reverse8[] each byte (note
 	 * that replies aren't split into nibbles). */
-	reverse = bit_reverse8(ch);
+	reverse = bit_reverse8[ch];
 	buf[1] = reverse & 0xF0;
 	buf[2] = (reverse & 0x0F) << 4;
 
-	spi_transfer(p, buf, NULL, sizeof(buf));
+	spiburst_write(p, buf, sizeof(buf));
 }
 
 
@@ -214,3 +180,19 @@ spi_HD44780_backlight(PrivateData *p, unsigned char state)
 							 errno, strerror(errno));
 	}
 }
+
+
+/**
+ * Send the queued data and close the SPI device.
+ * \param p  Pointer to driver's private data structure.
+ */
+void
+spi_HD44780_close(PrivateData *p)
+{
+	spiburst_close(p);
+
+	if (p->backlight_bit >= 0)
+		close(p->backlight_bit);
+	if (p->fd >= 0)
+		close(p->fd);
+}
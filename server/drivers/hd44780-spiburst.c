@@ -0,0 +1,170 @@
+/** \file server/drivers/hd44780-spiburst.c
+ * Queueing of SPI transfers for the SPI based connection types of the
+ * \c hd44780 driver.
+ *
+ * Instead of one ioctl per transfer, transfers are collected and sent to
+ * spidev as one SPI_IOC_MESSAGE when the display is flushed (or the queue
+ * is full). Chip select is still toggled between the transfers, so the
+ * device sees exactly the same frames. Delays requested with uPause()
+ * while transfers are queued are added to the last transfer, so the kernel
+ * keeps the timing between them.
+ */
+
+/*-
+ * This file is released under the GNU General Public License. Refer to the
+ * COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/ioctl.h>
+#include <linux/spi/spidev.h>
+
+#include "hd44780-spiburst.h"
+#include "hd44780-low.h"
+#include "shared/report.h"
+
+/** Max. number of transfers sent with one ioctl */
+#define SPIBURST_MAX_XFERS	64
+/** Max. delay after a single transfer (delay_usecs is 16 bit) */
+#define SPIBURST_MAX_DELAY	65535
+
+/** Queue of SPI transfers */
+typedef struct {
+	struct spi_ioc_transfer xfer[SPIBURST_MAX_XFERS];	/**< Queued transfers */
+	unsigned char buf[SPIBURST_MAX_XFERS][SPIBURST_MAX_LEN];	/**< Their data */
+	int count;			/**< Number of queued transfers */
+	uint32_t speed_hz;		/**< Speed of the transfers (0 = default) */
+	uint8_t bits_per_word;		/**< Word size of the transfers (0 = default) */
+	void (*uPause) (PrivateData *p, int usecs);	/**< Original uPause */
+} SpiBurst;
+
+
+/**
+ * Delay a number of microseconds. If transfers are queued, the delay is
+ * added to the last of them instead of waiting now.
+ * \param p      Pointer to driver's private data structure.
+ * \param usecs  Number of micro-seconds to wait.
+ */
+static void
+spiburst_uPause(PrivateData *p, int usecs)
+{
+	SpiBurst *burst = (SpiBurst *) p->connection_data;
+
+	if (burst->count > 0) {
+		struct spi_ioc_transfer *last = &burst->xfer[burst->count - 1];
+
+		if (last->delay_usecs + usecs <= SPIBURST_MAX_DELAY) {
+			last->delay_usecs += usecs;
+			return;
+		}
+		spiburst_flush(p);
+	}
+	burst->uPause(p, usecs);
+}
+
+
+/**
+ * Set up queueing of SPI transfers: replaces uPause and the flush function
+ * of the connection type. p->fd must be the opened spidev device.
+ * \param p              Pointer to driver's private data structure.
+ * \param speed_hz       Speed of the transfers (0 = device default).
+ * \param bits_per_word  Word size of the transfers (0 = device default).
+ * \retval 0   Success.
+ * \retval -1  Error allocating memory.
+ */
+int
+spiburst_init(PrivateData *p, uint32_t speed_hz, uint8_t bits_per_word)
+{
+	SpiBurst *burst = calloc(1, sizeof(SpiBurst));
+
+	if (burst == NULL) {
+		report(RPT_ERR, "HD44780: SPI: unable to allocate memory");
+		return -1;
+	}
+	burst->speed_hz = speed_hz;
+	burst->bits_per_word = bits_per_word;
+	burst->uPause = p->hd44780_functions->uPause;
+
+	p->connection_data = burst;
+	p->hd44780_functions->uPause = spiburst_uPause;
+	p->hd44780_functions->flush = spiburst_flush;
+
+	return 0;
+}
+
+
+/**
+ * Queue a transfer. The queue is sent when it is full.
+ * \param p     Pointer to driver's private data structure.
+ * \param data  Data to send.
+ * \param len   Number of bytes, at most SPIBURST_MAX_LEN.
+ */
+void
+spiburst_write(PrivateData *p, const unsigned char *data, int len)
+{
+	SpiBurst *burst = (SpiBurst *) p->connection_data;
+	struct spi_ioc_transfer *xfer;
+
+	if (burst->count == SPIBURST_MAX_XFERS)
+		spiburst_flush(p);
+
+	xfer = &burst->xfer[burst->count];
+	memcpy(burst->buf[burst->count], data, len);
+	memset(xfer, 0, sizeof(*xfer));
+	xfer->tx_buf = (unsigned long) burst->buf[burst->count];
+	xfer->len = len;
+	xfer->speed_hz = burst->speed_hz;
+	xfer->bits_per_word = burst->bits_per_word;
+	/* deselect the device after each transfer, as with single ioctls */
+	xfer->cs_change = 1;
+	burst->count++;
+}
+
+
+/**
+ * Send all queued transfers with a single ioctl.
+ * \param p  Pointer to driver's private data structure.
+ */
+void
+spiburst_flush(PrivateData *p)
+{
+	SpiBurst *burst = (SpiBurst *) p->connection_data;
+	static unsigned char no_more_errormsgs = 0;
+
+	if ((burst == NULL) || (burst->count == 0))
+		return;
+
+	/* on the last transfer cs_change would keep the device selected */
+	burst->xfer[burst->count - 1].cs_change = 0;
+
+	if (ioctl(p->fd, SPI_IOC_MESSAGE(burst->count), burst->xfer) < 0) {
+		p->hd44780_functions->drv_report(no_more_errormsgs ? RPT_DEBUG : RPT_ERR,
+						 "HD44780: SPI: sending %d transfers failed: %s",
+						 burst->count, strerror(errno));
+		no_more_errormsgs = 1;
+	}
+	burst->count = 0;
+}
+
+
+/**
+ * Send the remaining transfers and free the queue.
+ * \param p  Pointer to driver's private data structure.
+ */
+void
+spiburst_close(PrivateData *p)
+{
+	SpiBurst *burst = (SpiBurst *) p->connection_data;
+
+	if (burst == NULL)
+		return;
+
+	spiburst_flush(p);
+	p->hd44780_functions->uPause = burst->uPause;
+	p->hd44780_functions->flush = NULL;
+	p->connection_data = NULL;
+	free(burst);
+}
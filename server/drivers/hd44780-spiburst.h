@@ -0,0 +1,20 @@
+#ifndef HD_SPIBURST_H
+#define HD_SPIBURST_H
+
+#include <stdint.h>
+#include "lcd.h"
+#include "hd44780-low.h"
+
+/** Max. number of bytes of a single queued SPI transfer */
+#define SPIBURST_MAX_LEN	4
+
+/* set up queueing of SPI transfers for a connection type */
+int spiburst_init(PrivateData *p, uint32_t speed_hz, uint8_t bits_per_word);
+/* queue a transfer */
+void spiburst_write(PrivateData *p, const unsigned char *data, int len);
+/* send all queued transfers */
+void spiburst_flush(PrivateData *p);
+/* send queued transfers and free the queue */
+void spiburst_close(PrivateData *p);
+
+#endif
@@ -888,9 +888,8 @@ HD44780_flush(Driver *drvthis)
 		unsigned char *sp = p->framebuf + (y * p->width);
 		unsigned char *sq = p->backingstore + (y * p->width);
 
-		/* set pointers to end of the line */
+		/* set pointer to end of the line */
 		unsigned char *ep = sp + (p->width - 1);
-		unsigned char *eq = sq + (p->width - 1);
 
 		/* On forced refresh update everything */
 		if (refreshNow || keepaliveNow) {
@@ -898,10 +897,11 @@ HD44780_flush(Driver *drvthis)
 		}
 		else {
 			/* find begin and end of differences */
-			for (x = 0; (sp <= ep) && (*sp == *sq); sp++, sq++, x++)
-			  ;
-			for (; (ep >= sp) && (*ep == *eq); ep--, eq--)
-			  ;
+			int length = lib_fb_diff(sp, sq, p->width, &x);
+
+			sp += x;
+			sq += x;
+			ep = sp + length - 1;
 		}
 
 		/* there are differences, ... */
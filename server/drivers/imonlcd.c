@@ -51,6 +51,11 @@
 #define DEFAULT_DISCMODE     0	/**< spin the "slim" disc */
 #define DEFAULT_ON_EXIT      1	/**< show the big clock */
 #define DEFAULT_PROTOCOL     0	/**< protocol for 15c2:ffdc device */
+#define DEFAULT_PARTIAL      0	/**< always send the complete screen */
+
+/** Memory register of the first and last packet of screen data */
+#define IMONLCD_FIRST_MSB    0x20
+#define IMONLCD_LAST_MSB     0x3b
 
 
 #define ON_EXIT_SHOWMSG      0	/**< Do nothing - just leave the "shutdown"
@@ -94,6 +99,12 @@ typedef struct imonlcd_private_data {
 	 */
 	int discMode;
 
+	/* 1 = send only the packets whose data changed */
+	int partialRefresh;
+	/* statistics: data packets sent, and sent by full refreshes */
+	unsigned long packets_sent;
+	unsigned long packets_full;
+
 	/*
 	 * 0 = protocol for 15c2:ffdc device, 1 = protocol for 15c2:0038
 	 * device
@@ -367,6 +378,9 @@ imonlcd_init(Driver *drvthis)
 	/* Get the "disc-mode" setting */
 	p->discMode = drvthis->config_get_bool(drvthis->name, "DiscMode", 0, DEFAULT_DISCMODE);
 
+	/* Get the "partial refresh" setting */
+	p->partialRefresh = drvthis->config_get_bool(drvthis->name, "PartialRefresh", 0, DEFAULT_PARTIAL);
+
 	/*
 	 * We need a little bit of extra memory in the frame buffer so that
 	 * all of the last 7-byte-long packet data will be within the frame
@@ -446,6 +460,11 @@ imonlcd_close(Driver *drvthis)
 	uint64_t data;
 
 	if (p != NULL) {
+		if (p->partialRefresh && p->packets_full > 0)
+			report(RPT_INFO, "%s: partial refresh sent %lu of %lu packets, saving %lu bytes",
+			       drvthis->name, p->packets_sent, p->packets_full,
+			       (unsigned long) ((p->packets_full - p->packets_sent) * sizeof(p->tx_buf)));
+
 		if (p->imon_fd >= 0) {
 			if (p->on_exit == ON_EXIT_SHOWMSG) {
 				/*
@@ -537,16 +556,33 @@ imonlcd_flush(Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 
 	unsigned char msb;
+	int size = p->bytesperline * p->height;
 	int offset = 0, ret;
 
 	/*
-	 * The display only provides for a complete screen refresh. If
-	 * nothing has changed, don't refresh.
+	 * Each packet carries 7 bytes of screen data and the memory register
+	 * they go to. If nothing has changed, don't refresh.
 	 */
-	if (memcmp(p->backingstore, p->framebuf, (p->bytesperline * p->height)) == 0)
+	if (memcmp(p->backingstore, p->framebuf, size) == 0)
 		return;
 
-	for (msb = 0x20; msb < 0x3c; msb++) {
+	for (msb = IMONLCD_FIRST_MSB; msb <= IMONLCD_LAST_MSB; msb++) {
+		/*
+		 * In partial refresh mode skip packets whose data is
+		 * unchanged. The last packet is always sent, as the display
+		 * may only show the new data once it has been received.
+		 */
+		if (p->partialRefresh && msb != IMONLCD_LAST_MSB) {
+			int len = size - offset;
+
+			if (len > IMONLCD_PACKET_DATA_SIZE)
+				len = IMONLCD_PACKET_DATA_SIZE;
+			if (len <= 0 || memcmp(p->backingstore + offset, p->framebuf + offset, len) == 0) {
+				offset += IMONLCD_PACKET_DATA_SIZE;
+				continue;
+			}
+		}
+
 		/* Copy the packet data from the frame buffer. */
 		memcpy(p->tx_buf, p->framebuf + offset, IMONLCD_PACKET_DATA_SIZE);
 
@@ -561,10 +597,12 @@ imonlcd_flush(Driver *drvthis)
 			report(RPT_ERR, "imonlcd: incomplete write\n");
 
 		offset += IMONLCD_PACKET_DATA_SIZE;
+		p->packets_sent++;
 	}
+	p->packets_full += IMONLCD_LAST_MSB - IMONLCD_FIRST_MSB + 1;
 
 	/* Update the backing store. */
-	memcpy(p->backingstore, p->framebuf, (p->bytesperline * p->height));
+	memcpy(p->backingstore, p->framebuf, size);
 }
 
 
@@ -30,6 +30,7 @@
 #define LCD_H
 
 #include <stddef.h>
+#include <sys/time.h>
 
 /* Maximum supported sizes */
 #define LCD_MAX_WIDTH 256
@@ -212,6 +213,32 @@ typedef struct lcd_logical_driver {
 	int (*request_display_width) ();
 	int (*request_display_height) ();
 
+
+	/******** Members added within API version 0.5 ********/
+	/* Kept behind all older members, so drivers built against an older
+	 * header still find everything else at the same offsets */
+
+	/* event-driven input functions (optional; otherwise get_key is polled) */
+	int (*get_input_fd)	(struct lcd_logical_driver *drvthis);
+	const char *(*input_ready) (struct lcd_logical_driver *drvthis);
+
+	/* bulk output function (optional; otherwise string is used) */
+	void (*cells)		(struct lcd_logical_driver *drvthis, int x, int y, const char *chars, int len);
+
+	int input_pending;	/* Set by the server while the fd returned by
+				   get_input_fd() has data to be read */
+
+	/* Refresh scheduling, kept by the server */
+	long int refresh_interval;	/* Least time between two flushes in us,
+					   from MaxRefreshRate; 0 for none */
+	long int idle_interval;		/* Most time between two flushes in us
+					   while nothing changes, from
+					   IdleRefreshRate; 0 for none */
+	struct timeval last_flush;	/* When the last flush started */
+	struct timeval next_flush;	/* Earliest time of the next flush */
+	int states_pending;		/* Backlight or output changed since
+					   the last flush */
+
 } Driver;
 
 #endif
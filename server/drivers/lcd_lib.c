@@ -5,7 +5,10 @@
  * to this library.
  */
 
+#include <string.h>
+
 #include "lcd.h"
+#include "lcd_lib.h"
 
 #ifdef HAVE_CONFIG_H
 # include "config.h"
@@ -79,3 +82,185 @@ lib_vbar_static (Driver *drvthis, int x, int y, int len, int promille, int optio
 		}
 	}
 }
+
+
+/** \name Frame buffer comparison
+ * Text mode drivers keep the characters on the display in a backing store
+ * and only send the parts of the frame buffer that differ from it. These
+ * functions find those parts, comparing a machine word at a time.
+ *@{*/
+
+/** Comparison unit: one machine word */
+typedef unsigned long lib_fb_word;
+
+/**
+ * Find the first position at which two buffers differ.
+ * \param a    First buffer.
+ * \param b    Second buffer.
+ * \param len  Length of both buffers.
+ * \return  Index of the first difference, or \c len if they are equal.
+ */
+static int
+lib_fb_first_diff(const unsigned char *a, const unsigned char *b, int len)
+{
+	int i = 0;
+
+	for (; i + (int) sizeof(lib_fb_word) <= len; i += sizeof(lib_fb_word)) {
+		lib_fb_word wa, wb;
+
+		/* memcpy() compiles to plain (unaligned) loads */
+		memcpy(&wa, a + i, sizeof(wa));
+		memcpy(&wb, b + i, sizeof(wb));
+		if (wa != wb)
+			break;
+	}
+	while ((i < len) && (a[i] == b[i]))
+		i++;
+
+	return i;
+}
+
+
+/**
+ * Find the last position at which two buffers differ.
+ * \param a    First buffer.
+ * \param b    Second buffer.
+ * \param len  Length of both buffers.
+ * \return  Index of the last difference, or -1 if they are equal.
+ */
+static int
+lib_fb_last_diff(const unsigned char *a, const unsigned char *b, int len)
+{
+	int i = len;
+
+	for (; i >= (int) sizeof(lib_fb_word); i -= sizeof(lib_fb_word)) {
+		lib_fb_word wa, wb;
+
+		memcpy(&wa, a + i - sizeof(wa), sizeof(wa));
+		memcpy(&wb, b + i - sizeof(wb), sizeof(wb));
+		if (wa != wb)
+			break;
+	}
+	while ((i > 0) && (a[i - 1] == b[i - 1]))
+		i--;
+
+	return i - 1;
+}
+
+
+/**
+ * Find the changed part of a line: leading and trailing characters that
+ * are identical in frame buffer and backing store are left out.
+ * \param fb     Line in the frame buffer.
+ * \param bs     Same line in the backing store.
+ * \param len    Length of the line.
+ * \param first  Receives the index of the first changed character.
+ * \return  Number of characters from the first to the last changed one;
+ *          0 if the line did not change.
+ */
+int
+lib_fb_diff(const unsigned char *fb, const unsigned char *bs, int len, int *first)
+{
+	int start = lib_fb_first_diff(fb, bs, len);
+
+	*first = start;
+	if (start == len)
+		return 0;
+
+	/* the last difference is at or behind the first one */
+	return lib_fb_last_diff(fb + start, bs + start, len - start) + 1;
+}
+
+
+/**
+ * Tell whether a line changed.
+ * \param fb   Line in the frame buffer.
+ * \param bs   Same line in the backing store.
+ * \param len  Length of the line.
+ * \return  1 if frame buffer and backing store differ, 0 otherwise.
+ */
+int
+lib_fb_changed(const unsigned char *fb, const unsigned char *bs, int len)
+{
+	return (lib_fb_first_diff(fb, bs, len) < len);
+}
+
+
+/**
+ * Start iterating over the changed spans of a frame buffer.
+ * \param it      Iterator to initialize.
+ * \param fb      Frame buffer.
+ * \param bs      Backing store.
+ * \param width   Width of the display in characters.
+ * \param height  Height of the display in characters.
+ * \param gap     Max. number of unchanged characters inside a span. Use 0
+ *                to get only changed characters and \c width to get one
+ *                span per line from the first to the last change.
+ */
+void
+lib_fb_span_init(LibFbSpanIter *it, const unsigned char *fb, const unsigned char *bs,
+		 int width, int height, int gap)
+{
+	it->fb = fb;
+	it->bs = bs;
+	it->width = width;
+	it->height = height;
+	it->gap = gap;
+	it->x = 0;
+	it->y = 0;
+}
+
+
+/**
+ * Get the next changed span of the frame buffer. Spans are returned line
+ * by line from left to right and never cross line ends.
+ * \param it   Iterator set up by lib_fb_span_init().
+ * \param x    Receives the column of the span (0-based).
+ * \param y    Receives the line of the span (0-based).
+ * \param len  Receives the length of the span.
+ * \return  1 if a span was found, 0 if there are no more changes.
+ */
+int
+lib_fb_span_next(LibFbSpanIter *it, int *x, int *y, int *len)
+{
+	while (it->y < it->height) {
+		const unsigned char *fb = it->fb + it->y * it->width;
+		const unsigned char *bs = it->bs + it->y * it->width;
+		int start = it->x + lib_fb_first_diff(fb + it->x, bs + it->x, it->width - it->x);
+		int end, last;
+
+		if (start == it->width) {
+			/* no (more) changes in this line */
+			it->x = 0;
+			it->y++;
+			continue;
+		}
+
+		if (it->gap >= it->width) {
+			last = start + lib_fb_last_diff(fb + start, bs + start, it->width - start);
+		}
+		else {
+			/* extend the span while the unchanged runs are short enough */
+			last = start;
+			for (end = start + 1; end < it->width; end++) {
+				if (fb[end] != bs[end])
+					last = end;
+				else if (end - last > it->gap)
+					break;
+			}
+		}
+
+		*x = start;
+		*y = it->y;
+		*len = last - start + 1;
+
+		it->x = last + 1;
+		if (it->x >= it->width) {
+			it->x = 0;
+			it->y++;
+		}
+		return 1;
+	}
+	return 0;
+}
+/**@}*/
@@ -8,5 +8,21 @@
 void lib_hbar_static (Driver *drvthis, int x, int y, int len, int promille, int options, int cellwidth, int cc_offset);
 void lib_vbar_static (Driver *drvthis, int x, int y, int len, int promille, int options, int cellheight, int cc_offset);
 
+/** Iterator over the changed spans of a frame buffer */
+typedef struct lib_fb_span_iter {
+	const unsigned char *fb;	/**< Frame buffer */
+	const unsigned char *bs;	/**< Backing store */
+	int width;			/**< Display width */
+	int height;			/**< Display height */
+	int gap;			/**< Max. unchanged characters inside a span */
+	int x;				/**< Column to continue searching at */
+	int y;				/**< Line to continue searching at */
+} LibFbSpanIter;
+
+int lib_fb_diff (const unsigned char *fb, const unsigned char *bs, int len, int *first);
+int lib_fb_changed (const unsigned char *fb, const unsigned char *bs, int len);
+void lib_fb_span_init (LibFbSpanIter *it, const unsigned char *fb, const unsigned char *bs, int width, int height, int gap);
+int lib_fb_span_next (LibFbSpanIter *it, int *x, int *y, int *len);
+
 #endif
 
@@ -365,3 +365,19 @@ linuxInput_get_key (Driver *drvthis)
 
 	return retval;
 }
+
+
+/**
+ * Return the file descriptor of the input device, so the server can wait for
+ * events instead of polling linuxInput_get_key().
+ * \param drvthis  Pointer to driver structure.
+ * \retval         File descriptor of the input device;
+ *                 \c -1 while the device is lost.
+ */
+MODULE_EXPORT int
+linuxInput_get_input_fd (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+
+	return p->fd;
+}
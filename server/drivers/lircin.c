@@ -215,3 +215,44 @@ lircin_get_key (Driver *drvthis)
 
 	return cmd;
 }
+
+
+/**
+ * Return the LIRC socket, so the server can wait for input instead of
+ * polling lircin_get_key().
+ * \param drvthis  Pointer to driver structure.
+ * \return         File descriptor of the LIRC socket.
+ */
+MODULE_EXPORT int
+lircin_get_input_fd (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+
+	return p->lircin_fd;
+}
+
+
+/**
+ * Get key after the LIRC socket became readable. Unlike lircin_get_key()
+ * this skips unmapped codes, so a NULL return means all buffered input
+ * has been read.
+ * \param drvthis  Pointer to driver structure.
+ * \return         String representation of the key;
+ *                 \c NULL if nothing available.
+ */
+MODULE_EXPORT const char *
+lircin_input_ready (Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+	char *code = NULL, *cmd = NULL;
+
+	while ((cmd == NULL) && (lirc_nextcode(&code) == 0) && (code != NULL)) {
+		if ((lirc_code2char(p->lircin_irconfig, code, &cmd) == 0) && (cmd != NULL)) {
+			report(RPT_DEBUG, "%s: \"%s\"", drvthis->name, cmd);
+		}
+		free(code);
+		code = NULL;
+	}
+
+	return cmd;
+}
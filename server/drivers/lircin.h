@@ -24,6 +24,8 @@
 MODULE_EXPORT int lircin_init (Driver *drvthis);
 MODULE_EXPORT void lircin_close (Driver *drvthis);
 MODULE_EXPORT const char * lircin_get_key (Driver *drvthis);
+MODULE_EXPORT int lircin_get_input_fd (Driver *drvthis);
+MODULE_EXPORT const char * lircin_input_ready (Driver *drvthis);
 
 #define LIRCIN_VERBOSELY 0
 
@@ -99,22 +99,6 @@ typedef struct {
 #define USB_BUFFERS 4
 #endif
 
-#ifdef HAVE_LIBUSB_1_0
-/**
- * This structure holds the data for a USB transfer.
- */
-typedef struct usb_transfer_data {
-	/** structure for the details of the asynchronous USB transfer */
-	struct libusb_transfer *transfer;
-	/** transfer status */
-	int status;
-	/** Pointer to driver private data */
-	Driver *drvthis;
-	/** data buffer for the USB transfer */
-	unsigned char buffer[PICOLCD_MAX_DATA_LEN];
-}UsbTransferData;
-#endif
-
 /** Private data for the picoLCD driver */
 typedef struct picolcd_private_data {
 	USB_DEVICE_HANDLE *lcd;
@@ -149,8 +133,6 @@ typedef struct picolcd_private_data {
 #ifdef HAVE_LIBUSB_1_0
 	/* Pointer to libusb 1.0 session */
 	libusb_context *lib_ctx;
-	/* structure for the details of the USB transfer */
-	UsbTransferData input_transfer[USB_BUFFERS];
 	/* buffer for the key press data */
 	keys key_buffer[KEY_BUFFER_SIZE];
 	int key_read_index;	/* Read index in the key_buffer */
@@ -174,9 +156,8 @@ static void set_key_lights(USB_DEVICE_HANDLE *lcd, int keys[], int state);
 static void picolcd_lircsend(Driver *drvthis);
 static void ir_transcode(Driver *drvthis, unsigned char *data, unsigned int cbdata);
 #ifdef HAVE_LIBUSB_1_0
-static void free_usb_transfers(Driver *drvthis);
 static void key_buffer_put(Driver *drvthis, unsigned char high_key, unsigned char low_key);
-static void usb_cb_input(struct libusb_transfer *transfer);
+static void picolcd_input(void *data, unsigned char *buf, int len);
 #else
 static void get_key_event(USB_DEVICE_HANDLE *lcd, lcd_packet *packet, int timeout);
 #endif
@@ -246,8 +227,8 @@ picoLCD_init(Driver *drvthis)
 {
 	PrivateData *p;
 #ifdef HAVE_LIBUSB_1_0
+	libusb_device_handle *handle = NULL;
 	int error = 0;
-	int i;
 #else
 	struct usb_bus *bus;
 	struct usb_device *dev;
@@ -293,24 +274,24 @@ picoLCD_init(Driver *drvthis)
 	for (id = 0; picolcd_device_ids[id].device_name != NULL; id++) {
 		report(RPT_INFO, "%s: looking for device %s ", drvthis->name,
 			picolcd_device_ids[id].device_name);
-		p->lcd = libusb_open_device_with_vid_pid(p->lib_ctx,
+		handle = libusb_open_device_with_vid_pid(p->lib_ctx,
 					   picolcd_device_ids[id].vendor_id,
 					  picolcd_device_ids[id].device_id);
-		if ((p->lcd) != NULL) {
+		if (handle != NULL) {
 			p->device = &picolcd_device_ids[id];
 			debug(RPT_INFO, "%s: opening device %s succeeded", drvthis->name,
 			      picolcd_device_ids[id].device_name);
 			break;
 		}
 	}
-	if (p->lcd == NULL) {
+	if (handle == NULL) {
 		report(RPT_ERR, "%s: no device found", drvthis->name);
 		return -1;
 	}
 
-	if (libusb_kernel_driver_active(p->lcd, 0) == 1) {
+	if (libusb_kernel_driver_active(handle, 0) == 1) {
 		debug(RPT_DEBUG, "%s: libusb_kernel_driver_active returned true", drvthis->name);
-		error = libusb_detach_kernel_driver(p->lcd, 0);
+		error = libusb_detach_kernel_driver(handle, 0);
 		if (error) {
 			report(RPT_ERR, "%s: libusb_detach_kernel_driver error %d", drvthis->name, error);
 			return -1;
@@ -320,7 +301,7 @@ picoLCD_init(Driver *drvthis)
 		debug(RPT_DEBUG, "%s: libusb_kernel_driver_active returned false", drvthis->name);
 	}
 
-	error = libusb_claim_interface(p->lcd, 0);
+	error = libusb_claim_interface(handle, 0);
 	if (error) {
 		report(RPT_ERR, "%s: libusb_claim_interface error %d", drvthis->name, error);
 		return -1;
@@ -333,41 +314,24 @@ picoLCD_init(Driver *drvthis)
 	 * setting does not exist). Is this needed? Has it ever worked?
 	 * lsusb reports one configuration with one interface and no alternate settings.
 	 */
-	error = libusb_set_interface_alt_setting(p->lcd, 1, 0);
+	error = libusb_set_interface_alt_setting(handle, 1, 0);
 	if (error) {
 		report(RPT_WARNING, "%s: libusb_set_interface_alt_setting error %d", drvthis->name, error);
 	}
 
-	/* Set-up USB input transfer data structures */
-	for (i = 0; i < USB_BUFFERS; i++)
-		p->input_transfer[i].transfer = NULL;
-	for (i = 0; i < USB_BUFFERS; i++)
-	{
-		UsbTransferData *utdp = &p->input_transfer[i];
-
-		utdp->drvthis = drvthis;
-		utdp->transfer = libusb_alloc_transfer(0);
-		if (utdp->transfer == NULL) {
-			report(RPT_ERR, "%s: libusb_alloc_transfer failed", drvthis->name);
-			free_usb_transfers(drvthis);
-			return -1;
-		}
-		libusb_fill_interrupt_transfer(utdp->transfer,
-				p->lcd,
-				LIBUSB_ENDPOINT_IN + 1,
-				utdp->buffer,
-				sizeof(utdp->buffer),
-				usb_cb_input,
-				(void *)utdp,
-				0);
-		utdp->status = libusb_submit_transfer(utdp->transfer);
-		if (utdp->status) {
-			report(RPT_ERR, "%s: libusb_submit_transfer error %d",
-					drvthis->name, utdp->status);
-			free_usb_transfers(drvthis);
-			return -1;
-		}
+	/* From here on all transfers are asynchronous; a frame takes up to
+	 * two packets per line, and two frames may be queued */
+	p->lcd = lib_usb_async_open(p->lib_ctx, handle, drvthis->name,
+				    2 * 2 * p->device->height);
+	if (p->lcd == NULL) {
+		report(RPT_ERR, "%s: unable to set up usb transfers", drvthis->name);
+		libusb_release_interface(handle, 0);
+		libusb_close(handle);
+		return -1;
 	}
+	if (lib_usb_async_start_input(p->lcd, LIBUSB_ENDPOINT_IN + 1, PICOLCD_MAX_DATA_LEN,
+				      USB_BUFFERS, picolcd_input, drvthis) < 0)
+		return -1;
 
 #else				/* The libusb 0.1 way */
 
@@ -643,22 +607,25 @@ picoLCD_close(Driver *drvthis)
 	PrivateData *p = drvthis->private_data;
 	if (p != NULL) {
 #ifdef HAVE_LIBUSB_1_0
-		int error;
+		if (p->lcd != NULL) {
+			libusb_device_handle *handle = lib_usb_async_handle(p->lcd);
+			int error;
 
-		free_usb_transfers(drvthis);
+			lib_usb_async_close(p->lcd);
 
-		error = libusb_release_interface(p->lcd, 0);
-		if (error) {
-			report(RPT_ERR, "%s: usb_release_interface error %d", drvthis->name, error);
-		}
+			error = libusb_release_interface(handle, 0);
+			if (error) {
+				report(RPT_ERR, "%s: usb_release_interface error %d", drvthis->name, error);
+			}
 
-		/* FIXME: Does it make sense to re-attach a kernel driver? */
-		error = libusb_attach_kernel_driver(p->lcd, 0);
-		if (error) {
-			report(RPT_ERR, "%s: libusb_attach_kernel_driver error %d", drvthis->name, error);
-		}
+			/* FIXME: Does it make sense to re-attach a kernel driver? */
+			error = libusb_attach_kernel_driver(handle, 0);
+			if (error) {
+				report(RPT_ERR, "%s: libusb_attach_kernel_driver error %d", drvthis->name, error);
+			}
 
-		libusb_close(p->lcd);
+			libusb_close(handle);
+		}
 		if (p->key_wait_time != NULL)
 			free(p->key_wait_time);
 #ifndef USE_LIBUSB_SINGLE_SELECT
@@ -1285,20 +1252,11 @@ picoLCD_get_key(Driver *drvthis)
 
 #ifndef USE_LIBUSB_SINGLE_SELECT
 	/*
-	 * When using a single select statement polling for libusb-1.0 events
-	 * needs to be integrated into the LCDd main loop. See:
-	 * http://libusb.sourceforge.net/api-1.0/group__poll.html#pollmain
+	 * Process any outstanding USB events for our session. The server
+	 * only calls this when picoLCD_get_input_fd() reported events, or
+	 * while a key repeats.
 	 */
-	struct timeval timeout;
-	/*
-	 * FIXME: It is not efficient to call this at 32Hz, it is only needed
-	 * if a key has been pressed or IR data has been received.
-	 *
-	 * Process any outstanding USB events for our session.
-	 */
-	timeout.tv_sec = 0;
-	timeout.tv_usec = 0;
-	libusb_handle_events_timeout(p->lib_ctx, &timeout);
+	lib_usb_async_poll(p->lcd);
 #endif
 
 	/*
@@ -1451,6 +1409,41 @@ picoLCD_get_key(Driver *drvthis)
 #endif
 }
 
+
+#ifdef HAVE_LIBUSB_1_0
+/**
+ * Get the file descriptor the server waits on for USB events (key and IR
+ * input, completed output). While a key is held and repeats, -1 is
+ * returned, so the server polls picoLCD_get_key() for the repeats.
+ * \param drvthis  Pointer to driver structure.
+ * \return         File descriptor, or -1 to be polled.
+ */
+MODULE_EXPORT int
+picoLCD_get_input_fd(Driver *drvthis)
+{
+	PrivateData *p = drvthis->private_data;
+
+	if ((p->lcd == NULL) || (p->reported_keys.high_key && timerisset(p->key_wait_time)))
+		return -1;
+
+	return lib_usb_async_get_fd(p->lcd);
+}
+
+
+/**
+ * Process the USB events the server saw on the descriptor returned by
+ * picoLCD_get_input_fd() and return the next key, if any.
+ * \param drvthis  Pointer to driver structure.
+ * \return         String representation of the key;
+ *                 \c NULL if all events are processed.
+ */
+MODULE_EXPORT const char *
+picoLCD_input_ready(Driver *drvthis)
+{
+	return picoLCD_get_key(drvthis);
+}
+#endif
+
 /* lcd_logical_driver Hardware functions */
 
 /**
@@ -1874,14 +1867,8 @@ picolcd_send(USB_DEVICE_HANDLE * lcd, unsigned char *data, int size)
 	if ((lcd == NULL) && (data == NULL))
 		return;
 #ifdef HAVE_LIBUSB_1_0
-	int error = 0;
-	int transferred = 0;
-	unsigned int timeout = 1000;	/* milliseconds */
-	error = libusb_interrupt_transfer(lcd, LIBUSB_ENDPOINT_OUT + 1, data, size, &transferred, timeout);
-	if (error) {
-		report(RPT_WARNING, "libusb_interrupt_transfer error %d, sent %d of %d bytes\n",
-			error, transferred, size);
-	}
+	/* queued; picoLCD_get_key() processes the completions */
+	lib_usb_async_interrupt_out(lcd, LIBUSB_ENDPOINT_OUT + 1, data, size);
 #else
 	usb_interrupt_write(lcd, USB_ENDPOINT_OUT + 1, (char *)data, size, 1000);
 #endif
@@ -2093,43 +2080,6 @@ set_key_lights(USB_DEVICE_HANDLE * lcd, int keys[], int state)
 
 
 #ifdef HAVE_LIBUSB_1_0
-/**
- * Free the USB transfer data.
- *
- * \param drvthis   Pointer to driver structure
- */
-static void
-free_usb_transfers(Driver *drvthis)
-{
-	PrivateData *p = drvthis->private_data;
-	int i;
-
-	for (i = 0; i < USB_BUFFERS; i++) {
-		if (p->input_transfer[i].transfer != NULL) {
-			if (p->input_transfer[i].status == LIBUSB_SUCCESS) {
-				/* Need to cancel transfer before it is freed */
-				libusb_cancel_transfer(p->input_transfer[i].transfer);
-				while (p->input_transfer[i].status != LIBUSB_TRANSFER_CANCELLED) {
-					struct timeval timeout;
-					/*
-					 * Wait for the cancellation to complete, the
-					 * call-back will then have freed the
-					 * transfer.
-					 */
-					report(RPT_INFO, "%s: waiting for usb transfer %d to be cancelled", drvthis->name, i);
-					timeout.tv_sec = 1;
-					timeout.tv_usec = 0;
-					libusb_handle_events_timeout(p->lib_ctx, &timeout);
-				}
-			}
-			else {
-				libusb_free_transfer(p->input_transfer[i].transfer);
-				p->input_transfer[i].transfer = NULL;
-			}
-		}
-	}
-}
-
 /**
  * Store key press and release events in a buffer ready for the get key function.
  * If the buffer is full key codes are discarded.
@@ -2164,46 +2114,33 @@ key_buffer_put(Driver *drvthis, unsigned char high_key, unsigned char low_key)
  * Call-back for USB input. Either calls key_buffer_put to process key events
  * or ir_trancode to process events from IR receiver.
  *
- * \param transfer  Structure containing the USB data
+ * \param data  Pointer to driver structure
+ * \param buf   The received report
+ * \param len   Length of the report
  */
 static void
-usb_cb_input(struct libusb_transfer *transfer)
+picolcd_input(void *data, unsigned char *buf, int len)
 {
-	static const char *status[] = {
-		"COMPLETED", "ERROR", "TIMED_OUT", "CANCELLED", "STALL",
-		"NO_DEVICE", "OVERFLOW"
-	};
-	UsbTransferData *p = (UsbTransferData *)transfer->user_data;
-	Driver *drvthis = p->drvthis;
-	PrivateData *p_data = drvthis->private_data;
-
-	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
-		report(RPT_ERR, "%s: input transfer status: %s", drvthis->name, status[transfer->status]);
-		p->status = transfer->status;
-		libusb_free_transfer(transfer);
-		p->transfer = NULL;
+	Driver *drvthis = (Driver *) data;
+	PrivateData *p = drvthis->private_data;
+
+	if (len < 3)
 		return;
-	}
 
-	switch (transfer->buffer[0]) {
+	switch (buf[0]) {
 	    case IN_REPORT_KEY_STATE:
 		debug(RPT_INFO, "%s: USB input call-back key", drvthis->name);
-		key_buffer_put(drvthis, transfer->buffer[1], transfer->buffer[2]);
+		key_buffer_put(drvthis, buf[1], buf[2]);
 		break;
 	    case IN_REPORT_IR_DATA:
-		debug(RPT_INFO, "%s: USB input call-back IR length %i", drvthis->name, transfer->buffer[1]);
-		if (p_data->IRenabled)
-			ir_transcode(drvthis, &transfer->buffer[2], transfer->buffer[1]);
+		debug(RPT_INFO, "%s: USB input call-back IR length %i", drvthis->name, buf[1]);
+		if (p->IRenabled)
+			ir_transcode(drvthis, &buf[2], buf[1]);
 		break;
 	    default:
-		report(RPT_ERR, "%s: input transfer unexpected data %d", drvthis->name, transfer->buffer[0]);
+		report(RPT_ERR, "%s: input transfer unexpected data %d", drvthis->name, buf[0]);
 		break;
 	}
-
-	/* Re-transmit the input request transfer */
-	p->status = libusb_submit_transfer(transfer);
-	if (p->status != LIBUSB_SUCCESS)
-		report(RPT_ERR, "%s: input transfer submit status %d", drvthis->name, p->status);
 }
 #endif
 
@@ -15,8 +15,8 @@
 #define PCIOLCD_H
 
 #ifdef HAVE_LIBUSB_1_0
-# include <libusb.h>
-# define USB_DEVICE_HANDLE libusb_device_handle
+# include "usb_async_lib.h"
+# define USB_DEVICE_HANDLE struct lib_usb_async
 #else
 # include <usb.h>
 # define USB_DEVICE_HANDLE usb_dev_handle
@@ -83,6 +83,10 @@ MODULE_EXPORT void picoLCD_flush(Driver *drvthis);
 MODULE_EXPORT void picoLCD_string(Driver *drvthis, int x, int y, unsigned char string[]);
 MODULE_EXPORT void picoLCD_chr(Driver *drvthis, int x, int y, unsigned char c);
 MODULE_EXPORT char *picoLCD_get_key(Driver *drvthis);
+#ifdef HAVE_LIBUSB_1_0
+MODULE_EXPORT int  picoLCD_get_input_fd(Driver *drvthis);
+MODULE_EXPORT const char *picoLCD_input_ready(Driver *drvthis);
+#endif
 
 MODULE_EXPORT int picoLCD_get_free_chars (Driver *drvthis);
 MODULE_EXPORT void picoLCD_set_char (Driver *drvthis, int n, unsigned char *dat);
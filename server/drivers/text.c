@@ -239,6 +239,36 @@ text_chr (Driver *drvthis, int x, int y, char c)
 }
 
 
+/**
+ * Write a run of characters starting at position (x,y).
+ * \param drvthis  Pointer to driver structure.
+ * \param x        Horizontal character position (column).
+ * \param y        Vertical character position (row).
+ * \param chars    Characters that get written (not NUL-terminated).
+ * \param len      Number of characters.
+ */
+MODULE_EXPORT void
+text_cells (Driver *drvthis, int x, int y, const char *chars, int len)
+{
+	PrivateData *p = drvthis->private_data;
+
+	x--; y--;
+
+	if ((y < 0) || (y >= p->height))
+		return;
+	if (x < 0) {
+		chars -= x;
+		len += x;
+		x = 0;
+	}
+	if (len > p->width - x)
+		len = p->width - x;
+
+	if (len > 0)
+		memcpy(p->framebuf + (y * p->width) + x, chars, len);
+}
+
+
 /**
  * Change the display contrast.
  * Dumb text terminals do not support this, so we ignore it.
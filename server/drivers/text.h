@@ -9,6 +9,7 @@ MODULE_EXPORT void text_clear (Driver *drvthis);
 MODULE_EXPORT void text_flush (Driver *drvthis);
 MODULE_EXPORT void text_string (Driver *drvthis, int x, int y, const char string[]);
 MODULE_EXPORT void text_chr (Driver *drvthis, int x, int y, char c);
+MODULE_EXPORT void text_cells (Driver *drvthis, int x, int y, const char *chars, int len);
 MODULE_EXPORT void text_set_contrast (Driver *drvthis, int promille);
 MODULE_EXPORT void text_backlight (Driver *drvthis, int on);
 MODULE_EXPORT const char * text_get_info (Driver *drvthis);
@@ -260,33 +260,19 @@ MODULE_EXPORT void
 tyan_lcdm_flush (Driver *drvthis)
 {
 	PrivateData *p = drvthis->private_data;
-	int i;
-	unsigned char *xp = p->framebuf;
-	unsigned char *xq = p->backingstore;
 /*
  * We don't use delta update yet.
  * It is possible but not easy, we can only update a line, full or begining.
  */
 
-	for (i = 0; i < p->width; i++) {
-		if (*xp != *xq) {
-			tyan_lcdm_write_str(p->fd, p->framebuf, 0x80, 16);
-			memcpy(p->backingstore, p->framebuf, p->width);
-			break;
-		}
-		xp++; xq++;
+	if (lib_fb_changed(p->framebuf, p->backingstore, p->width)) {
+		tyan_lcdm_write_str(p->fd, p->framebuf, 0x80, 16);
+		memcpy(p->backingstore, p->framebuf, p->width);
 	}
 
-	xp = p->framebuf + p->width;
-	xq = p->backingstore + p->width;
-
-	for (i = 0; i < p->width; i++) {
-		if (*xp != *xq) {
-			tyan_lcdm_write_str(p->fd, p->framebuf + p->width, 0xc0, 16);
-			memcpy(p->backingstore + p->width, p->framebuf + p->width, p->width);
-			break;
-		}
-		xp++; xq++;
+	if (lib_fb_changed(p->framebuf + p->width, p->backingstore + p->width, p->width)) {
+		tyan_lcdm_write_str(p->fd, p->framebuf + p->width, 0xc0, 16);
+		memcpy(p->backingstore + p->width, p->framebuf + p->width, p->width);
 	}
 }
 
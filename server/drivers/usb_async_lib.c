@@ -0,0 +1,567 @@
+/** \file server/drivers/usb_async_lib.c
+ * Asynchronous USB transfers for LCDd drivers using libusb-1.0.
+ *
+ * Output transfers are submitted without waiting for them to complete.
+ * Each transfer has its own copy of the data, and drivers size the ring
+ * to hold two frames: while one frame is on the bus the next one is
+ * queued behind it, and sending only waits when a third frame follows
+ * before the first one completed. Transfers to the same endpoint
+ * complete in the order they were submitted.
+ *
+ * Input transfers on an interrupt-IN endpoint are resubmitted as soon as
+ * they complete, and the received data is handed to a callback.
+ *
+ * Completions are processed by lib_usb_async_poll(), which never blocks.
+ * Where epoll is available, lib_usb_async_get_fd() returns a descriptor
+ * that becomes readable whenever libusb has events to handle; drivers
+ * return it from get_input_fd, so the server waits for it in its select()
+ * and calls input_ready, which polls. Without it the drivers poll from
+ * get_key and flush.
+ */
+
+/*-
+ * This file is released under the GNU General Public License. Refer to the
+ * COPYING file distributed with this package.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef HAVE_LIBUSB_1_0
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+# include <poll.h>
+#endif
+
+#include "usb_async_lib.h"
+#include "shared/report.h"
+
+/** Timeout of output transfers in milliseconds */
+#define OUT_TIMEOUT	1000
+/** Number of seconds to wait for a free output transfer or cancellation */
+#define WAIT_TRIES	5
+
+/** An output transfer and its data */
+typedef struct {
+	struct libusb_transfer *transfer;
+	struct lib_usb_async *usb;
+	int busy;
+	unsigned char buffer[LIBUSB_CONTROL_SETUP_SIZE + LIB_USB_ASYNC_MAX_DATA];
+} OutTransfer;
+
+/** An input transfer and its data */
+typedef struct {
+	struct libusb_transfer *transfer;
+	struct lib_usb_async *usb;
+	int busy;
+	unsigned char *buffer;
+} InTransfer;
+
+struct lib_usb_async {
+	libusb_context *ctx;
+	libusb_device_handle *handle;
+	const char *name;		/**< Name of the driver for messages */
+	OutTransfer *out;		/**< Ring of output transfers */
+	int out_count;			/**< Number of output transfers */
+	int out_next;			/**< Output transfer to use next */
+	int out_busy;			/**< Number of output transfers in flight */
+	InTransfer *in;
+	int in_count;
+	int in_busy;			/**< Number of input transfers submitted */
+	lib_usb_async_input in_callback;
+	void *in_data;
+	int closing;			/**< Do not resubmit input transfers */
+	int event_fd;			/**< epoll descriptor watching libusb's
+					     descriptors, or -1 */
+};
+
+
+/**
+ * Handle USB events, waiting at most the given time.
+ * \param usb       Handle.
+ * \param timeout_ms  Max. time to wait in milliseconds.
+ */
+static void
+handle_events(struct lib_usb_async *usb, int timeout_ms)
+{
+	struct timeval tv;
+
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	libusb_handle_events_timeout_completed(usb->ctx, &tv, NULL);
+}
+
+
+/**
+ * Completion callback of output transfers.
+ * \param transfer  The completed transfer.
+ */
+static void
+out_done(struct libusb_transfer *transfer)
+{
+	OutTransfer *out = (OutTransfer *) transfer->user_data;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+	    transfer->status != LIBUSB_TRANSFER_CANCELLED)
+		report(RPT_WARNING, "%s: output transfer failed with status %d",
+		       out->usb->name, transfer->status);
+
+	out->busy = 0;
+	out->usb->out_busy--;
+}
+
+
+#ifdef HAVE_SYS_EPOLL_H
+/**
+ * Called by libusb when it starts using a file descriptor.
+ * \param fd         The file descriptor.
+ * \param events     Events to wait for, POLLIN and/or POLLOUT.
+ * \param user_data  Handle.
+ */
+static void
+pollfd_added(int fd, short events, void *user_data)
+{
+	struct lib_usb_async *usb = (struct lib_usb_async *) user_data;
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	if (events & POLLIN)
+		ev.events |= EPOLLIN;
+	if (events & POLLOUT)
+		ev.events |= EPOLLOUT;
+	ev.data.fd = fd;
+	if (epoll_ctl(usb->event_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+		report(RPT_WARNING, "%s: unable to watch usb descriptor %d", usb->name, fd);
+}
+
+
+/**
+ * Called by libusb when it stops using a file descriptor.
+ * \param fd         The file descriptor.
+ * \param user_data  Handle.
+ */
+static void
+pollfd_removed(int fd, void *user_data)
+{
+	struct lib_usb_async *usb = (struct lib_usb_async *) user_data;
+
+	epoll_ctl(usb->event_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+
+/**
+ * Collect libusb's file descriptors in an epoll descriptor and keep it up
+ * to date. Nothing happens if that fails; the drivers then poll.
+ * \param usb  Handle.
+ */
+static void
+watch_pollfds(struct lib_usb_async *usb)
+{
+	const struct libusb_pollfd **fds;
+	int i;
+
+	usb->event_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (usb->event_fd < 0)
+		return;
+
+	fds = libusb_get_pollfds(usb->ctx);
+	if (fds == NULL) {
+		close(usb->event_fd);
+		usb->event_fd = -1;
+		return;
+	}
+	for (i = 0; fds[i] != NULL; i++)
+		pollfd_added(fds[i]->fd, fds[i]->events, usb);
+	libusb_free_pollfds(fds);
+
+	libusb_set_pollfd_notifiers(usb->ctx, pollfd_added, pollfd_removed, usb);
+}
+#endif
+
+
+/**
+ * Completion callback of input transfers. Passes the data on and
+ * resubmits the transfer.
+ * \param transfer  The completed transfer.
+ */
+static void
+in_done(struct libusb_transfer *transfer)
+{
+	InTransfer *in = (InTransfer *) transfer->user_data;
+	struct lib_usb_async *usb = in->usb;
+	int error;
+
+	if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+		usb->in_callback(usb->in_data, transfer->buffer, transfer->actual_length);
+		if (usb->closing)
+			goto stopped;
+
+		error = libusb_submit_transfer(transfer);
+		if (error == LIBUSB_SUCCESS)
+			return;
+		report(RPT_ERR, "%s: input transfer submit error %d", usb->name, error);
+	}
+	else if (transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+		report(RPT_ERR, "%s: input transfer failed with status %d",
+		       usb->name, transfer->status);
+	}
+
+stopped:
+	in->busy = 0;
+	usb->in_busy--;
+}
+
+
+/**
+ * Get the next output transfer, waiting for it to complete if it is
+ * still in flight.
+ * \param usb  Handle.
+ * \return  The transfer, or NULL if it did not complete in time.
+ */
+static OutTransfer *
+next_out(struct lib_usb_async *usb)
+{
+	OutTransfer *out = &usb->out[usb->out_next];
+	int tries;
+
+	for (tries = 0; out->busy && tries < WAIT_TRIES; tries++)
+		handle_events(usb, 1000);
+
+	if (out->busy) {
+		report(RPT_ERR, "%s: output transfer does not complete", usb->name);
+		return NULL;
+	}
+	return out;
+}
+
+
+/**
+ * Submit a filled output transfer.
+ * \param usb  Handle.
+ * \param out  The transfer.
+ * \retval 0   Success.
+ * \retval -1  Error.
+ */
+static int
+submit_out(struct lib_usb_async *usb, OutTransfer *out)
+{
+	int error = libusb_submit_transfer(out->transfer);
+
+	if (error != LIBUSB_SUCCESS) {
+		report(RPT_WARNING, "%s: output transfer submit error %d", usb->name, error);
+		return -1;
+	}
+
+	out->busy = 1;
+	usb->out_busy++;
+	usb->out_next = (usb->out_next + 1) % usb->out_count;
+	return 0;
+}
+
+
+/**
+ * Set up asynchronous transfers for an opened device. The interface must
+ * already be claimed; it is neither released nor closed by this library.
+ * The context should not be shared with other handles, as the handle
+ * takes over its file descriptor notifiers.
+ * \param ctx        libusb context of the device.
+ * \param handle     Device handle.
+ * \param name       Name of the driver, used in messages.
+ * \param out_count  Number of output transfers; twice the packets of a
+ *                   frame lets a frame be queued while the last one is sent.
+ * \return  New handle, or NULL on error.
+ */
+struct lib_usb_async *
+lib_usb_async_open(libusb_context *ctx, libusb_device_handle *handle,
+		   const char *name, int out_count)
+{
+	struct lib_usb_async *usb;
+	int i;
+
+	usb = calloc(1, sizeof(struct lib_usb_async));
+	if (usb == NULL)
+		return NULL;
+
+	usb->ctx = ctx;
+	usb->handle = handle;
+	usb->name = name;
+	usb->event_fd = -1;
+
+	if (out_count < LIB_USB_ASYNC_OUT_TRANSFERS)
+		out_count = LIB_USB_ASYNC_OUT_TRANSFERS;
+	usb->out = calloc(out_count, sizeof(OutTransfer));
+	if (usb->out == NULL) {
+		free(usb);
+		return NULL;
+	}
+	usb->out_count = out_count;
+
+	for (i = 0; i < out_count; i++) {
+		usb->out[i].usb = usb;
+		usb->out[i].transfer = libusb_alloc_transfer(0);
+		if (usb->out[i].transfer == NULL) {
+			report(RPT_ERR, "%s: libusb_alloc_transfer failed", name);
+			lib_usb_async_close(usb);
+			return NULL;
+		}
+	}
+
+#ifdef HAVE_SYS_EPOLL_H
+	watch_pollfds(usb);
+#endif
+	return usb;
+}
+
+
+/**
+ * Get a file descriptor that becomes readable when there are USB events
+ * to process with lib_usb_async_poll().
+ * \param usb  Handle.
+ * \return  The file descriptor, or -1 if the driver has to poll.
+ */
+int
+lib_usb_async_get_fd(struct lib_usb_async *usb)
+{
+	return usb->event_fd;
+}
+
+
+/**
+ * Get the libusb device handle.
+ * \param usb  Handle.
+ * \return  The libusb device handle.
+ */
+libusb_device_handle *
+lib_usb_async_handle(struct lib_usb_async *usb)
+{
+	return usb->handle;
+}
+
+
+/**
+ * Start reading an interrupt-IN endpoint. Several transfers are kept
+ * submitted, so no report is lost between two calls of
+ * lib_usb_async_poll().
+ * \param usb       Handle.
+ * \param endpoint  Endpoint address (including LIBUSB_ENDPOINT_IN).
+ * \param size      Size of the buffer of each transfer.
+ * \param count     Number of transfers.
+ * \param callback  Called with the data of each completed transfer.
+ * \param data      Passed to the callback.
+ * \retval 0   Success.
+ * \retval -1  Error.
+ */
+int
+lib_usb_async_start_input(struct lib_usb_async *usb, unsigned char endpoint,
+			  int size, int count, lib_usb_async_input callback, void *data)
+{
+	int i;
+
+	if (usb->in != NULL)
+		return -1;
+
+	usb->in = calloc(count, sizeof(InTransfer));
+	if (usb->in == NULL)
+		return -1;
+	usb->in_count = count;
+	usb->in_callback = callback;
+	usb->in_data = data;
+
+	for (i = 0; i < count; i++) {
+		InTransfer *in = &usb->in[i];
+
+		in->usb = usb;
+		in->buffer = malloc(size);
+		in->transfer = libusb_alloc_transfer(0);
+		if (in->buffer == NULL || in->transfer == NULL) {
+			report(RPT_ERR, "%s: unable to allocate input transfer", usb->name);
+			goto error;
+		}
+		libusb_fill_interrupt_transfer(in->transfer, usb->handle, endpoint,
+					       in->buffer, size, in_done, in, 0);
+	}
+
+	for (i = 0; i < count; i++) {
+		InTransfer *in = &usb->in[i];
+		int error = libusb_submit_transfer(in->transfer);
+
+		if (error != LIBUSB_SUCCESS) {
+			report(RPT_ERR, "%s: input transfer submit error %d", usb->name, error);
+			/* lib_usb_async_close() cancels the ones submitted */
+			return -1;
+		}
+		in->busy = 1;
+		usb->in_busy++;
+	}
+
+	return 0;
+
+error:
+	for (i = 0; i < count; i++) {
+		libusb_free_transfer(usb->in[i].transfer);
+		free(usb->in[i].buffer);
+	}
+	free(usb->in);
+	usb->in = NULL;
+	usb->in_count = 0;
+	return -1;
+}
+
+
+/**
+ * Queue data for an interrupt-OUT endpoint. The data is copied, so the
+ * caller may reuse its buffer immediately.
+ * \param usb       Handle.
+ * \param endpoint  Endpoint address (including LIBUSB_ENDPOINT_OUT).
+ * \param data      Data to send.
+ * \param len       Length of the data, at most LIB_USB_ASYNC_MAX_DATA.
+ * \retval 0   Success.
+ * \retval -1  Error.
+ */
+int
+lib_usb_async_interrupt_out(struct lib_usb_async *usb, unsigned char endpoint,
+			    const unsigned char *data, int len)
+{
+	OutTransfer *out;
+
+	if (len > LIB_USB_ASYNC_MAX_DATA || (out = next_out(usb)) == NULL)
+		return -1;
+
+	memcpy(out->buffer, data, len);
+	libusb_fill_interrupt_transfer(out->transfer, usb->handle, endpoint,
+				       out->buffer, len, out_done, out, OUT_TIMEOUT);
+	return submit_out(usb, out);
+}
+
+
+/**
+ * Queue a control transfer sending data to the device.
+ * \param usb           Handle.
+ * \param request_type  bmRequestType of the setup packet.
+ * \param request       bRequest of the setup packet.
+ * \param value         wValue of the setup packet.
+ * \param index         wIndex of the setup packet.
+ * \param data          Data to send.
+ * \param len           Length of the data, at most LIB_USB_ASYNC_MAX_DATA.
+ * \retval 0   Success.
+ * \retval -1  Error.
+ */
+int
+lib_usb_async_control_out(struct lib_usb_async *usb, uint8_t request_type,
+			  uint8_t request, uint16_t value, uint16_t index,
+			  const unsigned char *data, int len)
+{
+	OutTransfer *out;
+
+	if (len > LIB_USB_ASYNC_MAX_DATA || (out = next_out(usb)) == NULL)
+		return -1;
+
+	libusb_fill_control_setup(out->buffer, request_type, request, value, index, len);
+	memcpy(out->buffer + LIBUSB_CONTROL_SETUP_SIZE, data, len);
+	libusb_fill_control_transfer(out->transfer, usb->handle, out->buffer,
+				     out_done, out, OUT_TIMEOUT);
+	return submit_out(usb, out);
+}
+
+
+/**
+ * Process completed transfers without waiting.
+ * \param usb  Handle.
+ */
+void
+lib_usb_async_poll(struct lib_usb_async *usb)
+{
+	handle_events(usb, 0);
+}
+
+
+/**
+ * Wait until all output transfers have completed.
+ * \param usb         Handle.
+ * \param timeout_ms  Max. time to wait in milliseconds.
+ * \retval 0   All output transfers completed.
+ * \retval -1  Timeout.
+ */
+int
+lib_usb_async_wait(struct lib_usb_async *usb, int timeout_ms)
+{
+	struct timeval start, now;
+	int left = timeout_ms;
+
+	gettimeofday(&start, NULL);
+	while (usb->out_busy > 0 && left > 0) {
+		handle_events(usb, left);
+		gettimeofday(&now, NULL);
+		left = timeout_ms - ((now.tv_sec - start.tv_sec) * 1000 +
+				     (now.tv_usec - start.tv_usec) / 1000);
+	}
+
+	return (usb->out_busy > 0) ? -1 : 0;
+}
+
+
+/**
+ * Send the pending output, cancel all other transfers and free them.
+ * \param usb  Handle.
+ */
+void
+lib_usb_async_close(struct lib_usb_async *usb)
+{
+	int i, tries;
+
+	if (usb == NULL)
+		return;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (usb->event_fd >= 0) {
+		libusb_set_pollfd_notifiers(usb->ctx, NULL, NULL, NULL);
+		close(usb->event_fd);
+		usb->event_fd = -1;
+	}
+#endif
+	usb->closing = 1;
+	lib_usb_async_wait(usb, OUT_TIMEOUT);
+
+	for (i = 0; i < usb->out_count; i++) {
+		if (usb->out[i].busy)
+			libusb_cancel_transfer(usb->out[i].transfer);
+	}
+	for (i = 0; i < usb->in_count; i++) {
+		if (usb->in[i].busy)
+			libusb_cancel_transfer(usb->in[i].transfer);
+	}
+
+	/* a transfer must not be freed before its cancellation completed */
+	for (tries = 0; (usb->out_busy > 0 || usb->in_busy > 0) && tries < WAIT_TRIES; tries++) {
+		report(RPT_INFO, "%s: waiting for usb transfers to be cancelled", usb->name);
+		handle_events(usb, 1000);
+	}
+
+	for (i = 0; i < usb->out_count; i++) {
+		if (!usb->out[i].busy)
+			libusb_free_transfer(usb->out[i].transfer);
+	}
+	for (i = 0; i < usb->in_count; i++) {
+		if (!usb->in[i].busy) {
+			libusb_free_transfer(usb->in[i].transfer);
+			free(usb->in[i].buffer);
+		}
+	}
+
+	if (usb->out_busy > 0 || usb->in_busy > 0) {
+		/* leak the transfers libusb still owns, and the handle with them */
+		report(RPT_WARNING, "%s: usb transfers could not be cancelled", usb->name);
+		return;
+	}
+	free(usb->in);
+	free(usb->out);
+	free(usb);
+}
+
+#endif /* HAVE_LIBUSB_1_0 */
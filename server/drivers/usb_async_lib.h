@@ -0,0 +1,48 @@
+/** \file server/drivers/usb_async_lib.h
+ * Asynchronous USB transfers for LCDd drivers using libusb-1.0.
+ */
+
+/*-
+ * This file is released under the GNU General Public License. Refer to the
+ * COPYING file distributed with this package.
+ */
+
+#ifndef USB_ASYNC_LIB_H
+#define USB_ASYNC_LIB_H
+
+#include <stdint.h>
+#include <libusb.h>
+
+/** Least number of output transfers that may be in flight at the same time */
+#define LIB_USB_ASYNC_OUT_TRANSFERS	4
+/** Max. length of the data of an output transfer */
+#define LIB_USB_ASYNC_MAX_DATA		64
+
+struct lib_usb_async;
+
+/**
+ * Called with the data of each completed input transfer.
+ * \param data  The pointer given to lib_usb_async_start_input().
+ * \param buf   Received data.
+ * \param len   Number of bytes received.
+ */
+typedef void (*lib_usb_async_input) (void *data, unsigned char *buf, int len);
+
+struct lib_usb_async *lib_usb_async_open(libusb_context *ctx,
+					 libusb_device_handle *handle,
+					 const char *name, int out_count);
+libusb_device_handle *lib_usb_async_handle(struct lib_usb_async *usb);
+int lib_usb_async_get_fd(struct lib_usb_async *usb);
+int lib_usb_async_start_input(struct lib_usb_async *usb, unsigned char endpoint,
+			      int size, int count, lib_usb_async_input callback,
+			      void *data);
+int lib_usb_async_interrupt_out(struct lib_usb_async *usb, unsigned char endpoint,
+				const unsigned char *data, int len);
+int lib_usb_async_control_out(struct lib_usb_async *usb, uint8_t request_type,
+			      uint8_t request, uint16_t value, uint16_t index,
+			      const unsigned char *data, int len);
+void lib_usb_async_poll(struct lib_usb_async *usb);
+int lib_usb_async_wait(struct lib_usb_async *usb, int timeout_ms);
+void lib_usb_async_close(struct lib_usb_async *usb);
+
+#endif
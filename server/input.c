@@ -14,11 +14,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "shared/sockets.h"
 #include "shared/report.h"
 #include "shared/configfile.h"
-#include "shared/LL.h"
+#include "shared/IL.h"
 
 #include "drivers.h"
 
@@ -32,13 +33,17 @@
 #include "render.h" /* For server_msg* */
 
 
-LinkedList *keylist;
+static IntrusiveList keylist;	/* KeyReservations, linked by their link */
+static int keylist_ready = 0;
 char *toggle_rotate_key;
 char *prev_screen_key;
 char *next_screen_key;
 char *scroll_up_key;
 char *scroll_down_key;
 
+int input_urgent = 0;
+struct timeval input_urgent_time;
+
 /* Local functions */
 int server_input(int key);
 void input_internal_key(const char *key);
@@ -48,7 +53,8 @@ int input_init(void)
 {
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
-	keylist = LL_new();
+	IL_Init(&keylist);
+	keylist_ready = 1;
 
 	/* Get rotate/scroll keys from config file */
 	toggle_rotate_key = strdup(config_get_string("server", "ToggleRotateKey", 0, "Enter"));
@@ -63,12 +69,16 @@ int input_init(void)
 
 void input_shutdown()
 {
-	if (!keylist) {
+	IL_node *node;
+
+	if (!keylist_ready) {
 		/* Program shutdown before completed startup */
 		return;
 	}
 
-	free(keylist);
+	while ((node = IL_PopHead(&keylist)) != NULL)
+		free(IL_ENTRY(node, KeyReservation, link));
+	keylist_ready = 0;
 
 	free(toggle_rotate_key);
 	free(prev_screen_key);
@@ -96,6 +106,9 @@ void handle_input(void)
 
 	/* Handle all keypresses */
 	while ((key = drivers_get_key()) != NULL) {
+		struct timeval now;
+
+		gettimeofday(&now, NULL);
 
 		/* Find what client wants the key */
 		kr = input_find_key(key, current_client);
@@ -106,6 +119,12 @@ void handle_input(void)
 		} else {
 			debug(RPT_DEBUG, "%s: left over key: \"%.40s\"", __FUNCTION__, key);
 			input_internal_key(key);
+
+			/* the display changes: have it rendered at once */
+			if (!input_urgent) {
+				input_urgent = 1;
+				input_urgent_time = now;
+			}
 		}
 	}
 }
@@ -145,6 +164,7 @@ input_internal_key(const char *key)
 int input_reserve_key(const char *key, bool exclusive, Client *client)
 {
 	KeyReservation *kr;
+	IL_node *node;
 
 	debug(RPT_DEBUG, "%s(key=\"%.40s\", exclusive=%d, client=[%d])",
 		__FUNCTION__, key, exclusive, (client?client->sock:-1));
@@ -152,7 +172,8 @@ int input_reserve_key(const char *key, bool exclusive, Client *client)
 	/* Find out if this key is already reserved in a way that interferes
 	 * with the new reservation.
 	 */
-	for (kr = LL_GetFirst(keylist); kr != NULL; kr = LL_GetNext(keylist)) {
+	for (node = IL_First(&keylist); node != NULL; node = IL_Next(&keylist, node)) {
+		kr = IL_ENTRY(node, KeyReservation, link);
 		if (strcmp(kr->key, key) == 0) {
 			if (kr->exclusive || exclusive) {
 				/* Sorry ! */
@@ -161,12 +182,17 @@ int input_reserve_key(const char *key, bool exclusive, Client *client)
 		}
 	}
 
-	/* We can now safely add it ! */
-	kr = malloc(sizeof(KeyReservation));
-	kr->key = strdup(key);
+	/* We can now safely add it ! One allocation holds the key, too. */
+	kr = malloc(sizeof(KeyReservation) + strlen(key) + 1);
+	if (kr == NULL) {
+		report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+		return -1;
+	}
+	kr->key = (char *) (kr + 1);
+	strcpy(kr->key, key);
 	kr->exclusive = exclusive;
 	kr->client = client;
-	LL_Push(keylist, kr);
+	IL_PushTail(&keylist, &kr->link);
 
 	report(RPT_INFO, "Key \"%.40s\" is now reserved %s by client [%d]",
 		key, (exclusive ? "exclusively" : "shared"), (client ? client->sock : -1));
@@ -177,16 +203,17 @@ int input_reserve_key(const char *key, bool exclusive, Client *client)
 void input_release_key(const char *key, Client *client)
 {
 	KeyReservation *kr;
+	IL_node *node;
 
 	debug(RPT_DEBUG, "%s(key=\"%.40s\", client=[%d])", __FUNCTION__, key, (client ? client->sock : -1));
 
-	for (kr = LL_GetFirst(keylist); kr != NULL; kr = LL_GetNext(keylist)) {
+	for (node = IL_First(&keylist); node != NULL; node = IL_Next(&keylist, node)) {
+		kr = IL_ENTRY(node, KeyReservation, link);
 		if ((kr->client == client) && (strcmp(kr->key, key) == 0)) {
 			report(RPT_INFO, "Key \"%.40s\" reserved %s by client [%d] and is now released",
 				key, (kr->exclusive ? "exclusively" : "shared"), (client ? client->sock : -1));
-			free(kr->key);
+			IL_Remove(&keylist, node);
 			free(kr);
-			LL_DeleteNode(keylist, NEXT);
 			return;
 		}
 	}
@@ -195,17 +222,19 @@ void input_release_key(const char *key, Client *client)
 void input_release_client_keys(Client *client)
 {
 	KeyReservation *kr;
+	IL_node *node, *next;
 
 	debug(RPT_DEBUG, "%s(client=[%d])", __FUNCTION__, (client ? client->sock : -1));
 
-	for (kr = LL_GetFirst(keylist); kr != NULL; kr = LL_GetNext(keylist)) {
+	for (node = IL_First(&keylist); node != NULL; node = next) {
+		// get the next node before this one is removed
+		next = IL_Next(&keylist, node);
+		kr = IL_ENTRY(node, KeyReservation, link);
 		if (kr->client == client) {
 			report(RPT_INFO, "Key \"%.40s\" reserved %s by client [%d] and is now released",
 				kr->key, (kr->exclusive ? "exclusively" : "shared"), (client ? client->sock : -1));
-			free(kr->key);
+			IL_Remove(&keylist, node);
 			free(kr);
-			// jump to node before deleted one to not miss any
-			LL_DeleteNode(keylist, PREV);
 		}
 	}
 }
@@ -213,10 +242,12 @@ void input_release_client_keys(Client *client)
 KeyReservation *input_find_key(const char *key, Client *client)
 {
 	KeyReservation *kr;
+	IL_node *node;
 
 	debug(RPT_DEBUG, "%s(key=\"%.40s\", client=[%d])", __FUNCTION__, key, (client?client->sock:-1));
 
-	for (kr = LL_GetFirst(keylist); kr != NULL; kr = LL_GetNext(keylist)) {
+	for (node = IL_First(&keylist); node != NULL; node = IL_Next(&keylist, node)) {
+		kr = IL_ENTRY(node, KeyReservation, link);
 		if (strcmp(kr->key, key) == 0) {
 			if (kr->exclusive || client == kr->client) {
 				return kr;
@@ -19,15 +19,23 @@
 #ifdef HAVE_STDBOOL_H
 # include <stdbool.h>
 #endif
+#include <sys/time.h>
 #include "shared/defines.h"
+#include "shared/IL.h"
 
 /* Accepts and uses keypad input while displaying screens... */
 void handle_input(void);
 
+/* Set when a key handled by the server changed the display, and the time
+ * that key was read. Cleared once the display has been rendered. */
+extern int input_urgent;
+extern struct timeval input_urgent_time;
+
 typedef struct KeyReservation {
-	char *key;
+	char *key;		/* stored behind the reservation */
 	bool exclusive;
 	Client *client;		/* NULL for internal clients */
+	IL_node link;		/* node in the list of reservations */
 } KeyReservation;
 
 
@@ -43,6 +43,7 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <limits.h>
+#include <stddef.h>
 
 #include "getopt.h"
 
@@ -61,6 +62,7 @@
 #include "screenlist.h"
 #include "parse.h"
 #include "render.h"
+#include "timerwheel.h"
 #include "serverscreens.h"
 #include "menuscreens.h"
 #include "input.h"
@@ -74,6 +76,8 @@
 
 #define DEFAULT_BIND_ADDR		"127.0.0.1"
 #define DEFAULT_BIND_PORT		LCDPORT
+#define DEFAULT_UNIX_SOCKET		""	/* none */
+#define DEFAULT_UNIX_SOCKET_MODE	0666
 #define DEFAULT_CONFIGFILE		SYSCONFDIR "/LCDd.conf"
 #define DEFAULT_USER			"nobody"
 #define DEFAULT_DRIVER			"curses"
@@ -131,6 +135,8 @@ int num_drivers = 0;
 /* End of configuration variables */
 
 /* Local variables */
+static char unix_socket[108];
+static int unix_socket_mode = DEFAULT_UNIX_SOCKET_MODE;
 static int foreground_mode = UNSET_INT;
 static int report_dest = UNSET_INT;
 static int report_level = UNSET_INT;
@@ -142,6 +148,12 @@ static volatile short got_reload_signal = 0;
 /* Local exported variables */
 long timer = 0;
 
+/* Key-to-display latency of keys handled by the server */
+static unsigned long key_latency_count = 0;
+static double key_latency_sum = 0;
+static long int key_latency_max = 0;
+static struct timeval last_urgent_render;
+
 /**** Local functions ****/
 static void clear_settings(void);
 static int process_command_line(int argc, char **argv);
@@ -155,6 +167,8 @@ static int init_drivers(void);
 static int drop_privs(char *user);
 static void do_reload(void);
 static void do_mainloop(void);
+static long int render_urgent(void);
+static void key_latency_update(void);
 static void exit_program(int val);
 static void catch_reload_signal(int val);
 static int interpret_boolean_arg(char *s);
@@ -234,7 +248,7 @@ main(int argc, char **argv)
 		/* Only catch SIGHUP if not in foreground mode */
 
 	/* Startup the subparts of the server */
-	CHAIN(e, sock_init(bind_addr, bind_port));
+	CHAIN(e, sock_init(bind_addr, bind_port, unix_socket, unix_socket_mode));
 	CHAIN(e, screenlist_init());
 	CHAIN(e, init_drivers());
 	CHAIN(e, clients_init());
@@ -392,10 +406,52 @@ process_command_line(int argc, char **argv)
 }
 
 
+/** Settings of the [Server] section */
+typedef struct {
+	long int port;
+	const char *bind;
+	const char *unixsocket;
+	long int unixsocketmode;
+	const char *user;
+	double waittime;
+	short foreground;
+	short serverscreen;
+	short backlight;
+	short heartbeat;
+	short autorotate;
+	long int titlespeed;
+	long int frameinterval;
+	short reporttosyslog;
+	long int reportlevel;
+} ServerConfig;
+
+/** Keys of the [Server] section, read at once by config_compile_section() */
+static const ConfigOption server_options[] = {
+	{ .keyname = "Port",           .type = CONFIG_TYPE_INT,      .offset = offsetof(ServerConfig, port),           .default_int = UNSET_INT },
+	{ .keyname = "Bind",           .type = CONFIG_TYPE_STRING,   .offset = offsetof(ServerConfig, bind),           .default_string = UNSET_STR },
+	{ .keyname = "UnixSocket",     .type = CONFIG_TYPE_STRING,   .offset = offsetof(ServerConfig, unixsocket),     .default_string = DEFAULT_UNIX_SOCKET },
+	{ .keyname = "UnixSocketMode", .type = CONFIG_TYPE_INT,      .offset = offsetof(ServerConfig, unixsocketmode), .default_int = DEFAULT_UNIX_SOCKET_MODE },
+	{ .keyname = "User",           .type = CONFIG_TYPE_STRING,   .offset = offsetof(ServerConfig, user),           .default_string = UNSET_STR },
+	{ .keyname = "WaitTime",       .type = CONFIG_TYPE_FLOAT,    .offset = offsetof(ServerConfig, waittime),       .default_float = 0 },
+	{ .keyname = "Foreground",     .type = CONFIG_TYPE_BOOL,     .offset = offsetof(ServerConfig, foreground),     .default_int = UNSET_INT },
+	{ .keyname = "ServerScreen",   .type = CONFIG_TYPE_TRISTATE, .offset = offsetof(ServerConfig, serverscreen),   .default_int = UNSET_INT, .name3rd = "blank" },
+	{ .keyname = "Backlight",      .type = CONFIG_TYPE_TRISTATE, .offset = offsetof(ServerConfig, backlight),      .default_int = UNSET_INT, .name3rd = "open" },
+	{ .keyname = "Heartbeat",      .type = CONFIG_TYPE_TRISTATE, .offset = offsetof(ServerConfig, heartbeat),      .default_int = UNSET_INT, .name3rd = "open" },
+	{ .keyname = "AutoRotate",     .type = CONFIG_TYPE_BOOL,     .offset = offsetof(ServerConfig, autorotate),     .default_int = DEFAULT_AUTOROTATE },
+	{ .keyname = "TitleSpeed",     .type = CONFIG_TYPE_INT,      .offset = offsetof(ServerConfig, titlespeed),     .default_int = DEFAULT_TITLESPEED },
+	{ .keyname = "FrameInterval",  .type = CONFIG_TYPE_INT,      .offset = offsetof(ServerConfig, frameinterval),  .default_int = DEFAULT_FRAME_INTERVAL },
+	{ .keyname = "ReportToSyslog", .type = CONFIG_TYPE_BOOL,     .offset = offsetof(ServerConfig, reporttosyslog), .default_int = UNSET_INT },
+	{ .keyname = "ReportLevel",    .type = CONFIG_TYPE_INT,      .offset = offsetof(ServerConfig, reportlevel),    .default_int = UNSET_INT },
+	{ .keyname = NULL }
+};
+
+
 /* reads and parses configuration file */
 static int
 process_configfile(char *configfile)
 {
+	ServerConfig cfg;
+
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
 	/* Read server settings*/
@@ -405,17 +461,24 @@ process_configfile(char *configfile)
 		return -1;
 	}
 
+	if (config_compile_section("Server", server_options, &cfg) < 0)
+		return -1;
+
 	if (bind_port == UNSET_INT)
-		bind_port = config_get_int("Server", "Port", 0, UNSET_INT);
+		bind_port = cfg.port;
 
 	if (strcmp(bind_addr, UNSET_STR) == 0)
-		strncpy(bind_addr, config_get_string("Server", "Bind", 0, UNSET_STR), sizeof(bind_addr));
+		strncpy(bind_addr, cfg.bind, sizeof(bind_addr));
+
+	strncpy(unix_socket, cfg.unixsocket, sizeof(unix_socket));
+	unix_socket[sizeof(unix_socket) - 1] = '\0';
+	unix_socket_mode = cfg.unixsocketmode;
 
 	if (strcmp(user, UNSET_STR) == 0)
-		strncpy(user, config_get_string("Server", "User", 0, UNSET_STR), sizeof(user));
+		strncpy(user, cfg.user, sizeof(user));
 
 	if (default_duration == UNSET_INT) {
-		default_duration = (config_get_float("Server", "WaitTime", 0, 0) * 1e6 / frame_interval);
+		default_duration = (cfg.waittime * 1e6 / frame_interval);
 		if (default_duration == 0)
 			default_duration = UNSET_INT;
 		else if (default_duration * frame_interval < 2e6) {
@@ -425,47 +488,41 @@ process_configfile(char *configfile)
 	}
 
 	if (foreground_mode == UNSET_INT) {
-		int fg = config_get_bool("Server", "Foreground", 0, UNSET_INT);
-
-		if (fg != UNSET_INT)
-			foreground_mode = fg;
+		if (cfg.foreground != UNSET_INT)
+			foreground_mode = cfg.foreground;
 	}
 
 	if (rotate_server_screen == UNSET_INT) {
-		rotate_server_screen = config_get_tristate("Server", "ServerScreen", 0, "blank", UNSET_INT);
+		rotate_server_screen = cfg.serverscreen;
 	}
 
 	if (backlight == UNSET_INT) {
-		backlight = config_get_tristate("Server", "Backlight", 0, "open", UNSET_INT);
+		backlight = cfg.backlight;
 	}
 
 	if (heartbeat == UNSET_INT) {
-		heartbeat = config_get_tristate("Server", "Heartbeat", 0, "open", UNSET_INT);
+		heartbeat = cfg.heartbeat;
 	}
 
 	if (autorotate == UNSET_INT) {
-		autorotate = config_get_bool("Server", "AutoRotate", 0, DEFAULT_AUTOROTATE);
+		autorotate = cfg.autorotate;
 	}
 
 	if (titlespeed == UNSET_INT) {
-		int speed = config_get_int("Server", "TitleSpeed", 0, DEFAULT_TITLESPEED);
-
 		/* set titlespeed */
-		titlespeed = (speed <= TITLESPEED_NO)
+		titlespeed = (cfg.titlespeed <= TITLESPEED_NO)
 			     ? TITLESPEED_NO
-			     : min(speed, TITLESPEED_MAX);
+			     : min(cfg.titlespeed, TITLESPEED_MAX);
 	}
 
-	frame_interval = config_get_int("Server", "FrameInterval", 0, DEFAULT_FRAME_INTERVAL);
+	frame_interval = cfg.frameinterval;
 
 	if (report_dest == UNSET_INT) {
-		int rs = config_get_bool("Server", "ReportToSyslog", 0, UNSET_INT);
-
-		if (rs != UNSET_INT)
-			report_dest = (rs) ? RPT_DEST_SYSLOG : RPT_DEST_STDERR;
+		if (cfg.reporttosyslog != UNSET_INT)
+			report_dest = (cfg.reporttosyslog) ? RPT_DEST_SYSLOG : RPT_DEST_STDERR;
 	}
 	if (report_level == UNSET_INT) {
-		report_level = config_get_int("Server", "ReportLevel", 0, UNSET_INT);
+		report_level = cfg.reportlevel;
 	}
 
 
@@ -701,6 +758,9 @@ drop_privs(char *user)
 			report(RPT_ERR, "User %.40s not a valid user!", user);
 			return -1;
 		} else {
+			/* The socket file may not be ours to remove later */
+			if (pwent->pw_uid != 0)
+				sock_unlink_on_exit();
 			if (setuid(pwent->pw_uid) < 0) {
 				report(RPT_ERR, "Unable to switch to user %.40s", user);
 				return -1;
@@ -740,6 +800,7 @@ do_reload(void)
 
 	/* And restart the drivers */
 	CHAIN(e, init_drivers());
+	CHAIN(e, (render_invalidate(), 0));
 	CHAIN_END(e, "Critical error while reloading, abort.");
 }
 
@@ -789,6 +850,7 @@ do_mainloop(void)
 		if (render_lag > 0) {
 			/* Time for a rendering stroke */
 			timer ++;
+			timerwheel_advance(timer);
 			screenlist_process();
 			s = screenlist_current();
 
@@ -798,7 +860,11 @@ do_mainloop(void)
 			if (s == server_screen) {
 				update_server_screen();
 			}
-			render_screen(s, timer);
+			/* Skip the frame if nothing on the display would change */
+			if (input_urgent || render_needed(s)) {
+				render_screen(s, timer);
+				key_latency_update();
+			}
 
 			/* We've done the job... */
 			if (render_lag > frame_interval * MAX_RENDER_LAG_FRAMES) {
@@ -809,10 +875,14 @@ do_mainloop(void)
 			/* Note: this DOES make a fixed frequency (except with slowdown) */
 		}
 
-		/* Sleep just as long as needed */
+		/* Sleep just as long as needed, but handle driver input at once */
 		sleeptime = min(0-process_lag, 0-render_lag);
-		if (sleeptime > 0) {
-			usleep(sleeptime);
+		if (input_urgent) {
+			/* Show the effect of keys without waiting for the next frame */
+			sleeptime = min(sleeptime, render_urgent());
+		}
+		if (drivers_wait_input(max(sleeptime, 0)) > 0) {
+			handle_input();
 		}
 
 		/* Check if a SIGHUP has been caught */
@@ -827,6 +897,89 @@ do_mainloop(void)
 }
 
 
+/**
+ * Render the current screen between two rendering strokes, after a key
+ * handled by the server changed the display. Urgent renders are at least
+ * URGENT_RENDER_INTERVAL apart, so key repeat cannot keep the server from
+ * processing client messages.
+ * \return  Time in microseconds until the next urgent render is allowed,
+ *          or 0 if the screen was rendered.
+ */
+static long int
+render_urgent(void)
+{
+	struct timeval now;
+	long int since;
+	Screen *s;
+
+	gettimeofday(&now, NULL);
+	since = (now.tv_sec - last_urgent_render.tv_sec) * 1000000L
+		+ (now.tv_usec - last_urgent_render.tv_usec);
+	if ((since >= 0) && (since < URGENT_RENDER_INTERVAL))
+		return URGENT_RENDER_INTERVAL - since;
+	last_urgent_render = now;
+
+	/* the key may have opened or closed the menu */
+	screenlist_switch_priority();
+	s = screenlist_current();
+	if (s == NULL) {
+		input_urgent = 0;
+		return 0;
+	}
+	if (s == server_screen) {
+		update_server_screen();
+	}
+	/* Same timer: animations do not advance, the drivers only send what changed */
+	render_screen(s, timer);
+	key_latency_update();
+
+	return 0;
+}
+
+
+/**
+ * Account for the keys handled by the server whose effect has just been
+ * rendered: update the key-to-display latency statistics.
+ */
+static void
+key_latency_update(void)
+{
+	struct timeval now;
+	long int latency;
+
+	if (!input_urgent)
+		return;
+	input_urgent = 0;
+
+	gettimeofday(&now, NULL);
+	latency = (now.tv_sec - input_urgent_time.tv_sec) * 1000000L
+		  + (now.tv_usec - input_urgent_time.tv_usec);
+
+	key_latency_count++;
+	key_latency_sum += latency;
+	if (latency > key_latency_max)
+		key_latency_max = latency;
+
+	debug(RPT_DEBUG, "%s: key-to-display latency %ld us", __FUNCTION__, latency);
+}
+
+
+/**
+ * Get the key-to-display latency statistics of the keys handled by the
+ * server.
+ * \param count  Number of keys measured.
+ * \param avg    Average latency in microseconds.
+ * \param max    Largest latency in microseconds.
+ */
+void
+key_latency_get(unsigned long *count, long int *avg, long int *max)
+{
+	*count = key_latency_count;
+	*avg = (key_latency_count > 0) ? (long int) (key_latency_sum / key_latency_count) : 0;
+	*max = key_latency_max;
+}
+
+
 static void
 exit_program(int val)
 {
@@ -850,6 +1003,11 @@ exit_program(int val)
 		report(RPT_NOTICE, buf);	/* report it */
 	}
 
+	if (key_latency_count > 0) {
+		report(RPT_NOTICE, "Key-to-display latency: %lu keys, avg %.0f us, max %ld us",
+		       key_latency_count, key_latency_sum / key_latency_count, key_latency_max);
+	}
+
 	/* Set emergency reporting and flush all messages if not done already. */
 	if (report_level == UNSET_INT)
 		report_level = DEFAULT_REPORTLEVEL;
@@ -32,6 +32,9 @@ extern char *build_date;
 #define MAX_RENDER_LAG_FRAMES 16
 /* Allow the rendering strokes to lag behind this many frames.
  * More lag will not be corrected, but will cause slow-down. */
+#define URGENT_RENDER_INTERVAL (1e6/PROCESS_FREQ)
+/* Keys handled by the server are rendered at once, but not more often than
+ * this (in microseconds), so key repeat cannot starve client processing. */
 
 extern long timer;
 /* 32 bits at 8Hz will overflow in 2 ^ 29 = 5e8 seconds = 17 years.
@@ -56,6 +59,9 @@ extern int num_drivers;
 
 /* End of configuration variables */
 
+/* Key-to-display latency of the keys handled by the server */
+void key_latency_get(unsigned long *count, long int *avg, long int *max);
+
 /* Defines for having 'unset' values*/
 #define UNSET_INT	-1
 #define UNSET_STR	"\01"
@@ -846,6 +846,7 @@ void menuitem_update_screen(MenuItem *item, Screen *s)
 
 	if ((item == NULL) || (s == NULL))
 		return;
+	screen_touch(s);
 
 	/* Disable the cursor by default */
 	s->cursor = CURSOR_OFF;
@@ -18,13 +18,18 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "shared/LL.h"
 #include "shared/sockets.h"
 #include "shared/report.h"
+#include "shared/lcdbinary.h"
 #include "clients.h"
+#include "screen.h"
 #include "commands/command_list.h"
+#include "main.h"
 #include "parse.h"
+#include "binproto.h"
 #include "sock.h"
 
 #define MAX_ARGUMENTS 40
@@ -196,27 +201,169 @@ static void parse_message(const char *str, Client *c)
 }
 
 
+/**
+ * Execute a binary frame (see shared/lcdbinary.h).
+ * \param frame  The frame, followed by a NUL byte.
+ * \param c      The client that sent it.
+ */
+static void
+parse_frame(const char *frame, Client *c)
+{
+	int len = LCDB_GET16(frame) - 1;
+	const char *payload = frame + LCDB_HEADER_SIZE;
+
+	switch ((unsigned char) frame[2]) {
+	case LCDB_OP_COMMAND:
+		/* empty commands keep the connection alive, like empty lines */
+		if (len > 0)
+			parse_message(payload, c);
+		break;
+	case LCDB_OP_WIDGET_TEXT:
+		binproto_widget_text(c, payload, len);
+		break;
+	case LCDB_OP_WIDGET_VALUE:
+		binproto_widget_value(c, payload, len);
+		break;
+	default:
+		sock_printf_error(c->sock, "Unknown opcode %d\n", (unsigned char) frame[2]);
+		break;
+	}
+}
+
+
+/**
+ * Get the number of messages a client may send in one processing stroke.
+ * Clients showing screens of higher priority get a larger share.
+ * \param c  The client.
+ * \return  Message budget of the client.
+ */
+static int
+parse_client_budget(Client *c)
+{
+	int priority = client_get_priority(c);
+
+	if (priority >= PRI_ALERT)
+		return PARSE_CLIENT_BUDGET * 4;
+	if (priority == PRI_FOREGROUND)
+		return PARSE_CLIENT_BUDGET * 2;
+	return PARSE_CLIENT_BUDGET;
+}
+
+
+/**
+ * Parse the messages of all clients. Clients are served round-robin in
+ * slices of PARSE_CLIENT_SLICE messages, each one up to its budget, so one
+ * busy client cannot hold back the others. When all budgets are used up
+ * and time is left, the budgets are handed out again. The stroke ends after
+ * PARSE_TIME_BUDGET microseconds; messages not parsed stay queued for the
+ * next stroke.
+ */
 void
 parse_all_client_messages(void)
 {
+	static Client **order = NULL;
+	static int order_size = 0;
+	static int rotation = 0;
+	struct timeval start, now;
+	int count, first, i;
+	int parsed, starved;
 	Client *c;
 
 	debug(RPT_DEBUG, "%s()", __FUNCTION__);
 
-	for (c = clients_getfirst(); c != NULL; c = clients_getnext()) {
-		char *str;
+	count = clients_client_count();
+	if (count <= 0)
+		return;
+
+	/* Take a snapshot of the clients; new ones only arrive in sock_poll_clients() */
+	if (count > order_size) {
+		Client **tmp = realloc(order, count * sizeof(Client *));
+
+		if (tmp == NULL) {
+			report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+			return;
+		}
+		order = tmp;
+		order_size = count;
+	}
+	i = 0;
+	for (c = clients_getfirst(); (c != NULL) && (i < count); c = clients_getnext()) {
+		c->msg_budget = parse_client_budget(c);
+		order[i++] = c;
+	}
+	count = i;
+
+	/* Start with another client each stroke */
+	first = rotation++ % count;
+
+	gettimeofday(&start, NULL);
+	while (1) {
+		parsed = 0;
+		starved = 0;
 
-		/* And parse all its messages...*/
-		for (str = client_get_message(c); str != NULL; str = client_get_message(c)) {
-			parse_message(str, c);
-			free(str);
+		for (i = 0; i < count; i++) {
+			int slice = PARSE_CLIENT_SLICE;
+			char *str;
 
-			if (c->state == GONE) {
-				sock_destroy_client_socket(c);
+			c = order[(first + i) % count];
+			if (c == NULL)
+				continue;
+
+			/* And parse a slice of its messages...*/
+			while ((slice-- > 0) && (c->msg_budget > 0)
+			       && ((str = client_get_message(c)) != NULL)) {
+				/* binary frames are marked by a leading NUL */
+				if (str[0] == '\0')
+					parse_frame(str + 1, c);
+				else
+					parse_message(str, c);
+				client_free_message(str);
+				c->msg_budget--;
+				c->msg_count++;
+				parsed++;
+
+				if (c->state == GONE) {
+					sock_destroy_client_socket(c);
+					order[(first + i) % count] = NULL;
+					c = NULL;
+					break;
+				}
+			}
+			if ((c != NULL) && (c->msg_budget <= 0) && (IL_Length(&c->messages) > 0))
+				starved++;
+		}
+
+		gettimeofday(&now, NULL);
+		if ((now.tv_sec - start.tv_sec) * 1000000L
+		    + (now.tv_usec - start.tv_usec) >= PARSE_TIME_BUDGET)
+			break;
+
+		if (parsed == 0) {
+			if (starved == 0)
 				break;
+			/* Time is left, hand out the budgets again */
+			for (i = 0; i < count; i++) {
+				if (order[i] != NULL)
+					order[i]->msg_budget = parse_client_budget(order[i]);
 			}
 		}
 	}
+
+	/* Remember what is left for the next stroke */
+	for (i = 0; i < count; i++) {
+		c = order[i];
+		if (c == NULL)
+			continue;
+
+		c->backlog = IL_Length(&c->messages);
+		if (c->backlog > 0) {
+			c->msg_deferred++;
+			if (c->backlog > c->backlog_max)
+				c->backlog_max = c->backlog;
+			debug(RPT_DEBUG, "%s: client on socket %i has %i messages left",
+				__FUNCTION__, c->sock, c->backlog);
+		}
+	}
 }
 
 
@@ -12,6 +12,13 @@
 #ifndef PARSE_H
 #define PARSE_H
 
+/** Messages a client may send per processing stroke (more for high priority) */
+#define PARSE_CLIENT_BUDGET	64
+/** Messages parsed of one client before the next one gets its turn */
+#define PARSE_CLIENT_SLICE	8
+/** Max. time in microseconds spent parsing messages per processing stroke */
+#define PARSE_TIME_BUDGET	(1e6/PROCESS_FREQ/2)
+
 // This should be pretty self-explanatory...
 void parse_all_client_messages(void);
 
@@ -36,16 +36,20 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 
 #include "shared/report.h"
 #include "shared/LL.h"
 #include "shared/defines.h"
 
+#include "main.h" /* for frame_interval */
 #include "drivers.h"
 #include "screen.h"
 #include "screenlist.h"
 #include "widget.h"
 #include "render.h"
+#include "cellbuf.h"
+#include "timerwheel.h"
 
 #define BUFSIZE 1024	/* larger than display width => large enough */
 
@@ -61,15 +65,45 @@ int output_state = 0;
 char *server_msg_text;
 int server_msg_expire = 0;
 
+/** Set while rendering a frame if its contents depend on the timer */
+static int frame_animated = 0;
 
-static void render_frame(LinkedList *list, int left, int top, int right, int bottom, int fwid, int fhgt, char fscroll, int fspeed, long timer);
-static void render_string(Widget *w, int left, int top, int right, int bottom, int fy);
+/** First frame in which the output may change with the timer; collected
+ * while rendering a frame */
+static long next_change;
+
+/** Due when the display has to be rendered again without any change */
+static TimerEntry render_timer;
+static int render_due = 1;
+
+/** What the last frame was rendered from */
+static struct {
+	Screen *screen;
+	unsigned int version;
+	int backlight;
+	int heartbeat;
+	int output;
+	int cursor, cursor_x, cursor_y;
+} last_render;
+
+
+static void render_frame(IntrusiveList *list, int left, int top, int right, int bottom, int fwid, int fhgt, char fscroll, int fspeed, long timer);
+static void render_string(Widget *w, int left, int top, int right, int bottom, int fy, int fx);
 static void render_hbar(Widget *w, int left, int top, int right, int bottom, int fy);
 static void render_vbar(Widget *w, int left, int top, int right, int bottom);
 static void render_pbar(Widget *w, int left, int top, int right, int bottom);
 static void render_title(Widget *w, int left, int top, int right, int bottom, long timer);
 static void render_scroller(Widget *w, int left, int top, int right, int bottom, long timer);
 static void render_num(Widget *w, int left, int top, int right, int bottom);
+static int render_cached(Screen *s);
+static WidgetAnim *widget_anim(Widget *w, int width, char direction);
+static int scroll_offset(long timer, int speed, int range);
+static int render_backlight_state(Screen *s);
+static int render_heartbeat_state(Screen *s);
+static void render_schedule(Screen *s, long timer);
+static void animate_period(long timer, int period);
+static void animate_toggle(long timer, long mask, long value);
+static void render_after(long timer, long usecs);
 
 
 /**
@@ -78,19 +112,23 @@ static void render_num(Widget *w, int left, int top, int right, int bottom);
  * \li  Clear the screen.
  * \li  Set the backlight.
  * \li  Set out-of-band data (output).
- * \li  Render the frame contents.
+ * \li  Render the frame contents, or copy them from the screen's cached
+ *      frame if the screen did not change since it was composed.
  * \li  Set the cursor.
  * \li  Draw the heartbeat.
  * \li  Show any server message.
  * \li  Flush all output to screen.
  *
  * \param s      The screen to render.
- * \param timer  A value increased with every call.
+ * \param timer  A value increased with every frame; the same value may be
+ *               passed again to render a frame anew, e.g. after a key press.
  * \return  -1 on error, 0 on success.
  */
 int
 render_screen(Screen *s, long timer)
 {
+	static long last_timer = -1;
+	int new_frame = (timer != last_timer);
 	int tmp_state = 0;
 
 	debug(RPT_DEBUG, "%s(screen=[%.40s], timer=%ld)  ==== START RENDERING ====", __FUNCTION__, s->id, timer);
@@ -102,27 +140,8 @@ render_screen(Screen *s, long timer)
 	drivers_clear();
 
 	/* 2. Set up the backlight */
-	/*-
-	 * 2.1:
-	 * First we find out who has set the backlight:
-	 *   a) the screen,
-	 *   b) the client, or
-	 *   c) the server core
-	 * with the latter taking precedence over the earlier. If the
-	 * backlight is not set on/off then use the fallback (set it ON).
-	 */
-	if (backlight != BACKLIGHT_OPEN) {
-		tmp_state = backlight;
-	}
-	else if ((s->client != NULL) && (s->client->backlight != BACKLIGHT_OPEN)) {
-		tmp_state = s->client->backlight;
-	}
-	else if (s->backlight != BACKLIGHT_OPEN) {
-		tmp_state = s->backlight;
-	}
-	else {
-		tmp_state = backlight_fallback;
-	}
+	/* 2.1: Find out who has set the backlight */
+	tmp_state = render_backlight_state(s);
 
 	/*-
 	 * 2.2:
@@ -155,33 +174,33 @@ render_screen(Screen *s, long timer)
 	drivers_output(output_state);
 
 	/* 4. Draw a frame... */
-	render_frame(s->widgetlist, 0, 0,
-			display_props->width, display_props->height,
-			s->width, s->height, 'v', max(s->duration / s->height, 1), timer);
+	next_change = LONG_MAX;
+	if (!render_cached(s)) {
+		frame_animated = 0;
+		render_frame(&s->widgetlist, 0, 0,
+				display_props->width, display_props->height,
+				s->width, s->height, 'v', max(s->duration / s->height, 1), timer);
+
+		/* ...and keep it unless it changes with the timer */
+		if (!frame_animated && (cellbuf_save(&s->frame) == 0))
+			s->frame_version = s->version;
+		else
+			s->frame_version = 0;
+	}
 
 	/* 5. Set the cursor */
 	drivers_cursor(s->cursor_x, s->cursor_y, s->cursor);
 
 	/* 6. Set the heartbeat */
-	if (heartbeat != HEARTBEAT_OPEN) {
-		tmp_state = heartbeat;
-	}
-	else if ((s->client != NULL) && (s->client->heartbeat != HEARTBEAT_OPEN)) {
-		tmp_state = s->client->heartbeat;
-	}
-	else if (s->heartbeat != HEARTBEAT_OPEN) {
-		tmp_state = s->heartbeat;
-	}
-	else {
-		tmp_state = heartbeat_fallback;
-	}
+	tmp_state = render_heartbeat_state(s);
 	drivers_heartbeat(tmp_state);
 
 	/* 7. If there is an server message that is not expired, display it */
 	if (server_msg_expire > 0) {
 		drivers_string(display_props->width - strlen(server_msg_text) + 1,
 				display_props->height, server_msg_text);
-		server_msg_expire--;
+		if (new_frame)
+			server_msg_expire--;
 		if (server_msg_expire == 0) {
 			free(server_msg_text);
 		}
@@ -189,17 +208,253 @@ render_screen(Screen *s, long timer)
 
 	/* 8. Flush display out, frame and all... */
 	drivers_flush();
+	last_timer = timer;
+	render_schedule(s, timer);
 
 	debug(RPT_DEBUG, "==== END RENDERING ====");
 	return 0;
 
 }
 
+/**
+ * Find out who has set the backlight:
+ *   a) the screen,
+ *   b) the client, or
+ *   c) the server core
+ * with the latter taking precedence over the earlier. If the
+ * backlight is not set on/off then use the fallback (set it ON).
+ * \param s  The screen to render.
+ * \return  The backlight state, including FLASH or BLINK.
+ */
+static int
+render_backlight_state(Screen *s)
+{
+	if (backlight != BACKLIGHT_OPEN)
+		return backlight;
+	if ((s->client != NULL) && (s->client->backlight != BACKLIGHT_OPEN))
+		return s->client->backlight;
+	if (s->backlight != BACKLIGHT_OPEN)
+		return s->backlight;
+	return backlight_fallback;
+}
+
+
+/**
+ * Find out who has set the heartbeat, in the same order as the backlight.
+ * \param s  The screen to render.
+ * \return  The heartbeat state.
+ */
+static int
+render_heartbeat_state(Screen *s)
+{
+	if (heartbeat != HEARTBEAT_OPEN)
+		return heartbeat;
+	if ((s->client != NULL) && (s->client->heartbeat != HEARTBEAT_OPEN))
+		return s->client->heartbeat;
+	if (s->heartbeat != HEARTBEAT_OPEN)
+		return s->heartbeat;
+	return heartbeat_fallback;
+}
+
+
+static void
+render_timer_due(TimerEntry *t)
+{
+	render_due = 1;
+}
+
+
+/**
+ * Remember what a frame was rendered from, and set the timer for the first
+ * frame in which the output changes with the timer alone, or a driver
+ * left out of the flush or refreshed while idle is due (see drivers.c).
+ * \param s      The screen that was rendered.
+ * \param timer  The timer the frame was rendered for.
+ */
+static void
+render_schedule(Screen *s, long timer)
+{
+	int state;
+	Driver *drv;
+
+	last_render.screen = s;
+	last_render.version = s->version;
+	last_render.backlight = render_backlight_state(s);
+	last_render.heartbeat = render_heartbeat_state(s);
+	last_render.output = output_state;
+	last_render.cursor = s->cursor;
+	last_render.cursor_x = s->cursor_x;
+	last_render.cursor_y = s->cursor_y;
+
+	/* Backlight flash and blink */
+	state = last_render.backlight;
+	if (state & BACKLIGHT_FLASH)
+		animate_toggle(timer, 7, 7);
+	else if (state & BACKLIGHT_BLINK)
+		animate_toggle(timer, 14, 14);
+
+	/* The cursor blinks if the driver leaves it to the server core */
+	if ((s->cursor == CURSOR_DEFAULT_ON) || (s->cursor == CURSOR_BLOCK)
+	    || (s->cursor == CURSOR_UNDER))
+		animate_toggle(timer, 2, 2);
+
+	/* The heartbeat of the server core beats with the timer; drivers
+	 * doing it themselves may count the frames */
+	if (last_render.heartbeat != HEARTBEAT_OFF) {
+		animate_toggle(timer, 5, 0);
+		for (drv = drivers_getfirst(); drv != NULL; drv = drivers_getnext()) {
+			if (drv->heartbeat != NULL)
+				animate_period(timer, 1);
+		}
+	}
+
+	/* Drivers left out of the flush, and drivers refreshed while idle */
+	render_after(timer, drivers_catch_up_time());
+	render_after(timer, drivers_idle_interval());
+
+	render_due = 0;
+	if (render_timer.callback == NULL)
+		timerwheel_init_entry(&render_timer, render_timer_due, NULL);
+	if (next_change != LONG_MAX)
+		timerwheel_add(&render_timer, next_change);
+	else
+		timerwheel_remove(&render_timer);
+}
+
+
+/**
+ * Note that the display has to be rendered again after some time, in the
+ * first frame that is not earlier.
+ * \param timer  The timer of the frame being rendered.
+ * \param usecs  Time in microseconds, or -1 for never.
+ */
+static void
+render_after(long timer, long usecs)
+{
+	if (usecs < 0)
+		return;
+	next_change = min(next_change,
+			  timer + max((usecs + frame_interval - 1) / frame_interval, 1));
+}
+
+
+/**
+ * Check whether the display needs to be rendered in this frame: because
+ * the screen, its widgets or the global states changed since the last
+ * frame, or because the output changes with the timer.
+ * \param s  The screen to render.
+ * \return  1 if the screen is to be rendered, 0 if it would not change.
+ */
+int
+render_needed(Screen *s)
+{
+	Widget *w;
+
+	if (s == NULL)
+		return 0;
+	if (render_due || (server_msg_expire > 0))
+		return 1;
+	if ((s != last_render.screen) || (s->version != last_render.version))
+		return 1;
+
+	/* Shared memory slots are only read when the widgets are applied */
+	for (w = screen_getfirst_widget(s); w != NULL; w = screen_getnext_widget(s, w))
+		widget_apply_pending(w);
+
+	return ((s->version != last_render.version)
+		|| (render_backlight_state(s) != last_render.backlight)
+		|| (render_heartbeat_state(s) != last_render.heartbeat)
+		|| (output_state != last_render.output)
+		|| (s->cursor != last_render.cursor)
+		|| (s->cursor_x != last_render.cursor_x)
+		|| (s->cursor_y != last_render.cursor_y));
+}
+
+
+/**
+ * Have the display rendered in the next frame, e.g. after the drivers were
+ * loaded anew.
+ */
+void
+render_invalidate(void)
+{
+	render_due = 1;
+}
+
+
+/**
+ * Note that the output changes in the next frame whose timer is a multiple
+ * of the period, or one less: the animations divide the timer by their
+ * speed, rounding down or towards zero.
+ * \param timer   The timer of the frame being rendered.
+ * \param period  Number of frames; 1 means every frame.
+ */
+static void
+animate_period(long timer, int period)
+{
+	long r;
+
+	if (period < 1)
+		period = 1;
+	r = timer % period;
+	next_change = min(next_change, timer + ((r < period - 1) ? period - 1 - r : 1));
+}
+
+
+/**
+ * Note the next frame in which the state (timer & mask) == value flips.
+ * \param timer  The timer of the frame being rendered.
+ * \param mask   Bits of the timer tested.
+ * \param value  Value compared with.
+ */
+static void
+animate_toggle(long timer, long mask, long value)
+{
+	int state = ((timer & mask) == value);
+	long t;
+
+	for (t = timer + 1; t <= timer + 2 * (mask + 1); t++) {
+		if (((t & mask) == value) != state) {
+			next_change = min(next_change, t);
+			return;
+		}
+	}
+}
+
+
+/**
+ * Copy the frame contents of a screen from its cache, if the screen and its
+ * widgets did not change since the frame was composed. Screens whose frame
+ * depends on the timer (scrolling titles, scrollers, frames) are never
+ * cached.
+ * \param s  The screen to render.
+ * \return  1 if the frame was copied, 0 if it has to be rendered.
+ */
+static int
+render_cached(Screen *s)
+{
+	Widget *w;
+
+	if ((s->frame == NULL) || (s->frame_version != s->version))
+		return 0;
+
+	/* Pending updates touch the screen when they are set, but shared
+	 * memory slots are only read here */
+	for (w = screen_getfirst_widget(s); w != NULL; w = screen_getnext_widget(s, w))
+		widget_apply_pending(w);
+
+	if (s->frame_version != s->version)
+		return 0;
+
+	return (cellbuf_restore(s->frame) == 0);
+}
+
+
 /* The following function is positively ghastly (as was mentioned above!) */
 /* Best thing to do is to remove support for frames... but anyway... */
 /* */
 static void
-render_frame(LinkedList *list,
+render_frame(IntrusiveList *list,
 		int left,	/* left edge of frame */
 		int top,	/* top edge of frame */
 		int right,	/* right edge of frame */
@@ -211,6 +466,8 @@ render_frame(LinkedList *list,
 		long timer)	/* current timer tick */
 {
 	int fy = 0;		/* Scrolling offset for the frame... */
+	int fx = 0;
+	IL_node *node;
 
 	debug(RPT_DEBUG, "%s(list=%p, left=%d, top=%d, "
 			  "right=%d, bottom=%d, fwid=%d, fhgt=%d, "
@@ -225,44 +482,46 @@ render_frame(LinkedList *list,
 	if (fscroll == 'v') {		/* vertical scrolling */
 		// only set offset !=0 when fspeed is != 0 and there is something to scroll
 		if ((fspeed != 0) && (fhgt > bottom - top)) {
-			int fy_max = fhgt - (bottom - top) + 1;
-
-			fy = (fspeed > 0)
-			     ? (timer / fspeed) % fy_max
-			     : (-fspeed * timer) % fy_max;
-
-			fy = max(fy, 0);	// safeguard against negative values
+			fy = scroll_offset(timer, fspeed, fhgt - (bottom - top) + 1);
+			frame_animated = 1;
+			animate_period(timer, (fspeed > 0) ? fspeed : 1);
 
 			debug(RPT_DEBUG, "%s: fy=%d", __FUNCTION__, fy);
 		}
 	}
 	else if (fscroll == 'h') {	/* horizontal scrolling */
-		/* TODO:  Frames don't scroll horizontally yet! */
-	}
+		/* same as vertical scrolling, column by column */
+		if ((fspeed != 0) && (fwid > right - left)) {
+			fx = scroll_offset(timer, fspeed, fwid - (right - left) + 1);
+			frame_animated = 1;
+			animate_period(timer, (fspeed > 0) ? fspeed : 1);
 
-	/* reset widget list */
-	LL_Rewind(list);
+			debug(RPT_DEBUG, "%s: fx=%d", __FUNCTION__, fx);
+		}
+	}
 
 	/* loop over all widgets */
-	do {
-		Widget *w = (Widget *) LL_Get(list);
+	for (node = IL_First(list); node != NULL; node = IL_Next(list, node)) {
+		Widget *w = IL_ENTRY(node, Widget, link);
 
-		if (w == NULL)
-			return;
+		/* Updates of a widget since the last frame only take effect now */
+		widget_apply_pending(w);
 
 		/* TODO:  Make this cleaner and more flexible! */
 		switch (w->type) {
 		case WID_STRING:
-			render_string(w, left, top - fy, right, bottom, fy);
+			render_string(w, left, top - fy, right, bottom, fy, fx);
 			break;
-		case WID_HBAR:
-			render_hbar(w, left, top - fy, right, bottom, fy);
+		case WID_HBAR:	  /* only shown while its start is visible */
+			if (w->x > fx)
+				render_hbar(w, left - fx, top - fy, right, bottom, fy);
 			break;
 		case WID_VBAR:	  /* FIXME:  Vbars don't work in frames! */
 			render_vbar(w, left, top, right, bottom);
 			break;
 		case WID_PBAR:
-			render_pbar(w, left, top - fy, right, bottom);
+			if (w->x > fx)
+				render_pbar(w, left - fx, top - fy, right, bottom);
 			break;
 		case WID_ICON:	  /* FIXME:  Icons don't work in frames! */
 			drivers_icon(w->x, w->y, w->length);
@@ -283,8 +542,12 @@ render_frame(LinkedList *list,
 				int new_right = min(left + w->right, right);
 				int new_bottom = min(top + w->bottom, bottom);
 
+				/* the widgets inside are not watched for changes */
+				frame_animated = 1;
+				animate_period(timer, 1);
+
 				if ((new_left < right) && (new_top < bottom))	/* Render only if it's visible... */
-					render_frame(w->frame_screen->widgetlist, new_left, new_top,
+					render_frame(&w->frame_screen->widgetlist, new_left, new_top,
 							new_right, new_bottom, w->width, w->height,
 							w->length, w->speed, timer);
 			}
@@ -300,18 +563,34 @@ render_frame(LinkedList *list,
 		default:
 			break;
 		}
-	} while (LL_Next(list) == 0);
+	}
 }
 
 
 static void
-render_string(Widget *w, int left, int top, int right, int bottom, int fy)
+render_string(Widget *w, int left, int top, int right, int bottom, int fy, int fx)
 {
-	debug(RPT_DEBUG, "%s(w=%p, left=%d, top=%d, right=%d, bottom=%d, fy=%d)",
-			  __FUNCTION__, w, left, top, right, bottom, fy);
+	debug(RPT_DEBUG, "%s(w=%p, left=%d, top=%d, right=%d, bottom=%d, fy=%d, fx=%d)",
+			  __FUNCTION__, w, left, top, right, bottom, fy, fx);
 
 	if ((w->text != NULL) &&
 	    (w->x > 0) && (w->y > 0) && (w->y > fy) && (w->y <= bottom - top)) {
+		if (fx > 0) {
+			/* in a frame scrolled sideways: cut to the visible columns */
+			char str[BUFSIZE];
+			int x = w->x - fx;
+			int skip = max(1 - x, 0);
+			int length = strlen(w->text);
+			int room = min(right - left - max(x, 1) + 1, (int) sizeof(str) - 1);
+
+			if ((skip >= length) || (room <= 0))
+				return;
+			length = min(length - skip, room);
+			memcpy(str, w->text + skip, length);
+			str[length] = '\0';
+			drivers_string(max(x, 1) + left, w->y + top, str);
+			return;
+		}
 		/*
 		 * FIXME: Could be a bug here? w->x is recalculated (On first
 		 * call only? Is it preserved between calls?) and first
@@ -399,14 +678,17 @@ render_title(Widget *w, int left, int top, int right, int bottom, long timer)
 	int vis_width = right - left;
 	char str[BUFSIZE];
 	int x, width = vis_width - 6, length, delay;
+	WidgetAnim *a;
 
 	debug(RPT_DEBUG, "%s(w=%p, left=%d, top=%d, right=%d, bottom=%d, timer=%ld)",
 			  __FUNCTION__, w, left, top, right, bottom, timer);
 
 	if ((w->text == NULL) || (vis_width < 8))
 		return;
+	if ((a = widget_anim(w, vis_width, 0)) == NULL)
+		return;
 
-	length = strlen(w->text);
+	length = a->length;
 
 	/* calculate delay from titlespeed: <=0 -> 0, [1 - infty] -> [10 - 1] */
 	delay = (titlespeed <= TITLESPEED_NO)
@@ -418,6 +700,17 @@ render_title(Widget *w, int left, int top, int right, int bottom, long timer)
 	drivers_icon(w->x + left + 1, w->y + top, ICON_BLOCK_FILLED);
 
 	length = min(length, sizeof(str)-1);
+	/* long titles scroll, or do so after TitleSpeed changed on reload */
+	if (length > width)
+		frame_animated = 1;
+	if ((length > width) && (delay != 0)) {
+		if (delay < length / (length - width))
+			animate_period(timer, delay);
+		else
+			/* reverses every length ticks, moves every delay ticks */
+			next_change = min(next_change, timer
+				+ min(length - timer % length, delay - (timer % length) % delay));
+	}
 	if ((length <= width) || (delay == 0)) {
 
 		/* copy test starting from the beginning */
@@ -478,30 +771,36 @@ render_scroller(Widget *w, int left, int top, int right, int bottom, long timer)
 {
 	char str[BUFSIZE];
 	int length;
-	int offset, gap;
+	int offset;
 	int screen_width;
 	int necessaryTimeUnits = 0;
+	WidgetAnim *a;
 
 	debug(RPT_DEBUG, "%s(w=%p, left=%d, top=%d, right=%d, bottom=%d, timer=%ld)",
 			  __FUNCTION__, w, left, top, right, bottom, timer);
 
 	if ((w->text == NULL) || (w->right < w->left))
 		return;
+	frame_animated = 1;
+	if (w->speed != 0)
+		animate_period(timer, (w->speed > 0) ? w->speed : 1);
 
 	screen_width = abs(w->right - w->left + 1);
 	screen_width = min(screen_width, sizeof(str)-1);
 
+	if ((a = widget_anim(w, screen_width, w->length)) == NULL)
+		return;
+
 	switch (w->length) {	/* actually, direction... */
 	case 'm': // Marquee
-		length = strlen(w->text);
+		length = a->length;
 		if (length <= screen_width) {
 			/* it fits within the box, just render it */
 			drivers_string(w->left, w->top, w->text);
 			break;
 		}
 
-		gap = screen_width / 2;
-		length += gap; /* Allow gap between end and beginning */
+		length = a->cycle; /* Allow gap between end and beginning */
 
 		if (w->speed > 0) {
 			necessaryTimeUnits = length * w->speed;
@@ -515,27 +814,14 @@ render_scroller(Widget *w, int left, int top, int right, int bottom, long timer)
 			offset = 0;
 		}
 		if (offset <= length) {
-			if (gap > offset) {
-				memset(str, ' ', gap - offset);
-				strncpy(&str[gap-offset], w->text, screen_width);
-			}
-			else {
-				int room = screen_width - (length - offset);
-
-				strncpy(str, &w->text[offset-gap], screen_width);
-				if (room > 0) {
-					memset(&str[length-offset], ' ', min(room, gap));
-					room -= gap;
-					if (room > 0)
-						strncpy(&str[length-offset+gap], w->text, room);
-				}
-			}
+			/* the cycle is kept twice: any window is one piece */
+			memcpy(str, a->text + offset, screen_width);
 			str[screen_width] = '\0';
 			drivers_string(w->left, w->top, str);
 		}
 		break;
 	case 'h':
-		length = strlen(w->text) + 1;
+		length = a->length + 1;
 		if (length <= screen_width) {
 			/* it fits within the box, just render it */
 			drivers_string(w->left, w->top, w->text);
@@ -585,7 +871,7 @@ render_scroller(Widget *w, int left, int top, int right, int bottom, long timer)
 	/* back up after hitting the bottom.  They jump back to */
 	/* the top instead...  (nevermind?) */
 	case 'v':
-		length = strlen(w->text);
+		length = a->length;
 		if (length <= screen_width) {
 			/* no scrolling required... */
 			drivers_string(w->left, w->top, w->text);
@@ -667,6 +953,75 @@ static void render_num(Widget *w, int left, int top, int right, int bottom)
 }
 
 
+/**
+ * Get the animation parameters of a scroller or title for its visible
+ * width. They are only computed anew after the text or geometry of the
+ * widget changed; a marquee's cycle of gap and text is laid out twice, so
+ * that each frame is a window into it at an offset.
+ * \param w          The widget, with text.
+ * \param width      Visible width.
+ * \param direction  Scroller direction, or 0 for titles.
+ * \return  The parameters, or NULL on error.
+ */
+static WidgetAnim *
+widget_anim(Widget *w, int width, char direction)
+{
+	WidgetAnim *a = &w->anim;
+
+	if (a->valid && (a->width == width) && (a->direction == direction))
+		return a;
+
+	a->valid = 0;
+	a->width = width;
+	a->direction = direction;
+	a->length = strlen(w->text);
+	a->cycle = a->length;
+
+	if ((direction == 'm') && (a->length > width)) {
+		int gap = width / 2;
+		size_t size;
+
+		a->cycle = a->length + gap;
+		size = 2 * a->cycle + 1;
+		if (size > a->size) {
+			char *buf = realloc(a->text, size);
+
+			if (buf == NULL) {
+				report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
+				return NULL;
+			}
+			a->text = buf;
+			a->size = size;
+		}
+		memset(a->text, ' ', gap);
+		memcpy(a->text + gap, w->text, a->length);
+		memcpy(a->text + a->cycle, a->text, a->cycle);
+		a->text[2 * a->cycle] = '\0';
+	}
+
+	a->valid = 1;
+	return a;
+}
+
+
+/**
+ * Get the offset of a frame scrolling through a range of lines or columns.
+ * \param timer  The timer of the frame being rendered.
+ * \param speed  Frames per step if positive, steps per frame if negative.
+ * \param range  Number of offsets.
+ * \return  The offset, from 0 to range - 1.
+ */
+static int
+scroll_offset(long timer, int speed, int range)
+{
+	int offset = (speed > 0)
+		     ? (timer / speed) % range
+		     : (-speed * timer) % range;
+
+	return max(offset, 0);	// safeguard against negative values
+}
+
+
 int
 server_msg(const char *text, int expire)
 {
@@ -40,6 +40,12 @@ extern int output_state;
 /* Render the given screen. */
 int render_screen(Screen *s, long timer);
 
+/* Check whether the given screen needs to be rendered in this frame. */
+int render_needed(Screen *s);
+
+/* Have the display rendered in the next frame. */
+void render_invalidate(void);
+
 /* Display a short message, which must be shorter than 16 chars, in a corner */
 int server_msg(const char *text, int expire);
 
@@ -28,6 +28,7 @@
 #include "menuscreens.h"
 #include "main.h"
 #include "render.h"
+#include "cellbuf.h"
 
 int  default_duration = 0;
 int  default_timeout  = -1;
@@ -83,21 +84,17 @@ screen_create(char *id, Client *client)
 	s->height = display_props->height;
 	s->keys = NULL;
 	s->client = client;
-	s->widgetlist = NULL;
+	IL_Init(&s->widgetlist);
+	IL_InitNode(&s->link);
 	s->timeout = default_timeout; 	/*ignored unless greater than 0.*/
 	s->backlight = BACKLIGHT_OPEN;		/*Lets the screen do it's own*/
 						/*or do what the client says.*/
 	s->cursor = CURSOR_OFF;
 	s->cursor_x = 1;
 	s->cursor_y = 1;
-
-	s->widgetlist = LL_new();
-	if (s->widgetlist == NULL) {
-		report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
-		free(s->id);
-		free(s);
-		return NULL;
-	}
+	s->frame = NULL;
+	s->frame_version = 0;
+	screen_touch(s);
 
 	menuscreen_add_screen(s);
 
@@ -113,7 +110,7 @@ screen_create(char *id, Client *client)
 int
 screen_destroy(Screen *s)
 {
-	Widget *w;
+	IL_node *node;
 
 	debug(RPT_DEBUG, "%s(s=[%.40s])", __FUNCTION__, s->id);
 
@@ -121,12 +118,10 @@ screen_destroy(Screen *s)
 
 	screenlist_remove(s);
 
-	for (w = LL_GetFirst(s->widgetlist); w; w = LL_GetNext(s->widgetlist)) {
+	while ((node = IL_PopHead(&s->widgetlist)) != NULL) {
 		/* Free a widget...*/
-		widget_destroy(w);
+		widget_destroy(IL_ENTRY(node, Widget, link));
 	}
-	LL_Destroy(s->widgetlist);
-	s->widgetlist = NULL;
 
 	if (s->id != NULL) {
 		free(s->id);
@@ -136,6 +131,7 @@ screen_destroy(Screen *s)
 		free(s->name);
 		s->name = NULL;
 	}
+	cellbuf_frame_free(s->frame);
 
 	free(s);
 	s = NULL;
@@ -144,6 +140,27 @@ screen_destroy(Screen *s)
 }
 
 
+/** Note that a screen or one of its widgets changed, so the frame cached
+ * for it (see render_screen()) is not used again.
+ * Versions are unique across all screens, so a screen allocated at the
+ * address of a destroyed one does not match that one's cache.
+ * \param s  The screen.
+ */
+void
+screen_touch(Screen *s)
+{
+	static unsigned int last_version = 0;
+
+	if (s == NULL)
+		return;
+
+	/* skip 0, which marks an empty cache */
+	if (++last_version == 0)
+		++last_version;
+	s->version = last_version;
+}
+
+
 /** Add a widget to a screen.
  * \param s  Screen to add the widget \c w to.
  * \param w  Widget to be added to \c s.
@@ -155,7 +172,8 @@ screen_add_widget(Screen *s, Widget *w)
 {
 	debug(RPT_DEBUG, "%s(s=[%.40s], widget=[%.40s])", __FUNCTION__, s->id, w->id);
 
-	LL_Push(s->widgetlist, (void *) w);
+	IL_PushTail(&s->widgetlist, &w->link);
+	screen_touch(s);
 
 	return 0;
 }
@@ -172,7 +190,8 @@ screen_remove_widget(Screen *s, Widget *w)
 {
 	debug(RPT_DEBUG, "%s(s=[%.40s], widget=[%.40s])", __FUNCTION__, s->id, w->id);
 
-	LL_Remove(s->widgetlist, (void *) w, NEXT);
+	IL_Remove(&s->widgetlist, &w->link);
+	screen_touch(s);
 
 	return 0;
 }
@@ -195,16 +214,17 @@ screen_find_widget(Screen *s, char *id)
 
 	debug(RPT_DEBUG, "%s(s=[%.40s], id=\"%.40s\")", __FUNCTION__, s->id, id);
 
-	for (w = LL_GetFirst(s->widgetlist); w != NULL; w = LL_GetNext(s->widgetlist)) {
+	for (w = screen_getfirst_widget(s); w != NULL; w = screen_getnext_widget(s, w)) {
 		if (0 == strcmp(w->id, id)) {
 			debug(RPT_DEBUG, "%s: Found %s", __FUNCTION__, id);
 			return w;
 		}
 		/* Search subscreens recursively */
 		if (w->type == WID_FRAME) {
-			w = widget_search_subs(w, id);
-			if (w != NULL)
-				return w;
+			Widget *sub = widget_search_subs(w, id);
+
+			if (sub != NULL)
+				return sub;
 		}
 	}
 	debug(RPT_DEBUG, "%s: Not found", __FUNCTION__);
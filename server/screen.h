@@ -25,6 +25,7 @@
 #define SCREEN_H_TYPES
 
 #include "shared/LL.h"
+#include "shared/IL.h"
 
 #ifdef INC_TYPES_ONLY
 # include "client.h"
@@ -51,8 +52,12 @@ typedef struct Screen {
 	short int cursor_x;
 	short int cursor_y;
 	char *keys;
-	LinkedList *widgetlist;
+	IntrusiveList widgetlist;	/* widgets, linked by Widget.link */
+	IL_node link;			/* node in the screenlist */
 	struct Client *client;
+	unsigned int version;		/* changes with every update of the screen */
+	unsigned int frame_version;	/* version the cached frame shows */
+	struct CellFrame *frame;	/* last composed frame, or NULL */
 } Screen;
 
 extern int  default_duration ;
@@ -74,25 +79,29 @@ Screen *screen_create(char *id, Client *client);
 /* Destroys a screen */
 int screen_destroy(Screen *s);
 
+/* Note that a screen or one of its widgets changed */
+void screen_touch(Screen *s);
+
 /* Add a widget to a screen */
 int screen_add_widget(Screen *s, Widget *w);
 
 /* Remove a widget from a screen (does not destroy it) */
 int screen_remove_widget(Screen *s, Widget *w);
 
-/* List functions */
+/* List functions; the caller keeps the position, so walks can be nested */
 static inline Widget *screen_getfirst_widget(Screen *s)
 {
-	return (Widget *) ((s != NULL)
-			   ? LL_GetFirst(s->widgetlist)
-			   : NULL);
+	IL_node *node = (s != NULL) ? IL_First(&s->widgetlist) : NULL;
+
+	return (node != NULL) ? IL_ENTRY(node, Widget, link) : NULL;
 }
 
-static inline Widget *screen_getnext_widget(Screen *s)
+static inline Widget *screen_getnext_widget(Screen *s, Widget *w)
 {
-	return (Widget *) ((s != NULL)
-			   ? LL_GetNext(s->widgetlist)
-			   : NULL);
+	IL_node *node = ((s != NULL) && (w != NULL))
+			? IL_Next(&s->widgetlist, &w->link) : NULL;
+
+	return (node != NULL) ? IL_ENTRY(node, Widget, link) : NULL;
 }
 
 
@@ -15,35 +15,82 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-#include "shared/LL.h"
+#include "shared/IL.h"
 #include "shared/sockets.h"
 #include "shared/report.h"
+#include "shared/defines.h"
 
 #include "client.h"
 #include "screen.h"
 #include "screenlist.h"
+#include "timerwheel.h"
 
 #include "main.h" /* for timer */
 
 /* Local functions */
-int compare_priority(void *one, void *two);
+static int compare_priority(IL_node *one, IL_node *two);
 
 int autorotate = UNSET_INT;	/* If on, INFO and FOREGROUND screens will rotate */
-LinkedList *screenlist = NULL;
+static IntrusiveList screenlist;	/* Screens, linked by Screen.link */
+static int screenlist_ready = 0;
 Screen *current_screen = NULL;
 long int current_screen_start_time = 0;
 
+/* Deadlines of the current screen; they only raise flags that
+ * screenlist_process() acts upon */
+static TimerEntry rotate_timer;
+static TimerEntry timeout_timer;
+static int rotate_due = 0;
+static int timeout_due = 0;
+
+static void screenlist_schedule_rotation(Screen *s);
+static void screenlist_schedule_timeout(Screen *s);
+
+
+/* Walk the screenlist; a screen that is not in the list has no neighbours */
+static Screen *
+screenlist_first(void)
+{
+	IL_node *node = IL_First(&screenlist);
+
+	return (node != NULL) ? IL_ENTRY(node, Screen, link) : NULL;
+}
+
+static Screen *
+screenlist_next(Screen *s)
+{
+	IL_node *node = IL_Linked(&s->link) ? IL_Next(&screenlist, &s->link) : NULL;
+
+	return (node != NULL) ? IL_ENTRY(node, Screen, link) : NULL;
+}
+
+static Screen *
+screenlist_prev(Screen *s)
+{
+	IL_node *node = IL_Linked(&s->link) ? IL_Prev(&screenlist, &s->link) : NULL;
+
+	return (node != NULL) ? IL_ENTRY(node, Screen, link) : NULL;
+}
+
+
+static void
+screenlist_timer_due(TimerEntry *t)
+{
+	*((int *) t->data) = 1;
+}
+
 
 int
 screenlist_init(void)
 {
 	report(RPT_DEBUG, "%s()", __FUNCTION__);
 
-	screenlist = LL_new();
-	if (!screenlist) {
-		report(RPT_ERR, "%s: Error allocating", __FUNCTION__);
-		return -1;
-	}
+	timerwheel_init_entry(&rotate_timer, screenlist_timer_due, &rotate_due);
+	timerwheel_init_entry(&timeout_timer, screenlist_timer_due, &timeout_due);
+
+	IL_Init(&screenlist);
+	screenlist_ready = 1;
+
 	return 0;
 }
 
@@ -53,11 +100,16 @@ screenlist_shutdown(void)
 {
 	report(RPT_DEBUG, "%s()", __FUNCTION__);
 
-	if (!screenlist) {
+	if (!screenlist_ready) {
 		/* Program shutdown before completed startup */
 		return -1;
 	}
-	LL_Destroy(screenlist);
+	/* The screens are destroyed with their clients */
+	while (IL_PopHead(&screenlist) != NULL)
+		;
+	screenlist_ready = 0;
+	timerwheel_remove(&rotate_timer);
+	timerwheel_remove(&timeout_timer);
 
 	return 0;
 }
@@ -66,9 +118,12 @@ screenlist_shutdown(void)
 int
 screenlist_add(Screen *s)
 {
-	if (!screenlist)
+	if (!screenlist_ready)
 		return -1;
-	return LL_Push(screenlist, s);
+	if (IL_Linked(&s->link))
+		return 0;
+	IL_PushTail(&screenlist, &s->link);
+	return 0;
 }
 
 
@@ -77,7 +132,9 @@ screenlist_remove(Screen *s)
 {
 	debug(RPT_DEBUG, "%s(s=[%.40s])", __FUNCTION__, s->id);
 
-	if (!screenlist)
+	if (!screenlist_ready)
+		return -1;
+	if (!IL_Linked(&s->link))
 		return -1;
 
 	/* Are we trying to remove the current screen ? */
@@ -85,13 +142,16 @@ screenlist_remove(Screen *s)
 		screenlist_goto_next();
 		if (s == current_screen) {
 			/* Hmm, no other screen had same priority */
-			void *res = LL_Remove(screenlist, s, NEXT);
+			IL_Remove(&screenlist, &s->link);
 			/* And now once more */
 			screenlist_goto_next();
-			return (res == NULL) ? -1 : 0;
+			if (s == current_screen)
+				current_screen = NULL;	/* it was the last one */
+			return 0;
 		}
 	}
-	return (LL_Remove(screenlist, s, NEXT) == NULL) ? -1 : 0;
+	IL_Remove(&screenlist, &s->link);
+	return 0;
 }
 
 
@@ -103,11 +163,11 @@ screenlist_process(void)
 
 	report(RPT_DEBUG, "%s()", __FUNCTION__);
 
-	if (!screenlist)
+	if (!screenlist_ready)
 		return;
 	/* Sort the list according to priority class */
-	LL_Sort(screenlist, compare_priority);
-	f = LL_GetFirst(screenlist);
+	IL_Sort(&screenlist, compare_priority);
+	f = screenlist_first();
 
 	/**** First we need to check out the current situation. ****/
 
@@ -127,18 +187,19 @@ screenlist_process(void)
 	}
 	else {
 		/* There already was an active screen.
-		 * Check to see if it has an expiry time. If so, decrease it
-		 * and then check to see if it has expired. Remove the screen
-		 * if expired. */
-		if (s->timeout != -1) {
-			--(s->timeout);
-			report(RPT_DEBUG, "Active screen [%.40s] has timeout->%d", s->id, s->timeout);
-			if (s->timeout <= 0) {
-				/* Expired, we can destroy it */
-				report(RPT_DEBUG, "Removing expired screen [%.40s]", s->id);
-				client_remove_screen(s->client, s);
-				screen_destroy(s);
-			}
+		 * Remove it if its timeout has expired. */
+		if (timeout_due) {
+			timeout_due = 0;
+			/* Expired, we can destroy it */
+			report(RPT_DEBUG, "Removing expired screen [%.40s]", s->id);
+			client_remove_screen(s->client, s);
+			screen_destroy(s);
+
+			/* Removing it switched to the next screen */
+			s = screenlist_current();
+			f = screenlist_first();
+			if ((s == NULL) || (f == NULL))
+				return;
 		}
 	}
 
@@ -156,7 +217,7 @@ screenlist_process(void)
 	/* Current screen has been visible long enough and is it of 'normal'
 	 * priority ?
 	 */
-	if (autorotate && (timer - current_screen_start_time >= s->duration)
+	if (autorotate && rotate_due
 	&& s->priority > PRI_BACKGROUND && s->priority <= PRI_FOREGROUND) {
 		/* Ah, rotate! */
 		screenlist_goto_next();
@@ -164,6 +225,30 @@ screenlist_process(void)
 }
 
 
+/**
+ * Switch to the screen of the highest priority class if it is above the
+ * priority of the current screen. Unlike screenlist_process() this neither
+ * counts down timeouts nor rotates screens, so it can be called between
+ * two rendering strokes, e.g. when a key opened or closed the menu.
+ */
+void
+screenlist_switch_priority(void)
+{
+	Screen *s;
+	Screen *f;
+
+	if (!screenlist_ready)
+		return;
+
+	IL_Sort(&screenlist, compare_priority);
+	f = screenlist_first();
+	s = screenlist_current();
+
+	if ((f != NULL) && ((s == NULL) || (f->priority > s->priority)))
+		screenlist_switch(f);
+}
+
+
 void
 screenlist_switch(Screen *s)
 {
@@ -198,8 +283,68 @@ screenlist_switch(Screen *s)
 		/* It's a server screen, no need to inform it. */
 	}
 	report(RPT_INFO, "%s: switched to screen [%.40s]", __FUNCTION__, s->id);
+
+	/* Only the current screen's timeout counts down: keep what is left */
+	if ((current_screen != NULL) && timerwheel_pending(&timeout_timer))
+		current_screen->timeout = max(timeout_timer.expires - timer, 1);
+
 	current_screen = s;
 	current_screen_start_time = timer;
+	screenlist_schedule_rotation(s);
+	screenlist_schedule_timeout(s);
+}
+
+
+/**
+ * Set the rotation of the current screen anew after its duration changed.
+ * \param s  The screen that was changed.
+ */
+void
+screenlist_update_duration(Screen *s)
+{
+	if ((s != NULL) && (s == current_screen))
+		screenlist_schedule_rotation(s);
+}
+
+
+/**
+ * Restart the timeout of the current screen after it was set.
+ * \param s  The screen that was changed.
+ */
+void
+screenlist_update_timeout(Screen *s)
+{
+	if ((s != NULL) && (s == current_screen))
+		screenlist_schedule_timeout(s);
+}
+
+
+/**
+ * Set the timer for the rotation away from the current screen, which is
+ * due once the screen has been visible for its duration.
+ * \param s  The current screen.
+ */
+static void
+screenlist_schedule_rotation(Screen *s)
+{
+	rotate_due = 0;
+	timerwheel_add(&rotate_timer, current_screen_start_time + s->duration);
+}
+
+
+/**
+ * Set the timer for the expiry of the current screen. The timeout counts
+ * the frames the screen is visible.
+ * \param s  The current screen.
+ */
+static void
+screenlist_schedule_timeout(Screen *s)
+{
+	timeout_due = 0;
+	if (s->timeout != -1)
+		timerwheel_add(&timeout_timer, timer + s->timeout);
+	else
+		timerwheel_remove(&timeout_timer);
 }
 
 
@@ -220,15 +365,11 @@ screenlist_goto_next(void)
 	if (!current_screen)
 		return -1;
 
-	/* Find current screen in screenlist */
-	for (s = LL_GetFirst(screenlist); s && s != current_screen; s = LL_GetNext(screenlist))
-		;
-
 	/* One step forward */
-	s = LL_GetNext(screenlist);
+	s = screenlist_next(current_screen);
 	if (!s || s->priority < current_screen->priority) {
 		/* To far, go back to start of screenlist */
-		s = LL_GetFirst(screenlist);
+		s = screenlist_first();
 	}
 	screenlist_switch(s);
 	return 0;
@@ -245,20 +386,17 @@ screenlist_goto_prev(void)
 	if (!current_screen)
 		return -1;
 
-	/* Find current screen in screenlist */
-	for (s = LL_GetFirst(screenlist); s && s != current_screen; s = LL_GetNext(screenlist));
-
 	/* One step back */
-	s = LL_GetPrev(screenlist);
+	s = screenlist_prev(current_screen);
 	if (!s) {
 		/* We're at the start of the screenlist. We should find the
 		 * last screen with the same priority as the first screen.
 		 */
-		Screen *f = LL_GetFirst(screenlist);
+		Screen *f = screenlist_first();
 		Screen *n;
 
 		s = f;
-		while ((n = LL_GetNext(screenlist)) && n->priority == f->priority) {
+		while ((n = screenlist_next(s)) && n->priority == f->priority) {
 			s = n;
 		}
 	}
@@ -267,8 +405,8 @@ screenlist_goto_prev(void)
 }
 
 /* Internal function for sorting. */
-int
-compare_priority(void *one, void *two)
+static int
+compare_priority(IL_node *one, IL_node *two)
 {
 	Screen *a, *b;
 
@@ -279,8 +417,8 @@ compare_priority(void *one, void *two)
 	if (!two)
 		return 0;
 
-	a = (Screen *) one;
-	b = (Screen *) two;
+	a = IL_ENTRY(one, Screen, link);
+	b = IL_ENTRY(two, Screen, link);
 
 	/*debug(RPT_DEBUG, "compare_priority: done?");*/
 
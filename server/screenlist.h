@@ -39,10 +39,21 @@ void screenlist_process(void);
 	/* Processes the screenlist. Decides if we need to switch to an other
 	 * screen. */
 
+void screenlist_switch_priority(void);
+	/* Switches to a screen of higher priority class, if any, without
+	 * processing timeouts or rotation. */
+
 void screenlist_switch(Screen *s);
 	/* Switches to an other screen in the proper way. Informs clients of
 	 * the switch. ALWAYS USE THIS FUNCTION TO SWITCH SCREENS. */
 
+void screenlist_update_duration(Screen *s);
+	/* Sets the rotation of the current screen anew after its duration
+	 * changed. */
+
+void screenlist_update_timeout(Screen *s);
+	/* Restarts the timeout of the current screen after it was set. */
+
 Screen *screenlist_current(void);
 	/* Returns the currently active screen. */
 
@@ -142,6 +142,8 @@ int
 update_server_screen(void)
 {
 	static int hello_done = 0;
+	static int last_clients = -1;
+	static int last_screens = -1;
 	Client *c;
 	Widget *w;
 	int num_clients = 0;
@@ -174,6 +176,13 @@ update_server_screen(void)
 		num_screens += client_screen_count(c);
 	}
 
+	/* keep the cached frame of the screen while nothing changed */
+	if ((num_clients == last_clients) && (num_screens == last_screens))
+		return 0;
+	last_clients = num_clients;
+	last_screens = num_screens;
+	screen_touch(server_screen);
+
 	/* update statistics if we do not only want to show a blank screen */
 	if (rotate_server_screen != SERVERSCREEN_BLANK) {
 		/* format strings for the appropriate display size ... */
@@ -274,6 +283,7 @@ reset_server_screen(int rotate, int heartbeat, int title)
 					? HEARTBEAT_OPEN : HEARTBEAT_OFF;
 	server_screen->priority = (rotate == SERVERSCREEN_ON)
 					? PRI_INFO : PRI_BACKGROUND;
+	screen_touch(server_screen);
 
 	for (i = 0; i < display_props->height; i++) {
 		char id[8];
@@ -293,6 +303,7 @@ reset_server_screen(int rotate, int heartbeat, int title)
 					strncpy(w->text, "LCDproc Server", LCD_MAX_WIDTH);
 					w->text[LCD_MAX_WIDTH] = '\0';
 				}
+				w->anim.valid = 0;
 			}
 		}
 	}
@@ -0,0 +1,264 @@
+/** \file server/shm.c
+ * Shared memory transport for widget values.
+ *
+ * A client asks for a segment with the \c shm_open command. LCDd creates
+ * it, maps it and passes its file descriptor to the client over the Unix
+ * domain socket; the client maps it too and binds widgets to slots with
+ * \c widget_shm. From then on the client updates these widgets by writing
+ * to the slots (see shared/lcdshm.h) and the renderer reads them without
+ * any parsing or system calls.
+ *
+ * The segment has no name other processes could open. Where possible it
+ * is a sealed memfd the client cannot resize; otherwise a client that
+ * truncates it makes the next read fault, and the SIGBUS handler below
+ * drops the segment instead of letting LCDd die.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE		/* memfd_create() and the file seals */
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <setjmp.h>
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef HAVE_SHM_OPEN
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+#include "shared/report.h"
+#include "shared/lcdshm.h"
+
+#include "client.h"
+#include "shm.h"
+
+/** Number of attempts to read a slot the client is writing to */
+#define SHM_READ_RETRIES	4
+
+
+/** Where shm_read_slot() continues when the segment it reads faults */
+static sigjmp_buf shm_fault_jmp;
+/** Tell if shm_read_slot() is reading a segment */
+static volatile sig_atomic_t shm_reading = 0;
+
+
+/**
+ * SIGBUS handler. A fault while reading a slot means the client truncated
+ * its segment; any other one is passed on to the default action.
+ */
+static void
+shm_catch_fault(int sig)
+{
+	if (shm_reading) {
+		shm_reading = 0;
+		siglongjmp(shm_fault_jmp, 1);
+	}
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+
+#ifdef HAVE_SHM_OPEN
+/**
+ * Create an anonymous file for a segment.
+ * \param c     The client.
+ * \param size  Size of the segment.
+ * \return  File descriptor, or -1 on error.
+ */
+static int
+shm_create_file(Client *c, size_t size)
+{
+	int fd;
+
+# ifdef HAVE_MEMFD_CREATE
+	fd = memfd_create("LCDd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd >= 0) {
+		if ((ftruncate(fd, size) < 0) ||
+		    (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)) {
+			report(RPT_ERR, "%s: error setting up memfd: %s", __FUNCTION__, strerror(errno));
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+	if (errno != ENOSYS) {
+		report(RPT_ERR, "%s: memfd_create failed: %s", __FUNCTION__, strerror(errno));
+		return -1;
+	}
+# endif
+	{
+		static unsigned int serial = 0;
+		char name[64];
+
+		snprintf(name, sizeof(name), "/LCDd.%ld.%i.%u", (long) getpid(), c->sock, serial++);
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd < 0) {
+			report(RPT_ERR, "%s: shm_open(%s) failed: %s", __FUNCTION__, name, strerror(errno));
+			return -1;
+		}
+		/* only the descriptor is handed on */
+		shm_unlink(name);
+		if (ftruncate(fd, size) < 0) {
+			report(RPT_ERR, "%s: error setting up %s: %s", __FUNCTION__, name, strerror(errno));
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+}
+#endif
+
+
+/**
+ * Create a shared memory segment for a client and map it. An existing
+ * segment of the client is replaced.
+ * \param c      The client.
+ * \param slots  Number of slots.
+ * \return  File descriptor of the segment for the client, which the caller
+ *          sends and closes; <0 on error, shared memory is not available.
+ */
+int
+shm_create(Client *c, int slots)
+{
+#ifdef HAVE_SHM_OPEN
+	static int fault_handler = 0;
+	size_t size;
+	LcdShmHeader *shm;
+	int fd;
+
+	if ((slots <= 0) || (slots > LCDSHM_MAX_SLOTS))
+		return -1;
+
+	if (!fault_handler) {
+		struct sigaction sa;
+
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = shm_catch_fault;
+		sigemptyset(&sa.sa_mask);
+		/* not blocked while handled, as the handler does not return */
+		sa.sa_flags = SA_NODEFER;
+		sigaction(SIGBUS, &sa, NULL);
+		fault_handler = 1;
+	}
+
+	shm_destroy(c);
+
+	size = LCDSHM_SIZE(slots);
+	if ((fd = shm_create_file(c, size)) < 0)
+		return -1;
+
+	shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (shm == MAP_FAILED) {
+		report(RPT_ERR, "%s: mmap failed: %s", __FUNCTION__, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	memset(shm, 0, size);
+	shm->magic = LCDSHM_MAGIC;
+	shm->version = LCDSHM_VERSION;
+	shm->slots = slots;
+	shm->slot_size = sizeof(LcdShmSlot);
+
+	c->shm = shm;
+	c->shm_size = size;
+	c->shm_slots = slots;
+
+	report(RPT_INFO, "Client on socket %i: shared memory with %i slots",
+		c->sock, slots);
+	return fd;
+#else
+	return -1;
+#endif
+}
+
+
+/**
+ * Unmap the shared memory segment of a client, if any.
+ * \param c  The client.
+ */
+void
+shm_destroy(Client *c)
+{
+#ifdef HAVE_SHM_OPEN
+	if (c->shm == NULL)
+		return;
+
+	munmap(c->shm, c->shm_size);
+#endif
+	c->shm = NULL;
+	c->shm_size = 0;
+	c->shm_slots = 0;
+}
+
+
+/**
+ * Read a slot of a client's segment, unless it is unchanged.
+ * \param c      The client.
+ * \param slot   Index of the slot.
+ * \param seq    Sequence counter of the last read; updated on success.
+ * \param value  Receives the numeric value.
+ * \param text   Receives the text, LCDSHM_TEXT_SIZE bytes.
+ * \retval 1     The slot was read.
+ * \retval 0     The slot did not change, or the client is writing it; the
+ *               next frame tries again.
+ */
+int
+shm_read_slot(Client *c, int slot, uint32_t *seq, int *value, char *text)
+{
+	LcdShmHeader *shm;
+	LcdShmSlot *s;
+	int tries;
+
+	if (c == NULL)
+		return 0;
+	shm = c->shm;
+	if ((shm == NULL) || (slot < 0) || (slot >= c->shm_slots))
+		return 0;
+
+	if (sigsetjmp(shm_fault_jmp, 0) != 0) {
+		report(RPT_WARNING, "Client on socket %i: shared memory was truncated, dropped",
+			c->sock);
+		shm_destroy(c);
+		return 0;
+	}
+	shm_reading = 1;
+
+	s = &shm->slot[slot];
+	for (tries = 0; tries < SHM_READ_RETRIES; tries++) {
+		uint32_t start = s->seq;
+
+		if ((start & 1) || (start == *seq))
+			break;
+
+		lcdshm_barrier();
+		*value = s->value;
+		memcpy(text, s->text, LCDSHM_TEXT_SIZE);
+		lcdshm_barrier();
+
+		if (s->seq == start) {
+			text[LCDSHM_TEXT_SIZE - 1] = '\0';
+			*seq = start;
+			shm_reading = 0;
+			return 1;
+		}
+	}
+	shm_reading = 0;
+	return 0;
+}
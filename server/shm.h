@@ -0,0 +1,29 @@
+/** \file server/shm.h
+ * Shared memory transport for widget values.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef SHM_H
+#define SHM_H
+
+#include <stdint.h>
+
+#define INC_TYPES_ONLY 1
+#include "client.h"
+#undef INC_TYPES_ONLY
+
+/* Create the client's shared memory segment */
+int shm_create(Client *c, int slots);
+
+/* Remove the client's shared memory segment */
+void shm_destroy(Client *c);
+
+/* Read a slot of the client's segment if it changed */
+int shm_read_slot(Client *c, int slot, uint32_t *seq, int *value, char *text);
+
+#endif
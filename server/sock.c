@@ -34,7 +34,9 @@
 #include <arpa/inet.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <string.h>
 
 #include "shared/report.h"
@@ -42,12 +44,15 @@
 #include "shared/defines.h"
 
 #include "clients.h"
+#include "binproto.h"
 #include "sock.h"
 
 
 /****************************************************************************/
 static fd_set active_fd_set, read_fd_set;
 static int listening_fd;
+static int unix_listening_fd = -1;
+static char unix_socket_path[sizeof(((struct sockaddr_un *) 0)->sun_path)];
 
 /* For efficiency we maintain a list of open sockets. Nodes in this list
  * are obtained from a pre-allocated pool - this removes heap operations
@@ -78,21 +83,27 @@ ClientSocketMap *freeClientSocketPool;
 /**** Internal function declarations ****************************************/
 static int sock_read_from_client(ClientSocketMap *clientSocketMap);
 static void sock_destroy_socket(void);
+static int sock_accept_client(int listen_fd);
+static int sock_read_binary_rest(Client *c);
 
 
 /** Initialize sockets.
  * Prepare server socket, and initialize socket management structures.
  * \param bind_addr       Hostname / IP address to bind to.
  * \param bind_port       Port to bind to.
+ * \param unix_path       File name of an additional Unix domain socket,
+ *                        or an empty string for none.
+ * \param unix_mode       Permissions of the Unix domain socket.
  * \retval  <0            error
  * \retval   0            success
  */
 int
-sock_init(char* bind_addr, int bind_port)
+sock_init(char* bind_addr, int bind_port, char *unix_path, int unix_mode)
 {
 	int i;
 
-	debug(RPT_DEBUG, "%s(bind_addr=\"%s\", port=%d)", __FUNCTION__, bind_addr, bind_port);
+	debug(RPT_DEBUG, "%s(bind_addr=\"%s\", port=%d, unix_path=\"%s\")",
+		__FUNCTION__, bind_addr, bind_port, unix_path);
 
 	/* Create the socket and set it up to accept connections. */
 	listening_fd = sock_create_inet_socket(bind_addr, bind_port);
@@ -102,6 +113,12 @@ sock_init(char* bind_addr, int bind_port)
 		return -1;
 	}
 
+	if ((unix_path != NULL) && (unix_path[0] != '\0')) {
+		unix_listening_fd = sock_create_unix_socket(unix_path, unix_mode);
+		if (unix_listening_fd < 0)
+			return -1;
+	}
+
 	/* Create the socket -> Client mapping pool */
 	/* How large can FD_SETSIZE be? Even if it is ~2000 this only uses a
 	   few kilobytes of memory. Let's trade size for speed! */
@@ -137,6 +154,13 @@ sock_init(char* bind_addr, int bind_port)
 		entry->socket = listening_fd;
 		entry->client = NULL;
 		LL_AddNode(openSocketList, (void*) entry);
+
+		if (unix_listening_fd >= 0) {
+			entry = (ClientSocketMap*) LL_Pop(freeClientSocketList);
+			entry->socket = unix_listening_fd;
+			entry->client = NULL;
+			LL_AddNode(openSocketList, (void*) entry);
+		}
 	}
 
 	if ((messageRing = sring_create(MAXMSG)) == NULL) {
@@ -180,6 +204,11 @@ sock_shutdown(void)
                   LL_Destroy(openSocketList);
         */
 	close(listening_fd);
+	if (unix_listening_fd >= 0) {
+		close(unix_listening_fd);
+		unlink(unix_socket_path);
+		unix_listening_fd = -1;
+	}
 	LL_Destroy(freeClientSocketList);
 	free(freeClientSocketPool);
 	sring_destroy(messageRing);
@@ -247,6 +276,149 @@ sock_create_inet_socket(char *addr, unsigned int port)
 }
 
 
+/** Create a Unix domain socket, bind to it and listen on it.
+ * A stale socket file left behind by a previous instance is removed.
+ * Must be called after sock_create_inet_socket().
+ * \param path      File name of the socket.
+ * \param mode      Permissions of the socket file.
+ * \retval  <0      error
+ * \retval  >=0     the socket
+ */
+int
+sock_create_unix_socket(char *path, int mode)
+{
+	struct sockaddr_un name;
+	struct stat st;
+	int sock;
+
+	debug(RPT_DEBUG, "%s(path=\"%s\", mode=%o)", __FUNCTION__, path, mode);
+
+	if (strlen(path) >= sizeof(name.sun_path)) {
+		report(RPT_ERR, "%s: socket name %s too long", __FUNCTION__, path);
+		return -1;
+	}
+
+	sock = socket(PF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0) {
+		report(RPT_ERR, "%s: cannot create socket - %s",
+			__FUNCTION__, sock_geterror());
+		return -1;
+	}
+
+	memset(&name, 0, sizeof(name));
+	name.sun_family = AF_UNIX;
+	strcpy(name.sun_path, path);
+
+	/* Remove a stale socket, but nothing else */
+	if ((lstat(path, &st) == 0) && S_ISSOCK(st.st_mode)) {
+		int probe = socket(PF_UNIX, SOCK_STREAM, 0);
+
+		if ((probe >= 0) && (connect(probe, (struct sockaddr *) &name, sizeof(name)) == 0)) {
+			report(RPT_ERR, "%s: %s is in use by another server", __FUNCTION__, path);
+			close(probe);
+			close(sock);
+			return -1;
+		}
+		if (probe >= 0)
+			close(probe);
+		unlink(path);
+	}
+
+	if (bind(sock, (struct sockaddr *) &name, sizeof(name)) < 0) {
+		report(RPT_ERR, "%s: cannot bind to %s - %s",
+			__FUNCTION__, path, sock_geterror());
+		close(sock);
+		return -1;
+	}
+	strcpy(unix_socket_path, path);
+
+	if (chmod(path, mode) < 0) {
+		report(RPT_ERR, "%s: cannot set permissions of %s - %s",
+			__FUNCTION__, path, sock_geterror());
+	}
+
+	if (listen(sock, SOMAXCONN) < 0) {
+		report(RPT_ERR, "%s: error in attempting to listen on %s - %s",
+			__FUNCTION__, path, sock_geterror());
+		close(sock);
+		unlink(path);
+		return -1;
+	}
+
+	report(RPT_NOTICE, "Listening for queries on %s", path);
+
+	FD_SET(sock, &active_fd_set);
+
+	return sock;
+}
+
+
+/** Make sure the Unix domain socket file is removed when the server exits,
+ * even if the server can no longer remove it itself. Must be called before
+ * privileges are dropped: a child process keeps them, waits for the server
+ * to exit, and removes the socket file if it is still the one the server
+ * created.
+ * 
+etval  <0      error
+ * 
+etval   0      success
+ */
+int
+sock_unlink_on_exit(void)
+{
+	struct stat st, now;
+	int pipefd[2];
+	pid_t pid;
+	char c;
+	int fd;
+
+	if ((unix_listening_fd < 0) || (lstat(unix_socket_path, &st) < 0))
+		return 0;
+
+	if (pipe(pipefd) < 0) {
+		report(RPT_ERR, "%s: cannot create pipe - %s",
+			__FUNCTION__, strerror(errno));
+		return -1;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		report(RPT_ERR, "%s: cannot fork - %s",
+			__FUNCTION__, strerror(errno));
+		close(pipefd[0]);
+		close(pipefd[1]);
+		return -1;
+	}
+	if (pid > 0) {
+		/* The server keeps the write end open until it exits */
+		close(pipefd[0]);
+		fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
+		return 0;
+	}
+
+	/* Child: the server's signals are not ours to handle */
+	signal(SIGINT, SIG_IGN);
+	signal(SIGTERM, SIG_IGN);
+	signal(SIGHUP, SIG_IGN);
+	signal(SIGPIPE, SIG_IGN);
+
+	/* Release the server's sockets and devices */
+	for (fd = sysconf(_SC_OPEN_MAX) - 1; fd > STDERR_FILENO; fd--) {
+		if (fd != pipefd[0])
+			close(fd);
+	}
+
+	while ((read(pipefd[0], &c, 1) < 0) && (errno == EINTR))
+		;
+
+	/* A new server may have replaced the socket in the meantime */
+	if ((lstat(unix_socket_path, &now) == 0) &&
+	    (now.st_dev == st.st_dev) && (now.st_ino == st.st_ino))
+		unlink(unix_socket_path);
+	_exit(0);
+}
+
+
 /** Service all clients with pending input.
  * \retval  <0       error
  * \retval   0       success
@@ -278,53 +450,13 @@ sock_poll_clients(void)
 	     clientSocket = LL_GetNext(openSocketList)) {
 
 		if (FD_ISSET(clientSocket->socket, &read_fd_set)) {
-			if (clientSocket->socket == listening_fd) {
-				/* Connection request on original socket. */
-				Client *c;
-				int new_sock;
-				struct sockaddr_in clientname;
-				socklen_t size = sizeof(clientname);
-
-				new_sock = accept(listening_fd, (struct sockaddr *) &clientname, &size);
-				if (new_sock < 0) {
-					report(RPT_ERR, "%s: Accept error - %s",
-						__FUNCTION__, sock_geterror());
-					return -1;
-				}
-				report(RPT_NOTICE, "Connect from host %s:%hu on socket %i",
-					inet_ntoa(clientname.sin_addr), ntohs(clientname.sin_port), new_sock);
-				FD_SET(new_sock, &active_fd_set);
-
-				fcntl(new_sock, F_SETFL, O_NONBLOCK);
-
-				/* Create new client */
-				if ((c = client_create(new_sock)) == NULL) {
-					report(RPT_ERR, "%s: Error creating client on socket %i - %s",
-						__FUNCTION__, clientSocket->socket, sock_geterror());
-					return -1;
-				}
-				else {
-					/* add new_sock */
-					ClientSocketMap *newClientSocket;
-					newClientSocket = (ClientSocketMap *) LL_Pop(freeClientSocketList);
-					if (newClientSocket != NULL) {
-						newClientSocket->socket = new_sock;
-						newClientSocket->client = c;
-						LL_InsertNode(openSocketList, (void *) newClientSocket);
-						/* advance past the new node - check it on the next pass */
-						LL_Next(openSocketList);
-					}
-					else {
-						report(RPT_ERR, "%s: Error - free client socket list exhausted - %d clients.",
-							__FUNCTION__, FD_SETSIZE);
-						return -1;
-					}
-				}
-				if (clients_add_client(c) == NULL) {
-					report(RPT_ERR, "%s: Could not add client on socket %i",
-						 __FUNCTION__, clientSocket->socket);
+			if ((clientSocket->socket == listening_fd) ||
+			    (clientSocket->socket == unix_listening_fd)) {
+				/* Connection request on a listening socket. */
+				if (sock_accept_client(clientSocket->socket) < 0)
 					return -1;
-				}
+				/* advance past the new node - check it on the next pass */
+				LL_Next(openSocketList);
 			}
 			else {	/* Data arriving on an already-connected socket. */
 				int err = 0;
@@ -340,6 +472,102 @@ sock_poll_clients(void)
 }
 
 
+/** Accept a connection on a listening socket and create a client for it.
+ * The new socket is inserted into openSocketList behind the current node.
+ * \param listen_fd  Listening socket with a pending connection.
+ * \retval  <0       error
+ * \retval   0       success
+ */
+static int
+sock_accept_client(int listen_fd)
+{
+	Client *c;
+	ClientSocketMap *newClientSocket;
+	int new_sock;
+	struct sockaddr_storage clientname;
+	socklen_t size = sizeof(clientname);
+
+	new_sock = accept(listen_fd, (struct sockaddr *) &clientname, &size);
+	if (new_sock < 0) {
+		report(RPT_ERR, "%s: Accept error - %s",
+			__FUNCTION__, sock_geterror());
+		return -1;
+	}
+	if (clientname.ss_family == AF_INET) {
+		struct sockaddr_in *in = (struct sockaddr_in *) &clientname;
+
+		report(RPT_NOTICE, "Connect from host %s:%hu on socket %i",
+			inet_ntoa(in->sin_addr), ntohs(in->sin_port), new_sock);
+	}
+	else if (clientname.ss_family == AF_INET6) {
+		struct sockaddr_in6 *in6 = (struct sockaddr_in6 *) &clientname;
+		char host[INET6_ADDRSTRLEN];
+
+		if (inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host)) == NULL)
+			strcpy(host, "?");
+		report(RPT_NOTICE, "Connect from host [%s]:%hu on socket %i",
+			host, ntohs(in6->sin6_port), new_sock);
+	}
+	else {
+		report(RPT_NOTICE, "Connect on %s on socket %i",
+			unix_socket_path, new_sock);
+	}
+	FD_SET(new_sock, &active_fd_set);
+
+	fcntl(new_sock, F_SETFL, O_NONBLOCK);
+
+	/* Create new client */
+	if ((c = client_create(new_sock)) == NULL) {
+		report(RPT_ERR, "%s: Error creating client on socket %i - %s",
+			__FUNCTION__, new_sock, sock_geterror());
+		return -1;
+	}
+
+	/* add new_sock */
+	newClientSocket = (ClientSocketMap *) LL_Pop(freeClientSocketList);
+	if (newClientSocket == NULL) {
+		report(RPT_ERR, "%s: Error - free client socket list exhausted - %d clients.",
+			__FUNCTION__, FD_SETSIZE);
+		return -1;
+	}
+	newClientSocket->socket = new_sock;
+	newClientSocket->client = c;
+	LL_InsertNode(openSocketList, (void *) newClientSocket);
+
+	if (clients_add_client(c) == NULL) {
+		report(RPT_ERR, "%s: Could not add client on socket %i",
+			 __FUNCTION__, new_sock);
+		return -1;
+	}
+	return 0;
+}
+
+
+/** Hand the data following "hello binary" in the message ring to the
+ * frame parser of the client. The line end of the hello line may
+ * consist of two characters; they cannot start a valid frame.
+ * \retval  <0       error
+ * \retval   0       success
+ */
+static int
+sock_read_binary_rest(Client *c)
+{
+	char rest[MAXMSG];
+	char *p = rest;
+	int len;
+
+	len = sring_read(messageRing, rest, sizeof(rest));
+	while ((len > 0) && ((*p == '\r') || (*p == '\n'))) {
+		p++;
+		len--;
+	}
+	if (len <= 0)
+		return 0;
+
+	return binproto_read(c, p, len);
+}
+
+
 /** Read from a client's socket and store the messages in the client for further parsing.
  * \retval  <0       error
  * \retval   0       success
@@ -356,24 +584,42 @@ sock_read_from_client(ClientSocketMap *clientSocketMap)
 	nbytes = sock_recv(clientSocketMap->socket, buffer, MAXMSG);
 
 	while (nbytes > 0) {		/* Data available */
+		Client *c = clientSocketMap->client;
 		int fr;
-		char *str;
+		char line[MAXMSG];
 
 		debug(RPT_DEBUG, "%s: received %4d bytes", __FUNCTION__, nbytes);
 
+		if ((c != NULL) && c->binary) {
+			/* Binary clients send frames instead of lines */
+			if (binproto_read(c, buffer, nbytes) < 0)
+				return -1;
+			nbytes = sock_recv(clientSocketMap->socket, buffer, MAXMSG);
+			continue;
+		}
+
 		/* Append to ring buffer */
 		sring_write(messageRing, buffer, nbytes);
 
-		/* Process all available message in ring buffer */
-		do {
-			str = sring_read_string(messageRing);
-			if (clientSocketMap->client) {
-				client_add_message(clientSocketMap->client, str);
+		/* Process all available message in ring buffer; the client
+		 * queue copies them, so lines are read into the stack */
+		while (sring_read_line(messageRing, line, sizeof(line)) > 0) {
+			if (c != NULL) {
+				int binary = (c->state == NEW)
+					     && (strcmp(line, "hello binary") == 0);
+
+				client_add_message(c, line);
+				if (binary) {
+					/* Everything after this line is framed */
+					if ((binproto_enable(c) < 0) || (sock_read_binary_rest(c) < 0))
+						return -1;
+					break;
+				}
 			} else {
 				report(RPT_DEBUG, "%s: Can't find client %d",
 					__FUNCTION__, clientSocketMap->socket);
 			}
-		} while (str != NULL);
+		}
 
 		/* Read again, but only as much as space is left */
 		fr = sring_getMaxWrite(messageRing);
@@ -424,6 +670,68 @@ sock_destroy_client_socket(Client *client)
 }
 
 
+/** Tell if a client is connected over the Unix domain socket, where the
+ * server can hand file descriptors to it.
+ * \param sock  Socket of the client.
+ * \retval  1   Unix domain socket
+ * \retval  0   TCP or unknown
+ */
+int
+sock_is_local(int sock)
+{
+	struct sockaddr_storage name;
+	socklen_t size = sizeof(name);
+
+	if (getsockname(sock, (struct sockaddr *) &name, &size) < 0)
+		return 0;
+	return (name.ss_family == AF_UNIX);
+}
+
+
+/** Send a message to a client together with a file descriptor
+ * (SCM_RIGHTS). Only works on the Unix domain socket.
+ * \param sock    Socket of the client.
+ * \param fd      File descriptor to pass; the caller keeps its copy.
+ * \param string  Message to send.
+ * \retval  <0    error
+ * \retval   0    success
+ */
+int
+sock_send_fd(int sock, int fd, const char *string)
+{
+	union {
+		struct cmsghdr hdr;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} control;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct iovec iov;
+
+	iov.iov_base = (void *) string;
+	iov.iov_len = strlen(string);
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&control, 0, sizeof(control));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+	if (sendmsg(sock, &msg, 0) != (ssize_t) iov.iov_len) {
+		report(RPT_ERR, "%s: sendmsg on socket %i failed: %s",
+			__FUNCTION__, sock, sock_geterror());
+		return -1;
+	}
+	return 0;
+}
+
+
 /** Close the socket the openSocketList's \c current pointer points to.
  */
 static void
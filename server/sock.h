@@ -21,11 +21,15 @@
 #undef INC_TYPES_ONLY
 
 /* Server functions...*/
-int sock_init(char* bind_addr, int bind_port);
+int sock_init(char* bind_addr, int bind_port, char *unix_path, int unix_mode);
 int sock_shutdown(void);
 int sock_create_inet_socket(char* bind_addr, unsigned int port);
+int sock_create_unix_socket(char *path, int mode);
+int sock_unlink_on_exit(void);
 int sock_poll_clients(void);
 int sock_destroy_client_socket(Client *client);
+int sock_is_local(int sock);
+int sock_send_fd(int sock, int fd, const char *string);
 int verify_ipv4(const char *addr);
 int verify_ipv6(const char *addr);
 
@@ -0,0 +1,106 @@
+/** \file server/test-replies.c
+ * Check that LCDd answers every command with exactly one reply, so the
+ * client library hands each reply to the command it belongs to.
+ *
+ * Commands with several options, and commands that fail, are pipelined
+ * behind each other; each gets a reply handler that records the result.
+ * Run by test-replies.sh against a server listening on a Unix domain socket.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "shared/lcdclient.h"
+#include "shared/report.h"
+
+/** A pipelined command and the reply it must get */
+typedef struct {
+	const char *cmd;	/**< Command text */
+	const char *expected;	/**< Start of the expected reply */
+	char reply[40];		/**< Start of the reply the handler got */
+	int replies;		/**< Number of replies the handler got */
+} TestCommand;
+
+/* The last command must get the last reply; a stray reply to one of the
+ * others would be taken for it. */
+static TestCommand tests[] = {
+	{ "screen_set t -name {multi} -priority foreground -heartbeat off", "success" },
+	{ "widget_set t nosuch 1 1 {x}", "huh? Unknown widget id" },
+	{ "screen_set t -name {again} -priority bogus -heartbeat off", "huh? invalid argument" },
+	{ "client_add_key -bogus A", "huh? Invalid option" },
+	{ "screen_set t -cursor on -cursor_x 1 -cursor_y 1", "success" },
+	{ "hello extra", "connect" },
+	{ "noop", "noop" },
+};
+
+#define NUM_TESTS	(sizeof(tests) / sizeof(tests[0]))
+
+
+static void
+test_reply(LcdcConnection *conn, int success, const char *reply, void *data)
+{
+	TestCommand *t = data;
+
+	snprintf(t->reply, sizeof(t->reply), "%s", reply);
+	t->replies++;
+}
+
+
+int
+main(int argc, char **argv)
+{
+	LcdcConnection *conn;
+	int failed = 0;
+	int i;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <socket>\n", argv[0]);
+		return 2;
+	}
+	set_reporting("test-replies", RPT_CRIT, RPT_DEST_STDERR);
+
+	conn = lcdc_connect(argv[1], 0);
+	if ((conn == NULL) || (lcdc_hello(conn, 5000) < 0)) {
+		fprintf(stderr, "Cannot connect to %s\n", argv[1]);
+		return 1;
+	}
+
+	lcdc_send_string(conn, "screen_add t\n");
+	for (i = 0; i < NUM_TESTS; i++)
+		lcdc_command(conn, test_reply, &tests[i], "%s", tests[i].cmd);
+	if (lcdc_flush(conn) < 0) {
+		fprintf(stderr, "Cannot send commands\n");
+		return 1;
+	}
+
+	for (i = 0; (i < 50) && (conn->pending_count > 0); i++)
+		lcdc_wait(conn, 100);
+
+	for (i = 0; i < NUM_TESTS; i++) {
+		TestCommand *t = &tests[i];
+
+		if ((t->replies != 1) || (strncmp(t->reply, t->expected, strlen(t->expected)) != 0)) {
+			fprintf(stderr, "\"%s\": expected \"%s\", got %d replies, last \"%s\"\n",
+				t->cmd, t->expected, t->replies, t->reply);
+			failed = 1;
+		}
+	}
+	if (conn->pending_count != 0) {
+		fprintf(stderr, "%d commands without reply\n", conn->pending_count);
+		failed = 1;
+	}
+
+	lcdc_close(conn);
+	return failed;
+}
@@ -0,0 +1,43 @@
+#!/bin/sh
+# Start LCDd with the text driver on a private Unix domain socket and run
+# test-replies against it.
+
+dir=`mktemp -d` || exit 99
+trap 'rm -rf "$dir"' 0
+
+cat > "$dir/LCDd.conf" <<CONF
+[server]
+DriverPath=`pwd`/drivers/
+Driver=text
+Bind=127.0.0.1
+Port=0
+UnixSocket=$dir/LCDd.sock
+User=`id -un`
+ReportToSyslog=no
+ReportLevel=2
+ServerScreen=no
+[text]
+Size=20x4
+CONF
+
+./LCDd -c "$dir/LCDd.conf" -f > "$dir/LCDd.out" 2>&1 &
+pid=$!
+
+tries=0
+while [ ! -S "$dir/LCDd.sock" ]; do
+	tries=`expr $tries + 1`
+	if [ $tries -gt 50 ] || ! kill -0 $pid 2>/dev/null; then
+		echo "LCDd did not start:" >&2
+		cat "$dir/LCDd.out" >&2
+		kill $pid 2>/dev/null
+		exit 99
+	fi
+	sleep 0.1
+done
+
+./test-replies "$dir/LCDd.sock"
+ret=$?
+
+kill $pid
+wait $pid 2>/dev/null
+exit $ret
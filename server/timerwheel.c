@@ -0,0 +1,250 @@
+/** \file server/timerwheel.c
+ * Deadlines of the server, counted in frames of the global timer.
+ *
+ * Timers are kept in a hierarchical timing wheel: four levels of 64 slots
+ * each. The first level holds the timers due within the next 64 frames, one
+ * slot per frame; each further level covers 64 times the range of the one
+ * below. Whenever the lower level wraps around, the timers of the next slot
+ * of the level above are moved down. Adding and removing a timer takes
+ * constant time, and advancing the wheel by a frame only looks at the
+ * timers due in that frame, however many timers are set.
+ *
+ * Timers further away than the wheel covers (2^24 frames) wait in the
+ * last slot of the top level and are put back until they are due.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+
+#include "timerwheel.h"
+
+#define TW_BITS		6
+#define TW_SIZE		(1 << TW_BITS)
+#define TW_MASK		(TW_SIZE - 1)
+#define TW_LEVELS	4
+#define TW_RANGE	(1L << (TW_BITS * TW_LEVELS))
+
+/** Index of a frame's slot at a level */
+#define TW_INDEX(t, level)	(((t) >> ((level) * TW_BITS)) & TW_MASK)
+
+static struct {
+	long now;				/**< Last frame that was run */
+	TimerEntry slot[TW_LEVELS][TW_SIZE];	/**< List heads */
+	int initialized;
+} wheel;
+
+
+static void
+timerwheel_setup(void)
+{
+	int level, i;
+
+	for (level = 0; level < TW_LEVELS; level++) {
+		for (i = 0; i < TW_SIZE; i++) {
+			TimerEntry *head = &wheel.slot[level][i];
+
+			head->next = head->prev = head;
+		}
+	}
+	wheel.initialized = 1;
+}
+
+
+/**
+ * Put a timer into the slot it belongs to, as seen from the current frame.
+ * \param t  The timer; must not be in a slot.
+ */
+static void
+timerwheel_insert(TimerEntry *t)
+{
+	long expires = t->expires;
+	long delta;
+	TimerEntry *head;
+	int level;
+
+	/* Timers that are already due run in the next frame */
+	if (expires <= wheel.now)
+		expires = wheel.now + 1;
+	delta = expires - wheel.now;
+	if (delta >= TW_RANGE) {
+		expires = wheel.now + TW_RANGE - 1;
+		delta = TW_RANGE - 1;
+	}
+
+	for (level = 0; level < TW_LEVELS - 1; level++) {
+		if (delta < (1L << ((level + 1) * TW_BITS)))
+			break;
+	}
+	head = &wheel.slot[level][TW_INDEX(expires, level)];
+
+	t->prev = head->prev;
+	t->next = head;
+	head->prev->next = t;
+	head->prev = t;
+}
+
+
+/**
+ * Prepare a timer for use.
+ * \param t         The timer.
+ * \param callback  Function called when the timer is due; it may set the
+ *                  timer again.
+ * \param data      Pointer for use by the owner of the timer.
+ */
+void
+timerwheel_init_entry(TimerEntry *t, void (*callback) (TimerEntry *t), void *data)
+{
+	t->next = t->prev = NULL;
+	t->expires = 0;
+	t->callback = callback;
+	t->data = data;
+}
+
+
+/**
+ * Set a timer. A timer that is set already is moved.
+ * \param t        The timer.
+ * \param expires  Value of the global timer in which it is due. If that
+ *                 frame was run already, the timer is due in the next one.
+ */
+void
+timerwheel_add(TimerEntry *t, long expires)
+{
+	if (!wheel.initialized)
+		timerwheel_setup();
+
+	timerwheel_remove(t);
+	t->expires = expires;
+	timerwheel_insert(t);
+}
+
+
+/**
+ * Cancel a timer. Nothing happens if it is not set.
+ * \param t  The timer.
+ */
+void
+timerwheel_remove(TimerEntry *t)
+{
+	if (t->next == NULL)
+		return;
+
+	t->prev->next = t->next;
+	t->next->prev = t->prev;
+	t->next = t->prev = NULL;
+}
+
+
+/**
+ * Move the timers of a slot to the slots they belong to now.
+ * \param head  Head of the slot.
+ */
+static void
+timerwheel_cascade(TimerEntry *head)
+{
+	TimerEntry list;
+
+	if (head->next == head)
+		return;
+
+	/* Detach the slot first: timers may go back into it */
+	list.next = head->next;
+	list.prev = head->prev;
+	list.next->prev = &list;
+	list.prev->next = &list;
+	head->next = head->prev = head;
+
+	while (list.next != &list) {
+		TimerEntry *t = list.next;
+
+		list.next = t->next;
+		t->next->prev = &list;
+		timerwheel_insert(t);
+	}
+}
+
+
+/**
+ * Run the timers due up to and including the given frame, in the order of
+ * the frames they are due in.
+ * \param now  Current value of the global timer.
+ */
+void
+timerwheel_advance(long now)
+{
+	if (!wheel.initialized)
+		timerwheel_setup();
+
+	while (wheel.now < now) {
+		TimerEntry *head;
+		int level;
+
+		wheel.now++;
+
+		/* Move timers down when a level wraps around */
+		for (level = 1; level < TW_LEVELS; level++) {
+			if (TW_INDEX(wheel.now, level - 1) != 0)
+				break;
+			timerwheel_cascade(&wheel.slot[level][TW_INDEX(wheel.now, level)]);
+		}
+
+		head = &wheel.slot[0][TW_INDEX(wheel.now, 0)];
+		while (head->next != head) {
+			TimerEntry *t = head->next;
+
+			timerwheel_remove(t);
+			if (t->expires > wheel.now) {
+				/* parked far away; not due yet */
+				timerwheel_insert(t);
+				continue;
+			}
+			if (t->callback != NULL)
+				t->callback(t);
+		}
+	}
+}
+
+
+/**
+ * Get the number of frames until the next timer is due.
+ * Within a level the slots are in the order of their frames, so only the
+ * first non-empty slot of each level has to be looked at.
+ * \return  Frames from the last frame run to the next due timer (at least
+ *          1), or -1 if no timer is set.
+ */
+long
+timerwheel_next(void)
+{
+	long best = -1;
+	int level, i;
+
+	if (!wheel.initialized)
+		return -1;
+
+	for (level = 0; level < TW_LEVELS; level++) {
+		for (i = 1; i <= TW_SIZE; i++) {
+			int index = (TW_INDEX(wheel.now, level) + i) & TW_MASK;
+			TimerEntry *head = &wheel.slot[level][index];
+			TimerEntry *t;
+
+			if (head->next == head)
+				continue;
+			for (t = head->next; t != head; t = t->next) {
+				long delta = t->expires - wheel.now;
+
+				if (delta < 1)
+					delta = 1;
+				if ((best < 0) || (delta < best))
+					best = delta;
+			}
+			break;
+		}
+	}
+
+	return best;
+}
@@ -0,0 +1,41 @@
+/** \file server/timerwheel.h
+ * Deadlines of the server, counted in frames of the global timer.
+ */
+
+/* This file is part of LCDd, the lcdproc server.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+/** A deadline; embedded in the structure it belongs to */
+typedef struct TimerEntry {
+	struct TimerEntry *next, *prev;	/**< Links in the slot; NULL if not pending */
+	long expires;			/**< Frame the timer is due in */
+	void (*callback) (struct TimerEntry *t);	/**< Called when due */
+	void *data;			/**< For use by the owner */
+} TimerEntry;
+
+/* Prepare a timer for use */
+void timerwheel_init_entry(TimerEntry *t, void (*callback) (TimerEntry *t), void *data);
+
+/* Set a timer to expire in the given frame, or cancel it */
+void timerwheel_add(TimerEntry *t, long expires);
+void timerwheel_remove(TimerEntry *t);
+
+/* Check whether a timer is set */
+static inline int timerwheel_pending(const TimerEntry *t)
+{
+	return (t->next != NULL);
+}
+
+/* Run the timers due up to and including the given frame */
+void timerwheel_advance(long now);
+
+/* Get the number of frames until the next timer is due */
+long timerwheel_next(void);
+
+#endif
@@ -22,10 +22,13 @@
 
 #include "shared/sockets.h"
 #include "shared/report.h"
+#include "shared/lcdshm.h"
 
 #include "screen.h"
 #include "widget.h"
 #include "render.h"
+#include "shm.h"
+#include "binproto.h"
 #include "drivers/lcd.h"
 
 char *typenames[] = {
@@ -97,6 +100,8 @@ widget_create(char *id, WidgetType type, Screen *screen)
 	w->top = 1;
 	w->length = 1;
 	w->speed = 1;
+	w->shm_slot = -1;
+	w->handle = -1;
 
 	if (type == WID_FRAME) {
 		/* create a screen for the frame widget */
@@ -122,8 +127,12 @@ widget_destroy(Widget *w)
 	if (!w)
 		return;
 
+	binproto_forget_widget(w);
+
 	free(w->id);
 	free(w->text);
+	free(w->pending_text);
+	free(w->anim.text);
 
 	/* Free subscreen of frame widget too */
 	if (w->type == WID_FRAME)
@@ -133,6 +142,98 @@ widget_destroy(Widget *w)
 }
 
 
+/** Set the text of a widget.
+ * The text is not applied at once but kept in a pending buffer until the
+ * widget is rendered next. A client setting a widget several times between
+ * two frames (or while its screen is not visible) only overwrites the
+ * pending text, and its buffer is reused instead of being reallocated.
+ * \param w     Widget to set the text of.
+ * \param text  New text.
+ * \retval 0    Success.
+ * \retval <0   Error allocating memory.
+ */
+int
+widget_set_text(Widget *w, const char *text)
+{
+	size_t size = strlen(text) + 1;
+
+	if (size > w->pending_size) {
+		char *buf = realloc(w->pending_text, size);
+
+		if (buf == NULL)
+			return -1;
+		w->pending_text = buf;
+		w->pending_size = size;
+	}
+	memcpy(w->pending_text, text, size);
+	w->pending = 1;
+	screen_touch(w->screen);
+
+	return 0;
+}
+
+
+/** Take the value of a widget from its shared memory slot, if it changed.
+ * \param w  Widget bound to a slot.
+ */
+static void
+widget_read_shm(Widget *w)
+{
+	char text[LCDSHM_TEXT_SIZE];
+	int value;
+
+	if (!shm_read_slot(w->screen->client, w->shm_slot, &w->shm_seq, &value, text))
+		return;
+	screen_touch(w->screen);
+
+	switch (w->type) {
+	case WID_STRING:
+	case WID_TITLE:
+	case WID_SCROLLER:
+		widget_set_text(w, text);
+		break;
+	case WID_HBAR:
+	case WID_VBAR:
+		w->length = value;
+		break;
+	case WID_PBAR:
+		w->promille = value;
+		break;
+	case WID_NUM:
+		if ((value >= 0) && (value <= 10))
+			w->y = value;
+		break;
+	default:
+		break;
+	}
+}
+
+
+/** Apply the text set since the last frame.
+ * The buffers of the current and the pending text are swapped, so the old
+ * text's buffer takes the next update.
+ * \param w  Widget to update.
+ */
+void
+widget_apply_pending(Widget *w)
+{
+	char *old;
+
+	if (w->shm_slot >= 0)
+		widget_read_shm(w);
+
+	if (!w->pending)
+		return;
+
+	old = w->text;
+	w->text = w->pending_text;
+	w->pending_text = old;
+	w->pending_size = (old != NULL) ? strlen(old) + 1 : 0;
+	w->pending = 0;
+	w->anim.valid = 0;
+}
+
+
 /** Convert a widget type name to a widget type.
  * \param typename  Name of the widget type.
  * \return          Widget type.
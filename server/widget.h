@@ -13,6 +13,8 @@
 #ifndef WIDGET_H
 #define WIDGET_H
 
+#include <stdint.h>
+
 #define INC_TYPES_ONLY 1
 #include "screen.h"
 #undef INC_TYPES_ONLY
@@ -32,6 +34,19 @@ typedef enum WidgetType {
 } WidgetType;
 
 
+/** Animation parameters of a scroller or title; they are kept until the
+ * widget's text or geometry changes (see render.c) */
+typedef struct WidgetAnim {
+	int valid;			/**< parameters match text and geometry */
+	int width;			/**< visible width they were computed for */
+	char direction;			/**< scroller direction they were computed for */
+	int length;			/**< length of the text */
+	int cycle;			/**< length of one cycle of text */
+	char *text;			/**< a marquee's cycle of text, twice */
+	size_t size;			/**< allocated size of text */
+} WidgetAnim;
+
+
 /** Widget structure */
 typedef struct Widget {
 	char *id;			/**< the widget's name */
@@ -47,6 +62,14 @@ typedef struct Widget {
 	char *begin_label;		/**< label in front of pbars; or NULL */
 	char *end_label;		/**< label at end of pbars; or NULL */
 	struct Screen *frame_screen;	/**< frame widget get an associated screen */
+	char *pending_text;		/**< text set since the last frame; buffer is reused */
+	size_t pending_size;		/**< allocated size of pending_text */
+	int pending;			/**< pending_text has to be applied before rendering */
+	int shm_slot;			/**< slot of the client's shared memory, or -1 */
+	uint32_t shm_seq;		/**< sequence counter of the slot when it was read last */
+	int handle;			/**< handle for binary frames, or -1 */
+	WidgetAnim anim;		/**< cached animation of scrollers and titles */
+	IL_node link;			/**< node in the screen's widget list */
 	//LinkedList *kids;		/* Frames can contain more widgets...*/
 } Widget;
 
@@ -64,6 +87,12 @@ WidgetType widget_typename_to_type(char *typename);
 /* Convert a widget typename to a widget type */
 char *widget_type_to_typename(WidgetType t);
 
+/* Set the text of a widget; it is applied when the widget is rendered */
+int widget_set_text(Widget *w, const char *text);
+
+/* Apply text set since the last frame */
+void widget_apply_pending(Widget *w);
+
 /* Search subwidgets of a widget */
 Widget *widget_search_subs(Widget *w, char *id);
 
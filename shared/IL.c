@@ -0,0 +1,193 @@
+/** \file shared/IL.c
+ * Define routines to deal with intrusive doubly linked lists
+ */
+
+/* This file is part of LCDproc.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <stdlib.h>
+#include "IL.h"
+
+
+/** Prepare an empty list.
+ * \param list  List object.
+ */
+void
+IL_Init(IntrusiveList *list)
+{
+	list->head.next = &list->head;
+	list->head.prev = &list->head;
+	list->length = 0;
+}
+
+
+/** Prepare a node that is not in a list yet.
+ * \param node  The node.
+ */
+void
+IL_InitNode(IL_node *node)
+{
+	node->next = NULL;
+	node->prev = NULL;
+}
+
+
+/** Link a node between two adjacent ones. */
+static void
+IL_Link(IL_node *prev, IL_node *next, IL_node *node)
+{
+	node->prev = prev;
+	node->next = next;
+	prev->next = node;
+	next->prev = node;
+}
+
+
+/** Append a node to the end of a list.
+ * \param list  List object.
+ * \param node  Node that is not in any list.
+ */
+void
+IL_PushTail(IntrusiveList *list, IL_node *node)
+{
+	IL_Link(list->head.prev, &list->head, node);
+	list->length++;
+}
+
+
+/** Add a node to the beginning of a list.
+ * \param list  List object.
+ * \param node  Node that is not in any list.
+ */
+void
+IL_PushHead(IntrusiveList *list, IL_node *node)
+{
+	IL_Link(&list->head, list->head.next, node);
+	list->length++;
+}
+
+
+/** Insert a node before another one.
+ * \param list  List object.
+ * \param pos   Node of the list to insert before; \c NULL to append.
+ * \param node  Node that is not in any list.
+ */
+void
+IL_InsertBefore(IntrusiveList *list, IL_node *pos, IL_node *node)
+{
+	if (pos == NULL)
+		pos = &list->head;
+	IL_Link(pos->prev, pos, node);
+	list->length++;
+}
+
+
+/** Remove a node from its list.
+ * Nothing happens if the node is not in a list.
+ * \param list  List object the node is in.
+ * \param node  The node.
+ */
+void
+IL_Remove(IntrusiveList *list, IL_node *node)
+{
+	if (node->next == NULL)
+		return;
+
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+	node->next = NULL;
+	node->prev = NULL;
+	list->length--;
+}
+
+
+/** Remove the first node of a list.
+ * \param list  List object.
+ * \return      The removed node; \c NULL if the list is empty.
+ */
+IL_node *
+IL_PopHead(IntrusiveList *list)
+{
+	IL_node *node = IL_First(list);
+
+	if (node != NULL)
+		IL_Remove(list, node);
+
+	return node;
+}
+
+
+/** Replace a node in its list by another one. */
+static void
+IL_Replace(IL_node *old, IL_node *node)
+{
+	IL_Link(old->prev, old->next, node);
+}
+
+
+/** Swap the positions of two nodes of the same list. */
+static void
+IL_Swap(IL_node *one, IL_node *two)
+{
+	IL_node tmp;
+
+	if (one == two)
+		return;
+
+	IL_Replace(one, &tmp);
+	IL_Replace(two, one);
+	IL_Replace(&tmp, two);
+}
+
+
+/** Sort a list.
+ * Nodes end up in the same order LL_Sort() puts the same data in, so
+ * lists can be moved over without changing the order of equal nodes.
+ * A list that is in order already is left alone after one pass.
+ * \param list     List object.
+ * \param compare  Comparison function; returns an int > \c 0 when the
+ *                 first node is considered greater than the second.
+ * \retval <0      error
+ * \retval  0      success.
+ */
+int
+IL_Sort(IntrusiveList *list, int (*compare)(IL_node *, IL_node *))
+{
+	IL_node *node, *last;
+	int i, j;
+
+	if (!list)
+		return -1;
+	if (!compare)
+		return -1;
+
+	for (node = list->head.next; node->next != &list->head; node = node->next) {
+		if (compare(node, node->next) > 0)
+			break;
+	}
+	if (node->next == &list->head)
+		return 0;
+
+	/* Same selection sort as LL_Sort(): the first of the greatest nodes
+	 * in front of position i trades places with the node there, if that
+	 * one is smaller */
+	last = list->head.prev;
+	for (i = list->length - 1; i > 0; i--) {
+		IL_node *best = last;
+
+		node = list->head.next;
+		for (j = 0; j < i; j++) {
+			if (compare(node, best) > 0)
+				best = node;
+			node = node->next;
+		}
+
+		IL_Swap(last, best);
+		last = best->prev;
+	}
+
+	return 0;
+}
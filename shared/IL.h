@@ -0,0 +1,119 @@
+/** \file shared/IL.h
+ * Define routines to deal with intrusive doubly linked lists
+ */
+
+/* This file is part of LCDproc.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef IL_H
+#define IL_H
+
+#include <stddef.h>
+
+/***********************************************************************
+  Intrusive Lists
+  *******************************************************************
+
+  Unlike the lists of LL.h, an intrusive list does not allocate nodes:
+  the node is a member of the structure that is put into the list, so
+  adding and removing never call malloc(). A structure can be in as many
+  lists as it has nodes, but each node in only one list at a time.
+
+  The list has no current pointer; whoever walks the list keeps the
+  cursor, so walks can be nested and lists can be changed while they are
+  walked, as long as the node of the cursor stays in the list.
+
+    typedef struct my_data {
+      IL_node link;
+      int number;
+    } my_data;
+
+    IntrusiveList list;
+    IL_node *node;
+
+    IL_Init(&list);
+    IL_PushTail(&list, &thingie->link);
+
+    for (node = IL_First(&list); node != NULL; node = IL_Next(&list, node)) {
+      my_data *thingie = IL_ENTRY(node, my_data, link);
+      ...
+    }
+
+  *******************************************************************/
+
+/** Node of an intrusive list; embedded in the structure it links */
+typedef struct IL_node {
+	struct IL_node *next;	/**< next node; \c NULL if not in a list */
+	struct IL_node *prev;	/**< previous node */
+} IL_node;
+
+/** Intrusive list; a ring of nodes through its head */
+typedef struct IntrusiveList {
+	IL_node head;		/**< not an element; links first and last node */
+	int length;		/**< number of nodes in the list */
+} IntrusiveList;
+
+/** Get the structure that a node is the member \c member of */
+#define IL_ENTRY(node, type, member) \
+	((type *) ((char *) (node) - offsetof(type, member)))
+
+// Prepare lists and nodes
+void IL_Init(IntrusiveList *list);
+void IL_InitNode(IL_node *node);
+
+// Add and remove nodes
+void IL_PushTail(IntrusiveList *list, IL_node *node);
+void IL_PushHead(IntrusiveList *list, IL_node *node);
+void IL_InsertBefore(IntrusiveList *list, IL_node *pos, IL_node *node);
+void IL_Remove(IntrusiveList *list, IL_node *node);
+IL_node *IL_PopHead(IntrusiveList *list);
+
+// Sort the list...
+int IL_Sort(IntrusiveList *list, int (*compare)(IL_node *, IL_node *));
+
+/** Check whether a node is in a list */
+static inline int IL_Linked(const IL_node *node)
+{
+	return (node->next != NULL);
+}
+
+/** Get the number of nodes in a list */
+static inline int IL_Length(const IntrusiveList *list)
+{
+	return list->length;
+}
+
+/** Check whether a list is empty */
+static inline int IL_IsEmpty(const IntrusiveList *list)
+{
+	return (list->length == 0);
+}
+
+/** Get the first node of a list; \c NULL if it is empty */
+static inline IL_node *IL_First(IntrusiveList *list)
+{
+	return (list->head.next != &list->head) ? list->head.next : NULL;
+}
+
+/** Get the last node of a list; \c NULL if it is empty */
+static inline IL_node *IL_Last(IntrusiveList *list)
+{
+	return (list->head.prev != &list->head) ? list->head.prev : NULL;
+}
+
+/** Get the node after \c node; \c NULL at the end of the list */
+static inline IL_node *IL_Next(IntrusiveList *list, IL_node *node)
+{
+	return (node->next != &list->head) ? node->next : NULL;
+}
+
+/** Get the node before \c node; \c NULL at the start of the list */
+static inline IL_node *IL_Prev(IntrusiveList *list, IL_node *node)
+{
+	return (node->prev != &list->head) ? node->prev : NULL;
+}
+
+#endif
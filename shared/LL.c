@@ -26,6 +26,58 @@
 //TODO: Test everything?
 
 
+/** Number of nodes allocated at once by the node pool */
+#define LL_POOL_BLOCK	64
+
+/** Nodes that are not in any list; linked through their \c next pointers */
+static LL_node *free_nodes = NULL;
+
+
+/** Get a node from the node pool.
+ * Nodes are allocated in blocks of #LL_POOL_BLOCK and recycled once they
+ * are removed from a list, so adding to a list only rarely calls malloc().
+ * Blocks are kept until the program ends.
+ * \note  The pool is not protected against concurrent use; lists must
+ *        only be changed by one thread.
+ * \return  Pointer to an uninitialized node; \c NULL on error.
+ */
+static LL_node *
+LL_AllocNode(void)
+{
+	LL_node *node;
+
+	if (free_nodes == NULL) {
+		LL_node *block = malloc(LL_POOL_BLOCK * sizeof(LL_node));
+		int i;
+
+		if (block == NULL)
+			return NULL;
+		for (i = 0; i < LL_POOL_BLOCK; i++) {
+			block[i].next = free_nodes;
+			free_nodes = &block[i];
+		}
+	}
+
+	node = free_nodes;
+	free_nodes = node->next;
+
+	return node;
+}
+
+
+/** Return a node to the node pool.
+ * \param node  Node that was removed from its list.
+ */
+static void
+LL_FreeNode(LL_node *node)
+{
+	node->data = NULL;
+	node->prev = NULL;
+	node->next = free_nodes;
+	free_nodes = node;
+}
+
+
 /** Create new linked list.
  * \return  Pointer to freshly created list object; \c NULL on error.
  */
@@ -83,7 +135,7 @@ LL_Destroy(LinkedList *list)
 		node->next = NULL;
 		node->prev = NULL;
 
-		free(node);
+		LL_FreeNode(node);
 	}
 
 	free(list);
@@ -377,7 +429,7 @@ LL_AddNode(LinkedList *list, void *add)
 	if (!list->current)
 		return -1;
 
-	node = malloc(sizeof(LL_node));
+	node = LL_AllocNode();
 	if (node == NULL)
 		return -1;
 
@@ -420,7 +472,7 @@ LL_InsertNode(LinkedList *list, void *add)
 	if (!list->current)
 		return -1;
 
-	node = malloc(sizeof(LL_node));
+	node = LL_AllocNode();
 	if (node == NULL)
 		return -1;
 
@@ -479,7 +531,7 @@ LL_DeleteNode(LinkedList *list, Direction whereto)
 	//if(list->current->data) free(list->current->data);
 	list->current->data = NULL;
 
-	free(list->current);
+	LL_FreeNode(list->current);
 
 	switch (whereto) {
 		case HEAD:	list->current = list->head.next;
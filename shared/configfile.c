@@ -18,12 +18,20 @@
 #include <strings.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <ctype.h>
 
 #ifdef HAVE_CONFIG_H
 # include "config.h"
 #endif
 
 #include "shared/report.h"
+#include "shared/configfile.h"
+
+
+/** Number of hash buckets for the sections */
+#define CONFIG_SECTION_BUCKETS	64
+/** Number of hash buckets for the keys of a section */
+#define CONFIG_KEY_BUCKETS	32
 
 
 /** configuration key */
@@ -31,6 +39,11 @@ typedef struct _config_key {
 	char *name;			/**< name of the config key */
 	char *value;			/**< value of the config key */
 	struct _config_key *next_key;	/**< pointer to next config key */
+	unsigned int hash;		/**< hash of the name */
+	struct _config_key *next_hash;	/**< next key name in the same hash bucket */
+	struct _config_key *next_value;	/**< next value of a multi-valued key */
+	struct _config_key *last_value;	/**< last value (first value only) */
+	int count;			/**< number of values (first value only) */
 } ConfigKey;
 
 /** configuration section */
@@ -38,13 +51,23 @@ typedef struct _config_section {
 	char *name;			/**< name of the config section */
 	ConfigKey *first_key;		/**< config keys in the config section */
 	struct _config_section *next_section;	/**< pointer to next config section */
+	ConfigKey *last_key;		/**< last config key, to append quickly */
+	unsigned int hash;		/**< hash of the name */
+	struct _config_section *next_hash;	/**< next section in the same hash bucket */
+	ConfigKey *keys[CONFIG_KEY_BUCKETS];	/**< first values of the keys by hash */
 } ConfigSection;
 
 
 static ConfigSection *first_section = NULL;
+static ConfigSection *last_section = NULL;
+static ConfigSection *sections[CONFIG_SECTION_BUCKETS];
 /* Yes there is a static. It's C after all :)*/
 
 
+static unsigned int config_hash(const char *name);
+static short value_to_tristate(const char *value, const char *name3rd, short default_value);
+static long int value_to_int(const char *value, long int default_value);
+static double value_to_float(const char *value, double default_value);
 static ConfigSection *find_section(const char *sectionname);
 static ConfigSection *add_section(const char *sectionname);
 static ConfigKey *find_key(ConfigSection *s, const char *keyname, int skip);
@@ -190,17 +213,7 @@ short config_get_bool(const char *sectionname, const char *keyname,
 	if (k == NULL)
 		return default_value;
 
-	if ((strcasecmp(k->value, "0") == 0) || (strcasecmp(k->value, "false") == 0) ||
-	    (strcasecmp(k->value, "n") == 0) || (strcasecmp(k->value, "no") == 0) ||
-	    (strcasecmp(k->value, "off") == 0)) {
-		return 0;
-	}
-	if ((strcasecmp(k->value, "1") == 0) || (strcasecmp(k->value, "true") == 0) ||
-	    (strcasecmp(k->value, "y") == 0) || (strcasecmp(k->value, "yes") == 0) ||
-	    (strcasecmp(k->value, "on") == 0)) {
-		return 1;
-	}
-	return default_value;
+	return value_to_tristate(k->value, NULL, default_value);
 }
 
 
@@ -229,21 +242,7 @@ short config_get_tristate(const char *sectionname, const char *keyname,
 	if (k == NULL)
 		return default_value;
 
-	if ((strcasecmp(k->value, "0") == 0) || (strcasecmp(k->value, "false") == 0) ||
-	    (strcasecmp(k->value, "n") == 0) || (strcasecmp(k->value, "no") == 0) ||
-	    (strcasecmp(k->value, "off") == 0)) {
-		return 0;
-	}
-	if ((strcasecmp(k->value, "1") == 0) || (strcasecmp(k->value, "true") == 0) ||
-	    (strcasecmp(k->value, "y") == 0) || (strcasecmp(k->value, "yes") == 0) ||
-	    (strcasecmp(k->value, "on") == 0)) {
-		return 1;
-	}
-	if ((strcasecmp(k->value, "2") == 0) ||
-	    ((name3rd != NULL) && (strcasecmp(k->value, name3rd) == 0))) {
-		return 2;
-	}
-	return default_value;
+	return value_to_tristate(k->value, (name3rd != NULL) ? name3rd : "2", default_value);
 }
 
 
@@ -262,15 +261,10 @@ long int config_get_int(const char *sectionname, const char *keyname,
 {
 	ConfigKey *k = find_key(find_section(sectionname), keyname, skip);
 
-	if (k != NULL) {
-		char *end;
-		long int v = strtol(k->value, &end, 0);
+	if (k == NULL)
+		return default_value;
 
-		if ((end != NULL) && (end != k->value) && (*end == '\0'))
-			/* Conversion successful */
-			return v;
-	}
-	return default_value;
+	return value_to_int(k->value, default_value);
 }
 
 
@@ -289,15 +283,10 @@ double config_get_float(const char *sectionname, const char *keyname,
 {
 	ConfigKey *k = find_key(find_section(sectionname), keyname, skip);
 
-	if (k != NULL) {
-		char *end;
-		double v = strtod(k->value, &end);
+	if (k == NULL)
+		return default_value;
 
-		if ((end != NULL) && (end != k->value) && (*end == '\0'))
-			/* Conversion successful*/
-			return v;
-	}
-	return default_value;
+	return value_to_float(k->value, default_value);
 }
 
 
@@ -320,19 +309,75 @@ int config_has_section(const char *sectionname)
  */
 int config_has_key(const char *sectionname, const char *keyname)
 {
-	ConfigSection *s = find_section(sectionname);
-	int count = 0;
+	ConfigKey *k = find_key(find_section(sectionname), keyname, 0);
+
+	return (k != NULL) ? k->count : 0;
+}
 
-	if (s != NULL) {
-		ConfigKey *k;
 
-		for (k = s->first_key; k != NULL; k = k->next_key) {
-			/* Did we find the right key ?*/
-			if (strcasecmp(k->name, keyname) == 0)
-				count++;
+/** Read the values of several keys of a section into a structure.
+ *
+ * This performs the lookups and conversions of a whole section once, e.g.
+ * after the config has been (re)read, instead of looking up each key
+ * whenever its value is needed. Each option is converted as by the
+ * corresponding config_get_*() function with \c skip = 0; missing or
+ * invalid values are set to the option's default.
+ *
+ * String values point into the configuration in memory and stay valid
+ * until config_clear() is called.
+ *
+ * \param sectionname  Name of the section to read.
+ * \param options      Array of options, terminated by an entry whose
+ *                     \c keyname is \c NULL.
+ * \param dest         Structure the values are stored in, at the offsets
+ *                     given in \c options.
+ * \retval <0          invalid option type
+ * \retval n           number of options found in the config
+ */
+int config_compile_section(const char *sectionname, const ConfigOption *options, void *dest)
+{
+	ConfigSection *s = find_section(sectionname);
+	const ConfigOption *o;
+	int found = 0;
+
+	for (o = options; o->keyname != NULL; o++) {
+		ConfigKey *k = find_key(s, o->keyname, 0);
+		const char *value = (k != NULL) ? k->value : NULL;
+		char *field = (char *) dest + o->offset;
+
+		if (k != NULL)
+			found++;
+
+		switch (o->type) {
+		  case CONFIG_TYPE_BOOL:
+			*(short *) field = (value != NULL)
+				? value_to_tristate(value, NULL, o->default_int)
+				: o->default_int;
+			break;
+		  case CONFIG_TYPE_TRISTATE:
+			*(short *) field = (value != NULL)
+				? value_to_tristate(value, (o->name3rd != NULL) ? o->name3rd : "2", o->default_int)
+				: o->default_int;
+			break;
+		  case CONFIG_TYPE_INT:
+			*(long int *) field = (value != NULL)
+				? value_to_int(value, o->default_int)
+				: o->default_int;
+			break;
+		  case CONFIG_TYPE_FLOAT:
+			*(double *) field = (value != NULL)
+				? value_to_float(value, o->default_float)
+				: o->default_float;
+			break;
+		  case CONFIG_TYPE_STRING:
+			*(const char **) field = (value != NULL) ? value : o->default_string;
+			break;
+		  default:
+			report(RPT_ERR, "%s: invalid type of option %s", __FUNCTION__, o->keyname);
+			return -1;
 		}
 	}
-	return count;
+	return found;
 }
 
 
@@ -363,17 +408,81 @@ void config_clear(void)
 	}
 	/* Finally make everything inaccessible */
 	first_section = NULL;
+	last_section = NULL;
+	memset(sections, 0, sizeof(sections));
 }
 
 
 /**** INTERNAL FUNCTIONS ****/
 
+/** Hash a section or key name, ignoring case. */
+static unsigned int config_hash(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (*name != '\0')
+		hash = (hash << 5) + hash + (unsigned char) tolower((unsigned char) *name++);
+
+	return hash;
+}
+
+
+/** Interpret a value as a tristate (or a boolean if \c name3rd is \c NULL). */
+static short value_to_tristate(const char *value, const char *name3rd, short default_value)
+{
+	if ((strcasecmp(value, "0") == 0) || (strcasecmp(value, "false") == 0) ||
+	    (strcasecmp(value, "n") == 0) || (strcasecmp(value, "no") == 0) ||
+	    (strcasecmp(value, "off") == 0)) {
+		return 0;
+	}
+	if ((strcasecmp(value, "1") == 0) || (strcasecmp(value, "true") == 0) ||
+	    (strcasecmp(value, "y") == 0) || (strcasecmp(value, "yes") == 0) ||
+	    (strcasecmp(value, "on") == 0)) {
+		return 1;
+	}
+	if ((name3rd != NULL) &&
+	    ((strcasecmp(value, "2") == 0) || (strcasecmp(value, name3rd) == 0))) {
+		return 2;
+	}
+	return default_value;
+}
+
+
+/** Interpret a value as an integer. */
+static long int value_to_int(const char *value, long int default_value)
+{
+	char *end;
+	long int v = strtol(value, &end, 0);
+
+	if ((end != NULL) && (end != value) && (*end == '\0'))
+		/* Conversion successful */
+		return v;
+
+	return default_value;
+}
+
+
+/** Interpret a value as a floating point number. */
+static double value_to_float(const char *value, double default_value)
+{
+	char *end;
+	double v = strtod(value, &end);
+
+	if ((end != NULL) && (end != value) && (*end == '\0'))
+		/* Conversion successful*/
+		return v;
+
+	return default_value;
+}
+
+
 static ConfigSection *find_section(const char *sectionname)
 {
 	ConfigSection *s;
+	unsigned int hash = config_hash(sectionname);
 
-	for (s = first_section; s != NULL; s = s->next_section) {
-		if (strcasecmp(s->name, sectionname) == 0) {
+	for (s = sections[hash % CONFIG_SECTION_BUCKETS]; s != NULL; s = s->next_hash) {
+		if ((s->hash == hash) && (strcasecmp(s->name, sectionname) == 0)) {
 			return s;
 		}
 	}
@@ -383,68 +492,91 @@ static ConfigSection *find_section(const char *sectionname)
 
 static ConfigSection *add_section(const char *sectionname)
 {
-	ConfigSection *s;
-	ConfigSection **place = &first_section;
-
-	for (s = first_section; s != NULL; s = s->next_section)
-		place = &(s->next_section);
+	ConfigSection *s = (ConfigSection *) calloc(1, sizeof(ConfigSection));
 
-	*place = (ConfigSection *) malloc(sizeof(ConfigSection));
-	if (*place != NULL) {
-		(*place)->name = strdup(sectionname);
-		(*place)->first_key = NULL;
-		(*place)->next_section = NULL;
+	if (s != NULL) {
+		s->name = strdup(sectionname);
+		s->hash = config_hash(sectionname);
+
+		/* keep the order of the file ... */
+		if (last_section != NULL)
+			last_section->next_section = s;
+		else
+			first_section = s;
+		last_section = s;
+
+		/* ... and index by name */
+		s->next_hash = sections[s->hash % CONFIG_SECTION_BUCKETS];
+		sections[s->hash % CONFIG_SECTION_BUCKETS] = s;
 	}
 
-	return(*place);
+	return s;
 }
 
 
 static ConfigKey *find_key(ConfigSection *s, const char *keyname, int skip)
 {
 	ConfigKey *k;
-	int count = 0;
-	ConfigKey *last_key = NULL;
+	unsigned int hash;
 
 	/* Check for NULL section*/
 	if (s == NULL)
 		return NULL;
 
-	for (k = s->first_key; k != NULL; k = k->next_key) {
-
+	hash = config_hash(keyname);
+	for (k = s->keys[hash % CONFIG_KEY_BUCKETS]; k != NULL; k = k->next_hash) {
 		/* Did we find the right key ?*/
-		if (strcasecmp(k->name, keyname) == 0) {
-			if (count == skip)
-				return k;
-
-			count++;
-			last_key = k;
-		}
+		if ((k->hash == hash) && (strcasecmp(k->name, keyname) == 0))
+			break;
 	}
+	if (k == NULL)
+		return NULL; /* not found*/
+
 	if (skip == -1)
-		return last_key;
+		return k->last_value;
+
+	while ((k != NULL) && (skip-- > 0))
+		k = k->next_value;
 
-	return NULL; /* not found*/
+	return k;
 }
 
 
 static ConfigKey *add_key(ConfigSection *s, const char *keyname, const char *value)
 {
 	if (s != NULL) {
-		ConfigKey *k;
-		ConfigKey **place = &(s->first_key);
-
-		for (k = s->first_key; k != NULL; k = k->next_key)
-			place = &(k->next_key);
-
-		*place = (ConfigKey *) malloc(sizeof(ConfigKey));
-		if (*place != NULL) {
-			(*place)->name = strdup(keyname);
-			(*place)->value = strdup(value);
-			(*place)->next_key = NULL;
+		ConfigKey *k = (ConfigKey *) calloc(1, sizeof(ConfigKey));
+		ConfigKey *first;
+
+		if (k == NULL)
+			return NULL;
+
+		k->name = strdup(keyname);
+		k->value = strdup(value);
+		k->hash = config_hash(keyname);
+
+		/* keep the order of the file ... */
+		if (s->last_key != NULL)
+			s->last_key->next_key = k;
+		else
+			s->first_key = k;
+		s->last_key = k;
+
+		/* ... and index by name, appending further values to the first */
+		first = find_key(s, keyname, 0);
+		if (first != NULL) {
+			first->last_value->next_value = k;
+			first->last_value = k;
+			first->count++;
+		}
+		else {
+			k->last_value = k;
+			k->count = 1;
+			k->next_hash = s->keys[k->hash % CONFIG_KEY_BUCKETS];
+			s->keys[k->hash % CONFIG_KEY_BUCKETS] = k;
 		}
 
-		return(*place);
+		return k;
 	}
 	return NULL;
 }
@@ -19,6 +19,30 @@
 #include "config.h"
 #endif
 
+#include <stddef.h>
+
+/* Types of the values read by config_compile_section() */
+typedef enum {
+	CONFIG_TYPE_BOOL,	/* short, as by config_get_bool() */
+	CONFIG_TYPE_TRISTATE,	/* short, as by config_get_tristate() */
+	CONFIG_TYPE_INT,	/* long int, as by config_get_int() */
+	CONFIG_TYPE_FLOAT,	/* double, as by config_get_float() */
+	CONFIG_TYPE_STRING	/* const char *, as by config_get_string() */
+} ConfigType;
+
+/* Description of a key read by config_compile_section().
+ * The default matching the type is used if the key is missing or invalid.
+ */
+typedef struct _config_option {
+	const char *keyname;		/* name of the key, NULL ends the list */
+	ConfigType type;		/* type of the value */
+	size_t offset;			/* offsetof() the field in the structure */
+	long int default_int;		/* default for BOOL, TRISTATE and INT */
+	double default_float;		/* default for FLOAT */
+	const char *default_string;	/* default for STRING */
+	const char *name3rd;		/* name of the 3rd state for TRISTATE */
+} ConfigOption;
+
 /* Opens the specified file and reads everything into memory.
  * Returns 0  when config file was successfully parsed
  * Returns <0 on errors
@@ -99,6 +123,15 @@ int config_has_section(const char *sectionname);
  */
 int config_has_key(const char *sectionname, const char *keyname);
 
+/* Reads the values of all keys described by options from the section
+ * into the structure dest, looking up the section only once.
+ * Meant to be called once after the config was (re)read; string values
+ * stay valid until config_clear() is called.
+ * Returns the number of keys found, or <0 on errors.
+ */
+int config_compile_section(const char *sectionname, const ConfigOption *options,
+		void *dest);
+
 /* Clears all data stored by the config_read_* functions.
  * Should be called if the config should be reread.
  */
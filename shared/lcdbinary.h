@@ -0,0 +1,56 @@
+/** \file shared/lcdbinary.h
+ * Binary framing of client messages, negotiated with "hello binary".
+ *
+ * After LCDd answered "hello binary" with a connect message ending in the
+ * word "binary", everything the client sends is a sequence of frames:
+ *
+ *\verbatim
+ * +--------+--------+--------+----------------------------+
+ * | length (16 bit) | opcode | payload (length - 1 bytes) |
+ * +--------+--------+--------+----------------------------+
+ *\endverbatim
+ *
+ * All integers are in network byte order. The server keeps answering in
+ * the text protocol. widget_add replies "success <handle>" to binary
+ * clients; the handle addresses the widget in the LCDB_OP_WIDGET_* frames.
+ * These frames are not acknowledged; errors are reported with an
+ * "error <text>" message. A frame with an unknown opcode gets the reply
+ * "huh? Unknown opcode <n>", like a failing command.
+ */
+
+/*-
+ * This file is part of LCDproc.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef LCDBINARY_H
+#define LCDBINARY_H
+
+/** Size of the frame header: length and opcode */
+#define LCDB_HEADER_SIZE	3
+/** Max. length of a frame, including the header */
+#define LCDB_MAX_FRAME		1024
+/** Max. number of widget handles of a client */
+#define LCDB_MAX_HANDLES	65535
+
+/** A text protocol command (without newline) */
+#define LCDB_OP_COMMAND		0x01
+/** Set a string, title or scroller widget: handle, x, y (16 bit each), text */
+#define LCDB_OP_WIDGET_TEXT	0x02
+/** Set a bar, icon or num widget: handle, x, y (16 bit each), value (32 bit) */
+#define LCDB_OP_WIDGET_VALUE	0x03
+
+/** Read a 16 bit integer from a frame */
+#define LCDB_GET16(p)	((unsigned int) (((unsigned char *) (p))[0] << 8) | ((unsigned char *) (p))[1])
+/** Read a 32 bit integer from a frame */
+#define LCDB_GET32(p)	((int) (((unsigned long) LCDB_GET16(p) << 16) | LCDB_GET16((unsigned char *) (p) + 2)))
+/** Write a 16 bit integer to a frame */
+#define LCDB_PUT16(p, v)	do { ((unsigned char *) (p))[0] = ((v) >> 8) & 0xFF; \
+				     ((unsigned char *) (p))[1] = (v) & 0xFF; } while (0)
+/** Write a 32 bit integer to a frame */
+#define LCDB_PUT32(p, v)	do { LCDB_PUT16((p), ((unsigned long) (v)) >> 16); \
+				     LCDB_PUT16((unsigned char *) (p) + 2, (v)); } while (0)
+
+#endif
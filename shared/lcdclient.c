@@ -0,0 +1,909 @@
+/** \file shared/lcdclient.c
+ * Client side of the LCDproc protocol, shared by the bundled clients.
+ *
+ * Commands are collected in an output buffer and written with as few
+ * write() calls as possible. The clients do not wait for the reply to each
+ * command: replies are matched to the commands in the order they were sent,
+ * so errors can be reported (and optional reply handlers called) whenever
+ * they arrive. All other server messages are split into words in place and
+ * handed to the client's event handler.
+ */
+
+/*-
+ * This file is part of the LCDproc clients.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <poll.h>
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef HAVE_SHM_OPEN
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/socket.h>
+#endif
+
+#include "report.h"
+#include "sockets.h"
+#include "lcdclient.h"
+#include "lcdbinary.h"
+
+
+static int lcdc_read_input(LcdcConnection *conn);
+
+
+/**
+ * Connect to the server and create a connection object.
+ * \param host  Name or address of the server.
+ * \param port  Port the server listens on.
+ * \return  Pointer to the new connection, or NULL on error.
+ */
+LcdcConnection *
+lcdc_connect(char *host, unsigned short int port)
+{
+	LcdcConnection *conn;
+
+	if ((conn = calloc(1, sizeof(LcdcConnection))) == NULL) {
+		report(RPT_ERR, "%s: out of memory", __FUNCTION__);
+		return NULL;
+	}
+
+	conn->fd = sock_connect(host, port);
+	if (conn->fd < 0) {
+		free(conn);
+		return NULL;
+	}
+	conn->shm_fd = -1;
+
+	return conn;
+}
+
+
+/**
+ * Close the connection and free the connection object.
+ * Queued commands that were not flushed yet are discarded.
+ * \param conn  Connection to close.
+ */
+void
+lcdc_close(LcdcConnection *conn)
+{
+	if (conn == NULL)
+		return;
+
+#ifdef HAVE_SHM_OPEN
+	if (conn->shm != NULL)
+		munmap(conn->shm, conn->shm_size);
+#endif
+	if (conn->shm_fd >= 0)
+		close(conn->shm_fd);
+	sock_close(conn->fd);
+	free(conn->outbuf);
+	free(conn->pending);
+	free(conn);
+}
+
+
+/**
+ * Set the handler for server events.
+ * \param conn     Connection to set the handler for.
+ * \param handler  Event handler.
+ * \param data     Pointer passed on to the handler.
+ */
+void
+lcdc_set_handler(LcdcConnection *conn, LcdcEventFunc handler, void *data)
+{
+	conn->handler = handler;
+	conn->handler_data = data;
+}
+
+
+/**
+ * Remember a command that waits for its reply.
+ * \param conn  Connection the command is sent on.
+ * \param cmd   Command text (need not be terminated).
+ * \param len   Length of the command.
+ * \param func  Reply handler or NULL.
+ * \param data  Argument for the reply handler.
+ * \return  0 on success, -1 on error.
+ */
+static int
+lcdc_add_pending(LcdcConnection *conn, const char *cmd, int len,
+		 LcdcReplyFunc func, void *data)
+{
+	LcdcPending *p;
+
+	if (conn->pending_count == conn->pending_size) {
+		int newsize = (conn->pending_size > 0) ? 2 * conn->pending_size : 64;
+		LcdcPending *newpending = malloc(newsize * sizeof(LcdcPending));
+		int i;
+
+		if (newpending == NULL) {
+			report(RPT_ERR, "%s: out of memory", __FUNCTION__);
+			return -1;
+		}
+		/* unroll the ring into the new array */
+		for (i = 0; i < conn->pending_count; i++)
+			newpending[i] = conn->pending[(conn->pending_first + i) % conn->pending_size];
+		free(conn->pending);
+		conn->pending = newpending;
+		conn->pending_first = 0;
+		conn->pending_size = newsize;
+	}
+
+	p = &conn->pending[(conn->pending_first + conn->pending_count) % conn->pending_size];
+	p->func = func;
+	p->data = data;
+	if (len > LCDC_CMD_PREFIX)
+		len = LCDC_CMD_PREFIX;
+	memcpy(p->cmd, cmd, len);
+	p->cmd[len] = '\0';
+	conn->pending_count++;
+
+	return 0;
+}
+
+
+/**
+ * Make room for more data in the output buffer.
+ * \param conn  Connection to queue data on.
+ * \param len   Number of bytes to be added.
+ * \return  0 on success, -1 on error.
+ */
+static int
+lcdc_reserve(LcdcConnection *conn, int len)
+{
+	/* drop what a running flush has written already */
+	if ((conn->outoff > 0) && (conn->outlen + len > conn->outsize)) {
+		memmove(conn->outbuf, conn->outbuf + conn->outoff, conn->outlen - conn->outoff);
+		conn->outlen -= conn->outoff;
+		conn->outoff = 0;
+	}
+	if (conn->outlen + len > conn->outsize) {
+		int newsize = (conn->outsize > 0) ? conn->outsize : 1024;
+		char *newbuf;
+
+		while (newsize < conn->outlen + len)
+			newsize *= 2;
+		if ((newbuf = realloc(conn->outbuf, newsize)) == NULL) {
+			report(RPT_ERR, "%s: out of memory", __FUNCTION__);
+			return -1;
+		}
+		conn->outbuf = newbuf;
+		conn->outsize = newsize;
+	}
+	return 0;
+}
+
+
+/**
+ * Write the output buffer if it has grown large enough. Commands queued
+ * by handlers that run during a flush are left to that flush.
+ * \param conn  Connection to check.
+ * \return  0 on success, -1 on error.
+ */
+static int
+lcdc_flush_if_full(LcdcConnection *conn)
+{
+	if ((conn->outlen >= LCDC_FLUSH_THRESHOLD) && !conn->in_flush)
+		return lcdc_flush(conn);
+
+	return 0;
+}
+
+
+/**
+ * Append a binary frame to the output buffer.
+ * \param conn     Connection in binary mode.
+ * \param opcode   Opcode of the frame.
+ * \param payload  Payload of the frame.
+ * \param len      Length of the payload.
+ * \return  0 on success, -1 on error.
+ */
+static int
+lcdc_queue_frame(LcdcConnection *conn, int opcode, const char *payload, int len)
+{
+	char *p;
+
+	if (LCDB_HEADER_SIZE + len > LCDB_MAX_FRAME) {
+		report(RPT_ERR, "%s: frame too long", __FUNCTION__);
+		return -1;
+	}
+	if (lcdc_reserve(conn, LCDB_HEADER_SIZE + len) < 0)
+		return -1;
+
+	p = conn->outbuf + conn->outlen;
+	LCDB_PUT16(p, len + 1);
+	p[2] = opcode;
+	memcpy(p + LCDB_HEADER_SIZE, payload, len);
+	conn->outlen += LCDB_HEADER_SIZE + len;
+
+	return 0;
+}
+
+
+/**
+ * Append commands to the output buffer and register each of them as
+ * waiting for a reply. Empty lines are sent, but get no reply. In binary
+ * mode every line is sent as a command frame.
+ * \param conn  Connection to queue the commands on.
+ * \param text  One or more lines of commands.
+ * \param len   Length of text.
+ * \param func  Reply handler for the last command, or NULL.
+ * \param data  Argument for the reply handler.
+ * \return  0 on success, -1 on error.
+ */
+static int
+lcdc_queue(LcdcConnection *conn, const char *text, int len,
+	   LcdcReplyFunc func, void *data)
+{
+	const char *line, *end;
+
+	if (!conn->binary) {
+		if (lcdc_reserve(conn, len) < 0)
+			return -1;
+		memcpy(conn->outbuf + conn->outlen, text, len);
+		conn->outlen += len;
+	}
+
+	/* every non-empty line is a command the server replies to */
+	for (line = text; line < text + len; line = end + 1) {
+		end = memchr(line, '\n', text + len - line);
+		if (end == NULL)
+			end = text + len;
+		if (conn->binary) {
+			if (lcdc_queue_frame(conn, LCDB_OP_COMMAND, line, end - line) < 0)
+				return -1;
+		}
+		if (end > line) {
+			int last = (end + 1 >= text + len);
+
+			if (lcdc_add_pending(conn, line, end - line,
+					     last ? func : NULL, last ? data : NULL) < 0)
+				return -1;
+		}
+	}
+
+	return lcdc_flush_if_full(conn);
+}
+
+
+/**
+ * Queue printf-like formatted commands. They are written by lcdc_flush(),
+ * or earlier if the output buffer grows too large.
+ * \param conn    Connection to queue the commands on.
+ * \param format  printf-like format of one or more lines of commands.
+ * \return  0 on success, -1 on error.
+ */
+int
+lcdc_printf(LcdcConnection *conn, const char *format, .../*args*/)
+{
+	char buf[1024];
+	char *text = buf;
+	va_list ap;
+	int len, ret;
+
+	va_start(ap, format);
+	len = vsnprintf(buf, sizeof(buf), format, ap);
+	va_end(ap);
+	if (len < 0) {
+		report(RPT_ERR, "%s: vsnprintf failed", __FUNCTION__);
+		return -1;
+	}
+
+	if (len >= sizeof(buf)) {
+		if ((text = malloc(len + 1)) == NULL) {
+			report(RPT_ERR, "%s: out of memory", __FUNCTION__);
+			return -1;
+		}
+		va_start(ap, format);
+		vsnprintf(text, len + 1, format, ap);
+		va_end(ap);
+	}
+
+	ret = lcdc_queue(conn, text, len, NULL, NULL);
+
+	if (text != buf)
+		free(text);
+	return ret;
+}
+
+
+/**
+ * Queue lines of commands.
+ * \param conn    Connection to queue the commands on.
+ * \param string  One or more lines of commands.
+ * \return  0 on success, -1 on error.
+ */
+int
+lcdc_send_string(LcdcConnection *conn, const char *string)
+{
+	return lcdc_queue(conn, string, strlen(string), NULL, NULL);
+}
+
+
+/**
+ * Queue a single command and get called back when its reply arrives.
+ * \param conn    Connection to queue the command on.
+ * \param func    Reply handler.
+ * \param data    Argument for the reply handler.
+ * \param format  printf-like format of the command (without newline).
+ * \return  0 on success, -1 on error.
+ */
+int
+lcdc_command(LcdcConnection *conn, LcdcReplyFunc func, void *data, const char *format, .../*args*/)
+{
+	char buf[1024];
+	va_list ap;
+	int len;
+
+	va_start(ap, format);
+	len = vsnprintf(buf, sizeof(buf) - 1, format, ap);
+	va_end(ap);
+	if ((len < 0) || (len >= sizeof(buf) - 1)) {
+		report(RPT_ERR, "%s: command too long", __FUNCTION__);
+		return -1;
+	}
+	buf[len++] = '\n';
+
+	return lcdc_queue(conn, buf, len, func, data);
+}
+
+
+/**
+ * Write all queued commands. While the socket cannot take more data,
+ * server messages are read so the server never blocks on us. Commands the
+ * event and reply handlers queue meanwhile are written by the same loop;
+ * a flush called from a handler returns at once.
+ * \param conn  Connection to flush.
+ * \return  0 on success, -1 on error.
+ */
+int
+lcdc_flush(LcdcConnection *conn)
+{
+	int ret = 0;
+
+	if (conn->in_flush)
+		return 0;
+	conn->in_flush = 1;
+
+	while (conn->outoff < conn->outlen) {
+		int sent = write(conn->fd, conn->outbuf + conn->outoff, conn->outlen - conn->outoff);
+
+		if (sent > 0) {
+			conn->outoff += sent;
+		}
+		else if ((sent < 0) && ((errno == EAGAIN) || (errno == EINTR))) {
+			struct pollfd pfd;
+
+			pfd.fd = conn->fd;
+			pfd.events = POLLIN | POLLOUT;
+			if ((poll(&pfd, 1, -1) > 0) && (pfd.revents & POLLIN)) {
+				if (lcdc_read_input(conn) < 0) {
+					ret = -1;
+					break;
+				}
+			}
+		}
+		else {
+			report(RPT_ERR, "%s: socket write error", __FUNCTION__);
+			ret = -1;
+			break;
+		}
+	}
+	conn->outlen = 0;
+	conn->outoff = 0;
+	conn->in_flush = 0;
+
+	return ret;
+}
+
+
+/**
+ * Handle the reply to the oldest pending command.
+ * \param conn     Connection the reply was received on.
+ * \param success  Tell if the command succeeded.
+ * \param reply    Text of the reply.
+ */
+static void
+lcdc_reply(LcdcConnection *conn, int success, const char *reply)
+{
+	LcdcPending p;
+
+	if (conn->pending_count == 0) {
+		report(RPT_WARNING, "Unexpected reply from server: \"%s\"", reply);
+		return;
+	}
+
+	p = conn->pending[conn->pending_first];
+	conn->pending_first = (conn->pending_first + 1) % conn->pending_size;
+	conn->pending_count--;
+
+	if (!success) {
+		conn->errors++;
+		report(RPT_WARNING, "Server said: \"%s\" to \"%s\"", reply, p.cmd);
+	}
+	if (p.func != NULL)
+		p.func(conn, success, reply, p.data);
+}
+
+
+/**
+ * Map the shared memory segment the server created for us. Its file
+ * descriptor came with the reply.
+ * \param conn   Connection the segment belongs to.
+ * \param slots  Number of slots the server announced.
+ * \return  0 on success, -1 on error.
+ */
+static int
+lcdc_shm_map(LcdcConnection *conn, int slots)
+{
+#ifdef HAVE_SHM_OPEN
+	size_t size = LCDSHM_SIZE(slots);
+	LcdShmHeader *shm;
+	int fd = conn->shm_fd;
+
+	conn->shm_fd = -1;
+	if (fd < 0) {
+		report(RPT_ERR, "%s: no shared memory received", __FUNCTION__);
+		return -1;
+	}
+	if ((slots <= 0) || (slots > LCDSHM_MAX_SLOTS)) {
+		close(fd);
+		return -1;
+	}
+
+	shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED) {
+		report(RPT_ERR, "%s: mmap failed: %s", __FUNCTION__, strerror(errno));
+		return -1;
+	}
+	if ((shm->magic != LCDSHM_MAGIC) || (shm->version != LCDSHM_VERSION) ||
+	    (shm->slot_size != sizeof(LcdShmSlot)) || (shm->slots != slots)) {
+		report(RPT_ERR, "%s: segment has an unknown layout", __FUNCTION__);
+		munmap(shm, size);
+		return -1;
+	}
+
+	if (conn->shm != NULL)
+		munmap(conn->shm, conn->shm_size);
+	conn->shm = shm;
+	conn->shm_size = size;
+	conn->shm_slots = slots;
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+
+/**
+ * Read from the server. A file descriptor the server passes along (the
+ * shared memory segment) is kept in the connection.
+ * \param conn    Connection to read from.
+ * \param buf     Buffer for the data.
+ * \param size    Size of the buffer.
+ * \return  Number of bytes read, 0 at end of file, -1 on error.
+ */
+static int
+lcdc_recv(LcdcConnection *conn, char *buf, size_t size)
+{
+#ifdef HAVE_SHM_OPEN
+	union {
+		struct cmsghdr hdr;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} control;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct iovec iov;
+	int len;
+
+	iov.iov_base = buf;
+	iov.iov_len = size;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	len = recvmsg(conn->fd, &msg, 0);
+	if (len < 0)
+		return len;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS) &&
+		    (cmsg->cmsg_len == CMSG_LEN(sizeof(int)))) {
+			if (conn->shm_fd >= 0)
+				close(conn->shm_fd);
+			memcpy(&conn->shm_fd, CMSG_DATA(cmsg), sizeof(int));
+		}
+	}
+	return len;
+#else
+	return read(conn->fd, buf, size);
+#endif
+}
+
+
+/**
+ * Split a server message into words in place.
+ * \param line  Message; spaces are replaced by NUL characters.
+ * \param argv  Array receiving pointers to the words.
+ * \return  Number of words.
+ */
+static int
+lcdc_split(char *line, char **argv)
+{
+	int argc = 0;
+
+	while (*line != '\0') {
+		while (*line == ' ')
+			*line++ = '\0';
+		if (*line == '\0')
+			break;
+		if (argc == LCDC_MAX_ARGS)
+			break;
+		argv[argc++] = line;
+		while ((*line != ' ') && (*line != '\0'))
+			line++;
+	}
+
+	return argc;
+}
+
+
+/**
+ * Dispatch a single server message.
+ * \param conn  Connection the message was received on.
+ * \param line  Message without newline; it is modified.
+ */
+static void
+lcdc_dispatch(LcdcConnection *conn, char *line)
+{
+	char *argv[LCDC_MAX_ARGS];
+	int argc;
+
+	debug(RPT_DEBUG, "Server said: \"%s\"", line);
+
+	if (strncmp(line, "huh?", 4) == 0) {
+		lcdc_reply(conn, 0, line);
+		return;
+	}
+	if ((strncmp(line, "success", 7) == 0) && ((line[7] == '\0') || (line[7] == ' '))) {
+		/* widget_add answers binary clients with "success <handle>" */
+		lcdc_reply(conn, 1, line);
+		return;
+	}
+
+	argc = lcdc_split(line, argv);
+	if (argc < 1)
+		return;
+
+	if (strcmp(argv[0], "connect") == 0) {
+		int a;
+
+		for (a = 1; a < argc - 1; a++) {
+			if (strcmp(argv[a], "wid") == 0)
+				conn->wid = atoi(argv[++a]);
+			else if (strcmp(argv[a], "hgt") == 0)
+				conn->hgt = atoi(argv[++a]);
+			else if (strcmp(argv[a], "cellwid") == 0)
+				conn->cellwid = atoi(argv[++a]);
+			else if (strcmp(argv[a], "cellhgt") == 0)
+				conn->cellhgt = atoi(argv[++a]);
+			else if (strcmp(argv[a], "protocol") == 0)
+				sscanf(argv[++a], "%d.%d", &conn->protocol_major, &conn->protocol_minor);
+		}
+		if (strcmp(argv[argc - 1], "binary") == 0)
+			conn->binary = 1;
+		conn->connected = 1;
+		lcdc_reply(conn, 1, argv[0]);
+	}
+	else if ((strcmp(argv[0], "listen") == 0) ||
+		 (strcmp(argv[0], "ignore") == 0) ||
+		 (strcmp(argv[0], "key") == 0) ||
+		 (strcmp(argv[0], "menuevent") == 0) ||
+		 (strcmp(argv[0], "bye") == 0) ||
+		 (strcmp(argv[0], "error") == 0) ||
+		 (conn->pending_count == 0)) {
+		if (conn->handler != NULL)
+			conn->handler(conn, argc, argv, conn->handler_data);
+	}
+	else if ((strcmp(argv[0], "shm") == 0) && (argc >= 2)) {
+		lcdc_reply(conn, lcdc_shm_map(conn, atoi(argv[1])) == 0, argv[0]);
+	}
+	else if (strcmp(argv[0], "sleeping") == 0) {
+		; /* progress message of the sleep command, the reply follows */
+	}
+	else {
+		/* any other reply, e.g. to noop or info */
+		lcdc_reply(conn, 1, argv[0]);
+	}
+}
+
+
+/**
+ * Read available server messages into the input buffer and dispatch all
+ * complete ones.
+ * \param conn  Connection to read from.
+ * \return  Number of messages dispatched, or -1 on error or end of file.
+ */
+static int
+lcdc_read_input(LcdcConnection *conn)
+{
+	int count = 0;
+
+	while (1) {
+		char *line, *end;
+		int len = lcdc_recv(conn, conn->inbuf + conn->inlen,
+				    sizeof(conn->inbuf) - 1 - conn->inlen);
+
+		if (len < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR))
+				return count;
+			report(RPT_ERR, "%s: socket read error", __FUNCTION__);
+			return -1;
+		}
+		if (len == 0)
+			return -1;
+
+		conn->inlen += len;
+		conn->inbuf[conn->inlen] = '\0';
+
+		/* dispatch all complete lines */
+		line = conn->inbuf;
+		while ((end = memchr(line, '\n', conn->inbuf + conn->inlen - line)) != NULL) {
+			*end = '\0';
+			if (end > line)
+				lcdc_dispatch(conn, line);
+			line = end + 1;
+			count++;
+		}
+
+		/* keep an incomplete line for the next read */
+		conn->inlen -= line - conn->inbuf;
+		if ((conn->inlen == sizeof(conn->inbuf) - 1) && (line == conn->inbuf)) {
+			report(RPT_WARNING, "%s: server message too long, discarded", __FUNCTION__);
+			conn->inlen = 0;
+		}
+		memmove(conn->inbuf, line, conn->inlen);
+	}
+}
+
+
+/**
+ * Read and dispatch all available server messages without waiting.
+ * \param conn  Connection to read from.
+ * \return  Number of messages dispatched, or -1 on error or end of file.
+ */
+int
+lcdc_process_input(LcdcConnection *conn)
+{
+	return lcdc_read_input(conn);
+}
+
+
+/**
+ * Flush queued commands, then wait for server messages for at most timeout
+ * milliseconds and dispatch them.
+ * \param conn     Connection to wait on.
+ * \param timeout  Max. time to wait in ms; negative to wait indefinitely.
+ * \return  Number of messages dispatched (0 on timeout), or -1 on error.
+ */
+int
+lcdc_wait(LcdcConnection *conn, int timeout)
+{
+	struct pollfd pfd;
+	int ret;
+
+	if (lcdc_flush(conn) < 0)
+		return -1;
+
+	pfd.fd = conn->fd;
+	pfd.events = POLLIN;
+	ret = poll(&pfd, 1, timeout);
+	if (ret < 0)
+		return (errno == EINTR) ? 0 : -1;
+	if (ret == 0)
+		return 0;
+
+	return lcdc_read_input(conn);
+}
+
+
+/**
+ * Send a hello command and wait for the server's connect message.
+ * \param conn     Connection to the server.
+ * \param hello    The hello command.
+ * \param timeout  Max. time to wait in ms.
+ * \return  0 on success, -1 on error or timeout.
+ */
+static int
+lcdc_say_hello(LcdcConnection *conn, const char *hello, int timeout)
+{
+	if (lcdc_send_string(conn, hello) < 0)
+		return -1;
+
+	while (!conn->connected && (timeout > 0)) {
+		if (lcdc_wait(conn, 100) < 0)
+			return -1;
+		timeout -= 100;
+	}
+
+	if (!conn->connected) {
+		report(RPT_ERR, "Did not receive LCDd connect response.");
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * Say hello to the server and wait for its connect message, which tells
+ * the display size and protocol version.
+ * \param conn     Connection to the server.
+ * \param timeout  Max. time to wait in ms.
+ * \return  0 on success, -1 on error or timeout.
+ */
+int
+lcdc_hello(LcdcConnection *conn, int timeout)
+{
+	return lcdc_say_hello(conn, "hello\n", timeout);
+}
+
+
+/**
+ * Like lcdc_hello(), but ask the server for binary frames. If the server
+ * agrees, conn->binary is set: all commands are sent as frames from then
+ * on, widget_add replies carry the widget's handle, and lcdc_widget_text()
+ * and lcdc_widget_value() can be used. Older servers simply stay in text
+ * mode.
+ * \param conn     Connection to the server.
+ * \param timeout  Max. time to wait in ms.
+ * \return  0 on success, -1 on error or timeout.
+ */
+int
+lcdc_hello_binary(LcdcConnection *conn, int timeout)
+{
+	return lcdc_say_hello(conn, "hello binary\n", timeout);
+}
+
+
+/**
+ * Queue a binary update of a string, title or scroller widget. The server
+ * does not reply unless the update fails.
+ * \param conn    Connection in binary mode.
+ * \param handle  Handle of the widget, as returned by widget_add.
+ * \param x       Column (string widgets only).
+ * \param y       Row (string widgets only).
+ * \param text    New text.
+ * \return  0 on success, -1 on error.
+ */
+int
+lcdc_widget_text(LcdcConnection *conn, int handle, int x, int y, const char *text)
+{
+	char payload[LCDB_MAX_FRAME];
+	int len = strlen(text);
+
+	if (!conn->binary)
+		return -1;
+	if (LCDB_HEADER_SIZE + 6 + len > LCDB_MAX_FRAME)
+		len = LCDB_MAX_FRAME - LCDB_HEADER_SIZE - 6;
+
+	LCDB_PUT16(payload, handle);
+	LCDB_PUT16(payload + 2, x);
+	LCDB_PUT16(payload + 4, y);
+	memcpy(payload + 6, text, len);
+	if (lcdc_queue_frame(conn, LCDB_OP_WIDGET_TEXT, payload, 6 + len) < 0)
+		return -1;
+
+	return lcdc_flush_if_full(conn);
+}
+
+
+/**
+ * Queue a binary update of a bar, icon or num widget. The server does not
+ * reply unless the update fails.
+ * \param conn    Connection in binary mode.
+ * \param handle  Handle of the widget, as returned by widget_add.
+ * \param x       Column.
+ * \param y       Row.
+ * \param value   Length, promille, icon or number.
+ * \return  0 on success, -1 on error.
+ */
+int
+lcdc_widget_value(LcdcConnection *conn, int handle, int x, int y, int value)
+{
+	char payload[10];
+
+	if (!conn->binary)
+		return -1;
+
+	LCDB_PUT16(payload, handle);
+	LCDB_PUT16(payload + 2, x);
+	LCDB_PUT16(payload + 4, y);
+	LCDB_PUT32(payload + 6, value);
+	if (lcdc_queue_frame(conn, LCDB_OP_WIDGET_VALUE, payload, sizeof(payload)) < 0)
+		return -1;
+
+	return lcdc_flush_if_full(conn);
+}
+
+
+/** Reply handler of the shm_open command. */
+static void
+lcdc_shm_reply(LcdcConnection *conn, int success, const char *reply, void *data)
+{
+	*(int *) data = success ? 1 : -1;
+}
+
+
+/**
+ * Ask the server for a shared memory segment and map it. Widgets bound to
+ * its slots with the widget_shm command are then updated with
+ * lcdc_shm_set() instead of widget_set. The server passes the segment
+ * over the Unix domain socket only.
+ * \param conn     Connection to the server.
+ * \param slots    Number of slots.
+ * \param timeout  Max. time to wait for the server in ms.
+ * \return  0 on success, -1 if shared memory is not available.
+ */
+int
+lcdc_shm_open(LcdcConnection *conn, int slots, int timeout)
+{
+	int result = 0;
+
+	if (lcdc_command(conn, lcdc_shm_reply, &result, "shm_open %d", slots) < 0)
+		return -1;
+
+	while ((result == 0) && (timeout > 0)) {
+		if (lcdc_wait(conn, 100) < 0)
+			return -1;
+		timeout -= 100;
+	}
+
+	return (result > 0) ? 0 : -1;
+}
+
+
+/**
+ * Write a widget value to a slot of the shared memory segment. The server
+ * picks it up when it renders the widget next.
+ * \param conn   Connection with a mapped segment.
+ * \param slot   Index of the slot.
+ * \param value  Value of bar and num widgets.
+ * \param text   Text of string, title and scroller widgets, or NULL.
+ */
+void
+lcdc_shm_set(LcdcConnection *conn, int slot, int value, const char *text)
+{
+	LcdShmSlot *s;
+
+	if ((conn->shm == NULL) || (slot < 0) || (slot >= conn->shm_slots))
+		return;
+
+	s = &conn->shm->slot[slot];
+	s->seq++;
+	lcdshm_barrier();
+	s->value = value;
+	if (text != NULL) {
+		strncpy(s->text, text, LCDSHM_TEXT_SIZE - 1);
+		s->text[LCDSHM_TEXT_SIZE - 1] = '\0';
+	}
+	lcdshm_barrier();
+	s->seq++;
+}
+
+/* EOF */
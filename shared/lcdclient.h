@@ -0,0 +1,130 @@
+/** \file shared/lcdclient.h
+ * Client side of the LCDproc protocol, shared by the bundled clients.
+ */
+
+/*-
+ * This file is part of the LCDproc clients.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef LCDCLIENT_H
+#define LCDCLIENT_H
+
+#include <stddef.h>
+#include "lcdshm.h"
+
+/** Size of the buffer for incoming server messages */
+#define LCDC_INBUF_SIZE		8192
+/** Queued commands are written early if they exceed this size */
+#define LCDC_FLUSH_THRESHOLD	4096
+/** Max. number of arguments of a server message passed to the handler */
+#define LCDC_MAX_ARGS		20
+/** Number of characters of a command kept to report server errors */
+#define LCDC_CMD_PREFIX		40
+
+struct lcdc_connection;
+
+/**
+ * Event handler, called for every message of the server that is not the
+ * reply to a command: listen, ignore, key, menuevent, bye, ...
+ * \param conn  Connection the message was received on.
+ * \param argc  Number of words of the message.
+ * \param argv  Words of the message. They point into the connection's input
+ *              buffer and are only valid during the call.
+ * \param data  Pointer given to lcdc_set_handler().
+ */
+typedef void (*LcdcEventFunc)(struct lcdc_connection *conn, int argc, char **argv, void *data);
+
+/**
+ * Reply handler, called when the reply to a command arrives.
+ * \param conn     Connection the reply was received on.
+ * \param success  1 for "success" (or any other non-error reply), 0 for "huh?".
+ * \param reply    Full text of the reply.
+ * \param data     Pointer given when the command was sent.
+ */
+typedef void (*LcdcReplyFunc)(struct lcdc_connection *conn, int success, const char *reply, void *data);
+
+/** A command waiting for its reply */
+typedef struct lcdc_pending {
+	LcdcReplyFunc func;			/**< Reply handler or NULL */
+	void *data;				/**< Argument for the reply handler */
+	char cmd[LCDC_CMD_PREFIX + 1];		/**< Start of the command text */
+} LcdcPending;
+
+/** Connection to LCDd */
+typedef struct lcdc_connection {
+	int fd;			/**< Socket connected to the server */
+
+	char *outbuf;		/**< Commands waiting to be written */
+	int outlen;		/**< Number of bytes in outbuf */
+	int outsize;		/**< Allocated size of outbuf */
+	int outoff;		/**< Number of bytes of outbuf already written */
+	int in_flush;		/**< lcdc_flush() is running */
+
+	char inbuf[LCDC_INBUF_SIZE];	/**< Incomplete server messages */
+	int inlen;		/**< Number of bytes in inbuf */
+
+	LcdcPending *pending;	/**< Ring of commands waiting for their replies */
+	int pending_first;	/**< Index of the oldest pending command */
+	int pending_count;	/**< Number of pending commands */
+	int pending_size;	/**< Allocated number of pending entries */
+
+	LcdcEventFunc handler;	/**< Event handler */
+	void *handler_data;	/**< Argument for the event handler */
+
+	int connected;		/**< Tell if the connect message was received */
+	int binary;		/**< Commands are sent as binary frames */
+	int wid;		/**< Display width in characters */
+	int hgt;		/**< Display height in characters */
+	int cellwid;		/**< Character cell width in pixels */
+	int cellhgt;		/**< Character cell height in pixels */
+	int protocol_major;	/**< Major protocol version of the server */
+	int protocol_minor;	/**< Minor protocol version of the server */
+
+	unsigned long errors;	/**< Number of commands rejected by the server */
+
+	LcdShmHeader *shm;	/**< Shared memory segment for widget values, or NULL */
+	size_t shm_size;	/**< Size of the mapped segment */
+	int shm_slots;		/**< Number of slots of the segment */
+	int shm_fd;		/**< Segment received with the shm reply, or -1 */
+} LcdcConnection;
+
+
+/** Connect to the server and create a connection object */
+LcdcConnection *lcdc_connect(char *host, unsigned short int port);
+/** Close the connection and free the connection object */
+void lcdc_close(LcdcConnection *conn);
+/** Set the handler for server events */
+void lcdc_set_handler(LcdcConnection *conn, LcdcEventFunc handler, void *data);
+/** Say hello and wait for the server's connect message */
+int lcdc_hello(LcdcConnection *conn, int timeout);
+/** Say hello, asking for binary frames, and wait for the connect message */
+int lcdc_hello_binary(LcdcConnection *conn, int timeout);
+
+/** Queue printf-like formatted commands */
+int lcdc_printf(LcdcConnection *conn, const char *format, .../*args*/);
+/** Queue lines of commands */
+int lcdc_send_string(LcdcConnection *conn, const char *string);
+/** Queue a single command and get called back when its reply arrives */
+int lcdc_command(LcdcConnection *conn, LcdcReplyFunc func, void *data, const char *format, .../*args*/);
+/** Write all queued commands */
+int lcdc_flush(LcdcConnection *conn);
+
+/** Read and dispatch all available server messages */
+int lcdc_process_input(LcdcConnection *conn);
+/** Wait for server messages for at most timeout ms and dispatch them */
+int lcdc_wait(LcdcConnection *conn, int timeout);
+
+/** Get a shared memory segment for widget values from the server */
+int lcdc_shm_open(LcdcConnection *conn, int slots, int timeout);
+/** Queue a binary update of a string, title or scroller widget */
+int lcdc_widget_text(LcdcConnection *conn, int handle, int x, int y, const char *text);
+/** Queue a binary update of a bar, icon or num widget */
+int lcdc_widget_value(LcdcConnection *conn, int handle, int x, int y, int value);
+
+/** Write a widget value to a slot of the shared memory segment */
+void lcdc_shm_set(LcdcConnection *conn, int slot, int value, const char *text);
+
+#endif
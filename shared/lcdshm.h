@@ -0,0 +1,56 @@
+/** \file shared/lcdshm.h
+ * Layout of the shared memory segment LCDd hands out with the \c shm_open
+ * command. A client writes widget values into the slots of the segment and
+ * LCDd picks them up when it renders the widgets bound to the slots with
+ * \c widget_shm, without any protocol traffic.
+ *
+ * Each slot is protected by a sequence counter: the writer increments it
+ * before and after changing the slot, so it is odd while an update is in
+ * progress. The reader copies the slot and retries if the counter changed
+ * meanwhile.
+ */
+
+/*-
+ * This file is part of LCDproc.
+ *
+ * This file is released under the GNU General Public License.
+ * Refer to the COPYING file distributed with this package.
+ */
+
+#ifndef LCDSHM_H
+#define LCDSHM_H
+
+#include <stdint.h>
+
+/** Magic number at the start of a segment ("LCDs") */
+#define LCDSHM_MAGIC		0x4c434473
+/** Version of the segment layout */
+#define LCDSHM_VERSION		1
+/** Size of the text of a slot, including the terminating NUL */
+#define LCDSHM_TEXT_SIZE	120
+/** Max. number of slots of a segment */
+#define LCDSHM_MAX_SLOTS	1024
+
+/** Full memory barrier around the sequence counter updates */
+#define lcdshm_barrier()	__sync_synchronize()
+
+/** A widget value */
+typedef struct lcdshm_slot {
+	volatile uint32_t seq;		/**< Sequence counter, odd while written */
+	int32_t value;			/**< Length / promille / number of bars and num widgets */
+	char text[LCDSHM_TEXT_SIZE];	/**< Text of string, title and scroller widgets */
+} LcdShmSlot;
+
+/** Start of a segment, followed by the slots */
+typedef struct lcdshm_header {
+	uint32_t magic;			/**< LCDSHM_MAGIC */
+	uint32_t version;		/**< LCDSHM_VERSION */
+	uint32_t slots;			/**< Number of slots */
+	uint32_t slot_size;		/**< sizeof(LcdShmSlot) */
+	LcdShmSlot slot[];		/**< The slots */
+} LcdShmHeader;
+
+/** Size of a segment with the given number of slots */
+#define LCDSHM_SIZE(slots)	(sizeof(LcdShmHeader) + (slots) * sizeof(LcdShmSlot))
+
+#endif
@@ -60,10 +60,48 @@ sock_init_sockaddr (sockaddr_in *name, const char *hostname, unsigned short int
 	return 0;
 }
 
+/**
+ * Connect to a server listening on a Unix domain socket.
+ * \param path  File name of the socket
+ * \return  socket file descriptor on success, -1 on error
+ */
+static int
+sock_connect_unix (const char *path)
+{
+	struct sockaddr_un servername;
+	int sock;
+
+	if (strlen (path) >= sizeof (servername.sun_path)) {
+		report (RPT_ERR, "sock_connect: Socket name %s too long", path);
+		return -1;
+	}
+
+	sock = socket (PF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0) {
+		report (RPT_ERR, "sock_connect: Error creating socket");
+		return sock;
+	}
+
+	memset (&servername, '\0', sizeof (servername));
+	servername.sun_family = AF_UNIX;
+	strcpy (servername.sun_path, path);
+
+	if (connect (sock, (struct sockaddr *) &servername, sizeof (servername)) < 0) {
+		report (RPT_ERR, "sock_connect: connect to %s failed", path);
+		close (sock);
+		return -1;
+	}
+
+	fcntl (sock, F_SETFL, O_NONBLOCK);
+
+	return sock;
+}
+
 /**
  * Connect to server.
- * \param host  Hostname or IP-address
- * \param port  Port number
+ * \param host  Hostname or IP-address, or the absolute file name of the
+ *              server's Unix domain socket
+ * \param port  Port number (ignored for Unix domain sockets)
  * \return  socket file descriptor on success, -1 on error
  */
 int
@@ -73,6 +111,9 @@ sock_connect (char *host, unsigned short int port)
 	int sock;
 	int err = 0;
 
+	if (host[0] == '/')
+		return sock_connect_unix (host);
+
 	report (RPT_DEBUG, "sock_connect: Creating socket");
 	sock = socket (PF_INET, SOCK_STREAM, 0);
 	if (sock < 0) {
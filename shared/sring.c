@@ -199,26 +199,18 @@ sring_read(sring_buffer *buf, char *dst, int dst_len)
 }
 
 /**
- * Return the next string from the ring buffer.
- * The next string is a sequence of bytes terminated by \\r, \\n or \\0. The
- * memory for the string is allocated dynamically and must be free'd by the
- * application. The string is always NUL terminated, but does not include the
- * end character.
+ * Get the length of the next string in the ring buffer.
  *
  * \param buf  Ring buffer to work on
- * \return     Pointer to allocated string, NULL if no string is available
+ * \return     Number of bytes up to and including the end character, 0 if
+ *             no complete string is available
  */
-char *
-sring_read_string(sring_buffer *buf)
+static int
+sring_string_length(sring_buffer *buf)
 {
 	int n;
 	char *border;
 	char *p;
-	char *dst;
-	int dst_len;
-
-	if (buf == NULL)
-		return NULL;
 
 	n = sring_getMaxRead(buf);
 	border = buf->data + buf->size;
@@ -233,9 +225,34 @@ sring_read_string(sring_buffer *buf)
 	};
 
 	if (n == -1)
+		return 0;
+
+	return sring_getMaxRead(buf) - n;
+}
+
+/**
+ * Return the next string from the ring buffer.
+ * The next string is a sequence of bytes terminated by \\r, \\n or \\0. The
+ * memory for the string is allocated dynamically and must be free'd by the
+ * application. The string is always NUL terminated, but does not include the
+ * end character.
+ *
+ * \param buf  Ring buffer to work on
+ * \return     Pointer to allocated string, NULL if no string is available
+ */
+char *
+sring_read_string(sring_buffer *buf)
+{
+	char *dst;
+	int dst_len;
+
+	if (buf == NULL)
+		return NULL;
+
+	dst_len = sring_string_length(buf);
+	if (dst_len == 0)
 		return NULL;
 
-	dst_len = sring_getMaxRead(buf) - n;
 	if ((dst = malloc(dst_len)) == NULL)
 		return NULL;
 
@@ -245,6 +262,37 @@ sring_read_string(sring_buffer *buf)
 	return dst;
 }
 
+/**
+ * Copy the next string from the ring buffer to a buffer of the caller.
+ * Like sring_read_string(), but without allocating memory.
+ *
+ * \param buf       Ring buffer to work on
+ * \param dst       Buffer for the string
+ * \param dst_size  Size of \c dst; a string that does not fit is left in
+ *                  the ring buffer
+ * \return          Length of the string including its NUL, 0 if no string is
+ *                  available, -1 if it does not fit
+ */
+int
+sring_read_line(sring_buffer *buf, char *dst, int dst_size)
+{
+	int dst_len;
+
+	if ((buf == NULL) || (dst == NULL))
+		return -1;
+
+	dst_len = sring_string_length(buf);
+	if (dst_len == 0)
+		return 0;
+	if (dst_len > dst_size)
+		return -1;
+
+	sring_read(buf, dst, dst_len);
+	dst[dst_len-1] = '\0';
+
+	return dst_len;
+}
+
 /**
  * Print content of buffer to stdout.
  * Only enabled, if DEBUG is defined.
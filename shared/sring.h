@@ -17,6 +17,7 @@ int  sring_getMaxRead(sring_buffer *buf);
 int  sring_write(sring_buffer *buf, char *src, int src_len);
 int  sring_read(sring_buffer *buf, char *dst, int dst_len);
 char* sring_read_string(sring_buffer *buf);
+int  sring_read_line(sring_buffer *buf, char *dst, int dst_size);
 void sring_dump(sring_buffer *buf);
 
 #endif